@@ -0,0 +1,477 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reader.h"
+#include "codegen.h"
+#include "error.h"
+
+extern SymTab* symtab;
+extern Token* currentToken;
+
+CodeBlock* codeBlock;
+
+static void emitted(int ok) {
+  if (!ok)
+    error(ERR_CODE_TOO_LONG, currentToken->lineNo, currentToken->colNo);
+}
+
+void initCodeBuffer(void) {
+  codeBlock = createCodeBlock(CODE_SIZE);
+}
+
+void printCodeBuffer(void) {
+  printCodeBlock(codeBlock);
+}
+
+void cleanCodeBuffer(void) {
+  freeCodeBlock(codeBlock);
+}
+
+int serialize(char* fileName) {
+  FILE* f = fopen(fileName, "wb");
+  int ok;
+
+  if (f == NULL) return IO_ERROR;
+  ok = saveCode(codeBlock, f);
+  ok = (fclose(f) == 0) && ok;
+  return ok ? IO_SUCCESS : IO_ERROR;
+}
+
+/******************************************************************/
+
+CodeMark markCode(void) {
+  CodeMark mark;
+
+  mark.address = codeBlock->codeSize;
+  mark.constantCount = codeBlock->constantCount;
+  mark.frameSize = symtab->currentScope->frameSize;
+  return mark;
+}
+
+void rewindCode(CodeMark* mark) {
+  codeBlock->codeSize = mark->address;
+  codeBlock->constantCount = mark->constantCount;
+  symtab->currentScope->frameSize = mark->frameSize;
+}
+
+CodeAddress getCurrentCodeAddress(void) {
+  return codeBlock->codeSize;
+}
+
+void updateJ(CodeAddress jump, CodeAddress label) {
+  codeBlock->code[jump].q = label;
+}
+
+void updateINT(CodeAddress increment, int size) {
+  codeBlock->code[increment].q = size;
+}
+
+// Number of static links from the current scope out to scope
+static int computeNestedLevel(Scope* scope) {
+  int level = 0;
+  Scope* tmp = symtab->currentScope;
+
+  while (tmp != scope) {
+    tmp = tmp->outer;
+    level ++;
+  }
+  return level;
+}
+
+static int sizeOfParams(ObjectNode* paramList) {
+  int size = 0;
+
+  for (; paramList != NULL; paramList = paramList->next) {
+    if (paramList->object->paramAttrs->kind == PARAM_REFERENCE)
+      size += INT_SIZE;
+    else
+      size += sizeOfType(paramList->object->paramAttrs->type);
+  }
+  return size;
+}
+
+int isPredefinedFunction(Object* func) {
+  return findObject(symtab->globalObjectList, func->name) == func;
+}
+
+int isPredefinedProcedure(Object* proc) {
+  return findObject(symtab->globalObjectList, proc->name) == proc;
+}
+
+/******************************************************************/
+
+void genVariableAddress(Object* var) {
+  genLA(computeNestedLevel(var->varAttrs->scope), var->varAttrs->localOffset);
+}
+
+static void genValue(int level, int offset, Type* type) {
+  if (type->typeClass == TP_DOUBLE)
+    emitted(emitLVF(codeBlock, level, offset));
+  else
+    genLV(level, offset);
+}
+
+void genVariableValue(Object* var) {
+  genValue(computeNestedLevel(var->varAttrs->scope), var->varAttrs->localOffset, var->varAttrs->type);
+}
+
+void genParameterAddress(Object* param) {
+  int level = computeNestedLevel(param->paramAttrs->scope);
+
+  if (param->paramAttrs->kind == PARAM_REFERENCE)
+    genLV(level, param->paramAttrs->localOffset);
+  else
+    genLA(level, param->paramAttrs->localOffset);
+}
+
+void genParameterValue(Object* param) {
+  int level = computeNestedLevel(param->paramAttrs->scope);
+
+  if (param->paramAttrs->kind == PARAM_REFERENCE) {
+    genLV(level, param->paramAttrs->localOffset);
+    genLoad(param->paramAttrs->type);
+  } else
+    genValue(level, param->paramAttrs->localOffset, param->paramAttrs->type);
+}
+
+void genTemporaryValue(int offset, Type* type) {
+  genValue(0, offset, type);
+}
+
+// Words of the type that hold strings: all of them or none
+static int stringWords(Type* type) {
+  int count = 1;
+
+  while (type->typeClass == TP_ARRAY) {
+    count *= type->arraySize;
+    type = type->elementType;
+  }
+  return (type->typeClass == TP_STRING) ? count : 0;
+}
+
+// Stores the empty string in the count words from offset on
+static void genEmptyStrings(int offset, int count, int empty) {
+  int index;
+  CodeAddress loop;
+
+  if (count == 1) {
+    genLA(0, offset);
+    emitted(emitLS(codeBlock, empty));
+    genST();
+    return;
+  }
+
+  index = declareTemporary(INT_SIZE);
+  genLA(0, index);
+  genLC(0);
+  genST();
+  loop = getCurrentCodeAddress();
+  genLA(0, offset);
+  genLV(0, index);
+  genAD();
+  emitted(emitLS(codeBlock, empty));
+  genST();
+  genLA(0, index);
+  genLV(0, index);
+  genLC(1);
+  genAD();
+  genST();
+  genLC(count);
+  genLV(0, index);
+  genLE();
+  genFJ(loop);
+}
+
+void genStringDefaults(Scope* scope) {
+  ObjectNode* node;
+  Object* owner = scope->owner;
+  int empty = addStringConstant(codeBlock, "");
+  int count;
+
+  if ((owner->kind == OBJ_FUNCTION) && (owner->funcAttrs->returnType->typeClass == TP_STRING))
+    genEmptyStrings(owner->funcAttrs->returnOffset, 1, empty);
+  for (node = scope->objList; node != NULL; node = node->next)
+    if (node->object->kind == OBJ_VARIABLE) {
+      count = stringWords(node->object->varAttrs->type);
+      if (count > 0)
+        genEmptyStrings(node->object->varAttrs->localOffset, count, empty);
+    }
+}
+
+void genReturnValueAddress(Object* func) {
+  genLA(computeNestedLevel(func->funcAttrs->scope), func->funcAttrs->returnOffset);
+}
+
+void genReturnValue(Object* func) {
+  genValue(computeNestedLevel(func->funcAttrs->scope), func->funcAttrs->returnOffset, func->funcAttrs->returnType);
+}
+
+void genPredefinedProcedureCall(Object* proc) {
+  if (strcmp(proc->name, "WRITEI") == 0)
+    emitted(emitWRI(codeBlock));
+  else if (strcmp(proc->name, "WRITEC") == 0)
+    emitted(emitWRC(codeBlock));
+  else if (strcmp(proc->name, "WRITES") == 0)
+    emitted(emitWRS(codeBlock));
+  else if (strcmp(proc->name, "WRITEF") == 0)
+    emitted(emitWRF(codeBlock));
+  else if (strcmp(proc->name, "WRITELN") == 0)
+    emitted(emitWLN(codeBlock));
+}
+
+void genPredefinedFunctionCall(Object* func) {
+  if (strcmp(func->name, "READC") == 0)
+    emitted(emitRC(codeBlock));
+  else if (strcmp(func->name, "READI") == 0)
+    emitted(emitRI(codeBlock));
+}
+
+void genProcedureCall(Object* proc) {
+  genDCT(RESERVED_WORDS + sizeOfParams(proc->procAttrs->paramList));
+  emitted(emitCALL(codeBlock, computeNestedLevel(proc->procAttrs->scope->outer),
+		   proc->procAttrs->codeAddress));
+}
+
+void genFunctionCall(Object* func) {
+  genDCT(RESERVED_WORDS + sizeOfParams(func->funcAttrs->paramList));
+  emitted(emitCALL(codeBlock, computeNestedLevel(func->funcAttrs->scope->outer),
+		   func->funcAttrs->codeAddress));
+}
+
+/******************************************************************/
+
+void genConstant(ConstantValue* value) {
+  switch (value->type) {
+  case TP_INT:
+    genLC(value->intValue);
+    break;
+  case TP_CHAR:
+    genLC((unsigned char) value->charValue);
+    break;
+  case TP_DOUBLE:
+    emitted(emitLCF(codeBlock, addDoubleConstant(codeBlock, value->doubleValue)));
+    break;
+  case TP_STRING:
+    emitted(emitLS(codeBlock, addStringConstant(codeBlock, value->stringValue)));
+    break;
+  default:
+    break;
+  }
+}
+
+void genLoad(Type* type) {
+  if (type->typeClass == TP_DOUBLE)
+    emitted(emitLIF(codeBlock));
+  else
+    genLI();
+}
+
+void genStore(Type* type) {
+  if (type->typeClass == TP_DOUBLE)
+    emitted(emitSTF(codeBlock));
+  else
+    genST();
+}
+
+void genConversion(Type* target, Type* source) {
+  if ((target->typeClass == TP_DOUBLE) && (source->typeClass == TP_INT))
+    emitted(emitITF(codeBlock));
+}
+
+// The index is on top of the address of the array
+void genIndex(Type* elementType) {
+  genLC(sizeOfType(elementType));
+  emitted(emitML(codeBlock));
+  genAD();
+}
+
+void genNegation(Type* type) {
+  if (type->typeClass == TP_DOUBLE)
+    emitted(emitNEGF(codeBlock));
+  else
+    emitted(emitNEG(codeBlock));
+}
+
+void genAddition(Type* type) {
+  switch (type->typeClass) {
+  case TP_DOUBLE:
+    emitted(emitADF(codeBlock));
+    break;
+  case TP_STRING:
+    emitted(emitCAT(codeBlock));
+    break;
+  default:
+    genAD();
+    break;
+  }
+}
+
+void genSubtraction(Type* type) {
+  if (type->typeClass == TP_DOUBLE)
+    emitted(emitSBF(codeBlock));
+  else
+    emitted(emitSB(codeBlock));
+}
+
+void genMultiplication(Type* type) {
+  if (type->typeClass == TP_DOUBLE)
+    emitted(emitMLF(codeBlock));
+  else
+    emitted(emitML(codeBlock));
+}
+
+void genDivision(Type* type) {
+  if (type->typeClass == TP_DOUBLE)
+    emitted(emitDVF(codeBlock));
+  else
+    emitted(emitDV(codeBlock));
+}
+
+// Strings are compared through the sign of CMPS
+void genComparison(TokenType comparator, Type* type) {
+  int isDouble = (type->typeClass == TP_DOUBLE);
+
+  if (type->typeClass == TP_STRING) {
+    emitted(emitCMPS(codeBlock));
+    genLC(0);
+  }
+  switch (comparator) {
+  case SB_EQ:
+    emitted(isDouble ? emitEQF(codeBlock) : emitEQ(codeBlock));
+    break;
+  case SB_NEQ:
+    emitted(isDouble ? emitNEF(codeBlock) : emitNE(codeBlock));
+    break;
+  case SB_LE:
+    emitted(isDouble ? emitLEF(codeBlock) : emitLE(codeBlock));
+    break;
+  case SB_LT:
+    emitted(isDouble ? emitLTF(codeBlock) : emitLT(codeBlock));
+    break;
+  case SB_GE:
+    emitted(isDouble ? emitGEF(codeBlock) : emitGE(codeBlock));
+    break;
+  case SB_GT:
+    emitted(isDouble ? emitGTF(codeBlock) : emitGT(codeBlock));
+    break;
+  default:
+    break;
+  }
+}
+
+// result := 1; while exponent > 0 do (result := result * base; exponent := exponent - 1),
+// with the three in locals of the current frame
+void genPower(int base, int exponent, int result) {
+  CodeAddress loop, done;
+
+  genLA(0, result);
+  genLC(1);
+  genST();
+  loop = getCurrentCodeAddress();
+  genLV(0, exponent);
+  genLC(0);
+  emitted(emitGT(codeBlock));
+  done = genFJ(DC_VALUE);
+  genLA(0, result);
+  genLV(0, result);
+  genLV(0, base);
+  emitted(emitML(codeBlock));
+  genST();
+  genLA(0, exponent);
+  genLV(0, exponent);
+  genLC(1);
+  emitted(emitSB(codeBlock));
+  genST();
+  genJ(loop);
+  updateJ(done, getCurrentCodeAddress());
+  genLV(0, result);
+}
+
+CodeAddress genBreak(CodeAddress chain) {
+  return genJ(chain);
+}
+
+void updateBreaks(CodeAddress chain, CodeAddress label) {
+  CodeAddress next;
+
+  while (chain != NO_LABEL) {
+    next = codeBlock->code[chain].q;
+    updateJ(chain, label);
+    chain = next;
+  }
+}
+
+/******************************************************************/
+
+void genLA(int level, int offset) {
+  emitted(emitLA(codeBlock, level, offset));
+}
+
+void genLV(int level, int offset) {
+  emitted(emitLV(codeBlock, level, offset));
+}
+
+void genLC(WORD constant) {
+  emitted(emitLC(codeBlock, constant));
+}
+
+void genLI(void) {
+  emitted(emitLI(codeBlock));
+}
+
+CodeAddress genINT(int delta) {
+  emitted(emitINT(codeBlock, delta));
+  return codeBlock->codeSize - 1;
+}
+
+void genDCT(int delta) {
+  emitted(emitDCT(codeBlock, delta));
+}
+
+CodeAddress genJ(CodeAddress label) {
+  emitted(emitJ(codeBlock, label));
+  return codeBlock->codeSize - 1;
+}
+
+CodeAddress genFJ(CodeAddress label) {
+  emitted(emitFJ(codeBlock, label));
+  return codeBlock->codeSize - 1;
+}
+
+void genHL(void) {
+  emitted(emitHL(codeBlock));
+}
+
+void genST(void) {
+  emitted(emitST(codeBlock));
+}
+
+void genCV(void) {
+  emitted(emitCV(codeBlock));
+}
+
+void genAD(void) {
+  emitted(emitAD(codeBlock));
+}
+
+void genLE(void) {
+  emitted(emitLE(codeBlock));
+}
+
+void genEP(void) {
+  emitted(emitEP(codeBlock));
+}
+
+void genEF(Object* func) {
+  if (func->funcAttrs->returnType->typeClass == TP_DOUBLE)
+    emitted(emitEFF(codeBlock, func->funcAttrs->returnOffset));
+  else
+    emitted(emitEF(codeBlock));
+}
@@ -0,0 +1,95 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __CODEGEN_H__
+#define __CODEGEN_H__
+
+#include "instructions.h"
+#include "symtab.h"
+
+#define CODE_SIZE (1 << 20)
+// A label not met yet, and the end of a chain of BREAK jumps
+#define NO_LABEL -1
+
+void initCodeBuffer(void);
+void printCodeBuffer(void);
+void cleanCodeBuffer(void);
+int serialize(char* fileName);
+
+// A point of the code to come back to, dropping all generated after it
+// with its constants and temporaries
+struct CodeMark_ {
+  CodeAddress address;
+  int constantCount;
+  int frameSize;
+};
+
+typedef struct CodeMark_ CodeMark;
+
+CodeMark markCode(void);
+void rewindCode(CodeMark* mark);
+
+CodeAddress getCurrentCodeAddress(void);
+void updateJ(CodeAddress jump, CodeAddress label);
+void updateINT(CodeAddress increment, int size);
+
+int isPredefinedFunction(Object* func);
+int isPredefinedProcedure(Object* proc);
+
+void genVariableAddress(Object* var);
+void genVariableValue(Object* var);
+void genParameterAddress(Object* param);
+void genParameterValue(Object* param);
+void genReturnValueAddress(Object* func);
+void genReturnValue(Object* func);
+// The STRING variables of the scope, and the result of a function that
+// returns one, start as the empty string instead of what the stack held
+void genStringDefaults(Scope* scope);
+// Of a local made by declareTemporary
+void genTemporaryValue(int offset, Type* type);
+
+void genPredefinedProcedureCall(Object* proc);
+void genPredefinedFunctionCall(Object* func);
+// After INT RESERVED_WORDS and the arguments
+void genProcedureCall(Object* proc);
+void genFunctionCall(Object* func);
+
+// Typed forms: the double and string instructions where the type needs them
+void genConstant(ConstantValue* value);
+void genLoad(Type* type);
+void genStore(Type* type);
+void genConversion(Type* target, Type* source);
+void genIndex(Type* elementType);
+void genNegation(Type* type);
+void genAddition(Type* type);
+void genSubtraction(Type* type);
+void genMultiplication(Type* type);
+void genDivision(Type* type);
+void genComparison(TokenType comparator, Type* type);
+void genPower(int base, int exponent, int result);
+
+// BREAKs jump to the end of their statement; until it is known, the
+// jumps are chained through their operands
+CodeAddress genBreak(CodeAddress chain);
+void updateBreaks(CodeAddress chain, CodeAddress label);
+
+void genLA(int level, int offset);
+void genLV(int level, int offset);
+void genLC(WORD constant);
+void genLI(void);
+CodeAddress genINT(int delta);
+void genDCT(int delta);
+CodeAddress genJ(CodeAddress label);
+CodeAddress genFJ(CodeAddress label);
+void genHL(void);
+void genST(void);
+void genCV(void);
+void genAD(void);
+void genLE(void);
+void genEP(void);
+void genEF(Object* func);
+
+#endif
@@ -0,0 +1,1034 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir.h"
+#include "verifier.h"
+
+#define UNKNOWN -1
+
+// Nothing falls through these
+static int endsFlow(enum OpCode op) {
+  return (op == OP_J) || (op == OP_HL) || (op == OP_EP) || (op == OP_EF) || (op == OP_EFF) ||
+    (op == OP_TC);
+}
+
+static void* grow(void* array, int* capacity, int count, int size) {
+  if (count < *capacity)
+    return array;
+  *capacity = (*capacity == 0) ? 8 : 2 * *capacity;
+  return realloc(array, *capacity * size);
+}
+
+void instructionEffect(IRProgram* program, Instruction* inst, int* need, int* delta) {
+  stackEffect(inst, need, delta);
+  if (inst->op == OP_CALL) {
+    // The frame of the callee is already off the stack; only its result stays
+    *need = 0;
+    switch (program->functions[inst->q]->returnKind) {
+    case RETURN_EF: *delta = 1; break;
+    case RETURN_EFF: *delta = DOUBLE_SIZE; break;
+    default: *delta = 0; break;
+    }
+  }
+}
+
+/******************************************************************/
+
+static IRFunction* createFunction(int address, int level, int returnKind) {
+  IRFunction* function = (IRFunction*) malloc(sizeof(IRFunction));
+
+  function->object = NULL;
+  function->address = address;
+  function->level = level;
+  function->returnKind = returnKind;
+  function->localSize = 0;
+  function->blocks = NULL;
+  function->blockCount = 0;
+  function->blockCapacity = 0;
+  function->analysed = 0;
+  function->order = NULL;
+  function->orderCount = 0;
+  function->scalar = NULL;
+  function->values = NULL;
+  function->valueCount = 0;
+  function->valueCapacity = 0;
+  return function;
+}
+
+IRBlock* insertBlock(IRFunction* function, int position) {
+  IRBlock* block = (IRBlock*) malloc(sizeof(IRBlock));
+  int i;
+
+  block->address = -1;
+  block->height = 0;
+  block->code = NULL;
+  block->length = 0;
+  block->capacity = 0;
+  block->next = NULL;
+  block->target = NULL;
+  block->preds = NULL;
+  block->predCount = 0;
+  block->idom = NULL;
+  block->order = -1;
+  block->phis = NULL;
+  block->phiCount = 0;
+
+  function->blocks = (IRBlock**) grow(function->blocks, &function->blockCapacity,
+				      function->blockCount, sizeof(IRBlock*));
+  memmove(function->blocks + position + 1, function->blocks + position,
+	  (function->blockCount - position) * sizeof(IRBlock*));
+  function->blocks[position] = block;
+  function->blockCount ++;
+  for (i = position; i < function->blockCount; i ++)
+    function->blocks[i]->id = i;
+  return block;
+}
+
+void moveBlock(IRFunction* function, IRBlock* block, int position) {
+  int i;
+
+  if (position > block->id) {
+    position --;
+    memmove(function->blocks + block->id, function->blocks + block->id + 1,
+	    (position - block->id) * sizeof(IRBlock*));
+  } else
+    memmove(function->blocks + position + 1, function->blocks + position,
+	    (block->id - position) * sizeof(IRBlock*));
+  function->blocks[position] = block;
+  for (i = 0; i < function->blockCount; i ++)
+    function->blocks[i]->id = i;
+}
+
+int addLocal(IRFunction* function) {
+  int slot = function->localSize;
+  IRBlock* block;
+  IRInstruction* ir;
+  int found = 0;
+  int i, k;
+
+  // The INT that makes the frame is the only one the stack is empty for
+  for (i = 0; (i < function->blockCount) && !found; i ++) {
+    block = function->blocks[i];
+    if (block->height != 0) continue;
+    for (k = 0; (k < block->length) && !found; k ++) {
+      ir = block->code + k;
+      if (!ir->deleted && (ir->inst.op == OP_INT)) {
+	ir->inst.q ++;
+	found = 1;
+      }
+    }
+  }
+  for (i = 0; i < function->blockCount; i ++)
+    if (function->blocks[i]->height >= slot)
+      function->blocks[i]->height ++;
+  function->localSize ++;
+  return slot;
+}
+
+IRInstruction* insertInstruction(IRBlock* block, int index, Instruction inst) {
+  IRInstruction* instruction;
+
+  block->code = (IRInstruction*) grow(block->code, &block->capacity, block->length, sizeof(IRInstruction));
+  memmove(block->code + index + 1, block->code + index, (block->length - index) * sizeof(IRInstruction));
+  block->length ++;
+  instruction = block->code + index;
+  instruction->inst = inst;
+  instruction->deleted = 0;
+  instruction->slot = NO_SLOT;
+  instruction->value = NO_VALUE;
+  instruction->pair = -1;
+  return instruction;
+}
+
+void deleteInstruction(IRInstruction* instruction) {
+  instruction->deleted = 1;
+  instruction->slot = NO_SLOT;
+  instruction->value = NO_VALUE;
+  instruction->pair = -1;
+}
+
+static Scope* scopeOf(Object* object) {
+  switch (object->kind) {
+  case OBJ_FUNCTION: return object->funcAttrs->scope;
+  case OBJ_PROCEDURE: return object->procAttrs->scope;
+  case OBJ_PROGRAM: return object->progAttrs->scope;
+  default: return NULL;
+  }
+}
+
+static void attachObjects(IRProgram* program, Scope* scope) {
+  ObjectNode* node;
+  Object* object;
+  int address, i;
+
+  for (node = scope->objList; node != NULL; node = node->next) {
+    object = node->object;
+    if (object->kind == OBJ_FUNCTION)
+      address = object->funcAttrs->codeAddress;
+    else if (object->kind == OBJ_PROCEDURE)
+      address = object->procAttrs->codeAddress;
+    else continue;
+    // Those never called have no code left
+    for (i = 0; i < program->functionCount; i ++)
+      if (program->functions[i]->address == address)
+	program->functions[i]->object = object;
+    attachObjects(program, scopeOf(object));
+  }
+}
+
+static void addOuterSlot(IRProgram* program, int level, int slot) {
+  program->outerLevels[program->outerCount] = level;
+  program->outerSlots[program->outerCount] = slot;
+  program->outerCount ++;
+}
+
+IRProgram* buildProgram(CodeBlock* codeBlock, Object* programObject) {
+  Instruction* code = codeBlock->code;
+  int n = codeBlock->codeSize;
+  IRProgram* program;
+  IRFunction* function;
+  IRBlock* block;
+  IRBlock** blockAt;
+  Instruction* inst;
+  CodeInfo info;
+  int* indexOf;
+  char* leader;
+  int errorPc, pc, i, j;
+
+  if (analyseCode(codeBlock, &info, &errorPc) != VERIFY_OK) {
+    freeCodeInfo(&info);
+    return NULL;
+  }
+
+  program = (IRProgram*) malloc(sizeof(IRProgram));
+  program->codeBlock = codeBlock;
+  program->functions = (IRFunction**) malloc(n * sizeof(IRFunction*));
+  program->functionCount = 0;
+  program->main = 0;
+  // LVF reaches two words
+  program->outerLevels = (int*) malloc(2 * n * sizeof(int));
+  program->outerSlots = (int*) malloc(2 * n * sizeof(int));
+  program->outerCount = 0;
+
+  indexOf = (int*) malloc(n * sizeof(int));
+  blockAt = (IRBlock**) calloc(n, sizeof(IRBlock*));
+  leader = (char*) calloc(n, 1);
+
+  for (pc = 0; pc < n; pc ++) {
+    indexOf[pc] = UNKNOWN;
+    if (info.level[pc] != UNKNOWN) {
+      if (pc == codeBlock->entry)
+	program->main = program->functionCount;
+      indexOf[pc] = program->functionCount;
+      program->functions[program->functionCount++] =
+	createFunction(pc, info.level[pc], info.returnKind[pc]);
+    }
+  }
+
+  for (pc = 0; pc < n; pc ++) {
+    if (info.owner[pc] == UNKNOWN) continue;
+    inst = code + pc;
+    if (pc == info.owner[pc])
+      leader[pc] = 1;
+    if ((inst->op == OP_J) || (inst->op == OP_FJ))
+      leader[inst->q] = 1;
+    if (((inst->op == OP_FJ) || endsFlow(inst->op)) && (pc + 1 < n))
+      leader[pc + 1] = 1;
+    if (((inst->op == OP_LA) || (inst->op == OP_LV) || (inst->op == OP_LVF)) && (inst->p > 0)) {
+      addOuterSlot(program, info.level[info.owner[pc]] - inst->p, inst->q);
+      if (inst->op == OP_LVF)
+	addOuterSlot(program, info.level[info.owner[pc]] - inst->p, inst->q + 1);
+    }
+  }
+
+  for (pc = 0; pc < n; pc ++) {
+    if (info.owner[pc] == UNKNOWN) continue;
+    function = program->functions[indexOf[info.owner[pc]]];
+    if (leader[pc]) {
+      block = insertBlock(function, function->blockCount);
+      block->address = pc;
+      block->height = info.height[pc];
+    } else block = blockAt[pc - 1];
+    blockAt[pc] = block;
+    insertInstruction(block, block->length, code[pc]);
+    if ((info.height[pc] > 0) && ((function->localSize == 0) || (info.height[pc] < function->localSize)))
+      function->localSize = info.height[pc];
+  }
+
+  for (i = 0; i < program->functionCount; i ++) {
+    function = program->functions[i];
+    for (j = 0; j < function->blockCount; j ++) {
+      block = function->blocks[j];
+      pc = block->address + block->length - 1;
+      inst = code + pc;
+      if ((inst->op == OP_J) || (inst->op == OP_FJ))
+	block->target = blockAt[inst->q];
+      if (!endsFlow(inst->op))
+	block->next = blockAt[pc + 1];
+    }
+  }
+
+  for (i = 0; i < program->functionCount; i ++) {
+    function = program->functions[i];
+    for (j = 0; j < function->blockCount; j ++) {
+      block = function->blocks[j];
+      for (pc = 0; pc < block->length; pc ++)
+	if ((block->code[pc].inst.op == OP_CALL) || (block->code[pc].inst.op == OP_TC))
+	  block->code[pc].inst.q = indexOf[block->code[pc].inst.q];
+    }
+  }
+
+  if (programObject != NULL) {
+    program->functions[program->main]->object = programObject;
+    attachObjects(program, scopeOf(programObject));
+  }
+
+  free(indexOf);
+  free(blockAt);
+  free(leader);
+  freeCodeInfo(&info);
+  return program;
+}
+
+static void clearAnalysis(IRFunction* function) {
+  IRBlock* block;
+  int i;
+
+  for (i = 0; i < function->blockCount; i ++) {
+    block = function->blocks[i];
+    free(block->preds);
+    free(block->phis);
+    block->preds = NULL;
+    block->predCount = 0;
+    block->phis = NULL;
+    block->phiCount = 0;
+    block->idom = NULL;
+    block->order = -1;
+  }
+  for (i = 0; i < function->valueCount; i ++)
+    free(function->values[i].operands);
+  free(function->values);
+  free(function->order);
+  free(function->scalar);
+  function->values = NULL;
+  function->valueCount = 0;
+  function->valueCapacity = 0;
+  function->order = NULL;
+  function->orderCount = 0;
+  function->scalar = NULL;
+  function->analysed = 0;
+}
+
+void freeProgram(IRProgram* program) {
+  IRFunction* function;
+  int i, j;
+
+  for (i = 0; i < program->functionCount; i ++) {
+    function = program->functions[i];
+    clearAnalysis(function);
+    for (j = 0; j < function->blockCount; j ++) {
+      free(function->blocks[j]->code);
+      free(function->blocks[j]);
+    }
+    free(function->blocks);
+    free(function);
+  }
+  free(program->functions);
+  free(program->outerLevels);
+  free(program->outerSlots);
+  free(program);
+}
+
+/******************************************************************/
+
+static IRBlock* successor(IRBlock* block, int k) {
+  return (k == 0) ? block->next : block->target;
+}
+
+// Reverse postorder of the blocks reached from the entry
+static void orderBlocks(IRFunction* function) {
+  IRBlock** stack = (IRBlock**) malloc(function->blockCount * sizeof(IRBlock*));
+  int* cursor = (int*) calloc(function->blockCount, sizeof(int));
+  char* seen = (char*) calloc(function->blockCount, 1);
+  IRBlock* block;
+  IRBlock* succ;
+  int top = 0;
+  int count = 0;
+  int i;
+
+  function->order = (IRBlock**) malloc(function->blockCount * sizeof(IRBlock*));
+  stack[top++] = function->blocks[0];
+  seen[0] = 1;
+  while (top > 0) {
+    block = stack[top - 1];
+    if (cursor[block->id] < 2) {
+      succ = successor(block, cursor[block->id]++);
+      if ((succ != NULL) && !seen[succ->id]) {
+	seen[succ->id] = 1;
+	stack[top++] = succ;
+      }
+    } else {
+      function->order[count++] = block;
+      top --;
+    }
+  }
+
+  for (i = 0; i < count / 2; i ++) {
+    block = function->order[i];
+    function->order[i] = function->order[count - 1 - i];
+    function->order[count - 1 - i] = block;
+  }
+  for (i = 0; i < count; i ++)
+    function->order[i]->order = i;
+  function->orderCount = count;
+
+  free(stack);
+  free(cursor);
+  free(seen);
+}
+
+static void linkPredecessors(IRFunction* function) {
+  IRBlock* block;
+  IRBlock* succ;
+  int i, k;
+
+  for (i = 0; i < function->orderCount; i ++)
+    for (k = 0; k < 2; k ++)
+      if ((succ = successor(function->order[i], k)) != NULL)
+	succ->predCount ++;
+  for (i = 0; i < function->orderCount; i ++) {
+    block = function->order[i];
+    block->preds = (IRBlock**) malloc((block->predCount + 1) * sizeof(IRBlock*));
+    block->predCount = 0;
+  }
+  for (i = 0; i < function->orderCount; i ++)
+    for (k = 0; k < 2; k ++)
+      if ((succ = successor(function->order[i], k)) != NULL)
+	succ->preds[succ->predCount++] = function->order[i];
+}
+
+static IRBlock* intersect(IRBlock* a, IRBlock* b) {
+  while (a != b) {
+    while (a->order > b->order) a = a->idom;
+    while (b->order > a->order) b = b->idom;
+  }
+  return a;
+}
+
+// Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm"
+static void findDominators(IRFunction* function) {
+  IRBlock* entry = function->order[0];
+  IRBlock* block;
+  IRBlock* idom;
+  int changed = 1;
+  int i, k;
+
+  entry->idom = entry;
+  while (changed) {
+    changed = 0;
+    for (i = 1; i < function->orderCount; i ++) {
+      block = function->order[i];
+      idom = NULL;
+      for (k = 0; k < block->predCount; k ++)
+	if (block->preds[k]->idom != NULL)
+	  idom = (idom == NULL) ? block->preds[k] : intersect(block->preds[k], idom);
+      if (block->idom != idom) {
+	block->idom = idom;
+	changed = 1;
+      }
+    }
+  }
+  entry->idom = NULL;
+}
+
+int dominates(IRBlock* dominator, IRBlock* block) {
+  for (; block != NULL; block = block->idom)
+    if (block == dominator)
+      return 1;
+  return 0;
+}
+
+// Words of the stack that hold no address of a local, or that no path has reached yet
+#define NOT_ADDRESS -1
+#define NOT_REACHED -2
+
+// Whether the DCT at index pops the frame of a CALL rather than words nothing uses
+static int popsFrame(IRBlock* block, int index) {
+  for (index ++; index < block->length; index ++)
+    if (!block->code[index].deleted)
+      return block->code[index].inst.op == OP_CALL;
+  return 0;
+}
+
+/*
+ * Finds the scalars by following which words of the stack hold the
+ * address of a local, from block to block: an LA 0,x pushes one, and a
+ * CV of one pushes it again, which is how FOR keeps its variable on the
+ * stack.  The instruction that pushed the word is paired with the ST that
+ * writes through it or the LI that reads through it, when they are in the
+ * same block; an ST may also write through a word an earlier block left,
+ * as around the loop of a power.  Dropping the word is harmless too.  A local whose address goes anywhere else, or whose
+ * address only some of the paths into a block leave in a word, is given
+ * away.
+ */
+static void findScalars(IRProgram* program, IRFunction* function) {
+  int size = function->localSize;
+  char* escaped = (char*) calloc(size + 1, 1);
+  char* accessed = (char*) calloc(size + 1, 1);
+  int** entry = (int**) calloc(function->blockCount, sizeof(int*));
+  int* slotAt = NULL;
+  int* pushedBy = NULL;
+  int capacity = 0;
+  int slotCapacity = 0;
+  IRBlock* block;
+  IRBlock* succ;
+  IRInstruction* ir;
+  Instruction* inst;
+  int changed, i, b, k, s, h, pos, need, delta, slot;
+
+#define ESCAPE(slot) if (((slot) >= 0) && ((slot) < size)) escaped[slot] = 1
+
+  for (k = 0; k < program->outerCount; k ++)
+    if (program->outerLevels[k] == function->level)
+      ESCAPE(program->outerSlots[k]);
+
+  for (b = 0; b < function->orderCount; b ++) {
+    block = function->order[b];
+    entry[block->id] = (int*) malloc((block->height + 1) * sizeof(int));
+    for (pos = 0; pos < block->height; pos ++)
+      entry[block->id][pos] = (b == 0) ? NOT_ADDRESS : NOT_REACHED;
+  }
+
+  do {
+    changed = 0;
+    for (b = 0; b < function->orderCount; b ++) {
+      block = function->order[b];
+      h = block->height;
+      while ((capacity < h + 1) || (slotCapacity < h + 1)) {
+	pushedBy = (int*) grow(pushedBy, &capacity, capacity, sizeof(int));
+	slotAt = (int*) grow(slotAt, &slotCapacity, slotCapacity, sizeof(int));
+      }
+      for (pos = 0; pos < h; pos ++) {
+	slotAt[pos] = (entry[block->id][pos] >= 0) ? entry[block->id][pos] : NOT_ADDRESS;
+	pushedBy[pos] = -1;
+      }
+
+      for (i = 0; i < block->length; i ++) {
+	ir = block->code + i;
+	ir->slot = NO_SLOT;
+	ir->value = NO_VALUE;
+	ir->pair = -1;
+	if (ir->deleted) continue;
+	inst = &ir->inst;
+	instructionEffect(program, inst, &need, &delta);
+	while ((capacity < h + delta + 1) || (slotCapacity < h + delta + 1)) {
+	  pushedBy = (int*) grow(pushedBy, &capacity, capacity, sizeof(int));
+	  slotAt = (int*) grow(slotAt, &slotCapacity, slotCapacity, sizeof(int));
+	}
+
+	if ((inst->op == OP_CV) && (h > 0) && (slotAt[h - 1] >= 0)) {
+	  slotAt[h] = slotAt[h - 1];
+	  pushedBy[h] = i;
+	  ir->slot = slotAt[h];
+	  h ++;
+	  continue;
+	}
+
+	for (pos = h - need; pos < h; pos ++)
+	  if ((pos >= 0) && (slotAt[pos] >= 0)) {
+	    k = pushedBy[pos];
+	    if ((k >= 0) && (((inst->op == OP_ST) && (pos == h - 2)) || (inst->op == OP_LI))) {
+	      block->code[k].pair = i;
+	      ir->pair = k;
+	      if (inst->op == OP_LI)
+		ir->slot = slotAt[pos];
+	    } else if ((inst->op == OP_ST) && (pos == h - 2))
+	      ir->slot = slotAt[pos];
+	    else if ((inst->op != OP_DCT) || popsFrame(block, i))
+	      ESCAPE(slotAt[pos]);
+	  }
+	for (pos = h - need; pos < h + delta; pos ++)
+	  if (pos >= 0) {
+	    slotAt[pos] = NOT_ADDRESS;
+	    pushedBy[pos] = -1;
+	  }
+
+	if (((inst->op == OP_LA) || (inst->op == OP_LV)) && (inst->p == 0) && (inst->q >= 0) && (inst->q < size))
+	  accessed[inst->q] = 1;
+	if ((inst->op == OP_LA) && (inst->p == 0)) {
+	  slotAt[h] = inst->q;
+	  pushedBy[h] = i;
+	  ir->slot = inst->q;
+	}
+	if (((inst->op == OP_LVF) && (inst->p == 0)) || (inst->op == OP_EFF)) {
+	  ESCAPE(inst->q);
+	  ESCAPE(inst->q + 1);
+	}
+	h += delta;
+      }
+
+      // What the words hold goes on to the blocks that follow
+      for (s = 0; s < 2; s ++) {
+	if (((succ = successor(block, s)) == NULL) || (succ->height != h)) continue;
+	for (pos = 0; pos < h; pos ++) {
+	  slot = entry[succ->id][pos];
+	  if (slot == slotAt[pos]) continue;
+	  if (slot == NOT_REACHED) {
+	    entry[succ->id][pos] = slotAt[pos];
+	    changed = 1;
+	  } else {
+	    ESCAPE(slot);
+	    ESCAPE(slotAt[pos]);
+	    if (slot != NOT_ADDRESS) {
+	      entry[succ->id][pos] = NOT_ADDRESS;
+	      changed = 1;
+	    }
+	  }
+	}
+      }
+    }
+  } while (changed);
+#undef ESCAPE
+
+  // The words of an array past the first are only reached through its address
+  function->scalar = (char*) calloc(size + 1, 1);
+  for (k = FRAME_HEADER_SIZE; k < size; k ++)
+    function->scalar[k] = accessed[k] && !escaped[k];
+
+  for (b = 0; b < function->orderCount; b ++) {
+    block = function->order[b];
+    for (i = 0; i < block->length; i ++) {
+      ir = block->code + i;
+      inst = &ir->inst;
+      if (ir->deleted) continue;
+      if ((inst->op == OP_LV) && (inst->p == 0) && (inst->q >= 0) && (inst->q < size) && function->scalar[inst->q])
+	ir->slot = inst->q;
+      // An ST through an address that a block before it pushed
+      if ((inst->op == OP_ST) && (ir->pair < 0) && (ir->slot != NO_SLOT)
+	  && ((ir->slot < 0) || (ir->slot >= size) || !function->scalar[ir->slot]))
+	ir->slot = NO_SLOT;
+      if ((ir->slot == NO_SLOT) || (inst->op == OP_ST) || (inst->op == OP_LV)) continue;
+      // An LA 0,x or CV that pushed an address, or an LI that read through one
+      if ((ir->slot < 0) || (ir->slot >= size) || !function->scalar[ir->slot]) {
+	ir->slot = NO_SLOT;
+	if (ir->pair >= 0) {
+	  block->code[ir->pair].pair = -1;
+	  block->code[ir->pair].slot = NO_SLOT;
+	  ir->pair = -1;
+	}
+      } else if ((ir->pair >= 0) && (block->code[ir->pair].inst.op == OP_ST))
+	block->code[ir->pair].slot = ir->slot;
+    }
+  }
+
+  for (b = 0; b < function->orderCount; b ++)
+    free(entry[function->order[b]->id]);
+  free(entry);
+  free(escaped);
+  free(accessed);
+  free(slotAt);
+  free(pushedBy);
+}
+
+static int newValue(IRFunction* function, enum IRValueKind kind, int slot, IRBlock* block, int index) {
+  IRValue* value;
+
+  function->values = (IRValue*) grow(function->values, &function->valueCapacity,
+				     function->valueCount, sizeof(IRValue));
+  value = function->values + function->valueCount;
+  value->kind = kind;
+  value->slot = slot;
+  value->block = block;
+  value->index = index;
+  value->operands = NULL;
+  if (kind == VALUE_PHI) {
+    value->operands = (int*) malloc((block->predCount + 1) * sizeof(int));
+    for (index = 0; index < block->predCount; index ++)
+      value->operands[index] = NO_VALUE;
+    block->phis = (int*) realloc(block->phis, (block->phiCount + 1) * sizeof(int));
+    block->phis[block->phiCount++] = function->valueCount;
+  }
+  return function->valueCount++;
+}
+
+// Phis where the definitions of a scalar meet: its iterated dominance frontier
+static void placePhis(IRFunction* function, int* entryValues) {
+  int n = function->blockCount;
+  int** frontier = (int**) calloc(n, sizeof(int*));
+  int* frontierCount = (int*) calloc(n, sizeof(int));
+  int* placed = (int*) malloc(n * sizeof(int));
+  int* queued = (int*) malloc(n * sizeof(int));
+  IRBlock** work = (IRBlock**) malloc(n * sizeof(IRBlock*));
+  IRBlock* block;
+  IRBlock* runner;
+  IRBlock* d;
+  int i, k, slot, top;
+
+  for (i = 0; i < function->orderCount; i ++) {
+    block = function->order[i];
+    if (block->predCount < 2) continue;
+    for (k = 0; k < block->predCount; k ++)
+      for (runner = block->preds[k]; (runner != NULL) && (runner != block->idom); runner = runner->idom) {
+	if ((frontierCount[runner->id] > 0) && (frontier[runner->id][frontierCount[runner->id] - 1] == block->id))
+	  break;
+	frontier[runner->id] = (int*) realloc(frontier[runner->id], (frontierCount[runner->id] + 1) * sizeof(int));
+	frontier[runner->id][frontierCount[runner->id]++] = block->id;
+      }
+  }
+
+  for (i = 0; i < n; i ++)
+    placed[i] = queued[i] = -1;
+  for (slot = 0; slot < function->localSize; slot ++) {
+    if (!function->scalar[slot]) continue;
+    entryValues[slot] = newValue(function, VALUE_ENTRY, slot, function->order[0], -1);
+    top = 0;
+    work[top++] = function->order[0];
+    queued[function->order[0]->id] = slot;
+    for (i = 1; i < function->orderCount; i ++) {
+      block = function->order[i];
+      for (k = 0; k < block->length; k ++)
+	if ((block->code[k].inst.op == OP_ST) && (block->code[k].slot == slot)) {
+	  work[top++] = block;
+	  queued[block->id] = slot;
+	  break;
+	}
+    }
+    while (top > 0) {
+      block = work[--top];
+      for (k = 0; k < frontierCount[block->id]; k ++) {
+	d = function->blocks[frontier[block->id][k]];
+	if (placed[d->id] == slot) continue;
+	placed[d->id] = slot;
+	newValue(function, VALUE_PHI, slot, d, -1);
+	if (queued[d->id] != slot) {
+	  queued[d->id] = slot;
+	  work[top++] = d;
+	}
+      }
+    }
+  }
+
+  for (i = 0; i < n; i ++)
+    free(frontier[i]);
+  free(frontier);
+  free(frontierCount);
+  free(placed);
+  free(queued);
+  free(work);
+}
+
+// Gives every LV and ST of a scalar its value, walking the dominator tree
+static void renameValues(IRFunction* function, int* current) {
+  int n = function->blockCount;
+  IRBlock** child = (IRBlock**) calloc(n, sizeof(IRBlock*));
+  IRBlock** sibling = (IRBlock**) calloc(n, sizeof(IRBlock*));
+  IRBlock** stack = (IRBlock**) malloc(n * sizeof(IRBlock*));
+  IRBlock** cursor = (IRBlock**) malloc(n * sizeof(IRBlock*));
+  int* mark = (int*) malloc(n * sizeof(int));
+  int* logSlot = NULL;
+  int* logValue = NULL;
+  int logCount = 0;
+  int logCapacity = 0;
+  int logSlotCapacity = 0;
+  IRBlock* block;
+  IRBlock* succ;
+  IRInstruction* ir;
+  IRValue* phi;
+  int i, k, s, p, v, top;
+
+#define RECORD(slot, value) do {					\
+    logSlot = (int*) grow(logSlot, &logSlotCapacity, logCount, sizeof(int)); \
+    logValue = (int*) grow(logValue, &logCapacity, logCount, sizeof(int)); \
+    logSlot[logCount] = (slot);						\
+    logValue[logCount++] = current[slot];				\
+    current[slot] = (value);						\
+  } while (0)
+
+  for (i = function->orderCount - 1; i > 0; i --) {
+    block = function->order[i];
+    sibling[block->id] = child[block->idom->id];
+    child[block->idom->id] = block;
+  }
+
+  top = 0;
+  stack[top++] = function->order[0];
+  cursor[function->order[0]->id] = NULL;
+  block = function->order[0];
+  for (;;) {
+    // Entering block
+    mark[block->id] = logCount;
+    for (k = 0; k < block->phiCount; k ++)
+      RECORD(function->values[block->phis[k]].slot, block->phis[k]);
+    for (i = 0; i < block->length; i ++) {
+      ir = block->code + i;
+      if (ir->deleted || (ir->slot == NO_SLOT)) continue;
+      if ((ir->inst.op == OP_LV) || (ir->inst.op == OP_LI))
+	ir->value = current[ir->slot];
+      else if (ir->inst.op == OP_ST) {
+	v = newValue(function, VALUE_STORE, ir->slot, block, i);
+	ir->value = v;
+	RECORD(ir->slot, v);
+      }
+    }
+    for (s = 0; s < 2; s ++) {
+      if ((succ = successor(block, s)) == NULL) continue;
+      for (p = 0; p < succ->predCount; p ++)
+	if (succ->preds[p] == block)
+	  for (k = 0; k < succ->phiCount; k ++) {
+	    phi = function->values + succ->phis[k];
+	    phi->operands[p] = current[phi->slot];
+	  }
+    }
+    cursor[block->id] = child[block->id];
+
+    // The next block to enter, leaving those done
+    block = NULL;
+    while ((top > 0) && (block == NULL)) {
+      succ = stack[top - 1];
+      if (cursor[succ->id] != NULL) {
+	block = cursor[succ->id];
+	cursor[succ->id] = sibling[block->id];
+	stack[top++] = block;
+      } else {
+	while (logCount > mark[succ->id]) {
+	  logCount --;
+	  current[logSlot[logCount]] = logValue[logCount];
+	}
+	top --;
+      }
+    }
+    if (block == NULL) break;
+  }
+#undef RECORD
+
+  free(child);
+  free(sibling);
+  free(stack);
+  free(cursor);
+  free(mark);
+  free(logSlot);
+  free(logValue);
+}
+
+void analyseFunction(IRProgram* program, IRFunction* function) {
+  int* current;
+
+  clearAnalysis(function);
+  orderBlocks(function);
+  linkPredecessors(function);
+  findDominators(function);
+  findScalars(program, function);
+
+  current = (int*) malloc((function->localSize + 1) * sizeof(int));
+  placePhis(function, current);
+  renameValues(function, current);
+  free(current);
+  function->analysed = 1;
+}
+
+void invalidateFunction(IRFunction* function) {
+  function->analysed = 0;
+}
+
+/******************************************************************/
+
+// The block laid out after block that is still reached, NULL if none
+static IRBlock* followingBlock(IRFunction* function, IRBlock* block) {
+  int i;
+
+  for (i = block->id + 1; i < function->blockCount; i ++)
+    if (function->blocks[i]->order >= 0)
+      return function->blocks[i];
+  return NULL;
+}
+
+int lowerProgram(IRProgram* program) {
+  CodeBlock* codeBlock = program->codeBlock;
+  int** start = (int**) malloc(program->functionCount * sizeof(int*));
+  Instruction* code;
+  IRFunction* function;
+  IRBlock* block;
+  Instruction* inst;
+  int i, j, k, pc;
+
+  pc = 0;
+  for (i = 0; i < program->functionCount; i ++) {
+    function = program->functions[i];
+    if (!function->analysed)
+      analyseFunction(program, function);
+    start[i] = (int*) malloc(function->blockCount * sizeof(int));
+    for (j = 0; j < function->blockCount; j ++) {
+      block = function->blocks[j];
+      start[i][j] = pc;
+      if (block->order < 0) continue;
+      for (k = 0; k < block->length; k ++)
+	if (!block->code[k].deleted)
+	  pc ++;
+      if ((block->next != NULL) && (followingBlock(function, block) != block->next))
+	pc ++;
+    }
+  }
+
+  if (pc > codeBlock->maxSize) {
+    for (i = 0; i < program->functionCount; i ++)
+      free(start[i]);
+    free(start);
+    return 0;
+  }
+
+  code = (Instruction*) malloc((pc + 1) * sizeof(Instruction));
+  pc = 0;
+  for (i = 0; i < program->functionCount; i ++) {
+    function = program->functions[i];
+    for (j = 0; j < function->blockCount; j ++) {
+      block = function->blocks[j];
+      if (block->order < 0) continue;
+      for (k = 0; k < block->length; k ++) {
+	if (block->code[k].deleted) continue;
+	inst = code + pc++;
+	*inst = block->code[k].inst;
+	if ((inst->op == OP_J) || (inst->op == OP_FJ))
+	  inst->q = start[i][block->target->id];
+	else if ((inst->op == OP_CALL) || (inst->op == OP_TC))
+	  inst->q = start[inst->q][0];
+      }
+      if ((block->next != NULL) && (followingBlock(function, block) != block->next)) {
+	inst = code + pc++;
+	inst->op = OP_J;
+	inst->p = DC_VALUE;
+	inst->q = start[i][block->next->id];
+      }
+    }
+  }
+
+  memcpy(codeBlock->code, code, pc * sizeof(Instruction));
+  codeBlock->codeSize = pc;
+  codeBlock->entry = start[program->main][0];
+
+  free(code);
+  for (i = 0; i < program->functionCount; i ++)
+    free(start[i]);
+  free(start);
+  return 1;
+}
+
+/******************************************************************/
+
+static char* slotName(IRFunction* function, int slot) {
+  Scope* scope;
+  ObjectNode* node;
+  Object* object;
+
+  if (function->object == NULL || (scope = scopeOf(function->object)) == NULL)
+    return NULL;
+  for (node = scope->objList; node != NULL; node = node->next) {
+    object = node->object;
+    if ((object->kind == OBJ_VARIABLE) && (object->varAttrs->localOffset == slot))
+      return object->name;
+    if ((object->kind == OBJ_PARAMETER) && (object->paramAttrs->localOffset == slot))
+      return object->name;
+  }
+  return NULL;
+}
+
+static void printSlot(IRFunction* function, int slot) {
+  char* name = slotName(function, slot);
+
+  if (name != NULL)
+    printf("%s", name);
+  else printf("[%d]", slot);
+}
+
+void printFunction(IRProgram* program, IRFunction* function) {
+  IRBlock* block;
+  IRInstruction* ir;
+  IRValue* value;
+  char buffer[100];
+  int i, j, k;
+
+  if (!function->analysed)
+    analyseFunction(program, function);
+
+  printf("%s: level %d, %d locals, scalars",
+	 (function->object != NULL) ? function->object->name : "?", function->level, function->localSize);
+  for (k = 0; k < function->localSize; k ++)
+    if (function->scalar[k]) {
+      printf(" ");
+      printSlot(function, k);
+    }
+  printf("\n");
+
+  for (i = 0; i < function->blockCount; i ++) {
+    block = function->blocks[i];
+    printf("B%d", block->id);
+    if (block->order < 0) {
+      printf(" unreached\n");
+      continue;
+    }
+    if (block->predCount > 0) {
+      printf(" <-");
+      for (k = 0; k < block->predCount; k ++)
+	printf(" B%d", block->preds[k]->id);
+    }
+    if (block->idom != NULL)
+      printf(", idom B%d", block->idom->id);
+    printf("\n");
+
+    for (k = 0; k < block->phiCount; k ++) {
+      value = function->values + block->phis[k];
+      printf("    v%d = phi(", block->phis[k]);
+      for (j = 0; j < block->predCount; j ++)
+	printf(j == 0 ? "v%d" : ", v%d", value->operands[j]);
+      printf(")  ");
+      printSlot(function, value->slot);
+      printf("\n");
+    }
+
+    for (k = 0; k < block->length; k ++) {
+      ir = block->code + k;
+      if (ir->deleted) continue;
+      switch (ir->inst.op) {
+      case OP_J:
+	sprintf(buffer, "J B%d", block->target->id);
+	break;
+      case OP_FJ:
+	sprintf(buffer, "FJ B%d", block->target->id);
+	break;
+      case OP_CALL:
+      case OP_TC:
+	sprintf(buffer, "%s %d,%s", (ir->inst.op == OP_CALL) ? "CALL" : "TC", ir->inst.p,
+		(program->functions[ir->inst.q]->object != NULL) ? program->functions[ir->inst.q]->object->name : "?");
+	break;
+      default:
+	sprintInstruction(buffer, &ir->inst);
+	break;
+      }
+      printf("    %-16s", buffer);
+      if (((ir->inst.op == OP_LV) || (ir->inst.op == OP_LI)) && (ir->value != NO_VALUE))
+	printf("v%d", ir->value);
+      else if ((ir->inst.op == OP_ST) && (ir->value != NO_VALUE)) {
+	printf("v%d = ", ir->value);
+	printSlot(function, ir->slot);
+      }
+      printf("\n");
+    }
+    if ((block->next != NULL) && (followingBlock(function, block) != block->next))
+      printf("    J B%d\n", block->next->id);
+  }
+}
+
+void printProgram(IRProgram* program) {
+  int i;
+
+  for (i = 0; i < program->functionCount; i ++) {
+    if (i > 0) printf("\n");
+    printFunction(program, program->functions[i]);
+  }
+}
@@ -0,0 +1,152 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __IR_H__
+#define __IR_H__
+
+#include "instructions.h"
+#include "symtab.h"
+
+/*
+ * The representation the optimizer works on, between the code the parser
+ * generates and the code kplc writes.  buildProgram() splits the code of
+ * the main program and of every function and procedure into basic blocks
+ * linked in a control flow graph.  analyseFunction() finds the dominators
+ * and gives SSA values to the scalar locals: the words of the frame whose
+ * address is only ever used to read or write them.  They are read by
+ * LV 0,x, and by an LI of the address an LA 0,x or CV pushed in the same
+ * block; they are written by an ST through such an address, or through
+ * one an earlier block left on the stack.  Passes (see passes.h) rewrite
+ * the blocks, and lowerProgram() lays them out as stack code again.
+ *
+ * Instructions keep their stack form; SSA values annotate the LV or LI
+ * that reads a scalar and the ST that writes it.  A pass may change
+ * anything inside a block as long as the stack height at its end stays
+ * the same.
+ */
+
+#define NO_VALUE -1
+#define NO_SLOT -1
+
+struct IRInstruction_ {
+  // J and FJ go to the target of their block; q of CALL and TC is the index of the callee
+  Instruction inst;
+  int deleted;
+  int slot;                     // the scalar an LV or LI reads, or an LA ... ST writes
+  int value;                    // SSA value the LV or LI reads, or the ST defines
+  int pair;                     // the ST or LI that takes the address an LA or CV pushed,
+                                // and the other way round
+};
+
+typedef struct IRInstruction_ IRInstruction;
+
+enum IRValueKind {
+  VALUE_ENTRY,                  // whatever the scalar holds when the function starts
+  VALUE_STORE,
+  VALUE_PHI
+};
+
+struct IRBlock_;
+
+struct IRValue_ {
+  enum IRValueKind kind;
+  int slot;
+  struct IRBlock_* block;
+  int index;                    // of the ST of a VALUE_STORE
+  int* operands;                // of a VALUE_PHI, one for each predecessor of its block
+};
+
+typedef struct IRValue_ IRValue;
+
+struct IRBlock_ {
+  int id;                       // place in the layout of its function
+  int address;                  // in the code of the parser, -1 for new blocks
+  int height;                   // of the stack when it starts
+  IRInstruction* code;
+  int length;
+  int capacity;
+  struct IRBlock_* next;        // when it falls through; NULL after J, HL, EP, EF and EFF
+  struct IRBlock_* target;      // of the J or FJ it ends with
+  // Set by analyseFunction()
+  struct IRBlock_** preds;      // once for every edge
+  int predCount;
+  struct IRBlock_* idom;        // NULL for the entry and the blocks nothing reaches
+  int order;                    // in reverse postorder, -1 when nothing reaches it
+  int* phis;
+  int phiCount;
+};
+
+typedef struct IRBlock_ IRBlock;
+
+struct IRFunction_ {
+  Object* object;               // the function, procedure or program, NULL if not known
+  int address;                  // entry in the code of the parser
+  int level;
+  int returnKind;               // as in verifier.h
+  int localSize;                // words of the frame under the evaluation stack
+  IRBlock** blocks;             // in layout order, the entry first
+  int blockCount;
+  int blockCapacity;
+  // Set by analyseFunction()
+  int analysed;
+  IRBlock** order;              // the blocks reached from the entry, in reverse postorder
+  int orderCount;
+  char* scalar;                 // by slot, up to localSize
+  IRValue* values;
+  int valueCount;
+  int valueCapacity;
+};
+
+typedef struct IRFunction_ IRFunction;
+
+struct IRProgram_ {
+  CodeBlock* codeBlock;
+  IRFunction** functions;       // in the order of their code
+  int functionCount;
+  int main;
+  // Words of outer frames that nested procedures reach: by level, then slot
+  int* outerLevels;
+  int* outerSlots;
+  int outerCount;
+};
+
+typedef struct IRProgram_ IRProgram;
+
+/*
+ * NULL when the code does not verify.  program is the object of the main
+ * program, whose scopes give the functions and procedures their objects;
+ * it may be NULL.
+ */
+IRProgram* buildProgram(CodeBlock* codeBlock, Object* program);
+void freeProgram(IRProgram* program);
+
+void analyseFunction(IRProgram* program, IRFunction* function);
+// After a pass changed the function
+void invalidateFunction(IRFunction* function);
+int dominates(IRBlock* dominator, IRBlock* block);
+// Words the instruction takes from the stack, and how it changes the height
+void instructionEffect(IRProgram* program, Instruction* inst, int* need, int* delta);
+
+// A new empty block at position in the layout
+IRBlock* insertBlock(IRFunction* function, int position);
+// Moves block before the one at position in the layout
+void moveBlock(IRFunction* function, IRBlock* block, int position);
+// A new word at the end of the frame, under the evaluation stack; returns its slot
+int addLocal(IRFunction* function);
+IRInstruction* insertInstruction(IRBlock* block, int index, Instruction inst);
+void deleteInstruction(IRInstruction* instruction);
+
+/*
+ * Replaces the code of the code block with that of the program; the main
+ * program keeps being the entry.  Returns 0, changing nothing, when the
+ * code would not fit.
+ */
+int lowerProgram(IRProgram* program);
+
+void printFunction(IRProgram* program, IRFunction* function);
+void printProgram(IRProgram* program);
+
+#endif
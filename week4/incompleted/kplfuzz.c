@@ -0,0 +1,281 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Random loop programs for make fuzz, which compiles each one with and
+ * without -noopt and compares what they print.  The loops nest FOR,
+ * WHILE, DO and REPEAT with BREAKs, calls that change globals, subscripts
+ * on the loop variables, powers and divisions that may fault: the code
+ * the passes of loops.c rewrite.  A seed always gives the same program.
+ */
+
+#define MAX_NAMES 16
+
+typedef struct {
+  char* names[MAX_NAMES];
+  int count;
+} Names;
+
+typedef struct {
+  Names vars;          // read anywhere
+  Names active;        // the variables of the FOR loops around
+  Names funcs;
+  Names procs;
+  Names targets;       // assigned to
+} Context;
+
+char* loopVars[] = {"I", "J", "K"};
+
+unsigned long long state;
+
+// xorshift64*, so that a seed gives the same program everywhere
+double next(void) {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return ((state * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int between(int low, int high) {
+  return low + (int) (next() * (high - low + 1));
+}
+
+char* choose(Names* names) {
+  return names->names[(int) (next() * names->count)];
+}
+
+void add(Names* names, char* name) {
+  names->names[names->count ++] = name;
+}
+
+void genStatement(Context* context, int depth);
+void genExpression(Context* context, int depth);
+
+void genIndex(Context* context) {
+  if ((context->active.count > 0) && (next() < 0.6)) {
+    char* var = choose(&context->active);
+    int offset = between(0, 4);
+
+    if (offset == 0) printf("%s", var);
+    else printf("%s + %d", var, offset);
+  } else printf("%d", between(0, 9));
+}
+
+void genAtom(Context* context) {
+  double x = next();
+
+  if (x < 0.25) printf("%d", between(0, 9));
+  else if (x < 0.55) printf("%s", choose(&context->vars));
+  else if ((x < 0.7) && (context->active.count > 0)) printf("%s", choose(&context->active));
+  else if (x < 0.85) {
+    printf("A(.");
+    genIndex(context);
+    printf(".)");
+  } else {
+    printf("B(.");
+    genIndex(context);
+    printf(".)(.");
+    genIndex(context);
+    printf(".)");
+  }
+}
+
+void genPower(Context* context) {
+  static char* exponents[] = {"0", "1", "2", "3", "C"};
+  Names bases = {{"2", "3"}, 2};
+  int i;
+
+  for (i = 0; i < context->vars.count; i ++)
+    if (context->vars.names[i][0] != 'N')
+      add(&bases, context->vars.names[i]);
+  for (i = 0; i < context->active.count; i ++)
+    add(&bases, context->active.names[i]);
+  printf("(%s ** %s)", choose(&bases), exponents[between(0, 4)]);
+}
+
+void genExpression(Context* context, int depth) {
+  static char* operators[] = {"+", "-", "*", "+", "-"};
+  double x = next();
+
+  if ((depth <= 0) || (x < 0.3))
+    genAtom(context);
+  else if ((x < 0.38) && (context->funcs.count > 0)) {
+    printf("%s(", choose(&context->funcs));
+    genExpression(context, depth - 1);
+    printf(")");
+  } else if (x < 0.45)
+    genPower(context);
+  else if (x < 0.5) {
+    printf("(");
+    genExpression(context, depth - 1);
+    printf(" / (");
+    genExpression(context, depth - 1);
+    printf("))");
+  } else if (x < 0.55) {
+    printf("(0 - ");
+    genExpression(context, depth - 1);
+    printf(")");
+  } else {
+    printf("(");
+    genExpression(context, depth - 1);
+    printf(" %s ", operators[between(0, 4)]);
+    genExpression(context, depth - 1);
+    printf(")");
+  }
+}
+
+void genCondition(Context* context) {
+  static char* comparators[] = {"=", "!=", "<", ">", "<=", ">="};
+
+  genExpression(context, 2);
+  printf(" %s ", comparators[between(0, 5)]);
+  genExpression(context, 2);
+}
+
+void genLvalue(Context* context) {
+  double x = next();
+
+  if (x < 0.5) printf("%s", choose(&context->targets));
+  else if (x < 0.8) {
+    printf("A(.");
+    genIndex(context);
+    printf(".)");
+  } else {
+    printf("B(.");
+    genIndex(context);
+    printf(".)(.");
+    genIndex(context);
+    printf(".)");
+  }
+}
+
+// WHILE, DO and REPEAT count in W<depth>, which nothing else assigns
+void genLoop(Context* context, int depth) {
+  static char* bounds[] = {"C", "C - 1", "C + 1"};
+  Context inner;
+  char* var = NULL;
+  double x = next();
+  int i, j;
+
+  for (i = 0; (i < 3) && (var == NULL); i ++) {
+    var = loopVars[i];
+    for (j = 0; j < context->active.count; j ++)
+      if (context->active.names[j] == var) var = NULL;
+  }
+
+  if ((var != NULL) && (x < 0.55)) {
+    printf("FOR %s := %d TO ", var, between(0, 2));
+    if (next() < 0.6) printf("%d", between(0, 5));
+    else printf("%s", bounds[between(0, 2)]);
+    printf(" DO ");
+    inner = *context;
+    add(&inner.active, var);
+    genStatement(&inner, depth - 1);
+  } else if (x < 0.75) {
+    printf("BEGIN W%d := 0; WHILE W%d < %d DO BEGIN W%d := W%d + 1; ", depth, depth, between(0, 4), depth, depth);
+    genStatement(context, depth - 1);
+    printf(" END END");
+  } else if (x < 0.88) {
+    printf("BEGIN W%d := 0; DO BEGIN W%d := W%d + 1; ", depth, depth, depth);
+    genStatement(context, depth - 1);
+    printf(" END WHILE W%d < %d END", depth, between(1, 4));
+  } else {
+    printf("BEGIN W%d := 0; REPEAT BEGIN W%d := W%d + 1; ", depth, depth, depth);
+    genStatement(context, depth - 1);
+    printf(" END UNTIL W%d >= %d END", depth, between(1, 4));
+  }
+}
+
+void genStatement(Context* context, int depth) {
+  double x = next();
+
+  if ((depth <= 0) || (x < 0.3)) {
+    genLvalue(context);
+    printf(" := ");
+    genExpression(context, 3);
+  } else if (x < 0.55)
+    genLoop(context, depth);
+  else if ((x < 0.62) && (context->procs.count > 0)) {
+    printf("CALL %s(", choose(&context->procs));
+    genExpression(context, 2);
+    printf(")");
+  } else if (x < 0.72) {
+    printf("IF ");
+    genCondition(context);
+    printf(" THEN ");
+    genStatement(context, depth - 1);
+    printf(" ELSE ");
+    genStatement(context, depth - 1);
+  } else if (x < 0.78) {
+    printf("BEGIN CALL WRITEI(");
+    genExpression(context, 3);
+    printf("); CALL WRITELN END");
+  } else if ((x < 0.82) && (context->active.count > 0)) {
+    printf("IF ");
+    genCondition(context);
+    printf(" THEN BREAK");
+  } else {
+    printf("BEGIN ");
+    genStatement(context, depth - 1);
+    printf("; ");
+    genStatement(context, depth - 1);
+    printf(" END");
+  }
+}
+
+int main(int argc, char *argv[]) {
+  Context function = {{{"N", "X", "Y"}, 3}, {{NULL}, 0}, {{NULL}, 0}, {{NULL}, 0}, {{"Y", "Z"}, 2}};
+  Context procedure = {{{"N", "L", "X", "Y", "Z", "S"}, 6}, {{NULL}, 0}, {{"F"}, 1}, {{NULL}, 0},
+		       {{"L", "S", "Y"}, 3}};
+  Context program = {{{"X", "Y", "Z", "S"}, 4}, {{NULL}, 0}, {{"F"}, 1}, {{"P"}, 1},
+		     {{"X", "Y", "Z", "S"}, 4}};
+  int i;
+
+  if (argc != 2) {
+    printf("Usage: kplfuzz seed\n");
+    return -1;
+  }
+  state = strtoull(argv[1], NULL, 10) * 0x9E3779B97F4A7C15ULL + 1;
+
+  printf("PROGRAM FUZZ;  (* kplfuzz %s *)\n", argv[1]);
+  printf("TYPE ROW = ARRAY(. 14 .) OF INTEGER;\n");
+  printf("VAR X : INTEGER; Y : INTEGER; Z : INTEGER; S : INTEGER; C : INTEGER;\n");
+  printf("    W0 : INTEGER; W1 : INTEGER; W2 : INTEGER; W3 : INTEGER; W4 : INTEGER;\n");
+  printf("    I : INTEGER; J : INTEGER; K : INTEGER;\n");
+  printf("    A : ARRAY(. 14 .) OF INTEGER; B : ARRAY(. 14 .) OF ROW;\n\n");
+
+  printf("FUNCTION F(N : INTEGER) : INTEGER;\nBEGIN\n  X := X + 1;\n  ");
+  genStatement(&function, 0);
+  printf(";\n  F := ");
+  genExpression(&function, 2);
+  printf("\nEND;\n\n");
+
+  printf("PROCEDURE P(N : INTEGER);\n");
+  printf("VAR L : INTEGER; I : INTEGER; J : INTEGER; K : INTEGER;\n");
+  printf("    W0 : INTEGER; W1 : INTEGER; W2 : INTEGER; W3 : INTEGER;\n");
+  printf("BEGIN\n  L := N; S := 0;\n");
+  for (i = 0; i < 2; i ++) {
+    printf("  ");
+    genStatement(&procedure, 3);
+    printf(";\n");
+  }
+  printf("  CALL WRITEI(L + S); CALL WRITELN\nEND;\n\n");
+
+  printf("BEGIN\n  X := 1; Y := 2; Z := 3; S := 0; C := 4;\n");
+  printf("  FOR I := 0 TO 13 DO BEGIN A(.I.) := I * 3 - 7; FOR J := 0 TO 13 DO B(.I.)(.J.) := I - J * 2 END;\n");
+  for (i = 0; i < 4; i ++) {
+    printf("  ");
+    genStatement(&program, 4);
+    printf(";\n");
+  }
+  printf("  CALL WRITEI(X); CALL WRITEI(Y); CALL WRITEI(Z); CALL WRITEI(S); CALL WRITELN;\n");
+  printf("  FOR I := 0 TO 13 DO BEGIN CALL WRITEI(A(.I.)); FOR J := 0 TO 13 DO CALL WRITEI(B(.I.)(.J.)) END\n");
+  printf("END.\n");
+  return 0;
+}
@@ -0,0 +1,1226 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "passes.h"
+
+// Rewrites of the loops of one function before a pass leaves them as they are
+#define MAX_REWRITES 64
+// Invariant words an induction expression may add up
+#define MAX_TERMS 8
+// Largest multiple of an induction variable that is followed
+#define MAX_FACTOR 65536
+
+typedef struct {
+  IRBlock* header;
+  char* member;                 // by block id
+  IRBlock** latches;            // the blocks whose edges go back to the header
+  int latchCount;
+  int size;
+  int writesMemory;             // it calls, or stores anything but scalars
+} Loop;
+
+enum WordKind {
+  WORD_OTHER,
+  WORD_INVARIANT,               // the same in every iteration
+  WORD_INDUCTION                // a multiple of the induction variable plus invariant terms
+};
+
+// What a word of the stack holds, and the code in the block that pushes it
+typedef struct {
+  enum WordKind kind;
+  int start;                    // -1 when that code is not all in the block
+  int end;                      // the instruction that pushes the word
+  int length;                   // of the code, leaving out what is deleted
+  WORD factor;                  // of the induction variable
+  int termCount;
+  int termStart[MAX_TERMS];
+  int termEnd[MAX_TERMS];
+  WORD termFactor[MAX_TERMS];
+} Word;
+
+// A word an instruction takes whole, without making it part of the word it pushes
+typedef struct {
+  IRBlock* block;
+  int consumer;                 // -1 when the word is left to the blocks that follow
+  Word word;
+} Root;
+
+typedef struct {
+  IRFunction* function;
+  Loop* loop;
+  int induction;                // the value of the induction variable, NO_VALUE if none
+  Root* roots;
+  int rootCount;
+  int rootCapacity;
+} Scan;
+
+typedef struct {
+  Instruction* code;
+  int length;
+  int capacity;
+} Code;
+
+// An inner loop that computes the same in every iteration, and the stores in front of it
+typedef struct {
+  IRBlock** blocks;             // in layout order
+  int blockCount;
+  IRBlock* entry;               // the block that falls into it
+  int start;                    // of the stores at the end of entry
+  IRBlock* exit;                // the block of its only edge out
+  IRBlock* after;               // where that edge goes
+} InnerLoop;
+
+/******************************************************************/
+
+static int hasSideEffect(enum OpCode op) {
+  switch (op) {
+  case OP_CALL: case OP_RC: case OP_RI: case OP_WRC: case OP_WRI: case OP_WRF:
+  case OP_WRS: case OP_WLN: case OP_HL: case OP_EP: case OP_EF: case OP_EFF: case OP_BP:
+  case OP_TC:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static int sideEffectBefore(IRBlock* block, int index) {
+  int i;
+
+  for (i = 0; i < index; i ++)
+    if (!block->code[i].deleted && hasSideEffect(block->code[i].inst.op))
+      return 1;
+  return 0;
+}
+
+// The instruction after index that is still there, the length of the block if none
+static int nextInstruction(IRBlock* block, int index) {
+  for (index ++; index < block->length; index ++)
+    if (!block->code[index].deleted)
+      return index;
+  return block->length;
+}
+
+static int lastInstruction(IRBlock* block) {
+  int index;
+
+  for (index = block->length - 1; index >= 0; index --)
+    if (!block->code[index].deleted)
+      return index;
+  return -1;
+}
+
+/******************************************************************/
+
+static int writesMemory(IRFunction* function, Loop* loop) {
+  IRBlock* block;
+  IRInstruction* ir;
+  int b, i;
+
+  for (b = 0; b < function->blockCount; b ++) {
+    if (!loop->member[b]) continue;
+    block = function->blocks[b];
+    for (i = 0; i < block->length; i ++) {
+      ir = block->code + i;
+      if (ir->deleted) continue;
+      if ((ir->inst.op == OP_CALL) || (ir->inst.op == OP_STF)
+	  || ((ir->inst.op == OP_ST) && (ir->slot == NO_SLOT)))
+	return 1;
+    }
+  }
+  return 0;
+}
+
+static int compareLoops(const void* a, const void* b) {
+  return ((const Loop*) a)->size - ((const Loop*) b)->size;
+}
+
+// The natural loops of the function, one for each header, the inner ones first
+static Loop* findLoops(IRFunction* function, int* count) {
+  Loop* loops = (Loop*) malloc((function->orderCount + 1) * sizeof(Loop));
+  IRBlock** work = (IRBlock**) malloc((function->blockCount + 1) * sizeof(IRBlock*));
+  IRBlock* header;
+  IRBlock* block;
+  IRBlock* pred;
+  Loop* loop;
+  int b, k, top;
+
+  *count = 0;
+  for (b = 0; b < function->orderCount; b ++) {
+    header = function->order[b];
+    loop = NULL;
+    top = 0;
+    for (k = 0; k < header->predCount; k ++) {
+      pred = header->preds[k];
+      if (!dominates(header, pred)) continue;
+      if (loop == NULL) {
+	loop = loops + (*count)++;
+	loop->header = header;
+	loop->member = (char*) calloc(function->blockCount, 1);
+	loop->latches = (IRBlock**) malloc(header->predCount * sizeof(IRBlock*));
+	loop->latchCount = 0;
+	loop->member[header->id] = 1;
+	loop->size = 1;
+      }
+      loop->latches[loop->latchCount++] = pred;
+      if (!loop->member[pred->id]) {
+	loop->member[pred->id] = 1;
+	loop->size ++;
+	work[top++] = pred;
+      }
+    }
+    while (top > 0) {
+      block = work[--top];
+      for (k = 0; k < block->predCount; k ++) {
+	pred = block->preds[k];
+	if (loop->member[pred->id]) continue;
+	loop->member[pred->id] = 1;
+	loop->size ++;
+	work[top++] = pred;
+      }
+    }
+    if (loop != NULL)
+      loop->writesMemory = writesMemory(function, loop);
+  }
+  qsort(loops, *count, sizeof(Loop), compareLoops);
+  free(work);
+  return loops;
+}
+
+static void freeLoops(Loop* loops, int count) {
+  int i;
+
+  for (i = 0; i < count; i ++) {
+    free(loops[i].member);
+    free(loops[i].latches);
+  }
+  free(loops);
+}
+
+static int isLatch(Loop* loop, IRBlock* block) {
+  int k;
+
+  for (k = 0; k < loop->latchCount; k ++)
+    if (loop->latches[k] == block)
+      return 1;
+  return 0;
+}
+
+static int leavesLoop(Loop* loop, IRBlock* block) {
+  return ((block->next == NULL) && (block->target == NULL))
+    || ((block->next != NULL) && !loop->member[block->next->id])
+    || ((block->target != NULL) && !loop->member[block->target->id]);
+}
+
+// A block that takes an edge back to itself, the header of a loop
+static int hasBackEdge(IRBlock* block) {
+  int k;
+
+  for (k = 0; k < block->predCount; k ++)
+    if (dominates(block, block->preds[k]))
+      return 1;
+  return 0;
+}
+
+/*
+ * Whether the code at index of block runs in every iteration that starts,
+ * with nothing anyone can see happening first, so that running it once in
+ * front of the loop traps only when the loop would have.  guarded is for
+ * a loop about to be rotated: the header only decides whether the first
+ * iteration starts at all, and a copy of it in front of the loop will.
+ */
+static int anticipable(IRFunction* function, Loop* loop, IRBlock* block, int index, int guarded) {
+  IRBlock* header = loop->header;
+  IRBlock** work;
+  char* seen;
+  IRBlock* other;
+  IRBlock* pred;
+  int ok = 1;
+  int top = 0;
+  int i, k;
+
+  if (block == header)
+    return !sideEffectBefore(header, index);
+  if (sideEffectBefore(header, header->length) || (!guarded && leavesLoop(loop, header)))
+    return 0;
+  for (i = 0; i < function->blockCount; i ++) {
+    other = function->blocks[i];
+    if (!loop->member[i] || (other == header)) continue;
+    if ((leavesLoop(loop, other) || isLatch(loop, other)) && !dominates(block, other))
+      return 0;
+  }
+
+  // The paths from the header to the block
+  work = (IRBlock**) malloc(function->blockCount * sizeof(IRBlock*));
+  seen = (char*) calloc(function->blockCount, 1);
+  work[top++] = block;
+  seen[block->id] = 1;
+  while (ok && (top > 0)) {
+    other = work[--top];
+    for (k = 0; ok && (k < other->predCount); k ++) {
+      pred = other->preds[k];
+      if ((pred == header) || seen[pred->id] || ((other == block) && dominates(block, pred)))
+	continue;
+      seen[pred->id] = 1;
+      if (sideEffectBefore(pred, pred->length) || hasBackEdge(pred))
+	ok = 0;
+      work[top++] = pred;
+    }
+  }
+  free(work);
+  free(seen);
+  return ok && !sideEffectBefore(block, index);
+}
+
+/******************************************************************/
+
+static void setWord(Word* word, enum WordKind kind, int start, int end, int length) {
+  word->kind = kind;
+  word->start = start;
+  word->end = end;
+  word->length = length;
+  word->factor = (kind == WORD_INDUCTION) ? 1 : 0;
+  word->termCount = 0;
+}
+
+static int isInvariant(Scan* scan, int value) {
+  return (value != NO_VALUE) && !scan->loop->member[scan->function->values[value].block->id];
+}
+
+// An LV, or an LI and the LA or CV that pushed its address
+static void readWord(Scan* scan, IRInstruction* ir, int start, int end, int length, Word* word) {
+  if (ir->slot != NO_SLOT) {
+    if ((scan->induction != NO_VALUE) && (ir->value == scan->induction))
+      setWord(word, WORD_INDUCTION, start, end, length);
+    else if (isInvariant(scan, ir->value))
+      setWord(word, WORD_INVARIANT, start, end, length);
+  } else if (!scan->loop->writesMemory)
+    setWord(word, WORD_INVARIANT, start, end, length);
+}
+
+static int fitsFactor(WORD factor) {
+  return (factor >= -MAX_FACTOR) && (factor <= MAX_FACTOR) && (factor != 0);
+}
+
+// An invariant word is an induction one with a factor of 0 and itself as its term
+static void asInduction(Word* word, Word* induction) {
+  *induction = *word;
+  if (word->kind == WORD_INVARIANT) {
+    induction->factor = 0;
+    induction->termCount = 1;
+    induction->termStart[0] = word->start;
+    induction->termEnd[0] = word->end;
+    induction->termFactor[0] = 1;
+  }
+}
+
+static int scaleWord(Word* word, WORD factor) {
+  int k;
+
+  if (!fitsFactor(factor) || !fitsFactor(word->factor * factor))
+    return 0;
+  word->factor *= factor;
+  for (k = 0; k < word->termCount; k ++) {
+    if (!fitsFactor(word->termFactor[k] * factor))
+      return 0;
+    word->termFactor[k] *= factor;
+  }
+  return 1;
+}
+
+static int addWords(Word* x, Word* y, int sign, Word* word) {
+  Word a, b;
+  int k;
+
+  asInduction(x, &a);
+  asInduction(y, &b);
+  if ((a.termCount + b.termCount > MAX_TERMS) || ((sign < 0) && !scaleWord(&b, -1)))
+    return 0;
+  *word = a;
+  word->kind = WORD_INDUCTION;
+  word->factor = a.factor + b.factor;
+  for (k = 0; k < b.termCount; k ++) {
+    word->termStart[word->termCount] = b.termStart[k];
+    word->termEnd[word->termCount] = b.termEnd[k];
+    word->termFactor[word->termCount++] = b.termFactor[k];
+  }
+  return fitsFactor(word->factor);
+}
+
+static int isConstant(IRBlock* block, Word* word) {
+  return (word->start == word->end) && (block->code[word->start].inst.op == OP_LC);
+}
+
+// The word the instruction at index pushes from the words it takes
+static void combineWords(Scan* scan, IRBlock* block, int index, Word* operands, Word* word) {
+  IRInstruction* ir = block->code + index;
+  Word* x = operands;
+  Word* y = operands + 1;
+  Word result;
+  int ok = 0;
+
+  switch (ir->inst.op) {
+  case OP_LC:
+  case OP_LS:
+    setWord(word, WORD_INVARIANT, index, index, 1);
+    return;
+  case OP_LA:
+    if (ir->slot == NO_SLOT)
+      setWord(word, WORD_INVARIANT, index, index, 1);
+    return;
+  case OP_LV:
+    readWord(scan, ir, index, index, 1, word);
+    return;
+  case OP_LI:
+    if (ir->slot != NO_SLOT) {
+      if ((x->end == ir->pair) && (nextInstruction(block, ir->pair) == index))
+	readWord(scan, ir, ir->pair, index, 2, word);
+    } else if ((x->kind == WORD_INVARIANT) && (x->start >= 0) && !scan->loop->writesMemory
+	       && (nextInstruction(block, x->end) == index))
+      setWord(word, WORD_INVARIANT, x->start, index, x->length + 1);
+    return;
+  case OP_NEG:
+    if ((x->kind == WORD_OTHER) || (x->start < 0) || (nextInstruction(block, x->end) != index))
+      return;
+    result = *x;
+    ok = (x->kind == WORD_INVARIANT) || scaleWord(&result, -1);
+    break;
+  case OP_AD: case OP_SB: case OP_ML: case OP_DV:
+  case OP_EQ: case OP_NE: case OP_GT: case OP_LT: case OP_GE: case OP_LE:
+    if ((x->kind == WORD_OTHER) || (y->kind == WORD_OTHER) || (x->start < 0) || (y->start < 0)
+	|| (nextInstruction(block, x->end) != y->start) || (nextInstruction(block, y->end) != index))
+      return;
+    if ((x->kind == WORD_INVARIANT) && (y->kind == WORD_INVARIANT)) {
+      result = *x;
+      ok = 1;
+    } else if ((ir->inst.op == OP_AD) || (ir->inst.op == OP_SB))
+      ok = addWords(x, y, (ir->inst.op == OP_AD) ? 1 : -1, &result);
+    else if (ir->inst.op == OP_ML) {
+      if ((x->kind == WORD_INDUCTION) && isConstant(block, y)) {
+	result = *x;
+	ok = scaleWord(&result, block->code[y->start].inst.q);
+      } else if ((y->kind == WORD_INDUCTION) && isConstant(block, x)) {
+	result = *y;
+	ok = scaleWord(&result, block->code[x->start].inst.q);
+      }
+    }
+    if (ok)
+      result.length = x->length + y->length;
+    break;
+  default:
+    return;
+  }
+  if (ok) {
+    *word = result;
+    word->start = x->start;
+    word->end = index;
+    word->length ++;
+  }
+}
+
+static void addRoot(Scan* scan, IRBlock* block, int consumer, Word* word) {
+  Root* root;
+
+  if ((word->kind == WORD_OTHER) || (word->start < 0))
+    return;
+  if (scan->rootCount == scan->rootCapacity) {
+    scan->rootCapacity = (scan->rootCapacity == 0) ? 32 : 2 * scan->rootCapacity;
+    scan->roots = (Root*) realloc(scan->roots, scan->rootCapacity * sizeof(Root));
+  }
+  root = scan->roots + scan->rootCount++;
+  root->block = block;
+  root->consumer = consumer;
+  root->word = *word;
+}
+
+static void scanBlock(IRProgram* program, Scan* scan, IRBlock* block) {
+  int capacity = block->height + 8;
+  Word* stack = (Word*) malloc(capacity * sizeof(Word));
+  IRInstruction* ir;
+  Word word;
+  int height = block->height;
+  int i, k, need, delta, pushed;
+
+  for (k = 0; k < height; k ++)
+    setWord(stack + k, WORD_OTHER, -1, -1, 0);
+  for (i = 0; i < block->length; i ++) {
+    ir = block->code + i;
+    if (ir->deleted) continue;
+    instructionEffect(program, &ir->inst, &need, &delta);
+    pushed = need + delta;
+    if (height + pushed + 1 > capacity) {
+      capacity = height + pushed + 8;
+      stack = (Word*) realloc(stack, capacity * sizeof(Word));
+    }
+    // A copy is a new word; the one it copies is still to be taken
+    if (ir->inst.op == OP_CV) {
+      setWord(stack + height++, WORD_OTHER, -1, i, 0);
+      continue;
+    }
+    setWord(&word, WORD_OTHER, -1, i, 0);
+    combineWords(scan, block, i, stack + height - need, &word);
+    if (word.kind == WORD_OTHER)
+      for (k = height - need; k < height; k ++)
+	addRoot(scan, block, i, stack + k);
+    height -= need;
+    for (k = 0; k < pushed; k ++)
+      if (pushed == 1)
+	stack[height++] = word;
+      else setWord(stack + height++, WORD_OTHER, -1, i, 0);
+  }
+  for (k = 0; k < height; k ++)
+    addRoot(scan, block, -1, stack + k);
+  free(stack);
+}
+
+static void scanLoop(IRProgram* program, IRFunction* function, Loop* loop, int induction, Scan* scan) {
+  int b;
+
+  scan->function = function;
+  scan->loop = loop;
+  scan->induction = induction;
+  scan->roots = NULL;
+  scan->rootCount = 0;
+  scan->rootCapacity = 0;
+  for (b = 0; b < function->blockCount; b ++)
+    if (loop->member[b])
+      scanBlock(program, scan, function->blocks[b]);
+}
+
+// The root that the instruction at consumer of block takes, NULL if none
+static Root* rootTakenBy(Scan* scan, IRBlock* block, int consumer) {
+  int i;
+
+  for (i = 0; i < scan->rootCount; i ++)
+    if ((scan->roots[i].block == block) && (scan->roots[i].consumer == consumer))
+      return scan->roots + i;
+  return NULL;
+}
+
+/******************************************************************/
+
+static void emit(Code* code, enum OpCode op, WORD p, WORD q) {
+  if (code->length == code->capacity) {
+    code->capacity = (code->capacity == 0) ? 16 : 2 * code->capacity;
+    code->code = (Instruction*) realloc(code->code, code->capacity * sizeof(Instruction));
+  }
+  code->code[code->length].op = op;
+  code->code[code->length].p = p;
+  code->code[code->length].q = q;
+  code->length ++;
+}
+
+// The code from start to end of block, reading scalars by LV wherever it is put
+static void copyCode(Code* code, IRBlock* block, int start, int end) {
+  IRInstruction* ir;
+  int i;
+
+  for (i = start; i <= end; i ++) {
+    ir = block->code + i;
+    if (ir->deleted) continue;
+    if ((ir->inst.op == OP_LI) && (ir->slot != NO_SLOT))
+      emit(code, OP_LV, 0, ir->slot);
+    else if (((ir->inst.op == OP_LA) || (ir->inst.op == OP_CV)) && (ir->pair >= 0)
+	     && (block->code[ir->pair].inst.op == OP_LI))
+      continue;
+    else emit(code, ir->inst.op, ir->inst.p, ir->inst.q);
+  }
+}
+
+// The sum of the terms of an induction word, each times its factor and scale
+static void copyTerms(Code* code, IRBlock* block, Word* word, WORD scale) {
+  WORD factor;
+  int k;
+
+  for (k = 0; k < word->termCount; k ++) {
+    copyCode(code, block, word->termStart[k], word->termEnd[k]);
+    factor = word->termFactor[k] * scale;
+    if (factor != 1) {
+      emit(code, OP_LC, DC_VALUE, factor);
+      emit(code, OP_ML, DC_VALUE, 0);
+    }
+    if (k > 0)
+      emit(code, OP_AD, DC_VALUE, 0);
+  }
+}
+
+static void appendCode(IRBlock* block, Code* code) {
+  int i;
+
+  for (i = 0; i < code->length; i ++)
+    insertInstruction(block, block->length, code->code[i]);
+}
+
+// Drops the code of the word, leaving inst to push it
+static void replaceWord(IRBlock* block, Word* word, Instruction inst) {
+  IRInstruction* ir;
+  int i;
+
+  for (i = word->start; i < word->end; i ++)
+    if (!block->code[i].deleted)
+      deleteInstruction(block->code + i);
+  ir = block->code + word->end;
+  ir->inst = inst;
+  ir->slot = NO_SLOT;
+  ir->value = NO_VALUE;
+  ir->pair = -1;
+}
+
+static void deleteCode(IRBlock* block, int start, int end) {
+  for (; start <= end; start ++)
+    if (!block->code[start].deleted)
+      deleteInstruction(block->code + start);
+}
+
+static Instruction makeInstruction(enum OpCode op, WORD p, WORD q) {
+  Instruction inst;
+
+  inst.op = op;
+  inst.p = p;
+  inst.q = q;
+  return inst;
+}
+
+/******************************************************************/
+
+// A new block before the one at position, keeping the members of loop in step
+static IRBlock* newBlock(IRFunction* function, Loop* loop, int position) {
+  IRBlock* block = insertBlock(function, position);
+
+  loop->member = (char*) realloc(loop->member, function->blockCount);
+  memmove(loop->member + position + 1, loop->member + position, function->blockCount - 1 - position);
+  loop->member[position] = 0;
+  return block;
+}
+
+static void redirectEntries(IRFunction* function, Loop* loop, IRBlock* from, IRBlock* to) {
+  IRBlock* block;
+  int b;
+
+  for (b = 0; b < function->blockCount; b ++) {
+    block = function->blocks[b];
+    if (loop->member[b] || (block == to)) continue;
+    if (block->next == from) block->next = to;
+    if (block->target == from) block->target = to;
+  }
+}
+
+// The only block the loop is entered from, made if there is none that only falls into it
+static IRBlock* findPreheader(IRFunction* function, Loop* loop) {
+  IRBlock* header = loop->header;
+  IRBlock* entry = NULL;
+  IRBlock* block;
+  int k;
+
+  for (k = 0; k < header->predCount; k ++) {
+    block = header->preds[k];
+    if (loop->member[block->id] || (block == entry)) continue;
+    if (entry != NULL) {
+      entry = NULL;
+      break;
+    }
+    entry = block;
+  }
+  if ((entry != NULL) && (entry->next == header) && (entry->target == NULL))
+    return entry;
+
+  block = newBlock(function, loop, header->id);
+  block->height = header->height;
+  redirectEntries(function, loop, header, block);
+  block->next = header;
+  return block;
+}
+
+/*
+ * Turns a loop whose header tests whether to leave it into one that
+ * tests at the bottom: a copy of the header decides whether to start the
+ * loop at all, then falls into the new preheader, which goes on to the
+ * body.  The header is left where it was, as the test before each
+ * further iteration.
+ */
+static IRBlock* rotateLoop(IRFunction* function, Loop* loop) {
+  IRBlock* header = loop->header;
+  IRBlock* guard = newBlock(function, loop, header->id);
+  IRBlock* preheader = newBlock(function, loop, header->id);
+  int i;
+
+  for (i = 0; i < header->length; i ++)
+    if (!header->code[i].deleted)
+      insertInstruction(guard, guard->length, header->code[i].inst);
+  guard->height = header->height;
+  redirectEntries(function, loop, header, guard);
+  guard->next = preheader;
+  guard->target = header->target;
+  preheader->height = header->next->height;
+  preheader->next = header->next;
+  return preheader;
+}
+
+static int canRotate(Loop* loop) {
+  IRBlock* header = loop->header;
+  int last = lastInstruction(header);
+
+  return (last >= 0) && (header->code[last].inst.op == OP_FJ)
+    && (header->next != NULL) && loop->member[header->next->id]
+    && (header->target != NULL) && !loop->member[header->target->id]
+    && !sideEffectBefore(header, header->length);
+}
+
+/******************************************************************/
+
+static int countStores(IRFunction* function, Loop* loop, int slot, IRBlock** block, int* index) {
+  IRBlock* other;
+  int count = 0;
+  int b, i;
+
+  for (b = 0; b < function->blockCount; b ++) {
+    if (!loop->member[b]) continue;
+    other = function->blocks[b];
+    for (i = 0; i < other->length; i ++)
+      if (!other->code[i].deleted && (other->code[i].inst.op == OP_ST) && (other->code[i].slot == slot)) {
+	*block = other;
+	*index = i;
+	count ++;
+      }
+  }
+  return count;
+}
+
+// Whether all the reads of the scalar in the loop read value
+static int onlyReads(IRFunction* function, Loop* loop, int slot, int value) {
+  IRBlock* block;
+  IRInstruction* ir;
+  int b, i;
+
+  for (b = 0; b < function->blockCount; b ++) {
+    if (!loop->member[b]) continue;
+    block = function->blocks[b];
+    for (i = 0; i < block->length; i ++) {
+      ir = block->code + i;
+      if (!ir->deleted && ((ir->inst.op == OP_LV) || (ir->inst.op == OP_LI))
+	  && (ir->slot == slot) && (ir->value != value))
+	return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * A store LA 0,x; tree; ST of a scalar that the loop writes nowhere else
+ * and only ever reads this value of, with the tree invariant.  Returns
+ * the root of its tree, NULL when the store is not one.
+ */
+static Root* invariantStore(IRFunction* function, Loop* loop, Scan* scan, IRBlock* block, int index) {
+  IRInstruction* ir = block->code + index;
+  IRBlock* other;
+  Root* root;
+  int k;
+
+  if ((ir->inst.op != OP_ST) || (ir->slot == NO_SLOT) || (ir->pair < 0)
+      || (block->code[ir->pair].inst.op != OP_LA))
+    return NULL;
+  root = rootTakenBy(scan, block, index);
+  if ((root == NULL) || (root->word.kind != WORD_INVARIANT)
+      || (nextInstruction(block, ir->pair) != root->word.start)
+      || (nextInstruction(block, root->word.end) != index))
+    return NULL;
+  if ((countStores(function, loop, ir->slot, &other, &k) != 1)
+      || !onlyReads(function, loop, ir->slot, ir->value))
+    return NULL;
+  return root;
+}
+
+// Whether the root is worth a local of its own
+static int isHoistable(Root* root) {
+  IRInstruction* ir = root->block->code + root->word.end;
+
+  return (root->word.kind == WORD_INVARIANT) && (root->word.length >= 2)
+    && !((root->word.length == 2) && (ir->inst.op == OP_LI) && (ir->slot != NO_SLOT));
+}
+
+static int isAllowedInInnerLoop(IRInstruction* ir) {
+  switch (ir->inst.op) {
+  case OP_LA: case OP_LV: case OP_LI: case OP_ST: case OP_CV:
+    return ir->slot != NO_SLOT;
+  case OP_LC: case OP_J: case OP_FJ: case OP_NEG:
+  case OP_AD: case OP_SB: case OP_ML: case OP_DV:
+  case OP_EQ: case OP_NE: case OP_GT: case OP_LT: case OP_GE: case OP_LE:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+// Whether value is given by the stores in front of the inner loop, or inside it
+static int isInnerValue(IRFunction* function, InnerLoop* inner, char* inside, int value) {
+  IRValue* definition;
+
+  if (value == NO_VALUE)
+    return 0;
+  definition = function->values + value;
+  return inside[definition->block->id]
+    || ((definition->kind == VALUE_STORE) && (definition->block == inner->entry)
+	&& (definition->index >= inner->start));
+}
+
+// Whether the inner loop may read value when it runs in front of the loop
+static int isOuterValue(IRFunction* function, Loop* loop, InnerLoop* inner, char* inside, int value) {
+  return (value != NO_VALUE)
+    && (!loop->member[function->values[value].block->id] || isInnerValue(function, inner, inside, value));
+}
+
+/*
+ * An inner loop like the one genPower() makes: it only computes scalars,
+ * from values the outer loop does not change or that the stores just in
+ * front of it give, and the outer loop reads what it writes only after
+ * it.  Its blocks are left in inner->blocks.
+ */
+static int isInvariantLoop(IRProgram* program, IRFunction* function, Loop* loop, Loop* candidate,
+			   Scan* scan, int guarded, InnerLoop* inner) {
+  IRBlock* header = candidate->header;
+  char* written = (char*) calloc(function->localSize + 1, 1);
+  IRBlock* block;
+  IRInstruction* ir;
+  IRValue* value;
+  Root* root;
+  int ok = 1;
+  int b, i, k, need, delta, height, lowest, start;
+
+  inner->entry = NULL;
+  inner->exit = NULL;
+  inner->after = NULL;
+  inner->blockCount = 0;
+  inner->blocks = (IRBlock**) malloc(function->blockCount * sizeof(IRBlock*));
+  for (k = 0; ok && (k < header->predCount); k ++) {
+    block = header->preds[k];
+    if (candidate->member[block->id]) continue;
+    if ((inner->entry != NULL) || (block->next != header) || (block->target != NULL))
+      ok = 0;
+    inner->entry = block;
+  }
+  for (b = 0; ok && (b < function->blockCount); b ++) {
+    if (!candidate->member[b]) continue;
+    block = function->blocks[b];
+    inner->blocks[inner->blockCount++] = block;
+    if ((block->next == NULL) && (block->target == NULL))
+      ok = 0;
+    for (k = 0; ok && (k < 2); k ++) {
+      IRBlock* succ = (k == 0) ? block->next : block->target;
+      if ((succ == NULL) || candidate->member[succ->id]) continue;
+      if ((inner->exit != NULL) || !loop->member[succ->id])
+	ok = 0;
+      inner->exit = block;
+      inner->after = succ;
+    }
+    // Its code must not reach under the words it starts with
+    height = block->height;
+    lowest = header->height;
+    if (height < lowest)
+      ok = 0;
+    for (i = 0; ok && (i < block->length); i ++) {
+      ir = block->code + i;
+      if (ir->deleted) continue;
+      if (!isAllowedInInnerLoop(ir)) {
+	ok = 0;
+	break;
+      }
+      instructionEffect(program, &ir->inst, &need, &delta);
+      if (height - need < lowest)
+	ok = 0;
+      height += delta;
+      if (ir->inst.op == OP_ST)
+	written[ir->slot] = 1;
+    }
+  }
+  if (!ok || (inner->entry == NULL) || (inner->exit == NULL) || (inner->after == NULL)) {
+    free(written);
+    return 0;
+  }
+
+  // The stores of what it writes that the entry ends with
+  block = inner->entry;
+  start = block->length;
+  for (i = lastInstruction(block); i >= 0; ) {
+    ir = block->code + i;
+    if ((ir->inst.op != OP_ST) || (ir->slot == NO_SLOT) || !written[ir->slot] || (ir->pair < 0)
+	|| (block->code[ir->pair].inst.op != OP_LA))
+      break;
+    root = rootTakenBy(scan, block, i);
+    if ((root == NULL) || (root->word.kind != WORD_INVARIANT)
+	|| (nextInstruction(block, ir->pair) != root->word.start)
+	|| (nextInstruction(block, root->word.end) != i))
+      break;
+    start = ir->pair;
+    for (i = ir->pair - 1; (i >= 0) && block->code[i].deleted; i --)
+      ;
+  }
+  inner->start = start;
+
+  // The height the stores start at is the one the loop goes on with
+  height = block->height;
+  for (i = 0; i < start; i ++)
+    if (!block->code[i].deleted) {
+      instructionEffect(program, &block->code[i].inst, &need, &delta);
+      height += delta;
+    }
+  if ((height != header->height) || (inner->after->height != height)) {
+    free(written);
+    return 0;
+  }
+
+  for (b = 0; ok && (b < function->blockCount); b ++) {
+    if (!loop->member[b]) continue;
+    block = function->blocks[b];
+    for (i = 0; ok && (i < block->length); i ++) {
+      ir = block->code + i;
+      if (ir->deleted || (ir->slot == NO_SLOT)) continue;
+      if ((ir->inst.op == OP_ST) && written[ir->slot] && !candidate->member[b]
+	  && !((block == inner->entry) && (i >= start)))
+	ok = 0;
+      else if (((ir->inst.op == OP_LV) || (ir->inst.op == OP_LI)) && candidate->member[b])
+	ok = isOuterValue(function, loop, inner, candidate->member, ir->value);
+      else if (((ir->inst.op == OP_LV) || (ir->inst.op == OP_LI)) && written[ir->slot])
+	ok = isInnerValue(function, inner, candidate->member, ir->value);
+    }
+    if (!candidate->member[b]) continue;
+    for (k = 0; ok && (k < block->phiCount); k ++) {
+      value = function->values + block->phis[k];
+      for (i = 0; ok && (i < block->predCount); i ++)
+	ok = isOuterValue(function, loop, inner, candidate->member, value->operands[i]);
+    }
+  }
+  free(written);
+  return ok && anticipable(function, loop, inner->entry, start, guarded);
+}
+
+static int findInvariantLoop(IRProgram* program, IRFunction* function, Loop* loop, Loop* loops, int count,
+			     Scan* scan, int guarded, InnerLoop* inner) {
+  int i, b;
+
+  for (i = 0; i < count; i ++) {
+    if ((loops + i == loop) || (loops[i].size >= loop->size) || !loop->member[loops[i].header->id])
+      continue;
+    for (b = 0; (b < function->blockCount) && (!loops[i].member[b] || loop->member[b]); b ++)
+      ;
+    if (b < function->blockCount) continue;
+    if (isInvariantLoop(program, function, loop, loops + i, scan, guarded, inner))
+      return 1;
+    free(inner->blocks);
+  }
+  return 0;
+}
+
+/*
+ * Runs the inner loop in front of the loop instead: the preheader takes
+ * the stores in front of it and falls into it, and it leaves to where the
+ * preheader went.
+ */
+static void moveInnerLoop(IRFunction* function, InnerLoop* inner, IRBlock* preheader) {
+  IRBlock* entry = inner->entry;
+  IRBlock* next = preheader->next;
+  Code code = { NULL, 0, 0 };
+  int delta = next->height - entry->next->height;
+  int k;
+
+  copyCode(&code, entry, inner->start, entry->length - 1);
+  appendCode(preheader, &code);
+  free(code.code);
+  deleteCode(entry, inner->start, entry->length - 1);
+
+  for (k = 0; k < inner->blockCount; k ++)
+    inner->blocks[k]->height += delta;
+  if (inner->exit->next == inner->after) inner->exit->next = next;
+  if (inner->exit->target == inner->after) inner->exit->target = next;
+  preheader->next = entry->next;
+  entry->next = inner->after;
+  for (k = 0; k < inner->blockCount; k ++)
+    moveBlock(function, inner->blocks[k], ((k == 0) ? preheader : inner->blocks[k - 1])->id + 1);
+}
+
+/******************************************************************/
+
+/*
+ * Moves what the loop computes the same in every iteration in front of
+ * it: trees of invariant words, each into a local of its own, stores of
+ * invariant values to scalars, and inner loops such as those of **.  A
+ * loop that tests at the top is rotated first (see rotateLoop()).
+ */
+static int hoistFromLoop(IRProgram* program, IRFunction* function, Loop* loop, Loop* loops, int count) {
+  int guarded = canRotate(loop);
+  IRBlock* preheader = NULL;
+  Scan scan;
+  InnerLoop inner;
+  Root** stores;
+  Root* root;
+  IRBlock* block;
+  Code code = { NULL, 0, 0 };
+  char* taken;
+  int storeCount = 0;
+  int treeCount = 0;
+  int hasInner = 0;
+  int b, i, slot;
+
+  scanLoop(program, function, loop, NO_VALUE, &scan);
+  stores = (Root**) malloc((scan.rootCount + 1) * sizeof(Root*));
+  taken = (char*) calloc(scan.rootCount + 1, 1);
+  for (b = 0; b < function->blockCount; b ++) {
+    if (!loop->member[b]) continue;
+    block = function->blocks[b];
+    for (i = 0; i < block->length; i ++) {
+      if (block->code[i].deleted) continue;
+      root = invariantStore(function, loop, &scan, block, i);
+      if ((root != NULL) && anticipable(function, loop, block, block->code[i].pair, guarded)) {
+	stores[storeCount++] = root;
+	taken[root - scan.roots] = 1;
+      }
+    }
+  }
+  for (i = 0; i < scan.rootCount; i ++) {
+    root = scan.roots + i;
+    if (taken[i] || !isHoistable(root)
+	|| !anticipable(function, loop, root->block, root->word.start, guarded))
+      taken[i] = 1;
+    else treeCount ++;
+  }
+  if ((storeCount == 0) && (treeCount == 0)) {
+    hasInner = findInvariantLoop(program, function, loop, loops, count, &scan, guarded, &inner);
+    if (hasInner && guarded)
+      free(inner.blocks);
+  }
+
+  if ((storeCount > 0) || (treeCount > 0) || hasInner)
+    preheader = guarded ? rotateLoop(function, loop) : findPreheader(function, loop);
+
+  for (i = 0; i < storeCount; i ++) {
+    root = stores[i];
+    block = root->block;
+    slot = block->code[root->consumer].slot;
+    code.length = 0;
+    emit(&code, OP_LA, 0, slot);
+    copyCode(&code, block, root->word.start, root->word.end);
+    emit(&code, OP_ST, DC_VALUE, 0);
+    appendCode(preheader, &code);
+    deleteCode(block, block->code[root->consumer].pair, root->consumer);
+  }
+  for (i = 0; i < scan.rootCount; i ++) {
+    if (taken[i]) continue;
+    root = scan.roots + i;
+    slot = addLocal(function);
+    code.length = 0;
+    emit(&code, OP_LA, 0, slot);
+    copyCode(&code, root->block, root->word.start, root->word.end);
+    emit(&code, OP_ST, DC_VALUE, 0);
+    appendCode(preheader, &code);
+    replaceWord(root->block, &root->word, makeInstruction(OP_LV, 0, slot));
+  }
+  if (hasInner && !guarded) {
+    moveInnerLoop(function, &inner, preheader);
+    free(inner.blocks);
+  }
+
+  free(code.code);
+  free(stores);
+  free(taken);
+  free(scan.roots);
+  return preheader != NULL;
+}
+
+/******************************************************************/
+
+static int isSafeTerm(IRBlock* block, Word* word) {
+  IRInstruction* ir;
+  int k, i;
+
+  for (k = 0; k < word->termCount; k ++)
+    for (i = word->termStart[k]; i <= word->termEnd[k]; i ++) {
+      ir = block->code + i;
+      if (!ir->deleted && ((ir->inst.op == OP_DV) || ((ir->inst.op == OP_LI) && (ir->slot == NO_SLOT))))
+	return 0;
+    }
+  return 1;
+}
+
+static int sameCode(IRBlock* a, int startA, int endA, IRBlock* b, int startB, int endB) {
+  Code x = { NULL, 0, 0 };
+  Code y = { NULL, 0, 0 };
+  int same, i;
+
+  copyCode(&x, a, startA, endA);
+  copyCode(&y, b, startB, endB);
+  same = (x.length == y.length);
+  for (i = 0; same && (i < x.length); i ++)
+    same = (x.code[i].op == y.code[i].op) && (x.code[i].p == y.code[i].p) && (x.code[i].q == y.code[i].q);
+  free(x.code);
+  free(y.code);
+  return same;
+}
+
+static int sameInduction(Root* a, Root* b) {
+  int k;
+
+  if ((a->word.factor != b->word.factor) || (a->word.termCount != b->word.termCount))
+    return 0;
+  for (k = 0; k < a->word.termCount; k ++)
+    if ((a->word.termFactor[k] != b->word.termFactor[k])
+	|| !sameCode(a->block, a->word.termStart[k], a->word.termEnd[k],
+		     b->block, b->word.termStart[k], b->word.termEnd[k]))
+      return 0;
+  return 1;
+}
+
+// The step of the induction variable times factor, as code
+static void stepCode(Code* code, Root* increment, WORD factor) {
+  Word* word = &increment->word;
+  IRInstruction* ir = increment->block->code + word->termStart[0];
+
+  if ((word->termCount == 1) && (word->termStart[0] == word->termEnd[0]) && (ir->inst.op == OP_LC)
+      && (ir->inst.q >= -MAX_FACTOR) && (ir->inst.q <= MAX_FACTOR))
+    emit(code, OP_LC, DC_VALUE, ir->inst.q * word->termFactor[0] * factor);
+  else copyTerms(code, increment->block, word, factor);
+}
+
+/*
+ * Reduces the uses of one induction variable of the loop: the scalar of
+ * the phi that the header has for it, stored once in the loop with its
+ * value plus an invariant step.  Uses that are the same multiple of it
+ * plus the same invariant terms, array addresses mostly, read a new local
+ * instead, which starts as their value in the preheader and takes the
+ * step times the factor after each store of the variable.
+ */
+static int reduceVariable(IRProgram* program, IRFunction* function, Loop* loop, int induction) {
+  IRValue* phi = function->values + induction;
+  IRBlock* header = loop->header;
+  IRBlock* block = NULL;
+  IRBlock* preheader;
+  Scan scan;
+  Root* increment;
+  Root* use;
+  Code update = { NULL, 0, 0 };
+  Code init = { NULL, 0, 0 };
+  char* done;
+  int store = -1;
+  int changed = 0;
+  int i, j, k, saving, slot;
+
+  if ((countStores(function, loop, phi->slot, &block, &store) != 1) || (block->code[store].value == NO_VALUE))
+    return 0;
+  for (k = 0; k < header->predCount; k ++)
+    if (loop->member[header->preds[k]->id] && (phi->operands[k] != block->code[store].value))
+      return 0;
+
+  scanLoop(program, function, loop, induction, &scan);
+  increment = rootTakenBy(&scan, block, store);
+  if ((increment == NULL) || (increment->word.kind != WORD_INDUCTION) || (increment->word.factor != 1)
+      || (increment->word.termCount == 0) || !isSafeTerm(block, &increment->word)) {
+    free(scan.roots);
+    return 0;
+  }
+
+  done = (char*) calloc(scan.rootCount + 1, 1);
+  for (i = 0; (i < scan.rootCount) && !changed; i ++) {
+    use = scan.roots + i;
+    if (done[i] || (use == increment) || (use->word.kind != WORD_INDUCTION) || (use->word.length < 3)
+	|| !isSafeTerm(use->block, &use->word))
+      continue;
+    saving = 0;
+    for (j = i; j < scan.rootCount; j ++)
+      if (!done[j] && (scan.roots + j != increment) && (scan.roots[j].word.kind == WORD_INDUCTION)
+	  && sameInduction(use, scan.roots + j)) {
+	done[j] = 2;
+	saving += scan.roots[j].word.length - 1;
+      }
+
+    update.length = 0;
+    emit(&update, OP_LA, 0, 0);
+    emit(&update, OP_LV, 0, 0);
+    stepCode(&update, increment, use->word.factor);
+    emit(&update, OP_AD, DC_VALUE, 0);
+    emit(&update, OP_ST, DC_VALUE, 0);
+    if (saving <= update.length) {
+      for (j = i; j < scan.rootCount; j ++)
+	if (done[j] == 2) done[j] = 1;
+      continue;
+    }
+
+    slot = addLocal(function);
+    update.code[0].q = slot;
+    update.code[1].q = slot;
+    init.length = 0;
+    emit(&init, OP_LA, 0, slot);
+    copyTerms(&init, use->block, &use->word, 1);
+    emit(&init, OP_LV, 0, phi->slot);
+    if (use->word.factor != 1) {
+      emit(&init, OP_LC, DC_VALUE, use->word.factor);
+      emit(&init, OP_ML, DC_VALUE, 0);
+    }
+    if (use->word.termCount > 0)
+      emit(&init, OP_AD, DC_VALUE, 0);
+    emit(&init, OP_ST, DC_VALUE, 0);
+    preheader = findPreheader(function, loop);
+    appendCode(preheader, &init);
+
+    for (j = i; j < scan.rootCount; j ++)
+      if (done[j] == 2)
+	replaceWord(scan.roots[j].block, &scan.roots[j].word, makeInstruction(OP_LV, 0, slot));
+    for (k = 0; k < update.length; k ++)
+      insertInstruction(block, store + 1 + k, update.code[k]);
+    changed = 1;
+  }
+
+  free(update.code);
+  free(init.code);
+  free(done);
+  free(scan.roots);
+  return changed;
+}
+
+static int reduceLoop(IRProgram* program, IRFunction* function, Loop* loop, Loop* loops, int count) {
+  IRBlock* header = loop->header;
+  int k;
+
+  for (k = 0; k < header->phiCount; k ++)
+    if (reduceVariable(program, function, loop, header->phis[k]))
+      return 1;
+  return 0;
+}
+
+/******************************************************************/
+
+typedef int (*LoopRewrite)(IRProgram* program, IRFunction* function, Loop* loop, Loop* loops, int count);
+
+// Rewrites one loop at a time, inner ones first, analysing the function again after each
+static int rewriteLoops(IRProgram* program, IRFunction* function, LoopRewrite rewrite) {
+  Loop* loops;
+  int changed = 0;
+  int rewritten = 1;
+  int round, count, i;
+
+  for (round = 0; rewritten && (round < MAX_REWRITES); round ++) {
+    if (!function->analysed)
+      analyseFunction(program, function);
+    loops = findLoops(function, &count);
+    rewritten = 0;
+    for (i = 0; (i < count) && !rewritten; i ++)
+      rewritten = rewrite(program, function, loops + i, loops, count);
+    freeLoops(loops, count);
+    if (rewritten) {
+      invalidateFunction(function);
+      changed = 1;
+    }
+  }
+  return changed;
+}
+
+int reduceInductions(IRProgram* program, IRFunction* function) {
+  return rewriteLoops(program, function, reduceLoop);
+}
+
+int hoistInvariants(IRProgram* program, IRFunction* function) {
+  return rewriteLoops(program, function, hoistFromLoop);
+}
@@ -1,27 +1,98 @@
-/* 
- * @copyright (c) 2008, Hedspi, Hanoi University of Technology
- * @author Huu-Duc Nguyen
- * @version 1.0
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-
-#include "reader.h"
-#include "parser.h"
-
-/******************************************************************/
-
-int main(int argc, char *argv[]) {
-  if (argc <= 1) {
-    printf("parser: no input file.\n");
-    return -1;
-  }
-
-  if (compile(argv[1]) == IO_ERROR) {
-    printf("Can\'t read input file!\n");
-    return -1;
-  }
-    
-  return 0;
-}
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reader.h"
+#include "parser.h"
+#include "codegen.h"
+#include "passes.h"
+
+char* outputName;
+int dumpCode;
+int printIR;
+int noOptimize;
+
+void printUsage(void) {
+  printf("Usage: kplc input [-o=file] [-dump] [-ir] [-noopt] [-nofold]\n");
+  printf("   input: input kpl program\n");
+  printf("   -o=file: write the executable to file\n");
+  printf("   -dump: print the generated code\n");
+  printf("   -ir: print the optimized IR\n");
+  printf("   -noopt: write the code as the parser generates it\n");
+  printf("   -nofold: compute constant expressions at run time\n");
+  printf("   with none of -o, -dump and -ir, the symbol table is printed\n");
+}
+
+int analyseParam(char* param) {
+  if (strncmp(param, "-o=", 3) == 0) {
+    outputName = param+3;
+    return 1;
+  }
+  if (strcmp(param, "-dump") == 0) {
+    dumpCode = 1;
+    return 1;
+  }
+  if (strcmp(param, "-ir") == 0) {
+    printIR = 1;
+    return 1;
+  }
+  if (strcmp(param, "-noopt") == 0) {
+    noOptimize = 1;
+    return 1;
+  }
+  if (strcmp(param, "-nofold") == 0) {
+    foldKnownValues = 0;
+    return 1;
+  }
+  return 0;
+}
+
+/******************************************************************/
+
+int main(int argc, char *argv[]) {
+  int i, optimize;
+
+  outputName = NULL;
+  dumpCode = 0;
+  printIR = 0;
+  noOptimize = 0;
+
+  if (argc <= 1) {
+    printf("parser: no input file.\n");
+    printUsage();
+    return -1;
+  }
+
+  for (i = 2; i < argc; i++)
+    if (analyseParam(argv[i]) == 0) {
+      printUsage();
+      return -1;
+    }
+
+  if (noOptimize)
+    optimize = OPTIMIZE_NONE;
+  else
+    optimize = printIR ? OPTIMIZE_PRINT : OPTIMIZE_CODE;
+  if (compile(argv[1], (outputName == NULL) && !dumpCode && !printIR, optimize) == IO_ERROR) {
+    printf("Can\'t read input file!\n");
+    return -1;
+  }
+
+  if (dumpCode)
+    printCodeBuffer();
+
+  if ((outputName != NULL) && (serialize(outputName) == IO_ERROR)) {
+    printf("Can\'t write %s!\n", outputName);
+    cleanCodeBuffer();
+    return -1;
+  }
+
+  cleanCodeBuffer();
+  return 0;
+}
@@ -1,1151 +1,1647 @@
-/* 
- * @copyright (c) 2008, Hedspi, Hanoi University of Technology
- * @author Huu-Duc Nguyen
- * @version 1.0
- */
-#include <stdio.h>
-#include <stdlib.h>
-
-#include "reader.h"
-#include "scanner.h"
-#include "parser.h"
-#include "semantics.h"
-#include "error.h"
-#include "debug.h"
-
-Token *currentToken;
-Token *lookAhead;
-
-extern Type *intType;
-extern Type *charType;
-extern SymTab *symtab;
-
-void scan(void)
-{
-  Token *tmp = currentToken;
-  currentToken = lookAhead;
-  lookAhead = getValidToken();
-  free(tmp);
-}
-
-void eat(TokenType tokenType)
-{
-  if (lookAhead->tokenType == tokenType)
-  {
-    scan();
-  }
-  else
-    missingToken(tokenType, lookAhead->lineNo, lookAhead->colNo);
-}
-
-void compileProgram(void)
-{
-  Object *program;
-
-  eat(KW_PROGRAM);
-  eat(TK_IDENT);
-
-  program = createProgramObject(currentToken->string);
-  enterBlock(program->progAttrs->scope);
-
-  eat(SB_SEMICOLON);
-
-  compileBlock();
-  eat(SB_PERIOD);
-
-  exitBlock();
-}
-
-void compileBlock(void)
-{
-  Object *constObj;
-  ConstantValue *constValue;
-
-  if (lookAhead->tokenType == KW_CONST)
-  {
-    eat(KW_CONST);
-
-    do
-    {
-      eat(TK_IDENT);
-
-      checkFreshIdent(currentToken->string);
-      constObj = createConstantObject(currentToken->string);
-
-      eat(SB_EQ);
-      constValue = compileConstant();
-
-      constObj->constAttrs->value = constValue;
-      declareObject(constObj);
-
-      eat(SB_SEMICOLON);
-    } while (lookAhead->tokenType == TK_IDENT);
-
-    compileBlock2();
-  }
-  else
-    compileBlock2();
-}
-
-void compileBlock2(void)
-{
-  Object *typeObj;
-  Type *actualType;
-
-  if (lookAhead->tokenType == KW_TYPE)
-  {
-    eat(KW_TYPE);
-
-    do
-    {
-      eat(TK_IDENT);
-
-      checkFreshIdent(currentToken->string);
-      typeObj = createTypeObject(currentToken->string);
-
-      eat(SB_EQ);
-      actualType = compileType();
-
-      typeObj->typeAttrs->actualType = actualType;
-      declareObject(typeObj);
-
-      eat(SB_SEMICOLON);
-    } while (lookAhead->tokenType == TK_IDENT);
-
-    compileBlock3();
-  }
-  else
-    compileBlock3();
-}
-
-void compileBlock3(void)
-{
-  Object *varObj;
-  Type *varType;
-
-  if (lookAhead->tokenType == KW_VAR)
-  {
-    eat(KW_VAR);
-
-    do
-    {
-      eat(TK_IDENT);
-
-      checkFreshIdent(currentToken->string);
-      varObj = createVariableObject(currentToken->string);
-
-      eat(SB_COLON);
-      varType = compileType();
-
-      varObj->varAttrs->type = varType;
-      declareObject(varObj);
-
-      eat(SB_SEMICOLON);
-    } while (lookAhead->tokenType == TK_IDENT);
-
-    compileBlock4();
-  }
-  else
-    compileBlock4();
-}
-
-void compileBlock4(void)
-{
-  compileSubDecls();
-  compileBlock5();
-}
-
-void compileBlock5(void)
-{
-  eat(KW_BEGIN);
-  compileStatements();
-  eat(KW_END);
-}
-
-void compileSubDecls(void)
-{
-  while ((lookAhead->tokenType == KW_FUNCTION) || (lookAhead->tokenType == KW_PROCEDURE))
-  {
-    if (lookAhead->tokenType == KW_FUNCTION)
-      compileFuncDecl();
-    else
-      compileProcDecl();
-  }
-}
-
-void compileFuncDecl(void)
-{
-  Object *funcObj;
-  Type *returnType;
-
-  eat(KW_FUNCTION);
-  eat(TK_IDENT);
-
-  checkFreshIdent(currentToken->string);
-  funcObj = createFunctionObject(currentToken->string);
-  declareObject(funcObj);
-
-  enterBlock(funcObj->funcAttrs->scope);
-
-  compileParams();
-  eat(SB_COLON);
-  returnType = compileBasicType();
-  funcObj->funcAttrs->returnType = returnType;
-
-  eat(SB_SEMICOLON);
-  compileBlock();
-  eat(SB_SEMICOLON);
-
-  exitBlock();
-}
-
-void compileProcDecl(void)
-{
-  Object *procObj;
-
-  eat(KW_PROCEDURE);
-  eat(TK_IDENT);
-
-  checkFreshIdent(currentToken->string);
-  procObj = createProcedureObject(currentToken->string);
-  declareObject(procObj);
-
-  enterBlock(procObj->procAttrs->scope);
-
-  compileParams();
-
-  eat(SB_SEMICOLON);
-  compileBlock();
-  eat(SB_SEMICOLON);
-
-  exitBlock();
-}
-
-ConstantValue *compileUnsignedConstant(void)
-{
-  ConstantValue *constValue;
-  Object *obj;
-
-  switch (lookAhead->tokenType)
-  {
-  case TK_INTEGER:
-    eat(TK_INTEGER);
-    constValue = makeIntConstant(currentToken->intValue);
-    break;
-  case TK_IDENT:
-    eat(TK_IDENT);
-
-    obj = checkDeclaredConstant(currentToken->string);
-    constValue = duplicateConstantValue(obj->constAttrs->value);
-
-    break;
-  case TK_CHAR:
-    eat(TK_CHAR);
-    constValue = makeCharConstant(currentToken->string[0]);
-    break;
-  case TK_DOUBLE:
-    eat(TK_DOUBLE);
-    constValue = makeDoubleConstant(currentToken->doubleValue);
-    break;
-
-  case TK_STRING:
-    eat(TK_STRING);
-    constValue = makeStringConstant(currentToken->string);
-    break;
-  default:
-    error(ERR_INVALID_CONSTANT, lookAhead->lineNo, lookAhead->colNo);
-    break;
-  }
-  return constValue;
-}
-
-ConstantValue *compileConstant(void)
-{
-  ConstantValue *constValue;
-
-  switch (lookAhead->tokenType)
-  {
-  case SB_PLUS:
-    eat(SB_PLUS);
-    constValue = compileConstant2();
-    break;
-  case SB_MINUS:
-    eat(SB_MINUS);
-    constValue = compileConstant2();
-    constValue->intValue = -constValue->intValue;
-    break;
-  case TK_CHAR:
-    eat(TK_CHAR);
-    constValue = makeCharConstant(currentToken->string[0]);
-    break;
-  default:
-    constValue = compileConstant2();
-    break;
-  }
-  return constValue;
-}
-
-ConstantValue *compileConstant2(void)
-{
-  ConstantValue *constValue;
-  Object *obj;
-
-  switch (lookAhead->tokenType)
-  {
-  case TK_INTEGER:
-    eat(TK_INTEGER);
-    constValue = makeIntConstant(currentToken->intValue);
-    break;
-  case TK_STRING:
-    eat(TK_STRING);
-    constValue = makeStringConstant(currentToken->string);
-    break;
-  case TK_DOUBLE:
-    eat(TK_DOUBLE);
-    constValue = makeDoubleConstant(currentToken->doubleValue);
-    break;
-  case TK_IDENT:
-    eat(TK_IDENT);
-    obj = checkDeclaredConstant(currentToken->string);
-    if (obj->constAttrs->value->type != TP_ARRAY)
-      constValue = duplicateConstantValue(obj->constAttrs->value);
-    break;
-  default:
-    error(ERR_INVALID_CONSTANT, lookAhead->lineNo, lookAhead->colNo);
-    break;
-  }
-  return constValue;
-}
-
-Type *compileType(void)
-{
-  Type *type;
-  Type *elementType;
-  int arraySize;
-  Object *obj;
-
-  switch (lookAhead->tokenType)
-  {
-  case KW_INTEGER:
-    eat(KW_INTEGER);
-    type = makeIntType();
-    break;
-  case KW_CHAR:
-    eat(KW_CHAR);
-    type = makeCharType();
-    break;
-  case KW_DOUBLE:
-    eat(KW_DOUBLE);
-    type = makeDoubleType();
-    break;
-  case KW_STRING:
-    eat(KW_STRING);
-    type = makeStringType();
-    break;
-  case KW_ARRAY:
-    eat(KW_ARRAY);
-    eat(SB_LSEL);
-    eat(TK_INTEGER);
-    arraySize = currentToken->intValue;
-
-    eat(SB_RSEL);
-    eat(KW_OF);
-    elementType = compileType();
-    type = makeArrayType(arraySize, elementType);
-    break;
-  case TK_IDENT:
-    eat(TK_IDENT);
-    obj = checkDeclaredType(currentToken->string);
-    type = duplicateType(obj->typeAttrs->actualType);
-    break;
-  default:
-    error(ERR_INVALID_TYPE, lookAhead->lineNo, lookAhead->colNo);
-    break;
-  }
-  return type;
-}
-
-Type *compileBasicType(void)
-{
-  Type *type;
-
-  switch (lookAhead->tokenType)
-  {
-  case KW_INTEGER:
-    eat(KW_INTEGER);
-    type = makeIntType();
-    break;
-  case KW_DOUBLE:
-    eat(KW_DOUBLE);
-    type = makeDoubleType();
-    break;
-  case KW_CHAR:
-    eat(KW_CHAR);
-    type = makeCharType();
-    break;
-  case KW_STRING:
-    eat(KW_STRING);
-    type = makeStringType();
-    break;
-  default:
-    error(ERR_INVALID_BASICTYPE, lookAhead->lineNo, lookAhead->colNo);
-    break;
-  }
-  return type;
-}
-
-void compileParams(void)
-{
-  if (lookAhead->tokenType == SB_LPAR)
-  {
-    eat(SB_LPAR);
-    compileParam();
-    while (lookAhead->tokenType == SB_SEMICOLON)
-    {
-      eat(SB_SEMICOLON);
-      compileParam();
-    }
-    eat(SB_RPAR);
-  }
-}
-
-void compileParam(void)
-{
-  Object *param;
-  Type *type;
-  enum ParamKind paramKind;
-
-  switch (lookAhead->tokenType)
-  {
-  case TK_IDENT:
-    paramKind = PARAM_VALUE;
-    break;
-  case KW_VAR:
-    eat(KW_VAR);
-    paramKind = PARAM_REFERENCE;
-    break;
-  default:
-    error(ERR_INVALID_PARAMETER, lookAhead->lineNo, lookAhead->colNo);
-    break;
-  }
-
-  eat(TK_IDENT);
-  checkFreshIdent(currentToken->string);
-  param = createParameterObject(currentToken->string, paramKind, symtab->currentScope->owner);
-  eat(SB_COLON);
-  type = compileBasicType();
-  param->paramAttrs->type = type;
-  declareObject(param);
-}
-
-void compileStatements(void)
-{
-  compileStatement();
-  while (lookAhead->tokenType == SB_SEMICOLON)
-  {
-    eat(SB_SEMICOLON);
-    compileStatement();
-  }
-}
-
-void compileStatement(void)
-{
-  switch (lookAhead->tokenType)
-  {
-  case TK_IDENT:
-    compileAssignSt();
-    break;
-  case KW_CALL:
-    compileCallSt();
-    break;
-  case KW_BEGIN:
-    compileGroupSt();
-    break;
-  case KW_IF:
-    compileIfSt();
-    break;
-  case KW_WHILE:
-    compileWhileSt();
-    break;
-  case KW_FOR:
-    compileForSt();
-    break;
-    // EmptySt needs to check FOLLOW tokens
-  case KW_DO:
-    compileDoWhileSt();
-    break;
-  case KW_SWITCH:
-    compileSwitchSt();
-    break;
-  case KW_CASE:
-    compileCaseSt();
-    break;
-  case KW_DEFAULT:
-    compileDefaultSt();
-    break;
-  case KW_BREAK:
-    eat(KW_BREAK);
-    break;
-  case KW_REPEAT:
-    compileRepeatUntilSt();
-    break;
-  case SB_SEMICOLON:
-  case KW_END:
-  case KW_ELSE:
-    break;
-    // Error occurs
-  default:
-    error(ERR_INVALID_STATEMENT, lookAhead->lineNo, lookAhead->colNo);
-    break;
-  }
-}
-
-Type *compileLValue(void)
-{
-  // TODO: parse a lvalue (a variable, an array element, a parameter, the current function identifier)
-  Object *var;
-  Type *varType;
-  switch (lookAhead->tokenType)
-  {
-  case TK_CHAR:
-  case TK_DOUBLE:
-  case TK_STRING:
-  case TK_INTEGER:
-    error(ERR_INVALID_VARIABLE, currentToken->lineNo, currentToken->colNo);
-    break;
-  default:
-    break;
-  }
-  eat(TK_IDENT);
-  // check if the identifier is a function identifier, or a variable identifier, or a parameter
-  var = checkDeclaredLValueIdent(currentToken->string);
-  if (var->kind == OBJ_VARIABLE)
-  {
-    if (var->varAttrs->type->typeClass == TP_ARRAY)
-      varType = compileIndexes(var->varAttrs->type);
-    else
-      varType = duplicateType(var->varAttrs->type);
-  }
-  else if (var->kind == OBJ_PARAMETER)
-    varType = duplicateType(var->paramAttrs->type);
-  else
-    varType = duplicateType(var->funcAttrs->returnType);
-  return varType;
-}
-
-void compileAssignSt(void)
-{
-  // TODO: parse the assignment and check type consistency
-  int leftCount = 0;
-  int rightCount = 0;
-  Type **leftType = (Type **)malloc(100 * sizeof(Type *));
-  Type **rightType = (Type **)malloc(100 * sizeof(Type *));
-  while (1)
-  {
-    leftType[leftCount] = compileLValue();
-    leftCount += 1;
-    if (lookAhead->tokenType != SB_COMMA)
-      break;
-    eat(SB_COMMA);
-  }
-  eat(SB_ASSIGN);
-  while (1)
-  {
-    rightType[rightCount] = compileExpression();
-    rightCount += 1;
-    if (lookAhead->tokenType != SB_COMMA)
-      break;
-    eat(SB_COMMA);
-  }
-  checkVariableCount(leftCount, rightCount);
-  for (int i = 0; i < leftCount; i++)
-    checkTypeEquality(*(leftType + i), *(rightType + i));
-}
-
-void compileCallSt(void)
-{
-  Object *proc;
-
-  eat(KW_CALL);
-  eat(TK_IDENT);
-
-  proc = checkDeclaredProcedure(currentToken->string);
-
-  compileArguments(proc->procAttrs->paramList);
-}
-
-void compileGroupSt(void)
-{
-  eat(KW_BEGIN);
-  compileStatements();
-  eat(KW_END);
-}
-
-void compileIfSt(void)
-{
-  eat(KW_IF);
-  compileCondition();
-  eat(KW_THEN);
-  compileStatement();
-  if (lookAhead->tokenType == KW_ELSE)
-    compileElseSt();
-}
-
-void compileElseSt(void)
-{
-  eat(KW_ELSE);
-  compileStatement();
-}
-
-void compileWhileSt(void)
-{
-  eat(KW_WHILE);
-  compileCondition();
-  eat(KW_DO);
-  compileStatement();
-}
-
-void compileDoWhileSt(void)
-{
-  eat(KW_DO);
-  compileStatement();
-  eat(KW_WHILE);
-  compileCondition();
-}
-
-void compileForSt(void)
-{
-  // TODO: Check type consistency of FOR's variable
-  Object *varObj;
-  Type *expType;
-
-  eat(KW_FOR);
-  eat(TK_IDENT);
-
-  // check if the identifier is a variable
-  varObj = checkDeclaredVariable(currentToken->string);
-
-  eat(SB_ASSIGN);
-  expType = compileExpression();
-  checkTypeEquality(varObj->varAttrs->type, expType);
-
-  eat(KW_TO);
-  expType = compileExpression();
-  checkTypeEquality(varObj->varAttrs->type, expType);
-
-  eat(KW_DO);
-  compileStatement();
-}
-
-void compileSwitchSt(void)
-{
-  eat(KW_SWITCH);
-  compileExpression();
-  compileGroupSt();
-}
-
-void compileCaseSt(void)
-{
-  eat(KW_CASE);
-  compileConstant();
-  if (lookAhead->tokenType == SB_COLON)
-    eat(SB_COLON);
-  else
-    error(ERR_INVALID_STATEMENT, lookAhead->lineNo, lookAhead->colNo);
-  compileStatements();
-}
-
-void compileDefaultSt(void)
-{
-  eat(KW_DEFAULT);
-  if (lookAhead->tokenType == SB_COLON)
-    eat(SB_COLON);
-  else
-    error(ERR_INVALID_STATEMENT, lookAhead->lineNo, lookAhead->colNo);
-  compileStatement();
-}
-
-void compileRepeatUntilSt(void){
-  eat(KW_REPEAT);
-  compileStatement();
-  eat(KW_UNTIL);
-  compileCondition();
-}
-
-void compileArgument(Object *param)
-{
-  // TODO: parse an argument, and check type consistency
-  //       If the corresponding parameter is a reference, the argument must be a lvalue
-  Type *expType;
-
-  if (param != NULL && param->paramAttrs->kind == PARAM_VALUE)
-  {
-    expType = compileExpression();
-    checkTypeEquality(expType, param->paramAttrs->type);
-  }
-  else if (param != NULL && param->paramAttrs->kind == PARAM_REFERENCE)
-  {
-    expType = compileLValue();
-    checkTypeEquality(expType, param->paramAttrs->type);
-  }
-  else if (param == NULL && currentToken->tokenType != SB_RPAR)
-    error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
-}
-
-void compileArguments(ObjectNode *paramList)
-{
-  //TODO: parse a list of arguments, check the consistency of the arguments and the given parameters
-  ObjectNode *node = paramList;
-  Object *param;
-  if (node == NULL)
-    param = NULL;
-  else
-    param = node->object;
-
-  switch (lookAhead->tokenType)
-  {
-  case SB_LPAR:
-    eat(SB_LPAR);
-    compileArgument(param);
-
-    while (lookAhead->tokenType == SB_COMMA)
-    {
-      eat(SB_COMMA);
-      node = node->next;
-      if (node == NULL)
-        param = NULL;
-      else
-        param = node->object;
-      compileArgument(param);
-    }
-
-    if (node->next != NULL)
-      error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
-
-    eat(SB_RPAR);
-    break;
-    // Check FOLLOW set
-  case SB_TIMES:
-  case SB_SLASH:
-  case SB_PLUS:
-  case SB_MINUS:
-  case KW_TO:
-  case KW_DO:
-  case SB_RPAR:
-  case SB_COMMA:
-  case SB_EQ:
-  case SB_NEQ:
-  case SB_LE:
-  case SB_LT:
-  case SB_GE:
-  case SB_GT:
-  case SB_RSEL:
-  case SB_SEMICOLON:
-  case KW_END:
-  case KW_ELSE:
-  case KW_THEN:
-    break;
-  default:
-    error(ERR_INVALID_ARGUMENTS, lookAhead->lineNo, lookAhead->colNo);
-  }
-}
-
-void compileCondition(void)
-{
-  // TODO: check the type consistency of LHS and RSH, check the basic type
-  Type *leftType = compileExpression();
-
-  switch (lookAhead->tokenType)
-  {
-  case SB_EQ:
-    eat(SB_EQ);
-    break;
-  case SB_NEQ:
-    eat(SB_NEQ);
-    break;
-  case SB_LE:
-    eat(SB_LE);
-    break;
-  case SB_LT:
-    eat(SB_LT);
-    break;
-  case SB_GE:
-    eat(SB_GE);
-    break;
-  case SB_GT:
-    eat(SB_GT);
-    break;
-  default:
-    error(ERR_INVALID_COMPARATOR, lookAhead->lineNo, lookAhead->colNo);
-  }
-
-  Type *rightType = compileExpression();
-  checkTypeEquality(leftType, rightType);
-}
-
-Type *compileExpression(void)
-{
-  Type *type;
-  Type *type1, *type2;
-  switch (lookAhead->tokenType)
-  {
-  case SB_PLUS:
-    eat(SB_PLUS);
-    type = compileExpression2();
-    if (type->typeClass == TP_STRING)
-      error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
-    break;
-  case SB_MINUS:
-    eat(SB_MINUS);
-    type = compileExpression2();
-    if (type->typeClass == TP_STRING)
-      error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
-    break;
-  case KW_IF:
-    eat(KW_IF);
-    compileCondition();
-    eat(KW_RETURN);
-
-    type1 = compileExpression();
-
-    eat(KW_ELSE);
-    eat(KW_RETURN);
-
-    type2 = compileExpression();
-    checkTypeEquality(type2, type1);
-    return type1;
-  case KW_SUM:
-    type= compileSum();
-    break;
-  default:
-    type = compileExpression2();
-  }
-  return type;
-}
-
-Type *compileExpression2(void)
-{
-  Type *type1;
-  Type *type2;
-
-  type1 = compileTerm();
-  type2 = compileExpression3();
-  if (type2 == NULL)
-    return type1;
-  else
-  {
-    checkTypeEquality(type1, type2);
-    return type1;
-  }
-}
-
-Type *compileExpression3(void)
-{
-  Type *type1;
-  Type *type2;
-
-  switch (lookAhead->tokenType)
-  {
-  case SB_PLUS:
-    eat(SB_PLUS);
-    type1 = compileTerm();
-    type2 = compileExpression3();
-    if (type2 != NULL)
-      checkTypeEquality(type1, type2);
-    return type1;
-    break;
-  case SB_MINUS:
-    eat(SB_MINUS);
-    type1 = compileTerm();
-    if (type1->typeClass == TP_STRING)
-      error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
-    type2 = compileExpression3();
-    if (type2 != NULL)
-      checkTypeEquality(type1, type2);
-    return type1;
-    break;
-    // check the FOLLOW set
-  case KW_BEGIN:
-  case KW_RETURN:
-  case KW_UNTIL:
-  case KW_TO:
-  case KW_DO:
-  case KW_WHILE:
-  case SB_RPAR:
-  case SB_COMMA:
-  case SB_EQ:
-  case SB_NEQ:
-  case SB_LE:
-  case SB_LT:
-  case SB_GE:
-  case SB_GT:
-  case SB_RSEL:
-  case SB_SEMICOLON:
-  case KW_END:
-  case KW_ELSE:
-  case KW_THEN:
-    return NULL;
-    break;
-  default:
-    error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
-    return NULL;
-  }
-}
-
-Type *compileTerm(void)
-{
-  // TODO: check type of Term2
-  Type *type;
-
-  type = compileFactor();
-  compileTerm2();
-
-  return type;
-}
-
-void compileTerm2(void)
-{
-  // TODO: check type of term2
-  Type *type;
-
-  switch (lookAhead->tokenType)
-  {
-  case SB_TIMES:
-    eat(SB_TIMES);
-    type = compileFactor();
-    if (type->typeClass == TP_DOUBLE)
-      checkDoubleType(type);
-    else
-      checkIntType(type);
-    compileTerm2();
-    break;
-  case SB_SLASH:
-    eat(SB_SLASH);
-    type = compileFactor();
-    if (type->typeClass == TP_DOUBLE)
-      checkDoubleType(type);
-    else
-      checkIntType(type);
-    compileTerm2();
-    break;
-    // check the FOLLOW set
-  case KW_RETURN:
-  case KW_BEGIN:
-  case KW_UNTIL:
-  case SB_PLUS:
-  case SB_MINUS:
-  case KW_TO:
-  case KW_DO:
-  case KW_WHILE:
-  case SB_RPAR:
-  case SB_COMMA:
-  case SB_EQ:
-  case SB_NEQ:
-  case SB_LE:
-  case SB_LT:
-  case SB_GE:
-  case SB_GT:
-  case SB_RSEL:
-  case SB_SEMICOLON:
-  case KW_END:
-  case KW_ELSE:
-  case KW_THEN:
-    break;
-  default:
-    error(ERR_INVALID_TERM, lookAhead->lineNo, lookAhead->colNo);
-  }
-}
-
-Type* compileSum(void){
-    eat(KW_SUM);
-    Type* type = compileExpression();
-    if(type == NULL)
-      return makeIntType();
-    checkIntType(type);
-    while (lookAhead->tokenType == SB_COMMA){
-        eat(SB_COMMA);
-        type= compileExpression();
-        checkIntType(type);
-    }
-    return type;
-}
-
-Type *compileFactor(void)
-{
-  // TODO: parse a factor and return the factor's type
-
-  Object *obj;
-  Type *type;
-  Type *type1;
-  switch (lookAhead->tokenType)
-  {
-  case TK_INTEGER:
-    eat(TK_INTEGER);
-
-    if (lookAhead->tokenType == SB_POW)
-    {
-      type = compilePow();
-      return type;
-    }
-    else
-    {
-      type = makeIntType();
-      return type;
-    }
-    break;
-  case TK_CHAR:
-    eat(TK_CHAR);
-    type = makeCharType();
-    return type;
-    break;
-  case TK_DOUBLE:
-    eat(TK_DOUBLE);
-    type = makeDoubleType();
-    return type;
-    break;
-  case TK_STRING:
-    eat(TK_STRING);
-    type = makeStringType();
-    return type;
-    break;
-  case TK_IDENT:
-    eat(TK_IDENT);
-    // check if the identifier is declared
-    obj = checkDeclaredIdent(currentToken->string);
-
-    switch (obj->kind)
-    {
-    case OBJ_CONSTANT:
-      switch (obj->constAttrs->value->type)
-      {
-      case TP_INT:
-        type = makeIntType();
-        break;
-      case TP_CHAR:
-        type = makeCharType();
-        break;
-      case TP_DOUBLE:
-        type = makeDoubleType();
-        break;
-      case TP_STRING:
-        type = makeStringType();
-        break;
-      case TP_ARRAY:
-        error(ERR_INVALID_CONSTANT, currentToken->lineNo, currentToken->colNo);
-        break;
-      }
-      break;
-    case OBJ_VARIABLE:
-      if (obj->varAttrs->type->typeClass == TP_ARRAY)
-        type = compileIndexes(obj->varAttrs->type);
-      else
-      {
-        if (lookAhead->tokenType == SB_POW)
-        {
-          type1 = duplicateType(obj->varAttrs->type);
-          type = compilePow();
-          checkTypeEquality(type1, type);
-          break;
-        }
-        else
-        {
-          type = duplicateType(obj->varAttrs->type);
-          break;
-        }
-      }
-    case OBJ_PARAMETER:
-      type = duplicateType(obj->paramAttrs->type);
-
-      break;
-    case OBJ_FUNCTION:
-      compileArguments(obj->funcAttrs->paramList);
-      type = duplicateType(obj->funcAttrs->returnType);
-      break;
-    default:
-      return NULL;
-    }
-    break;
-  default:
-      return NULL;
-  }
-
-  return type;
-}
-
-Type *compilePow(void)
-{
-  Type *type;
-
-  switch (lookAhead->tokenType)
-  {
-  case SB_POW:
-    eat(SB_POW);
-    type = compileFactor();
-    checkIntType(type);
-    return type;
-    break;
-  case SB_SLASH:
-  case SB_PLUS:
-  case SB_MINUS:
-  case KW_TO:
-  case KW_DO:
-  case KW_WHILE:
-  case SB_RPAR:
-  case SB_COMMA:
-  case SB_EQ:
-  case SB_NEQ:
-  case SB_LE:
-  case SB_LT:
-  case SB_GE:
-  case SB_GT:
-  case SB_RSEL:
-  case SB_SEMICOLON:
-  case KW_END:
-  case KW_ELSE:
-  case KW_THEN:
-    return NULL;
-    break;
-  default:
-    error(ERR_INVALID_TERM, lookAhead->lineNo, lookAhead->colNo);
-    return NULL;
-  }
-}
-
-Type *compileIndexes(Type *arrayType)
-{
-  // TODO: parse a sequence of indexes, check the consistency to the arrayType, and return the element type
-  Type *expressionType;
-  while (lookAhead->tokenType == SB_LSEL)
-  {
-    eat(SB_LSEL);
-    expressionType = compileExpression();
-    checkIntType(expressionType);
-    // if(arrayType->typeClass == TP_ARRAY)
-    arrayType = arrayType->elementType;
-    // else error(ERR_INDEXES_EXCEED_DIMENSION, currentToken->lineNo, currentToken->colNo);
-    eat(SB_RSEL);
-  }
-  return arrayType;
-}
-
-int compile(char *fileName)
-{
-  if (openInputStream(fileName) == IO_ERROR)
-    return IO_ERROR;
-
-  currentToken = NULL;
-  lookAhead = getValidToken();
-
-  initSymTab();
-
-  compileProgram();
-
-  printObject(symtab->program, 0);
-
-  cleanSymTab();
-
-  free(currentToken);
-  free(lookAhead);
-  closeInputStream();
-  return IO_SUCCESS;
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "reader.h"
+#include "scanner.h"
+#include "parser.h"
+#include "semantics.h"
+#include "error.h"
+#include "debug.h"
+#include "codegen.h"
+#include "passes.h"
+
+Token *currentToken;
+Token *lookAhead;
+
+extern Type *intType;
+extern Type *charType;
+extern SymTab *symtab;
+
+struct SwitchContext_
+{
+  Type *type;
+  int value;              // local holding the value switched on
+  CodeAddress test;       // jump to the test of the next case
+  CodeAddress defaultBody;
+};
+
+typedef struct SwitchContext_ SwitchContext;
+
+// Chain of the BREAKs out of the innermost loop or switch, NULL outside them
+CodeAddress *currentBreaks = NULL;
+SwitchContext *currentSwitch = NULL;
+
+// The value of the expression just compiled when it is known at compile
+// time, NULL otherwise. Its code is then the single load at knownStart
+ConstantValue *knownValue = NULL;
+CodeMark knownStart;
+
+// Cleared by kplc -nofold: no value is ever known, so nothing is folded
+int foldKnownValues = 1;
+
+void loadKnownValue(ConstantValue *value)
+{
+  free(knownValue);
+  knownStart = markCode();
+  genConstant(value);
+  if (foldKnownValues)
+    knownValue = value;
+  else
+  {
+    free(value);
+    knownValue = NULL;
+  }
+}
+
+ConstantValue *takeKnownValue(void)
+{
+  ConstantValue *value = knownValue;
+  knownValue = NULL;
+  return value;
+}
+
+void forgetKnownValue(void)
+{
+  free(knownValue);
+  knownValue = NULL;
+}
+
+// As genConversion, but a known int is loaded as a double instead
+void genKnownConversion(Type *target, Type *source)
+{
+  ConstantValue *value;
+
+  if (knownValue != NULL && target->typeClass == TP_DOUBLE && source->typeClass == TP_INT)
+  {
+    value = makeDoubleConstant(knownValue->intValue);
+    rewindCode(&knownStart);
+    loadKnownValue(value);
+  }
+  else
+    genConversion(target, source);
+}
+
+// The right operand has just been compiled; left is the value of the left
+// one, loaded at leftStart, if it is known. Both known, the result is too
+void genOperator(TokenType op, Type *type, ConstantValue *left, CodeMark *leftStart)
+{
+  ConstantValue *right = takeKnownValue();
+  ConstantValue *result = NULL;
+
+  if (left != NULL && right != NULL)
+    result = foldConstants(op, left, right);
+  free(left);
+  free(right);
+  if (result != NULL)
+  {
+    rewindCode(leftStart);
+    loadKnownValue(result);
+    return;
+  }
+
+  switch (op)
+  {
+  case SB_PLUS:
+    genAddition(type);
+    break;
+  case SB_MINUS:
+    genSubtraction(type);
+    break;
+  case SB_TIMES:
+    genMultiplication(type);
+    break;
+  case SB_SLASH:
+    genDivision(type);
+    break;
+  default:
+    genComparison(op, type);
+    break;
+  }
+}
+
+// A statement that can never run is checked, and its code dropped. A CASE
+// in it can still be jumped to, and then it is jumped over instead
+void compileDeadStatement(void)
+{
+  CodeMark mark = markCode();
+  CodeAddress jump = genJ(DC_VALUE);
+  CodeAddress breaks = NO_LABEL;
+  SwitchContext context;
+
+  if (currentBreaks != NULL)
+    breaks = *currentBreaks;
+  if (currentSwitch != NULL)
+    context = *currentSwitch;
+  compileStatement();
+  if (currentSwitch != NULL && (currentSwitch->test != context.test || currentSwitch->defaultBody != context.defaultBody))
+    updateJ(jump, getCurrentCodeAddress());
+  else
+  {
+    rewindCode(&mark);
+    if (currentBreaks != NULL)
+      *currentBreaks = breaks;
+  }
+}
+
+void scan(void)
+{
+  Token *tmp = currentToken;
+  currentToken = lookAhead;
+  lookAhead = getValidToken();
+  free(tmp);
+}
+
+void eat(TokenType tokenType)
+{
+  if (lookAhead->tokenType == tokenType)
+  {
+    scan();
+  }
+  else
+    missingToken(tokenType, lookAhead->lineNo, lookAhead->colNo);
+}
+
+void compileProgram(void)
+{
+  Object *program;
+
+  eat(KW_PROGRAM);
+  eat(TK_IDENT);
+
+  program = createProgramObject(currentToken->string);
+  enterBlock(program->progAttrs->scope);
+
+  eat(SB_SEMICOLON);
+
+  compileBlock();
+  genHL();
+  eat(SB_PERIOD);
+
+  exitBlock();
+}
+
+void compileBlock(void)
+{
+  Object *constObj;
+  ConstantValue *constValue;
+
+  if (lookAhead->tokenType == KW_CONST)
+  {
+    eat(KW_CONST);
+
+    do
+    {
+      eat(TK_IDENT);
+
+      checkFreshIdent(currentToken->string);
+      constObj = createConstantObject(currentToken->string);
+
+      eat(SB_EQ);
+      constValue = compileConstant();
+
+      constObj->constAttrs->value = constValue;
+      declareObject(constObj);
+
+      eat(SB_SEMICOLON);
+    } while (lookAhead->tokenType == TK_IDENT);
+
+    compileBlock2();
+  }
+  else
+    compileBlock2();
+}
+
+void compileBlock2(void)
+{
+  Object *typeObj;
+  Type *actualType;
+
+  if (lookAhead->tokenType == KW_TYPE)
+  {
+    eat(KW_TYPE);
+
+    do
+    {
+      eat(TK_IDENT);
+
+      checkFreshIdent(currentToken->string);
+      typeObj = createTypeObject(currentToken->string);
+
+      eat(SB_EQ);
+      actualType = compileType();
+
+      typeObj->typeAttrs->actualType = actualType;
+      declareObject(typeObj);
+
+      eat(SB_SEMICOLON);
+    } while (lookAhead->tokenType == TK_IDENT);
+
+    compileBlock3();
+  }
+  else
+    compileBlock3();
+}
+
+void compileBlock3(void)
+{
+  Object *varObj;
+  Type *varType;
+
+  if (lookAhead->tokenType == KW_VAR)
+  {
+    eat(KW_VAR);
+
+    do
+    {
+      eat(TK_IDENT);
+
+      checkFreshIdent(currentToken->string);
+      varObj = createVariableObject(currentToken->string);
+
+      eat(SB_COLON);
+      varType = compileType();
+
+      varObj->varAttrs->type = varType;
+      declareObject(varObj);
+
+      eat(SB_SEMICOLON);
+    } while (lookAhead->tokenType == TK_IDENT);
+
+    compileBlock4();
+  }
+  else
+    compileBlock4();
+}
+
+void compileBlock4(void)
+{
+  CodeAddress jump;
+  CodeAddress increment;
+
+  jump = genJ(DC_VALUE);
+  compileSubDecls();
+  updateJ(jump, getCurrentCodeAddress());
+
+  increment = genINT(symtab->currentScope->frameSize);
+  genStringDefaults(symtab->currentScope);
+  compileBlock5();
+  // Temporaries of the statements have made the frame larger
+  updateINT(increment, symtab->currentScope->frameSize);
+}
+
+void compileBlock5(void)
+{
+  eat(KW_BEGIN);
+  compileStatements();
+  eat(KW_END);
+}
+
+void compileSubDecls(void)
+{
+  while ((lookAhead->tokenType == KW_FUNCTION) || (lookAhead->tokenType == KW_PROCEDURE))
+  {
+    if (lookAhead->tokenType == KW_FUNCTION)
+      compileFuncDecl();
+    else
+      compileProcDecl();
+  }
+}
+
+void compileFuncDecl(void)
+{
+  Object *funcObj;
+  Type *returnType;
+
+  eat(KW_FUNCTION);
+  eat(TK_IDENT);
+
+  checkFreshIdent(currentToken->string);
+  funcObj = createFunctionObject(currentToken->string);
+  funcObj->funcAttrs->codeAddress = getCurrentCodeAddress();
+  declareObject(funcObj);
+
+  enterBlock(funcObj->funcAttrs->scope);
+
+  compileParams();
+  eat(SB_COLON);
+  returnType = compileBasicType();
+  funcObj->funcAttrs->returnType = returnType;
+  if (returnType->typeClass == TP_DOUBLE)
+    funcObj->funcAttrs->returnOffset = declareTemporary(DOUBLE_SIZE);
+
+  eat(SB_SEMICOLON);
+  compileBlock();
+  genEF(funcObj);
+  eat(SB_SEMICOLON);
+
+  exitBlock();
+}
+
+void compileProcDecl(void)
+{
+  Object *procObj;
+
+  eat(KW_PROCEDURE);
+  eat(TK_IDENT);
+
+  checkFreshIdent(currentToken->string);
+  procObj = createProcedureObject(currentToken->string);
+  procObj->procAttrs->codeAddress = getCurrentCodeAddress();
+  declareObject(procObj);
+
+  enterBlock(procObj->procAttrs->scope);
+
+  compileParams();
+
+  eat(SB_SEMICOLON);
+  compileBlock();
+  genEP();
+  eat(SB_SEMICOLON);
+
+  exitBlock();
+}
+
+ConstantValue *compileUnsignedConstant(void)
+{
+  ConstantValue *constValue;
+  Object *obj;
+
+  switch (lookAhead->tokenType)
+  {
+  case TK_INTEGER:
+    eat(TK_INTEGER);
+    constValue = makeIntConstant(currentToken->intValue);
+    break;
+  case TK_IDENT:
+    eat(TK_IDENT);
+
+    obj = checkDeclaredConstant(currentToken->string);
+    constValue = duplicateConstantValue(obj->constAttrs->value);
+
+    break;
+  case TK_CHAR:
+    eat(TK_CHAR);
+    constValue = makeCharConstant(currentToken->string[0]);
+    break;
+  case TK_DOUBLE:
+    eat(TK_DOUBLE);
+    constValue = makeDoubleConstant(currentToken->doubleValue);
+    break;
+
+  case TK_STRING:
+    eat(TK_STRING);
+    constValue = makeStringConstant(currentToken->string);
+    break;
+  default:
+    error(ERR_INVALID_CONSTANT, lookAhead->lineNo, lookAhead->colNo);
+    break;
+  }
+  return constValue;
+}
+
+ConstantValue *compileConstant(void)
+{
+  ConstantValue *constValue;
+
+  switch (lookAhead->tokenType)
+  {
+  case SB_PLUS:
+    eat(SB_PLUS);
+    constValue = compileConstant2();
+    break;
+  case SB_MINUS:
+    eat(SB_MINUS);
+    constValue = compileConstant2();
+    if (constValue->type == TP_DOUBLE)
+      constValue->doubleValue = -constValue->doubleValue;
+    else
+      constValue->intValue = -constValue->intValue;
+    break;
+  case TK_CHAR:
+    eat(TK_CHAR);
+    constValue = makeCharConstant(currentToken->string[0]);
+    break;
+  default:
+    constValue = compileConstant2();
+    break;
+  }
+  return constValue;
+}
+
+ConstantValue *compileConstant2(void)
+{
+  ConstantValue *constValue;
+  Object *obj;
+
+  switch (lookAhead->tokenType)
+  {
+  case TK_INTEGER:
+    eat(TK_INTEGER);
+    constValue = makeIntConstant(currentToken->intValue);
+    break;
+  case TK_STRING:
+    eat(TK_STRING);
+    constValue = makeStringConstant(currentToken->string);
+    break;
+  case TK_DOUBLE:
+    eat(TK_DOUBLE);
+    constValue = makeDoubleConstant(currentToken->doubleValue);
+    break;
+  case TK_IDENT:
+    eat(TK_IDENT);
+    obj = checkDeclaredConstant(currentToken->string);
+    if (obj->constAttrs->value->type != TP_ARRAY)
+      constValue = duplicateConstantValue(obj->constAttrs->value);
+    break;
+  default:
+    error(ERR_INVALID_CONSTANT, lookAhead->lineNo, lookAhead->colNo);
+    break;
+  }
+  return constValue;
+}
+
+Type *compileType(void)
+{
+  Type *type;
+  Type *elementType;
+  int arraySize;
+  Object *obj;
+
+  switch (lookAhead->tokenType)
+  {
+  case KW_INTEGER:
+    eat(KW_INTEGER);
+    type = makeIntType();
+    break;
+  case KW_CHAR:
+    eat(KW_CHAR);
+    type = makeCharType();
+    break;
+  case KW_DOUBLE:
+    eat(KW_DOUBLE);
+    type = makeDoubleType();
+    break;
+  case KW_STRING:
+    eat(KW_STRING);
+    type = makeStringType();
+    break;
+  case KW_ARRAY:
+    eat(KW_ARRAY);
+    eat(SB_LSEL);
+    eat(TK_INTEGER);
+    arraySize = currentToken->intValue;
+
+    eat(SB_RSEL);
+    eat(KW_OF);
+    elementType = compileType();
+    type = makeArrayType(arraySize, elementType);
+    break;
+  case TK_IDENT:
+    eat(TK_IDENT);
+    obj = checkDeclaredType(currentToken->string);
+    type = duplicateType(obj->typeAttrs->actualType);
+    break;
+  default:
+    error(ERR_INVALID_TYPE, lookAhead->lineNo, lookAhead->colNo);
+    break;
+  }
+  return type;
+}
+
+Type *compileBasicType(void)
+{
+  Type *type;
+
+  switch (lookAhead->tokenType)
+  {
+  case KW_INTEGER:
+    eat(KW_INTEGER);
+    type = makeIntType();
+    break;
+  case KW_DOUBLE:
+    eat(KW_DOUBLE);
+    type = makeDoubleType();
+    break;
+  case KW_CHAR:
+    eat(KW_CHAR);
+    type = makeCharType();
+    break;
+  case KW_STRING:
+    eat(KW_STRING);
+    type = makeStringType();
+    break;
+  default:
+    error(ERR_INVALID_BASICTYPE, lookAhead->lineNo, lookAhead->colNo);
+    break;
+  }
+  return type;
+}
+
+void compileParams(void)
+{
+  if (lookAhead->tokenType == SB_LPAR)
+  {
+    eat(SB_LPAR);
+    compileParam();
+    while (lookAhead->tokenType == SB_SEMICOLON)
+    {
+      eat(SB_SEMICOLON);
+      compileParam();
+    }
+    eat(SB_RPAR);
+  }
+}
+
+void compileParam(void)
+{
+  Object *param;
+  Type *type;
+  enum ParamKind paramKind;
+
+  switch (lookAhead->tokenType)
+  {
+  case TK_IDENT:
+    paramKind = PARAM_VALUE;
+    break;
+  case KW_VAR:
+    eat(KW_VAR);
+    paramKind = PARAM_REFERENCE;
+    break;
+  default:
+    error(ERR_INVALID_PARAMETER, lookAhead->lineNo, lookAhead->colNo);
+    break;
+  }
+
+  eat(TK_IDENT);
+  checkFreshIdent(currentToken->string);
+  param = createParameterObject(currentToken->string, paramKind, symtab->currentScope->owner);
+  eat(SB_COLON);
+  type = compileBasicType();
+  param->paramAttrs->type = type;
+  declareObject(param);
+}
+
+void compileStatements(void)
+{
+  compileStatement();
+  while (lookAhead->tokenType == SB_SEMICOLON)
+  {
+    eat(SB_SEMICOLON);
+    compileStatement();
+  }
+}
+
+void compileStatement(void)
+{
+  switch (lookAhead->tokenType)
+  {
+  case TK_IDENT:
+    compileAssignSt();
+    break;
+  case KW_CALL:
+    compileCallSt();
+    break;
+  case KW_BEGIN:
+    compileGroupSt();
+    break;
+  case KW_IF:
+    compileIfSt();
+    break;
+  case KW_WHILE:
+    compileWhileSt();
+    break;
+  case KW_FOR:
+    compileForSt();
+    break;
+    // EmptySt needs to check FOLLOW tokens
+  case KW_DO:
+    compileDoWhileSt();
+    break;
+  case KW_SWITCH:
+    compileSwitchSt();
+    break;
+  case KW_CASE:
+    compileCaseSt();
+    break;
+  case KW_DEFAULT:
+    compileDefaultSt();
+    break;
+  case KW_BREAK:
+    eat(KW_BREAK);
+    if (currentBreaks == NULL)
+      error(ERR_INVALID_STATEMENT, currentToken->lineNo, currentToken->colNo);
+    *currentBreaks = genBreak(*currentBreaks);
+    break;
+  case KW_REPEAT:
+    compileRepeatUntilSt();
+    break;
+  case SB_SEMICOLON:
+  case KW_END:
+  case KW_ELSE:
+    break;
+    // Error occurs
+  default:
+    error(ERR_INVALID_STATEMENT, lookAhead->lineNo, lookAhead->colNo);
+    break;
+  }
+}
+
+Type *compileLValue(void)
+{
+  // TODO: parse a lvalue (a variable, an array element, a parameter, the current function identifier)
+  Object *var;
+  Type *varType;
+  switch (lookAhead->tokenType)
+  {
+  case TK_CHAR:
+  case TK_DOUBLE:
+  case TK_STRING:
+  case TK_INTEGER:
+    error(ERR_INVALID_VARIABLE, currentToken->lineNo, currentToken->colNo);
+    break;
+  default:
+    break;
+  }
+  eat(TK_IDENT);
+  // check if the identifier is a function identifier, or a variable identifier, or a parameter
+  var = checkDeclaredLValueIdent(currentToken->string);
+  if (var->kind == OBJ_VARIABLE)
+  {
+    genVariableAddress(var);
+    if (var->varAttrs->type->typeClass == TP_ARRAY)
+      varType = compileIndexes(var->varAttrs->type);
+    else
+      varType = duplicateType(var->varAttrs->type);
+  }
+  else if (var->kind == OBJ_PARAMETER)
+  {
+    genParameterAddress(var);
+    varType = duplicateType(var->paramAttrs->type);
+  }
+  else
+  {
+    genReturnValueAddress(var);
+    varType = duplicateType(var->funcAttrs->returnType);
+  }
+  // Whole arrays are not assigned or passed
+  checkBasicType(varType);
+  return varType;
+}
+
+void compileAssignSt(void)
+{
+  // TODO: parse the assignment and check type consistency
+  int leftCount = 0;
+  int rightCount = 0;
+  Type **leftType = (Type **)malloc(100 * sizeof(Type *));
+  Type **rightType = (Type **)malloc(100 * sizeof(Type *));
+  int *temporary = (int *)malloc(100 * sizeof(int));
+  while (1)
+  {
+    leftType[leftCount] = compileLValue();
+    leftCount += 1;
+    if (lookAhead->tokenType != SB_COMMA)
+      break;
+    eat(SB_COMMA);
+  }
+  eat(SB_ASSIGN);
+  // With several lvalues, every value is computed into a temporary before
+  // any is stored, as the addresses are all on the stack
+  while (1)
+  {
+    if (rightCount >= leftCount)
+      error(ERR_RIGHT_MORE_VARIABLE, lookAhead->lineNo, lookAhead->colNo);
+    if (leftCount > 1)
+    {
+      temporary[rightCount] = declareTemporary(sizeOfType(leftType[rightCount]));
+      genLA(0, temporary[rightCount]);
+    }
+    rightType[rightCount] = compileExpression();
+    checkTypeEquality(leftType[rightCount], rightType[rightCount]);
+    genKnownConversion(leftType[rightCount], rightType[rightCount]);
+    if (leftCount > 1)
+      genStore(leftType[rightCount]);
+    rightCount += 1;
+    if (lookAhead->tokenType != SB_COMMA)
+      break;
+    eat(SB_COMMA);
+  }
+  checkVariableCount(leftCount, rightCount);
+  if (leftCount == 1)
+    genStore(leftType[0]);
+  else
+    for (int i = leftCount - 1; i >= 0; i--)
+    {
+      genTemporaryValue(temporary[i], leftType[i]);
+      genStore(leftType[i]);
+    }
+  free(leftType);
+  free(rightType);
+  free(temporary);
+}
+
+void compileCallSt(void)
+{
+  Object *proc;
+
+  eat(KW_CALL);
+  eat(TK_IDENT);
+
+  proc = checkDeclaredProcedure(currentToken->string);
+
+  if (isPredefinedProcedure(proc))
+  {
+    compileArguments(proc->procAttrs->paramList);
+    genPredefinedProcedureCall(proc);
+  }
+  else
+  {
+    genINT(RESERVED_WORDS);
+    compileArguments(proc->procAttrs->paramList);
+    genProcedureCall(proc);
+  }
+}
+
+void compileGroupSt(void)
+{
+  eat(KW_BEGIN);
+  compileStatements();
+  eat(KW_END);
+}
+
+void compileIfSt(void)
+{
+  CodeAddress falseJump;
+  CodeAddress jump;
+  ConstantValue *condition;
+
+  eat(KW_IF);
+  compileCondition();
+  eat(KW_THEN);
+
+  // Only the branch taken is kept
+  condition = takeKnownValue();
+  if (condition != NULL)
+  {
+    rewindCode(&knownStart);
+    if (condition->intValue)
+      compileStatement();
+    else
+      compileDeadStatement();
+    if (lookAhead->tokenType == KW_ELSE)
+    {
+      eat(KW_ELSE);
+      if (condition->intValue)
+        compileDeadStatement();
+      else
+        compileStatement();
+    }
+    free(condition);
+    return;
+  }
+
+  falseJump = genFJ(DC_VALUE);
+  compileStatement();
+  if (lookAhead->tokenType == KW_ELSE)
+  {
+    jump = genJ(DC_VALUE);
+    updateJ(falseJump, getCurrentCodeAddress());
+    compileElseSt();
+    updateJ(jump, getCurrentCodeAddress());
+  }
+  else
+    updateJ(falseJump, getCurrentCodeAddress());
+}
+
+void compileElseSt(void)
+{
+  eat(KW_ELSE);
+  compileStatement();
+}
+
+void compileWhileSt(void)
+{
+  CodeAddress beginWhile;
+  CodeAddress falseJump = NO_LABEL;
+  CodeAddress breaks = NO_LABEL;
+  CodeAddress *outerBreaks = currentBreaks;
+  ConstantValue *condition;
+
+  beginWhile = getCurrentCodeAddress();
+  eat(KW_WHILE);
+  compileCondition();
+  condition = takeKnownValue();
+  if (condition != NULL)
+    rewindCode(&knownStart);
+  else
+    falseJump = genFJ(DC_VALUE);
+  eat(KW_DO);
+  currentBreaks = &breaks;
+  if (condition != NULL && !condition->intValue)
+    compileDeadStatement();
+  else
+  {
+    compileStatement();
+    genJ(beginWhile);
+  }
+  currentBreaks = outerBreaks;
+  if (falseJump != NO_LABEL)
+    updateJ(falseJump, getCurrentCodeAddress());
+  updateBreaks(breaks, getCurrentCodeAddress());
+  free(condition);
+}
+
+void compileDoWhileSt(void)
+{
+  CodeAddress beginDo;
+  CodeAddress falseJump;
+  CodeAddress breaks = NO_LABEL;
+  CodeAddress *outerBreaks = currentBreaks;
+
+  beginDo = getCurrentCodeAddress();
+  eat(KW_DO);
+  currentBreaks = &breaks;
+  compileStatement();
+  currentBreaks = outerBreaks;
+  eat(KW_WHILE);
+  compileCondition();
+  falseJump = genFJ(DC_VALUE);
+  genJ(beginDo);
+  updateJ(falseJump, getCurrentCodeAddress());
+  updateBreaks(breaks, getCurrentCodeAddress());
+}
+
+void compileForSt(void)
+{
+  // TODO: Check type consistency of FOR's variable
+  Object *varObj;
+  Type *expType;
+  CodeAddress beginLoop;
+  CodeAddress falseJump;
+  CodeAddress breaks = NO_LABEL;
+  CodeAddress *outerBreaks = currentBreaks;
+
+  eat(KW_FOR);
+  eat(TK_IDENT);
+
+  // check if the identifier is a variable
+  varObj = checkDeclaredVariable(currentToken->string);
+  if (varObj->varAttrs->type->typeClass != TP_INT && varObj->varAttrs->type->typeClass != TP_CHAR)
+    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+
+  // The address of the variable stays on the stack during the loop
+  genVariableAddress(varObj);
+  genCV();
+
+  eat(SB_ASSIGN);
+  expType = compileExpression();
+  checkTypeEquality(varObj->varAttrs->type, expType);
+  genST();
+  genCV();
+  genLI();
+
+  beginLoop = getCurrentCodeAddress();
+  eat(KW_TO);
+  expType = compileExpression();
+  checkTypeEquality(varObj->varAttrs->type, expType);
+  genLE();
+  falseJump = genFJ(DC_VALUE);
+
+  eat(KW_DO);
+  currentBreaks = &breaks;
+  compileStatement();
+  currentBreaks = outerBreaks;
+
+  genCV();
+  genCV();
+  genLI();
+  genLC(1);
+  genAD();
+  genST();
+  genCV();
+  genLI();
+  genJ(beginLoop);
+
+  updateJ(falseJump, getCurrentCodeAddress());
+  updateBreaks(breaks, getCurrentCodeAddress());
+  genDCT(1);
+}
+
+// The cases test the value one after the other; a body falls through
+// into the next one, over its test, until a BREAK
+void compileSwitchSt(void)
+{
+  SwitchContext context;
+  SwitchContext *outerSwitch = currentSwitch;
+  CodeAddress breaks = NO_LABEL;
+  CodeAddress *outerBreaks = currentBreaks;
+
+  eat(KW_SWITCH);
+  // Large enough for any basic type
+  context.value = declareTemporary(DOUBLE_SIZE);
+  genLA(0, context.value);
+  context.type = compileExpression();
+  checkBasicType(context.type);
+  genStore(context.type);
+  context.test = genJ(DC_VALUE);
+  context.defaultBody = NO_LABEL;
+
+  currentSwitch = &context;
+  currentBreaks = &breaks;
+  compileGroupSt();
+  currentSwitch = outerSwitch;
+  currentBreaks = outerBreaks;
+
+  if (context.defaultBody != NO_LABEL)
+    updateJ(context.test, context.defaultBody);
+  else
+    updateJ(context.test, getCurrentCodeAddress());
+  updateBreaks(breaks, getCurrentCodeAddress());
+}
+
+void compileCaseSt(void)
+{
+  ConstantValue *value;
+  Type *type;
+  CodeAddress fallThrough;
+
+  eat(KW_CASE);
+  value = compileConstant();
+  if (currentSwitch == NULL)
+    error(ERR_INVALID_STATEMENT, currentToken->lineNo, currentToken->colNo);
+  if (value->type == TP_INT)
+    type = makeIntType();
+  else if (value->type == TP_DOUBLE)
+    type = makeDoubleType();
+  else if (value->type == TP_CHAR)
+    type = makeCharType();
+  else
+    type = makeStringType();
+  checkTypeEquality(currentSwitch->type, type);
+
+  fallThrough = genJ(DC_VALUE);
+  updateJ(currentSwitch->test, getCurrentCodeAddress());
+  genTemporaryValue(currentSwitch->value, currentSwitch->type);
+  loadKnownValue(value);
+  genKnownConversion(currentSwitch->type, type);
+  forgetKnownValue();
+  genComparison(SB_EQ, currentSwitch->type);
+  currentSwitch->test = genFJ(DC_VALUE);
+  updateJ(fallThrough, getCurrentCodeAddress());
+  freeType(type);
+
+  if (lookAhead->tokenType == SB_COLON)
+    eat(SB_COLON);
+  else
+    error(ERR_INVALID_STATEMENT, lookAhead->lineNo, lookAhead->colNo);
+  compileStatements();
+}
+
+void compileDefaultSt(void)
+{
+  eat(KW_DEFAULT);
+  if (currentSwitch == NULL)
+    error(ERR_INVALID_STATEMENT, currentToken->lineNo, currentToken->colNo);
+  currentSwitch->defaultBody = getCurrentCodeAddress();
+  if (lookAhead->tokenType == SB_COLON)
+    eat(SB_COLON);
+  else
+    error(ERR_INVALID_STATEMENT, lookAhead->lineNo, lookAhead->colNo);
+  compileStatement();
+}
+
+void compileRepeatUntilSt(void){
+  CodeAddress beginRepeat;
+  CodeAddress breaks = NO_LABEL;
+  CodeAddress *outerBreaks = currentBreaks;
+
+  beginRepeat = getCurrentCodeAddress();
+  eat(KW_REPEAT);
+  currentBreaks = &breaks;
+  compileStatement();
+  currentBreaks = outerBreaks;
+  eat(KW_UNTIL);
+  compileCondition();
+  genFJ(beginRepeat);
+  updateBreaks(breaks, getCurrentCodeAddress());
+}
+
+void compileArgument(Object *param)
+{
+  // TODO: parse an argument, and check type consistency
+  //       If the corresponding parameter is a reference, the argument must be a lvalue
+  Type *expType;
+
+  if (param != NULL && param->paramAttrs->kind == PARAM_VALUE)
+  {
+    expType = compileExpression();
+    checkTypeEquality(param->paramAttrs->type, expType);
+    genKnownConversion(param->paramAttrs->type, expType);
+  }
+  else if (param != NULL && param->paramAttrs->kind == PARAM_REFERENCE)
+  {
+    // The address is passed, so there is nothing to convert
+    expType = compileLValue();
+    if (!compareType(param->paramAttrs->type, expType))
+      error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+  }
+  else if (param == NULL && currentToken->tokenType != SB_RPAR)
+    error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+}
+
+void compileArguments(ObjectNode *paramList)
+{
+  //TODO: parse a list of arguments, check the consistency of the arguments and the given parameters
+  ObjectNode *node = paramList;
+  Object *param;
+  if (node == NULL)
+    param = NULL;
+  else
+    param = node->object;
+
+  switch (lookAhead->tokenType)
+  {
+  case SB_LPAR:
+    eat(SB_LPAR);
+    compileArgument(param);
+
+    while (lookAhead->tokenType == SB_COMMA)
+    {
+      eat(SB_COMMA);
+      node = node->next;
+      if (node == NULL)
+        param = NULL;
+      else
+        param = node->object;
+      compileArgument(param);
+    }
+
+    if (node != NULL && node->next != NULL)
+      error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+
+    eat(SB_RPAR);
+    break;
+    // Check FOLLOW set
+  case SB_TIMES:
+  case SB_SLASH:
+  case SB_PLUS:
+  case SB_MINUS:
+  case KW_TO:
+  case KW_DO:
+  case SB_RPAR:
+  case SB_COMMA:
+  case SB_EQ:
+  case SB_NEQ:
+  case SB_LE:
+  case SB_LT:
+  case SB_GE:
+  case SB_GT:
+  case SB_RSEL:
+  case SB_SEMICOLON:
+  case KW_END:
+  case KW_ELSE:
+  case KW_THEN:
+    if (paramList != NULL)
+      error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, lookAhead->lineNo, lookAhead->colNo);
+    break;
+  default:
+    error(ERR_INVALID_ARGUMENTS, lookAhead->lineNo, lookAhead->colNo);
+  }
+}
+
+void compileCondition(void)
+{
+  // TODO: check the type consistency of LHS and RSH, check the basic type
+  Type *leftType = compileExpression();
+  TokenType comparator = lookAhead->tokenType;
+  ConstantValue *leftValue = takeKnownValue();
+  CodeMark leftStart = knownStart;
+
+  checkBasicType(leftType);
+  switch (lookAhead->tokenType)
+  {
+  case SB_EQ:
+    eat(SB_EQ);
+    break;
+  case SB_NEQ:
+    eat(SB_NEQ);
+    break;
+  case SB_LE:
+    eat(SB_LE);
+    break;
+  case SB_LT:
+    eat(SB_LT);
+    break;
+  case SB_GE:
+    eat(SB_GE);
+    break;
+  case SB_GT:
+    eat(SB_GT);
+    break;
+  default:
+    error(ERR_INVALID_COMPARATOR, lookAhead->lineNo, lookAhead->colNo);
+  }
+
+  Type *rightType = compileExpression();
+  checkTypeEquality(leftType, rightType);
+  genKnownConversion(leftType, rightType);
+  genOperator(comparator, leftType, leftValue, &leftStart);
+}
+
+Type *compileExpression(void)
+{
+  Type *type;
+  Type *type1, *type2;
+  CodeAddress falseJump, jump;
+  ConstantValue *value;
+  switch (lookAhead->tokenType)
+  {
+  case SB_PLUS:
+    eat(SB_PLUS);
+    type = compileExpression2();
+    if (type->typeClass == TP_STRING)
+      error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
+    break;
+  case SB_MINUS:
+    eat(SB_MINUS);
+    type = compileExpression2();
+    if (type->typeClass == TP_STRING)
+      error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
+    if (knownValue != NULL && negateConstant(knownValue))
+    {
+      value = takeKnownValue();
+      rewindCode(&knownStart);
+      loadKnownValue(value);
+    }
+    else
+    {
+      forgetKnownValue();
+      genNegation(type);
+    }
+    break;
+  case KW_IF:
+    eat(KW_IF);
+    compileCondition();
+    eat(KW_RETURN);
+    value = takeKnownValue();
+    if (value != NULL)
+      return compileKnownIfExpression(value);
+    falseJump = genFJ(DC_VALUE);
+
+    type1 = compileExpression();
+    jump = genJ(DC_VALUE);
+    updateJ(falseJump, getCurrentCodeAddress());
+
+    eat(KW_ELSE);
+    eat(KW_RETURN);
+
+    type2 = compileExpression();
+    checkTypeEquality(type1, type2);
+    genConversion(type1, type2);
+    forgetKnownValue();
+    updateJ(jump, getCurrentCodeAddress());
+    return type1;
+  case KW_SUM:
+    type= compileSum();
+    break;
+  default:
+    type = compileExpression2();
+  }
+  return type;
+}
+
+// IF with a known condition: the other expression is checked, and its code
+// dropped
+Type *compileKnownIfExpression(ConstantValue *condition)
+{
+  Type *type1, *type2;
+  ConstantValue *value1;
+  CodeMark start1;
+  CodeMark mark;
+
+  rewindCode(&knownStart);
+  mark = markCode();
+  type1 = compileExpression();
+  value1 = takeKnownValue();
+  start1 = knownStart;
+  if (!condition->intValue)
+  {
+    rewindCode(&mark);
+    free(value1);
+  }
+
+  eat(KW_ELSE);
+  eat(KW_RETURN);
+
+  mark = markCode();
+  type2 = compileExpression();
+  checkTypeEquality(type1, type2);
+  if (condition->intValue)
+  {
+    rewindCode(&mark);
+    forgetKnownValue();
+    knownValue = value1;
+    knownStart = start1;
+  }
+  else
+    genKnownConversion(type1, type2);
+  free(condition);
+  return type1;
+}
+
+Type *compileExpression2(void)
+{
+  Type *type;
+
+  type = compileTerm();
+  return compileExpression3(type);
+}
+
+// type is that of the terms on the left, whose value is on the stack
+Type *compileExpression3(Type *type)
+{
+  Type *type1;
+  ConstantValue *value;
+  CodeMark start = knownStart;
+
+  switch (lookAhead->tokenType)
+  {
+  case SB_PLUS:
+    eat(SB_PLUS);
+    value = takeKnownValue();
+    type1 = compileTerm();
+    checkTypeEquality(type, type1);
+    genKnownConversion(type, type1);
+    genOperator(SB_PLUS, type, value, &start);
+    return compileExpression3(type);
+    break;
+  case SB_MINUS:
+    eat(SB_MINUS);
+    value = takeKnownValue();
+    type1 = compileTerm();
+    if (type1 == NULL || type1->typeClass == TP_STRING)
+      error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
+    checkTypeEquality(type, type1);
+    genKnownConversion(type, type1);
+    genOperator(SB_MINUS, type, value, &start);
+    return compileExpression3(type);
+    break;
+    // check the FOLLOW set
+  case KW_BEGIN:
+  case KW_RETURN:
+  case KW_UNTIL:
+  case KW_TO:
+  case KW_DO:
+  case KW_WHILE:
+  case SB_RPAR:
+  case SB_COMMA:
+  case SB_EQ:
+  case SB_NEQ:
+  case SB_LE:
+  case SB_LT:
+  case SB_GE:
+  case SB_GT:
+  case SB_RSEL:
+  case SB_SEMICOLON:
+  case KW_END:
+  case KW_ELSE:
+  case KW_THEN:
+    return type;
+    break;
+  default:
+    error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
+    return NULL;
+  }
+}
+
+Type *compileTerm(void)
+{
+  Type *type;
+
+  type = compileFactor();
+  return compileTerm2(type);
+}
+
+// Only numbers are multiplied and divided
+void checkNumberType(Type *type)
+{
+  if (type != NULL && type->typeClass == TP_DOUBLE)
+    checkDoubleType(type);
+  else
+    checkIntType(type);
+}
+
+// type is that of the factors on the left, whose value is on the stack
+Type *compileTerm2(Type *type)
+{
+  Type *type1;
+  ConstantValue *value;
+  CodeMark start = knownStart;
+
+  switch (lookAhead->tokenType)
+  {
+  case SB_TIMES:
+    eat(SB_TIMES);
+    checkNumberType(type);
+    value = takeKnownValue();
+    type1 = compileFactor();
+    checkNumberType(type1);
+    checkTypeEquality(type, type1);
+    genKnownConversion(type, type1);
+    genOperator(SB_TIMES, type, value, &start);
+    return compileTerm2(type);
+    break;
+  case SB_SLASH:
+    eat(SB_SLASH);
+    checkNumberType(type);
+    value = takeKnownValue();
+    type1 = compileFactor();
+    checkNumberType(type1);
+    checkTypeEquality(type, type1);
+    genKnownConversion(type, type1);
+    genOperator(SB_SLASH, type, value, &start);
+    return compileTerm2(type);
+    break;
+    // check the FOLLOW set
+  case KW_RETURN:
+  case KW_BEGIN:
+  case KW_UNTIL:
+  case SB_PLUS:
+  case SB_MINUS:
+  case KW_TO:
+  case KW_DO:
+  case KW_WHILE:
+  case SB_RPAR:
+  case SB_COMMA:
+  case SB_EQ:
+  case SB_NEQ:
+  case SB_LE:
+  case SB_LT:
+  case SB_GE:
+  case SB_GT:
+  case SB_RSEL:
+  case SB_SEMICOLON:
+  case KW_END:
+  case KW_ELSE:
+  case KW_THEN:
+    return type;
+    break;
+  default:
+    error(ERR_INVALID_TERM, lookAhead->lineNo, lookAhead->colNo);
+    return NULL;
+  }
+}
+
+Type* compileSum(void){
+    ConstantValue* value;
+    CodeMark start;
+
+    eat(KW_SUM);
+    Type* type = compileExpression();
+    if(type == NULL){
+      loadKnownValue(makeIntConstant(0));
+      return makeIntType();
+    }
+    checkIntType(type);
+    while (lookAhead->tokenType == SB_COMMA){
+        eat(SB_COMMA);
+        value = takeKnownValue();
+        start = knownStart;
+        type= compileExpression();
+        checkIntType(type);
+        genOperator(SB_PLUS, type, value, &start);
+    }
+    return type;
+}
+
+Type *compileFactor(void)
+{
+  // TODO: parse a factor and return the factor's type
+
+  Object *obj;
+  Type *type;
+  int base;
+
+  forgetKnownValue();
+  switch (lookAhead->tokenType)
+  {
+  case TK_INTEGER:
+    eat(TK_INTEGER);
+
+    if (lookAhead->tokenType == SB_POW)
+    {
+      type = compileKnownPow(makeIntConstant(currentToken->intValue));
+      return type;
+    }
+    else
+    {
+      loadKnownValue(makeIntConstant(currentToken->intValue));
+      type = makeIntType();
+      return type;
+    }
+    break;
+  case TK_CHAR:
+    eat(TK_CHAR);
+    loadKnownValue(makeCharConstant(currentToken->string[0]));
+    type = makeCharType();
+    return type;
+    break;
+  case TK_DOUBLE:
+    eat(TK_DOUBLE);
+    loadKnownValue(makeDoubleConstant(currentToken->doubleValue));
+    type = makeDoubleType();
+    return type;
+    break;
+  case TK_STRING:
+    eat(TK_STRING);
+    loadKnownValue(makeStringConstant(currentToken->string));
+    type = makeStringType();
+    return type;
+    break;
+  case SB_LPAR:
+    eat(SB_LPAR);
+    type = compileExpression();
+    eat(SB_RPAR);
+    return type;
+    break;
+  case TK_IDENT:
+    eat(TK_IDENT);
+    // check if the identifier is declared
+    obj = checkDeclaredIdent(currentToken->string);
+
+    switch (obj->kind)
+    {
+    case OBJ_CONSTANT:
+      switch (obj->constAttrs->value->type)
+      {
+      case TP_INT:
+        type = makeIntType();
+        break;
+      case TP_CHAR:
+        type = makeCharType();
+        break;
+      case TP_DOUBLE:
+        type = makeDoubleType();
+        break;
+      case TP_STRING:
+        type = makeStringType();
+        break;
+      case TP_ARRAY:
+        error(ERR_INVALID_CONSTANT, currentToken->lineNo, currentToken->colNo);
+        break;
+      }
+      loadKnownValue(duplicateConstantValue(obj->constAttrs->value));
+      break;
+    case OBJ_VARIABLE:
+      if (obj->varAttrs->type->typeClass == TP_ARRAY)
+      {
+        genVariableAddress(obj);
+        type = compileIndexes(obj->varAttrs->type);
+        checkBasicType(type);
+        genLoad(type);
+        type = duplicateType(type);
+        forgetKnownValue();
+      }
+      else if (lookAhead->tokenType == SB_POW)
+      {
+        checkIntType(obj->varAttrs->type);
+        base = declareTemporary(INT_SIZE);
+        genLA(0, base);
+        genVariableValue(obj);
+        genST();
+        type = compilePow(base, NULL, NULL);
+      }
+      else
+      {
+        genVariableValue(obj);
+        type = duplicateType(obj->varAttrs->type);
+      }
+      break;
+    case OBJ_PARAMETER:
+      genParameterValue(obj);
+      type = duplicateType(obj->paramAttrs->type);
+
+      break;
+    case OBJ_FUNCTION:
+      if (isPredefinedFunction(obj))
+      {
+        compileArguments(obj->funcAttrs->paramList);
+        genPredefinedFunctionCall(obj);
+      }
+      else if ((obj == symtab->currentScope->owner) && (obj->funcAttrs->paramList != NULL)
+               && (lookAhead->tokenType != SB_LPAR))
+      {
+        // Inside its own body, the name of a function that takes arguments
+        // and is given none is the result it has so far
+        genReturnValue(obj);
+        type = duplicateType(obj->funcAttrs->returnType);
+        break;
+      }
+      else
+      {
+        genINT(RESERVED_WORDS);
+        compileArguments(obj->funcAttrs->paramList);
+        genFunctionCall(obj);
+      }
+      forgetKnownValue();
+      type = duplicateType(obj->funcAttrs->returnType);
+      break;
+    default:
+      return NULL;
+    }
+    break;
+  default:
+      return NULL;
+  }
+
+  return type;
+}
+
+// The base is in a temporary; the power is left on the stack. When the
+// base is known to be baseValue, stored from start on, and the exponent is
+// known too, the power is loaded instead
+Type *compilePow(int base, ConstantValue *baseValue, CodeMark *start)
+{
+  Type *type;
+  int exponent;
+  ConstantValue *power = NULL;
+
+  eat(SB_POW);
+  exponent = declareTemporary(INT_SIZE);
+  genLA(0, exponent);
+  type = compileFactor();
+  checkIntType(type);
+  if (baseValue != NULL && knownValue != NULL)
+    power = foldConstants(SB_POW, baseValue, knownValue);
+  free(baseValue);
+  if (power != NULL)
+  {
+    rewindCode(start);
+    loadKnownValue(power);
+    return type;
+  }
+  genST();
+  forgetKnownValue();
+  genPower(base, exponent, declareTemporary(INT_SIZE));
+  return type;
+}
+
+// The power of a known int base
+Type *compileKnownPow(ConstantValue *value)
+{
+  CodeMark start = markCode();
+  int base = declareTemporary(INT_SIZE);
+
+  genLA(0, base);
+  genConstant(value);
+  genST();
+  return compilePow(base, value, &start);
+}
+
+Type *compileIndexes(Type *arrayType)
+{
+  // TODO: parse a sequence of indexes, check the consistency to the arrayType, and return the element type
+  Type *expressionType;
+  while (lookAhead->tokenType == SB_LSEL)
+  {
+    eat(SB_LSEL);
+    checkArrayType(arrayType);
+    expressionType = compileExpression();
+    checkIntType(expressionType);
+    arrayType = arrayType->elementType;
+    genIndex(arrayType);
+    eat(SB_RSEL);
+  }
+  return arrayType;
+}
+
+int compile(char *fileName, int printSymbols, int optimize)
+{
+  if (openInputStream(fileName) == IO_ERROR)
+    return IO_ERROR;
+
+  currentToken = NULL;
+  lookAhead = getValidToken();
+
+  initSymTab();
+  initCodeBuffer();
+
+  compileProgram();
+  if (optimize != OPTIMIZE_NONE)
+    optimizeProgram(symtab->program, optimize == OPTIMIZE_PRINT);
+
+  if (printSymbols)
+    printObject(symtab->program, 0);
+
+  cleanSymTab();
+
+  free(currentToken);
+  free(lookAhead);
+  closeInputStream();
+  return IO_SUCCESS;
 }
\ No newline at end of file
@@ -1,69 +1,79 @@
-/* 
- * @copyright (c) 2008, Hedspi, Hanoi University of Technology
- * @author Huu-Duc Nguyen
- * @version 1.0
- */
-#ifndef __PARSER_H__
-#define __PARSER_H__
-#include "token.h"
-#include "symtab.h"
-
-void scan(void);
-void eat(TokenType tokenType);
-
-void compileProgram(void);
-void compileBlock(void);
-void compileBlock2(void);
-void compileBlock3(void);
-void compileBlock4(void);
-void compileBlock5(void);
-void compileConstDecls(void);
-void compileConstDecl(void);
-void compileTypeDecls(void);
-void compileTypeDecl(void);
-void compileVarDecls(void);
-void compileVarDecl(void);
-void compileSubDecls(void);
-void compileFuncDecl(void);
-void compileProcDecl(void);
-ConstantValue* compileUnsignedConstant(void);
-ConstantValue* compileConstant(void);
-ConstantValue* compileConstant2(void);
-Type* compileType(void);
-Type* compileBasicType(void);
-void compileParams(void);
-void compileParam(void);
-void compileStatements(void);
-void compileStatement(void);
-Type* compileLValue(void);
-void compileAssignSt(void);
-void compileCallSt(void);
-void compileGroupSt(void);
-void compileIfSt(void);
-void compileElseSt(void);
-void compileWhileSt(void);
-void compileDoWhileSt(void);
-void compileForSt(void);
-void compileSwitchSt(void);
-void compileCaseSt(void);
-void compileDefaultSt(void);
-void compileRepeatUntilSt(void);
-void compileArgument(Object* param);
-void compileArguments(ObjectNode* paramList);
-void compileCondition(void);
-Type* compileSum(void);
-Type* compileExpression(void);
-Type* compileExpression2(void);
-Type* compileExpression3(void);
-Type* compileExpression4(void);
-Type* compileExpression5(void);
-Type* compileTerm(void);
-void compileTerm2(void);
-Type* compilePow(void);
-Type* compileFactor(void);
-
-Type* compileIndexes(Type* arrayType);
-
-int compile(char *fileName);
-
-#endif
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+#ifndef __PARSER_H__
+#define __PARSER_H__
+#include "token.h"
+#include "symtab.h"
+#include "codegen.h"
+
+void scan(void);
+void eat(TokenType tokenType);
+
+void compileProgram(void);
+void compileBlock(void);
+void compileBlock2(void);
+void compileBlock3(void);
+void compileBlock4(void);
+void compileBlock5(void);
+void compileConstDecls(void);
+void compileConstDecl(void);
+void compileTypeDecls(void);
+void compileTypeDecl(void);
+void compileVarDecls(void);
+void compileVarDecl(void);
+void compileSubDecls(void);
+void compileFuncDecl(void);
+void compileProcDecl(void);
+ConstantValue* compileUnsignedConstant(void);
+ConstantValue* compileConstant(void);
+ConstantValue* compileConstant2(void);
+Type* compileType(void);
+Type* compileBasicType(void);
+void compileParams(void);
+void compileParam(void);
+void compileStatements(void);
+void compileStatement(void);
+void compileDeadStatement(void);
+Type* compileLValue(void);
+void compileAssignSt(void);
+void compileCallSt(void);
+void compileGroupSt(void);
+void compileIfSt(void);
+void compileElseSt(void);
+void compileWhileSt(void);
+void compileDoWhileSt(void);
+void compileForSt(void);
+void compileSwitchSt(void);
+void compileCaseSt(void);
+void compileDefaultSt(void);
+void compileRepeatUntilSt(void);
+void compileArgument(Object* param);
+void compileArguments(ObjectNode* paramList);
+void compileCondition(void);
+Type* compileSum(void);
+Type* compileExpression(void);
+Type* compileKnownIfExpression(ConstantValue* condition);
+Type* compileExpression2(void);
+Type* compileExpression3(Type* type);
+Type* compileExpression4(void);
+Type* compileExpression5(void);
+Type* compileTerm(void);
+void checkNumberType(Type* type);
+Type* compileTerm2(Type* type);
+Type* compilePow(int base, ConstantValue* baseValue, CodeMark* start);
+Type* compileKnownPow(ConstantValue* value);
+Type* compileFactor(void);
+
+Type* compileIndexes(Type* arrayType);
+
+// When 0, constant expressions and conditions are compiled as written
+extern int foldKnownValues;
+
+// The code is left in the code buffer (see codegen.h); optimize is one of
+// the OPTIMIZE_ of passes.h
+int compile(char *fileName, int printSymbols, int optimize);
+
+#endif
@@ -0,0 +1,390 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "passes.h"
+#include "optimizer.h"
+#include "verifier.h"
+
+extern CodeBlock* codeBlock;
+
+// Rounds of the passes over a function that keeps changing
+#define MAX_ROUNDS 8
+
+// States of a value for propagateConstants()
+#define UNDEFINED 0
+#define CONSTANT 1
+#define VARYING 2
+
+// The instruction before index that is still there, -1 if none
+static int previousInstruction(IRBlock* block, int index) {
+  for (index --; index >= 0; index --)
+    if (!block->code[index].deleted)
+      return index;
+  return -1;
+}
+
+// The constant of an LA 0,x; LC c; ST
+static int storedConstant(IRBlock* block, int store, WORD* constant) {
+  int k = previousInstruction(block, store);
+
+  if ((k < 0) || (block->code[k].inst.op != OP_LC) || (previousInstruction(block, k) != block->code[store].pair))
+    return 0;
+  *constant = block->code[k].inst.q;
+  return 1;
+}
+
+int propagateConstants(IRProgram* program, IRFunction* function) {
+  int n = function->valueCount;
+  char* state = (char*) calloc(n + 1, 1);
+  WORD* constant = (WORD*) malloc((n + 1) * sizeof(WORD));
+  IRValue* value;
+  IRBlock* block;
+  IRInstruction* ir;
+  int changed, b, i, k, v, operand;
+
+  for (v = 0; v < n; v ++) {
+    value = function->values + v;
+    if (value->kind == VALUE_ENTRY)
+      state[v] = VARYING;
+    else if (value->kind == VALUE_STORE)
+      state[v] = storedConstant(value->block, value->index, constant + v) ? CONSTANT : VARYING;
+  }
+
+  // Phis start undefined and only ever go down, to the constant all their
+  // defined operands agree on, then to varying
+  do {
+    changed = 0;
+    for (v = 0; v < n; v ++) {
+      value = function->values + v;
+      if ((value->kind != VALUE_PHI) || (state[v] == VARYING)) continue;
+      for (k = 0; k < value->block->predCount; k ++) {
+	operand = value->operands[k];
+	if ((operand != NO_VALUE) && (state[operand] == UNDEFINED)) continue;
+	if ((operand == NO_VALUE) || (state[operand] == VARYING)
+	    || ((state[v] == CONSTANT) && (constant[v] != constant[operand]))) {
+	  state[v] = VARYING;
+	  changed = 1;
+	  break;
+	}
+	if (state[v] == UNDEFINED) {
+	  state[v] = CONSTANT;
+	  constant[v] = constant[operand];
+	  changed = 1;
+	}
+      }
+    }
+  } while (changed);
+
+  changed = 0;
+  for (b = 0; b < function->orderCount; b ++) {
+    block = function->order[b];
+    for (i = 0; i < block->length; i ++) {
+      ir = block->code + i;
+      if (ir->deleted || ((ir->inst.op != OP_LV) && (ir->inst.op != OP_LI))
+	  || (ir->value == NO_VALUE) || (state[ir->value] != CONSTANT))
+	continue;
+      // An LI pops the address it reads through
+      if (ir->inst.op == OP_LI)
+	deleteInstruction(block->code + ir->pair);
+      ir->inst.op = OP_LC;
+      ir->inst.p = DC_VALUE;
+      ir->inst.q = constant[ir->value];
+      ir->slot = NO_SLOT;
+      ir->value = NO_VALUE;
+      ir->pair = -1;
+      changed = 1;
+    }
+  }
+
+  free(state);
+  free(constant);
+  return changed;
+}
+
+// Whether dropping the instruction that pushes a word changes nothing else
+static int isPure(enum OpCode op) {
+  return (op == OP_LC) || (op == OP_LV) || (op == OP_LA) || (op == OP_LS);
+}
+
+int removeDeadStores(IRProgram* program, IRFunction* function) {
+  int n = function->valueCount;
+  char* live = (char*) calloc(n + 1, 1);
+  int* work = (int*) malloc((n + 1) * sizeof(int));
+  IRValue* value;
+  IRBlock* block;
+  IRInstruction* ir;
+  int changed = 0;
+  int top = 0;
+  int b, i, k, v, pure;
+
+  // Values the LVs and LIs read, and those that flow into them through phis
+  for (b = 0; b < function->orderCount; b ++) {
+    block = function->order[b];
+    for (i = 0; i < block->length; i ++) {
+      ir = block->code + i;
+      if (ir->deleted || ((ir->inst.op != OP_LV) && (ir->inst.op != OP_LI))
+	  || (ir->value == NO_VALUE) || live[ir->value]) continue;
+      live[ir->value] = 1;
+      work[top++] = ir->value;
+    }
+  }
+  while (top > 0) {
+    value = function->values + work[--top];
+    if (value->kind != VALUE_PHI) continue;
+    for (k = 0; k < value->block->predCount; k ++) {
+      v = value->operands[k];
+      if ((v != NO_VALUE) && !live[v]) {
+	live[v] = 1;
+	work[top++] = v;
+      }
+    }
+  }
+
+  for (b = 0; b < function->orderCount; b ++) {
+    block = function->order[b];
+    for (i = 0; i < block->length; i ++) {
+      ir = block->code + i;
+      if (ir->deleted || (ir->inst.op != OP_ST) || (ir->value == NO_VALUE) || live[ir->value]) continue;
+      // The word is dropped with what pushed it, or popped if that has to
+      // run; an address an earlier block pushed is popped along with it
+      k = previousInstruction(block, i);
+      pure = (ir->pair >= 0) && (k >= 0) && (previousInstruction(block, k) == ir->pair)
+	&& isPure(block->code[k].inst.op);
+      if (ir->pair >= 0)
+	deleteInstruction(block->code + ir->pair);
+      if (pure) {
+	deleteInstruction(block->code + k);
+	deleteInstruction(ir);
+      } else {
+	ir->inst.op = OP_DCT;
+	ir->inst.p = DC_VALUE;
+	ir->inst.q = (ir->pair >= 0) ? 1 : 2;
+	ir->slot = NO_SLOT;
+	ir->value = NO_VALUE;
+	ir->pair = -1;
+      }
+      changed = 1;
+    }
+  }
+
+  free(live);
+  free(work);
+  return changed;
+}
+
+// Whether the callee takes every argument by value: a reference could be into the frame
+static int takesValues(IRFunction* callee) {
+  ObjectNode* node;
+
+  if (callee->object == NULL)
+    return 0;
+  if (callee->object->kind == OBJ_FUNCTION)
+    node = callee->object->funcAttrs->paramList;
+  else if (callee->object->kind == OBJ_PROCEDURE)
+    node = callee->object->procAttrs->paramList;
+  else return 0;
+  for (; node != NULL; node = node->next)
+    if (node->object->paramAttrs->kind == PARAM_REFERENCE)
+      return 0;
+  return 1;
+}
+
+// The EP, EF or EFF the code after index reaches through jumps alone, NULL if none
+static IRInstruction* returnAfter(IRFunction* function, IRBlock* block, int index) {
+  IRInstruction* ir;
+  int steps = 0;
+
+  for (;;) {
+    for (index ++; (index < block->length) && block->code[index].deleted; index ++)
+      ;
+    if (index < block->length) {
+      ir = block->code + index;
+      if ((ir->inst.op == OP_EP) || (ir->inst.op == OP_EF) || (ir->inst.op == OP_EFF))
+	return ir;
+      if (ir->inst.op != OP_J)
+	return NULL;
+      block = block->target;
+    } else block = block->next;
+    if ((block == NULL) || (++ steps > function->blockCount))
+      return NULL;
+    index = -1;
+  }
+}
+
+// Whether the function still returns somewhere once nothing follows block
+static int returnsWithout(IRFunction* function, IRBlock* block) {
+  char* seen = (char*) calloc(function->blockCount, 1);
+  IRBlock** work = (IRBlock**) malloc(function->blockCount * sizeof(IRBlock*));
+  IRBlock* current;
+  IRBlock* succ;
+  enum OpCode op;
+  int top = 0;
+  int found = 0;
+  int i, s;
+
+  seen[function->blocks[0]->id] = 1;
+  work[top++] = function->blocks[0];
+  while ((top > 0) && !found) {
+    current = work[--top];
+    for (i = 0; i < current->length; i ++) {
+      op = current->code[i].inst.op;
+      if (!current->code[i].deleted && ((op == OP_EP) || (op == OP_EF) || (op == OP_EFF)))
+	found = 1;
+    }
+    if (current == block) continue;
+    for (s = 0; s < 2; s ++) {
+      succ = (s == 0) ? current->next : current->target;
+      if ((succ != NULL) && !seen[succ->id]) {
+	seen[succ->id] = 1;
+	work[top++] = succ;
+      }
+    }
+  }
+  free(seen);
+  free(work);
+  return found;
+}
+
+/*
+ * Finds the instruction that pushed the word an ST or STF at store takes
+ * its address from, when it is in the block and nothing else took the
+ * word in between; -1 otherwise.
+ */
+static int addressOf(IRProgram* program, IRBlock* block, int store) {
+  int* height = (int*) malloc((block->length + 1) * sizeof(int));
+  int h = block->height;
+  int pusher = -1;
+  int i, need, delta, pos;
+
+  for (i = 0; i <= store; i ++) {
+    height[i] = h;
+    if (block->code[i].deleted) continue;
+    instructionEffect(program, &block->code[i].inst, &need, &delta);
+    h += delta;
+  }
+  pos = height[store] - ((block->code[store].inst.op == OP_ST) ? 2 : 1 + DOUBLE_SIZE);
+  for (i = store - 1; i >= 0; i --) {
+    if (block->code[i].deleted) continue;
+    instructionEffect(program, &block->code[i].inst, &need, &delta);
+    if (height[i] - need <= pos) {
+      if ((height[i] == pos) && (need == 0) && (delta == 1))
+	pusher = i;
+      break;
+    }
+  }
+  free(height);
+  return pusher;
+}
+
+int makeTailCalls(IRProgram* program, IRFunction* function) {
+  int kind = function->returnKind;
+  IRBlock* block;
+  IRInstruction* exit;
+  IRInstruction* ir;
+  IRFunction* callee;
+  int changed = 0;
+  int b, last, call, store, address, count;
+
+  if ((kind != RETURN_EP) && (kind != RETURN_EF) && (kind != RETURN_EFF))
+    return 0;
+  for (b = 0; b < function->orderCount; b ++) {
+    block = function->order[b];
+    // [LA 0,result ...] INT 4; arguments; DCT; CALL 1,callee [ST or STF] [J]
+    last = previousInstruction(block, block->length);
+    call = ((last >= 0) && (block->code[last].inst.op == OP_J)) ? previousInstruction(block, last) : last;
+    store = -1;
+    if ((kind != RETURN_EP) && (call >= 0)
+	&& (block->code[call].inst.op == ((kind == RETURN_EF) ? OP_ST : OP_STF))) {
+      store = call;
+      call = previousInstruction(block, store);
+    }
+    if ((call < 0) || (block->code[call].inst.op != OP_CALL) || (block->code[call].inst.p != 1)
+	|| ((kind != RETURN_EP) && (store < 0)))
+      continue;
+    callee = program->functions[block->code[call].inst.q];
+    if ((callee->returnKind != kind) || !takesValues(callee))
+      continue;
+    count = previousInstruction(block, call);
+    if ((count < 0) || (block->code[count].inst.op != OP_DCT)
+	|| (block->code[count].inst.q < RESERVED_WORDS))
+      continue;
+    if ((exit = returnAfter(function, block, (store >= 0) ? store : call)) == NULL)
+      continue;
+    address = -1;
+    if (store >= 0) {
+      // The result goes where the function returns it from
+      address = addressOf(program, block, store);
+      if ((address < 0) || (block->code[address].inst.op != OP_LA) || (block->code[address].inst.p != 0)
+	  || (block->code[address].inst.q != ((kind == RETURN_EF) ? RETURN_VALUE_OFFSET : exit->inst.q)))
+	continue;
+    }
+    if (!returnsWithout(function, block))
+      continue;
+
+    if (address >= 0)
+      deleteInstruction(block->code + address);
+    if (store >= 0)
+      deleteInstruction(block->code + store);
+    if (last != ((store >= 0) ? store : call))
+      deleteInstruction(block->code + last);
+    ir = block->code + call;
+    ir->inst.op = OP_TC;
+    ir->inst.p = block->code[count].inst.q - RESERVED_WORDS;
+    deleteInstruction(block->code + count);
+    block->next = NULL;
+    block->target = NULL;
+    changed = 1;
+  }
+  return changed;
+}
+
+/******************************************************************/
+
+void runPasses(IRProgram* program, PassFunction* passes, int passCount) {
+  IRFunction* function;
+  int i, k, round, changed;
+
+  for (i = 0; i < program->functionCount; i ++) {
+    function = program->functions[i];
+    changed = 1;
+    for (round = 0; changed && (round < MAX_ROUNDS); round ++) {
+      changed = 0;
+      for (k = 0; k < passCount; k ++) {
+	if (!function->analysed)
+	  analyseFunction(program, function);
+	if (passes[k](program, function)) {
+	  invalidateFunction(function);
+	  changed = 1;
+	}
+      }
+    }
+  }
+}
+
+static PassFunction standardPasses[] = {
+  propagateConstants,
+  reduceInductions,
+  hoistInvariants,
+  removeDeadStores,
+  makeTailCalls
+};
+
+int optimizeProgram(Object* programObject, int printIR) {
+  IRProgram* program = buildProgram(codeBlock, programObject);
+
+  if (program == NULL)
+    return 0;
+  runPasses(program, standardPasses, sizeof(standardPasses) / sizeof(PassFunction));
+  if (printIR)
+    printProgram(program);
+  lowerProgram(program);
+  freeProgram(program);
+  free(optimizeCode(codeBlock));
+  return 1;
+}
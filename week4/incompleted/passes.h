@@ -0,0 +1,52 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __PASSES_H__
+#define __PASSES_H__
+
+#include "ir.h"
+
+// What compile() does with the code once the parser is done with it
+#define OPTIMIZE_NONE 0
+#define OPTIMIZE_CODE 1
+#define OPTIMIZE_PRINT 2        // as OPTIMIZE_CODE, printing the IR after the passes
+
+/*
+ * A pass rewrites one function and returns whether it changed anything.
+ * runPasses() analyses the function again before each pass that follows
+ * a change, so a pass can count on the dominators and SSA values
+ * matching the code, and runs them all again as long as one of them
+ * changes the function.
+ */
+typedef int (*PassFunction)(IRProgram* program, IRFunction* function);
+
+// A read of a scalar that holds a known constant becomes an LC
+int propagateConstants(IRProgram* program, IRFunction* function);
+// A store of a scalar that nothing reads is dropped
+int removeDeadStores(IRProgram* program, IRFunction* function);
+// The uses of an induction variable of a loop that are the same multiple of
+// it plus the same invariant terms, array addresses mostly, read a local
+// that steps along with it instead (loops.c)
+int reduceInductions(IRProgram* program, IRFunction* function);
+// What a loop computes the same in every iteration is computed once in
+// front of it, when that cannot trap where the loop would not (loops.c)
+int hoistInvariants(IRProgram* program, IRFunction* function);
+// A call the function returns from right after becomes a TC, which runs
+// the callee in the frame of the function: when the callee is on the same
+// level, returns the same way and takes its arguments by value
+int makeTailCalls(IRProgram* program, IRFunction* function);
+
+void runPasses(IRProgram* program, PassFunction* passes, int passCount);
+
+/*
+ * Runs the passes over the code of the code buffer (see codegen.h), and
+ * then the rewrites of optimizer.h over the code they leave.  program is
+ * the object of the main program.  Returns 0, leaving the code as it
+ * was, when it does not verify.
+ */
+int optimizeProgram(Object* program, int printIR);
+
+#endif
@@ -1,611 +1,612 @@
-/* Scanner
- * @copyright (c) 2008, Hedspi, Hanoi University of Technology
- * @author Huu-Duc Nguyen
- * @version 1.0
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <ctype.h>
-#include <string.h>
-
-#include "reader.h"
-#include "charcode.h"
-#include "token.h"
-#include "error.h"
-#include "scanner.h"
-#include "symtab.h"
-
-extern int lineNo;
-extern int colNo;
-extern int currentChar;
-
-extern CharCode charCodes[];
-
-/***************************************************************/
-int checkRSEL = 0;
-
-void skipBlank()
-{
-  while ((currentChar != EOF) && (charCodes[currentChar] == CHAR_SPACE))
-    readChar();
-}
-
-void skipComment()
-{
-  int state = 0;
-  while ((currentChar != EOF) && (state < 2))
-  {
-    switch (charCodes[currentChar])
-    {
-    case CHAR_TIMES:
-      state = 1;
-      break;
-    case CHAR_RPAR:
-      if (state == 1)
-        state = 2;
-      else
-        state = 0;
-      break;
-    default:
-      state = 0;
-    }
-    readChar();
-  }
-  if (state != 2)
-    error(ERR_ENDOFCOMMENT, lineNo, colNo);
-}
-
-Token *readIdentKeyword(void)
-{
-  Token *token = makeToken(TK_NONE, lineNo, colNo);
-  int count = 1;
-
-  token->string[0] = toupper((char)currentChar);
-  readChar();
-
-  while ((currentChar != EOF) &&
-         ((charCodes[currentChar] == CHAR_LETTER) || (charCodes[currentChar] == CHAR_DIGIT)))
-  {
-    if (count <= MAX_IDENT_LEN)
-      token->string[count++] = toupper((char)currentChar);
-    readChar();
-  }
-
-  if (count > MAX_IDENT_LEN)
-  {
-    error(ERR_IDENT_TOO_LONG, token->lineNo, token->colNo);
-    return token;
-  }
-
-  token->string[count] = '\0';
-  token->tokenType = checkKeyword(token->string);
-
-  if (token->tokenType == TK_NONE)
-    token->tokenType = TK_IDENT;
-
-  return token;
-}
-
-Token *readNumber(void)
-{
-  Token *token;
-  int i = 0, dotCount = 0;
-
-  token = makeToken(TK_DOUBLE, lineNo, colNo);
-  do
-  {
-    if (charCodes[currentChar] == CHAR_DIGIT)
-    {
-      token->string[i] = currentChar;
-      i++;
-      readChar();
-    }
-    else
-    {
-      readChar();
-      if (charCodes[currentChar] == CHAR_DIGIT)
-      {
-        dotCount++;
-        token->string[i] = '.';
-        i++;
-
-        token->string[i] = currentChar;
-        i++;
-        readChar();
-      }
-      else if (charCodes[currentChar] == CHAR_RPAR)
-        checkRSEL = 1;
-      else if (charCodes[currentChar] == CHAR_PERIOD)
-      {
-        readChar();
-        if (charCodes[currentChar] == CHAR_RPAR)
-        {
-          dotCount++;
-          token->string[i] = '.';
-          i++;
-          token->string[i] = '0';
-          i++;
-          checkRSEL = 1;
-        }
-        else
-        {
-          token->tokenType = TK_NONE;
-          error(ERR_INVALID_DOUBLE, token->lineNo, token->colNo);
-          return token;
-        }
-      }
-      else
-      {
-        dotCount++;
-        token->string[i] = '.';
-        i++;
-        token->string[i] = '0';
-        i++;
-      }
-    }
-  } while (charCodes[currentChar] == CHAR_DIGIT || charCodes[currentChar] == CHAR_PERIOD);
-  token->string[i] = 0;
-
-  if (dotCount == 0)
-  {
-    token->tokenType = TK_INTEGER;
-    token->intValue = atoi(token->string);
-  }
-  else if (dotCount > 1)
-  {
-    token->tokenType = TK_NONE;
-    error(ERR_INVALID_DOUBLE, token->lineNo, token->colNo);
-    return token;
-  }
-  else
-  {
-    token->doubleValue = atof(token->string);
-  }
-  return token;
-}
-
-Token *readConstChar(void)
-{
-  Token *token = makeToken(TK_CHAR, lineNo, colNo);
-
-  readChar();
-  if (currentChar == EOF)
-  {
-    token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
-    return token;
-  }
-
-  token->string[0] = currentChar;
-  token->string[1] = '\0';
-
-  readChar();
-  if (currentChar == EOF)
-  {
-    token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
-    return token;
-  }
-
-  if (charCodes[currentChar] == CHAR_SINGLEQUOTE)
-  {
-    readChar();
-    return token;
-  }
-  else
-  {
-    token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
-    return token;
-  }
-}
-
-Token *readString(void)
-{
-  Token *token;
-  char string[MAX_LENGTH + 1];
-  int i = 0, j;
-
-  token = makeToken(TK_STRING, lineNo, colNo);
-  readChar();
-  do
-  {
-    string[i] = currentChar;
-    i++;
-    readChar();
-  } while (charCodes[currentChar] != CHAR_DOUBLEQUOTE && i <= MAX_LENGTH && currentChar != EOF);
-
-  if (i > MAX_LENGTH || currentChar == EOF)
-  {
-    token->tokenType = TK_NONE;
-    error(ERR_INVALID_STRING, token->lineNo, token->colNo);
-    return token;
-  }
-  else
-  {
-    string[i] = 0;
-    token->tokenType = TK_STRING;
-    for (j = 0; string[j]; j++)
-      token->string[j] = string[j];
-    token->string[j] = 0;
-    readChar();
-    return token;
-  }
-}
-
-Token *getToken(void)
-{
-  Token *token;
-  int ln, cn;
-
-  if (currentChar == EOF)
-    return makeToken(TK_EOF, lineNo, colNo);
-
-  switch (charCodes[currentChar])
-  {
-  case CHAR_SPACE:
-    skipBlank();
-    return getToken();
-  case CHAR_LETTER:
-    return readIdentKeyword();
-  case CHAR_DIGIT:
-    return readNumber();
-  case CHAR_PLUS:
-    token = makeToken(SB_PLUS, lineNo, colNo);
-    readChar();
-    return token;
-  case CHAR_MINUS:
-    token = makeToken(SB_MINUS, lineNo, colNo);
-    readChar();
-    return token;
-  case CHAR_TIMES:
-    token = makeToken(SB_TIMES, lineNo, colNo);
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_TIMES))
-    {
-      readChar();
-      return makeToken(SB_POW, lineNo, colNo);
-    }
-    else
-      return token;
-  case CHAR_SLASH:
-    token = makeToken(SB_SLASH, lineNo, colNo);
-    readChar();
-    return token;
-  case CHAR_LT:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ))
-    {
-      readChar();
-      return makeToken(SB_LE, ln, cn);
-    }
-    else
-      return makeToken(SB_LT, ln, cn);
-  case CHAR_GT:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ))
-    {
-      readChar();
-      return makeToken(SB_GE, ln, cn);
-    }
-    else
-      return makeToken(SB_GT, ln, cn);
-  case CHAR_EQ:
-    token = makeToken(SB_EQ, lineNo, colNo);
-    readChar();
-    return token;
-  case CHAR_EXCLAIMATION:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ))
-    {
-      readChar();
-      return makeToken(SB_NEQ, ln, cn);
-    }
-    else
-    {
-      token = makeToken(TK_NONE, ln, cn);
-      error(ERR_INVALID_SYMBOL, ln, cn);
-      return token;
-    }
-  case CHAR_COMMA:
-    token = makeToken(SB_COMMA, lineNo, colNo);
-    readChar();
-    return token;
-
-  case CHAR_PERIOD:
-    token = makeToken(SB_PERIOD, lineNo, colNo);
-    readChar();
-    if (charCodes[currentChar] == CHAR_RPAR)
-    {
-      token->tokenType = SB_RSEL;
-      readChar();
-    }
-    else if (charCodes[currentChar] == CHAR_DIGIT)
-    {
-      int i = 2;
-      token->tokenType = TK_DOUBLE;
-      token->string[0] = '0';
-      token->string[1] = '.';
-      while (charCodes[currentChar] == CHAR_DIGIT)
-      {
-        token->string[i] = currentChar;
-        i++;
-        readChar();
-      }
-      token->string[i] = 0;
-      if (charCodes[currentChar] == CHAR_PERIOD)
-      {
-        readChar();
-        if (charCodes[currentChar] == CHAR_RPAR)
-          checkRSEL = 1;
-        else
-        {
-          token->tokenType = TK_NONE;
-          error(ERR_INVALID_DOUBLE, token->lineNo, token->colNo);
-        }
-      }
-    }
-    return token;
-
-  case CHAR_COLON:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ))
-    {
-      readChar();
-      return makeToken(SB_ASSIGN, ln, cn);
-    }
-    else
-      return makeToken(SB_COLON, ln, cn);
-  case CHAR_SINGLEQUOTE:
-    return readConstChar();
-  case CHAR_SEMICOLON:
-    token = makeToken(SB_SEMICOLON, lineNo, colNo);
-    readChar();
-    return token;
-  case CHAR_LPAR:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-
-    if (currentChar == EOF)
-      return makeToken(SB_LPAR, ln, cn);
-
-    switch (charCodes[currentChar])
-    {
-    case CHAR_PERIOD:
-      readChar();
-      return makeToken(SB_LSEL, ln, cn);
-    case CHAR_TIMES:
-      readChar();
-      skipComment();
-      return getToken();
-    default:
-      return makeToken(SB_LPAR, ln, cn);
-    }
-
-  case CHAR_RPAR:
-    if (checkRSEL == 1)
-    {
-      token = makeToken(SB_RSEL, lineNo, colNo - 1);
-      checkRSEL = 0;
-    }
-    else
-      token = makeToken(SB_RPAR, lineNo, colNo);
-    readChar();
-    return token;
-
-  case CHAR_DOUBLEQUOTE:
-    token = readString();
-    return token;
-  default:
-    token = makeToken(TK_NONE, lineNo, colNo);
-    error(ERR_INVALID_SYMBOL, lineNo, colNo);
-    readChar();
-    return token;
-  }
-}
-
-Token *getValidToken(void)
-{
-  Token *token = getToken();
-  while (token->tokenType == TK_NONE)
-  {
-    free(token);
-    token = getToken();
-  }
-  return token;
-}
-
-/******************************************************************/
-
-void printToken(Token *token)
-{
-
-  printf("%d-%d:", token->lineNo, token->colNo);
-
-  switch (token->tokenType)
-  {
-  case TK_NONE:
-    printf("TK_NONE\n");
-    break;
-  case TK_IDENT:
-    printf("TK_IDENT(%s)\n", token->string);
-    break;
-  case TK_INTEGER:
-    printf("TK_INTEGER(%s)\n", token->string);
-    break;
-  case TK_CHAR:
-    printf("TK_CHAR(\'%s\')\n", token->string);
-    break;
-  case TK_STRING:
-    printf("TK_STRING(\'%s\')\n", token->string);
-    break;
-  case TK_DOUBLE:
-    printf("TK_DOUBLE(\'%s\')\n", token->string);
-    break;
-  case TK_EOF:
-    printf("TK_EOF\n");
-    break;
-
-  case KW_PROGRAM:
-    printf("KW_PROGRAM\n");
-    break;
-  case KW_CONST:
-    printf("KW_CONST\n");
-    break;
-  case KW_TYPE:
-    printf("KW_TYPE\n");
-    break;
-  case KW_VAR:
-    printf("KW_VAR\n");
-    break;
-  case KW_INTEGER:
-    printf("KW_INTEGER\n");
-    break;
-  case KW_CHAR:
-    printf("KW_CHAR\n");
-    break;
-  case KW_ARRAY:
-    printf("KW_ARRAY\n");
-    break;
-  case KW_STRING:
-    printf("KW_STRING\n");
-    break;
-  case KW_DOUBLE:
-    printf("KW_DOUBLE\n");
-    break;
-  case KW_OF:
-    printf("KW_OF\n");
-    break;
-  case KW_FUNCTION:
-    printf("KW_FUNCTION\n");
-    break;
-  case KW_PROCEDURE:
-    printf("KW_PROCEDURE\n");
-    break;
-  case KW_BEGIN:
-    printf("KW_BEGIN\n");
-    break;
-  case KW_END:
-    printf("KW_END\n");
-    break;
-  case KW_CALL:
-    printf("KW_CALL\n");
-    break;
-  case KW_IF:
-    printf("KW_IF\n");
-    break;
-  case KW_THEN:
-    printf("KW_THEN\n");
-    break;
-  case KW_ELSE:
-    printf("KW_ELSE\n");
-    break;
-  case KW_WHILE:
-    printf("KW_WHILE\n");
-    break;
-  case KW_DO:
-    printf("KW_DO\n");
-    break;
-  case KW_FOR:
-    printf("KW_FOR\n");
-    break;
-  case KW_TO:
-    printf("KW_TO\n");
-    break;
-  case KW_SWITCH:
-    printf("KW_SWITCH\n");
-    break;
-  case KW_CASE:
-    printf("KW_CASE\n");
-    break;
-  case KW_DEFAULT:
-    printf("KW_DEFAULT\n");
-    break;
-  case KW_BREAK:
-    printf("KW_BREAK\n");
-    break;
-  case KW_RETURN:
-    printf("KW_RETURN\n");
-    break;
-  case KW_SUM:
-    printf("KW_SUM\n");
-    break;
-  case KW_REPEAT:
-    printf("KW_REPEAT\n");
-    break;
-  case KW_UNTIL:
-    printf("KW_UNTIL\n");
-    break;
-
-  case SB_SEMICOLON:
-    printf("SB_SEMICOLON\n");
-    break;
-  case SB_COLON:
-    printf("SB_COLON\n");
-    break;
-  case SB_PERIOD:
-    printf("SB_PERIOD\n");
-    break;
-  case SB_COMMA:
-    printf("SB_COMMA\n");
-    break;
-  case SB_ASSIGN:
-    printf("SB_ASSIGN\n");
-    break;
-  case SB_EQ:
-    printf("SB_EQ\n");
-    break;
-  case SB_NEQ:
-    printf("SB_NEQ\n");
-    break;
-  case SB_LT:
-    printf("SB_LT\n");
-    break;
-  case SB_LE:
-    printf("SB_LE\n");
-    break;
-  case SB_GT:
-    printf("SB_GT\n");
-    break;
-  case SB_GE:
-    printf("SB_GE\n");
-    break;
-  case SB_PLUS:
-    printf("SB_PLUS\n");
-    break;
-  case SB_MINUS:
-    printf("SB_MINUS\n");
-    break;
-  case SB_TIMES:
-    printf("SB_TIMES\n");
-    break;
-  case SB_SLASH:
-    printf("SB_SLASH\n");
-    break;
-  case SB_LPAR:
-    printf("SB_LPAR\n");
-    break;
-  case SB_RPAR:
-    printf("SB_RPAR\n");
-    break;
-  case SB_LSEL:
-    printf("SB_LSEL\n");
-    break;
-  case SB_RSEL:
-    printf("SB_RSEL\n");
-    break;
-  case SB_POW:
-    printf("SB_POW\n");
-    break;
-  }
+/* Scanner
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+
+#include "reader.h"
+#include "charcode.h"
+#include "token.h"
+#include "error.h"
+#include "scanner.h"
+#include "symtab.h"
+
+extern int lineNo;
+extern int colNo;
+extern int currentChar;
+
+extern CharCode charCodes[];
+
+/***************************************************************/
+int checkRSEL = 0;
+
+void skipBlank()
+{
+  while ((currentChar != EOF) && (charCodes[currentChar] == CHAR_SPACE))
+    readChar();
+}
+
+void skipComment()
+{
+  int state = 0;
+  while ((currentChar != EOF) && (state < 2))
+  {
+    switch (charCodes[currentChar])
+    {
+    case CHAR_TIMES:
+      state = 1;
+      break;
+    case CHAR_RPAR:
+      if (state == 1)
+        state = 2;
+      else
+        state = 0;
+      break;
+    default:
+      state = 0;
+    }
+    readChar();
+  }
+  if (state != 2)
+    error(ERR_ENDOFCOMMENT, lineNo, colNo);
+}
+
+Token *readIdentKeyword(void)
+{
+  Token *token = makeToken(TK_NONE, lineNo, colNo);
+  int count = 1;
+
+  token->string[0] = toupper((char)currentChar);
+  readChar();
+
+  while ((currentChar != EOF) &&
+         ((charCodes[currentChar] == CHAR_LETTER) || (charCodes[currentChar] == CHAR_DIGIT)))
+  {
+    if (count <= MAX_IDENT_LEN)
+      token->string[count++] = toupper((char)currentChar);
+    readChar();
+  }
+
+  if (count > MAX_IDENT_LEN)
+  {
+    error(ERR_IDENT_TOO_LONG, token->lineNo, token->colNo);
+    return token;
+  }
+
+  token->string[count] = '\0';
+  token->tokenType = checkKeyword(token->string);
+
+  if (token->tokenType == TK_NONE)
+    token->tokenType = TK_IDENT;
+
+  return token;
+}
+
+Token *readNumber(void)
+{
+  Token *token;
+  int i = 0, dotCount = 0;
+
+  token = makeToken(TK_DOUBLE, lineNo, colNo);
+  do
+  {
+    if (charCodes[currentChar] == CHAR_DIGIT)
+    {
+      token->string[i] = currentChar;
+      i++;
+      readChar();
+    }
+    else
+    {
+      readChar();
+      if (charCodes[currentChar] == CHAR_DIGIT)
+      {
+        dotCount++;
+        token->string[i] = '.';
+        i++;
+
+        token->string[i] = currentChar;
+        i++;
+        readChar();
+      }
+      else if (charCodes[currentChar] == CHAR_RPAR)
+        checkRSEL = 1;
+      else if (charCodes[currentChar] == CHAR_PERIOD)
+      {
+        readChar();
+        if (charCodes[currentChar] == CHAR_RPAR)
+        {
+          dotCount++;
+          token->string[i] = '.';
+          i++;
+          token->string[i] = '0';
+          i++;
+          checkRSEL = 1;
+        }
+        else
+        {
+          token->tokenType = TK_NONE;
+          error(ERR_INVALID_DOUBLE, token->lineNo, token->colNo);
+          return token;
+        }
+      }
+      else
+      {
+        dotCount++;
+        token->string[i] = '.';
+        i++;
+        token->string[i] = '0';
+        i++;
+      }
+    }
+  } while (charCodes[currentChar] == CHAR_DIGIT || charCodes[currentChar] == CHAR_PERIOD);
+  token->string[i] = 0;
+
+  if (dotCount == 0)
+  {
+    token->tokenType = TK_INTEGER;
+    token->intValue = atoi(token->string);
+  }
+  else if (dotCount > 1)
+  {
+    token->tokenType = TK_NONE;
+    error(ERR_INVALID_DOUBLE, token->lineNo, token->colNo);
+    return token;
+  }
+  else
+  {
+    token->doubleValue = atof(token->string);
+  }
+  return token;
+}
+
+Token *readConstChar(void)
+{
+  Token *token = makeToken(TK_CHAR, lineNo, colNo);
+
+  readChar();
+  if (currentChar == EOF)
+  {
+    token->tokenType = TK_NONE;
+    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
+    return token;
+  }
+
+  token->string[0] = currentChar;
+  token->string[1] = '\0';
+
+  readChar();
+  if (currentChar == EOF)
+  {
+    token->tokenType = TK_NONE;
+    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
+    return token;
+  }
+
+  if (charCodes[currentChar] == CHAR_SINGLEQUOTE)
+  {
+    readChar();
+    return token;
+  }
+  else
+  {
+    token->tokenType = TK_NONE;
+    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
+    return token;
+  }
+}
+
+Token *readString(void)
+{
+  Token *token;
+  char string[MAX_LENGTH + 1];
+  int i = 0, j;
+
+  token = makeToken(TK_STRING, lineNo, colNo);
+  readChar();
+  // "" is the empty string
+  while (charCodes[currentChar] != CHAR_DOUBLEQUOTE && i <= MAX_LENGTH && currentChar != EOF)
+  {
+    string[i] = currentChar;
+    i++;
+    readChar();
+  }
+
+  if (i > MAX_LENGTH || currentChar == EOF)
+  {
+    token->tokenType = TK_NONE;
+    error(ERR_INVALID_STRING, token->lineNo, token->colNo);
+    return token;
+  }
+  else
+  {
+    string[i] = 0;
+    token->tokenType = TK_STRING;
+    for (j = 0; string[j]; j++)
+      token->string[j] = string[j];
+    token->string[j] = 0;
+    readChar();
+    return token;
+  }
+}
+
+Token *getToken(void)
+{
+  Token *token;
+  int ln, cn;
+
+  if (currentChar == EOF)
+    return makeToken(TK_EOF, lineNo, colNo);
+
+  switch (charCodes[currentChar])
+  {
+  case CHAR_SPACE:
+    skipBlank();
+    return getToken();
+  case CHAR_LETTER:
+    return readIdentKeyword();
+  case CHAR_DIGIT:
+    return readNumber();
+  case CHAR_PLUS:
+    token = makeToken(SB_PLUS, lineNo, colNo);
+    readChar();
+    return token;
+  case CHAR_MINUS:
+    token = makeToken(SB_MINUS, lineNo, colNo);
+    readChar();
+    return token;
+  case CHAR_TIMES:
+    token = makeToken(SB_TIMES, lineNo, colNo);
+    readChar();
+    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_TIMES))
+    {
+      readChar();
+      return makeToken(SB_POW, lineNo, colNo);
+    }
+    else
+      return token;
+  case CHAR_SLASH:
+    token = makeToken(SB_SLASH, lineNo, colNo);
+    readChar();
+    return token;
+  case CHAR_LT:
+    ln = lineNo;
+    cn = colNo;
+    readChar();
+    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ))
+    {
+      readChar();
+      return makeToken(SB_LE, ln, cn);
+    }
+    else
+      return makeToken(SB_LT, ln, cn);
+  case CHAR_GT:
+    ln = lineNo;
+    cn = colNo;
+    readChar();
+    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ))
+    {
+      readChar();
+      return makeToken(SB_GE, ln, cn);
+    }
+    else
+      return makeToken(SB_GT, ln, cn);
+  case CHAR_EQ:
+    token = makeToken(SB_EQ, lineNo, colNo);
+    readChar();
+    return token;
+  case CHAR_EXCLAIMATION:
+    ln = lineNo;
+    cn = colNo;
+    readChar();
+    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ))
+    {
+      readChar();
+      return makeToken(SB_NEQ, ln, cn);
+    }
+    else
+    {
+      token = makeToken(TK_NONE, ln, cn);
+      error(ERR_INVALID_SYMBOL, ln, cn);
+      return token;
+    }
+  case CHAR_COMMA:
+    token = makeToken(SB_COMMA, lineNo, colNo);
+    readChar();
+    return token;
+
+  case CHAR_PERIOD:
+    token = makeToken(SB_PERIOD, lineNo, colNo);
+    readChar();
+    if (charCodes[currentChar] == CHAR_RPAR)
+    {
+      token->tokenType = SB_RSEL;
+      readChar();
+    }
+    else if (charCodes[currentChar] == CHAR_DIGIT)
+    {
+      int i = 2;
+      token->tokenType = TK_DOUBLE;
+      token->string[0] = '0';
+      token->string[1] = '.';
+      while (charCodes[currentChar] == CHAR_DIGIT)
+      {
+        token->string[i] = currentChar;
+        i++;
+        readChar();
+      }
+      token->string[i] = 0;
+      if (charCodes[currentChar] == CHAR_PERIOD)
+      {
+        readChar();
+        if (charCodes[currentChar] == CHAR_RPAR)
+          checkRSEL = 1;
+        else
+        {
+          token->tokenType = TK_NONE;
+          error(ERR_INVALID_DOUBLE, token->lineNo, token->colNo);
+        }
+      }
+    }
+    return token;
+
+  case CHAR_COLON:
+    ln = lineNo;
+    cn = colNo;
+    readChar();
+    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ))
+    {
+      readChar();
+      return makeToken(SB_ASSIGN, ln, cn);
+    }
+    else
+      return makeToken(SB_COLON, ln, cn);
+  case CHAR_SINGLEQUOTE:
+    return readConstChar();
+  case CHAR_SEMICOLON:
+    token = makeToken(SB_SEMICOLON, lineNo, colNo);
+    readChar();
+    return token;
+  case CHAR_LPAR:
+    ln = lineNo;
+    cn = colNo;
+    readChar();
+
+    if (currentChar == EOF)
+      return makeToken(SB_LPAR, ln, cn);
+
+    switch (charCodes[currentChar])
+    {
+    case CHAR_PERIOD:
+      readChar();
+      return makeToken(SB_LSEL, ln, cn);
+    case CHAR_TIMES:
+      readChar();
+      skipComment();
+      return getToken();
+    default:
+      return makeToken(SB_LPAR, ln, cn);
+    }
+
+  case CHAR_RPAR:
+    if (checkRSEL == 1)
+    {
+      token = makeToken(SB_RSEL, lineNo, colNo - 1);
+      checkRSEL = 0;
+    }
+    else
+      token = makeToken(SB_RPAR, lineNo, colNo);
+    readChar();
+    return token;
+
+  case CHAR_DOUBLEQUOTE:
+    token = readString();
+    return token;
+  default:
+    token = makeToken(TK_NONE, lineNo, colNo);
+    error(ERR_INVALID_SYMBOL, lineNo, colNo);
+    readChar();
+    return token;
+  }
+}
+
+Token *getValidToken(void)
+{
+  Token *token = getToken();
+  while (token->tokenType == TK_NONE)
+  {
+    free(token);
+    token = getToken();
+  }
+  return token;
+}
+
+/******************************************************************/
+
+void printToken(Token *token)
+{
+
+  printf("%d-%d:", token->lineNo, token->colNo);
+
+  switch (token->tokenType)
+  {
+  case TK_NONE:
+    printf("TK_NONE\n");
+    break;
+  case TK_IDENT:
+    printf("TK_IDENT(%s)\n", token->string);
+    break;
+  case TK_INTEGER:
+    printf("TK_INTEGER(%s)\n", token->string);
+    break;
+  case TK_CHAR:
+    printf("TK_CHAR(\'%s\')\n", token->string);
+    break;
+  case TK_STRING:
+    printf("TK_STRING(\'%s\')\n", token->string);
+    break;
+  case TK_DOUBLE:
+    printf("TK_DOUBLE(\'%s\')\n", token->string);
+    break;
+  case TK_EOF:
+    printf("TK_EOF\n");
+    break;
+
+  case KW_PROGRAM:
+    printf("KW_PROGRAM\n");
+    break;
+  case KW_CONST:
+    printf("KW_CONST\n");
+    break;
+  case KW_TYPE:
+    printf("KW_TYPE\n");
+    break;
+  case KW_VAR:
+    printf("KW_VAR\n");
+    break;
+  case KW_INTEGER:
+    printf("KW_INTEGER\n");
+    break;
+  case KW_CHAR:
+    printf("KW_CHAR\n");
+    break;
+  case KW_ARRAY:
+    printf("KW_ARRAY\n");
+    break;
+  case KW_STRING:
+    printf("KW_STRING\n");
+    break;
+  case KW_DOUBLE:
+    printf("KW_DOUBLE\n");
+    break;
+  case KW_OF:
+    printf("KW_OF\n");
+    break;
+  case KW_FUNCTION:
+    printf("KW_FUNCTION\n");
+    break;
+  case KW_PROCEDURE:
+    printf("KW_PROCEDURE\n");
+    break;
+  case KW_BEGIN:
+    printf("KW_BEGIN\n");
+    break;
+  case KW_END:
+    printf("KW_END\n");
+    break;
+  case KW_CALL:
+    printf("KW_CALL\n");
+    break;
+  case KW_IF:
+    printf("KW_IF\n");
+    break;
+  case KW_THEN:
+    printf("KW_THEN\n");
+    break;
+  case KW_ELSE:
+    printf("KW_ELSE\n");
+    break;
+  case KW_WHILE:
+    printf("KW_WHILE\n");
+    break;
+  case KW_DO:
+    printf("KW_DO\n");
+    break;
+  case KW_FOR:
+    printf("KW_FOR\n");
+    break;
+  case KW_TO:
+    printf("KW_TO\n");
+    break;
+  case KW_SWITCH:
+    printf("KW_SWITCH\n");
+    break;
+  case KW_CASE:
+    printf("KW_CASE\n");
+    break;
+  case KW_DEFAULT:
+    printf("KW_DEFAULT\n");
+    break;
+  case KW_BREAK:
+    printf("KW_BREAK\n");
+    break;
+  case KW_RETURN:
+    printf("KW_RETURN\n");
+    break;
+  case KW_SUM:
+    printf("KW_SUM\n");
+    break;
+  case KW_REPEAT:
+    printf("KW_REPEAT\n");
+    break;
+  case KW_UNTIL:
+    printf("KW_UNTIL\n");
+    break;
+
+  case SB_SEMICOLON:
+    printf("SB_SEMICOLON\n");
+    break;
+  case SB_COLON:
+    printf("SB_COLON\n");
+    break;
+  case SB_PERIOD:
+    printf("SB_PERIOD\n");
+    break;
+  case SB_COMMA:
+    printf("SB_COMMA\n");
+    break;
+  case SB_ASSIGN:
+    printf("SB_ASSIGN\n");
+    break;
+  case SB_EQ:
+    printf("SB_EQ\n");
+    break;
+  case SB_NEQ:
+    printf("SB_NEQ\n");
+    break;
+  case SB_LT:
+    printf("SB_LT\n");
+    break;
+  case SB_LE:
+    printf("SB_LE\n");
+    break;
+  case SB_GT:
+    printf("SB_GT\n");
+    break;
+  case SB_GE:
+    printf("SB_GE\n");
+    break;
+  case SB_PLUS:
+    printf("SB_PLUS\n");
+    break;
+  case SB_MINUS:
+    printf("SB_MINUS\n");
+    break;
+  case SB_TIMES:
+    printf("SB_TIMES\n");
+    break;
+  case SB_SLASH:
+    printf("SB_SLASH\n");
+    break;
+  case SB_LPAR:
+    printf("SB_LPAR\n");
+    break;
+  case SB_RPAR:
+    printf("SB_RPAR\n");
+    break;
+  case SB_LSEL:
+    printf("SB_LSEL\n");
+    break;
+  case SB_RSEL:
+    printf("SB_RSEL\n");
+    break;
+  case SB_POW:
+    printf("SB_POW\n");
+    break;
+  }
 }
\ No newline at end of file
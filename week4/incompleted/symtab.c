@@ -1,419 +1,602 @@
-/* 
- * @copyright (c) 2008, Hedspi, Hanoi University of Technology
- * @author Huu-Duc Nguyen
- * @version 1.0
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "symtab.h"
-#include "error.h"
-
-void freeObject(Object *obj);
-void freeScope(Scope *scope);
-void freeObjectList(ObjectNode *objList);
-void freeReferenceList(ObjectNode *objList);
-
-SymTab *symtab;
-Type *intType;
-Type *charType;
-
-/******************* Type utilities ******************************/
-
-Type *makeIntType(void)
-{
-  Type *type = (Type *)malloc(sizeof(Type));
-  type->typeClass = TP_INT;
-  return type;
-}
-
-Type *makeCharType(void)
-{
-  Type *type = (Type *)malloc(sizeof(Type));
-  type->typeClass = TP_CHAR;
-  return type;
-}
-
-Type *makeStringType(void)
-{
-  Type *type = (Type *)malloc(sizeof(Type));
-  type->typeClass = TP_STRING;
-  return type;
-}
-
-Type *makeDoubleType(void)
-{
-  Type *type = (Type *)malloc(sizeof(Type));
-  type->typeClass = TP_DOUBLE;
-  return type;
-}
-
-Type *makeArrayType(int arraySize, Type *elementType)
-{
-  Type *type = (Type *)malloc(sizeof(Type));
-  type->typeClass = TP_ARRAY;
-  type->arraySize = arraySize;
-  type->elementType = elementType;
-  return type;
-}
-
-Type *duplicateType(Type *type)
-{
-  Type *resultType = (Type *)malloc(sizeof(Type));
-  resultType->typeClass = type->typeClass;
-  if (type->typeClass == TP_ARRAY)
-  {
-    resultType->arraySize = type->arraySize;
-    resultType->elementType = duplicateType(type->elementType);
-  }
-  return resultType;
-}
-
-int compareType(Type *type1, Type *type2)
-{
-  if (type1->typeClass == type2->typeClass)
-  {
-    if (type1->typeClass == TP_ARRAY)
-    {
-      if (type1->arraySize == type2->arraySize)
-        return compareType(type1->elementType, type2->elementType);
-      else
-        return 0;
-    }
-    else
-      return 1;
-  }
-  else
-    return 0;
-}
-
-void freeType(Type *type)
-{
-  switch (type->typeClass)
-  {
-  case TP_INT:
-  case TP_CHAR:
-  case TP_STRING:
-  case TP_DOUBLE:
-    free(type);
-    break;
-  case TP_ARRAY:
-    freeType(type->elementType);
-    freeType(type);
-    break;
-  }
-}
-
-/******************* Constant utility ******************************/
-
-ConstantValue *makeIntConstant(int i)
-{
-  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
-  value->type = TP_INT;
-  value->intValue = i;
-  return value;
-}
-
-ConstantValue *makeDoubleConstant(double d)
-{
-  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
-  value->type = TP_DOUBLE;
-  value->doubleValue = d;
-  return value;
-}
-
-ConstantValue *makeStringConstant(char str[])
-{
-  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
-  value->type = TP_STRING;
-  strcpy(value->stringValue, str);
-  return value;
-}
-
-ConstantValue *makeCharConstant(char ch)
-{
-  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
-  value->type = TP_CHAR;
-  value->charValue = ch;
-  return value;
-}
-
-ConstantValue *duplicateConstantValue(ConstantValue *v)
-{
-  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
-  value->type = v->type;
-  if (v->type == TP_INT)
-    value->intValue = v->intValue;
-  else if (v->type == TP_DOUBLE)
-    value->doubleValue = v->doubleValue;
-  else if (v->type == TP_STRING)
-    strcpy(value->stringValue,v->stringValue);
-  else
-    value->charValue = v->charValue;
-  return value;
-}
-
-/******************* Object utilities ******************************/
-
-Scope *createScope(Object *owner, Scope *outer)
-{
-  Scope *scope = (Scope *)malloc(sizeof(Scope));
-  scope->objList = NULL;
-  scope->owner = owner;
-  scope->outer = outer;
-  return scope;
-}
-
-Object *createProgramObject(char *programName)
-{
-  Object *program = (Object *)malloc(sizeof(Object));
-  strcpy(program->name, programName);
-  program->kind = OBJ_PROGRAM;
-  program->progAttrs = (ProgramAttributes *)malloc(sizeof(ProgramAttributes));
-  program->progAttrs->scope = createScope(program, NULL);
-  symtab->program = program;
-
-  return program;
-}
-
-Object *createConstantObject(char *name)
-{
-  Object *obj = (Object *)malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_CONSTANT;
-  obj->constAttrs = (ConstantAttributes *)malloc(sizeof(ConstantAttributes));
-  return obj;
-}
-
-Object *createTypeObject(char *name)
-{
-  Object *obj = (Object *)malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_TYPE;
-  obj->typeAttrs = (TypeAttributes *)malloc(sizeof(TypeAttributes));
-  return obj;
-}
-
-Object *createVariableObject(char *name)
-{
-  Object *obj = (Object *)malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_VARIABLE;
-  obj->varAttrs = (VariableAttributes *)malloc(sizeof(VariableAttributes));
-  obj->varAttrs->scope = symtab->currentScope;
-  return obj;
-}
-
-Object *createFunctionObject(char *name)
-{
-  Object *obj = (Object *)malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_FUNCTION;
-  obj->funcAttrs = (FunctionAttributes *)malloc(sizeof(FunctionAttributes));
-  obj->funcAttrs->paramList = NULL;
-  obj->funcAttrs->scope = createScope(obj, symtab->currentScope);
-  return obj;
-}
-
-Object *createProcedureObject(char *name)
-{
-  Object *obj = (Object *)malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_PROCEDURE;
-  obj->procAttrs = (ProcedureAttributes *)malloc(sizeof(ProcedureAttributes));
-  obj->procAttrs->paramList = NULL;
-  obj->procAttrs->scope = createScope(obj, symtab->currentScope);
-  return obj;
-}
-
-Object *createParameterObject(char *name, enum ParamKind kind, Object *owner)
-{
-  Object *obj = (Object *)malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_PARAMETER;
-  obj->paramAttrs = (ParameterAttributes *)malloc(sizeof(ParameterAttributes));
-  obj->paramAttrs->kind = kind;
-  obj->paramAttrs->function = owner;
-  return obj;
-}
-
-void freeObject(Object *obj)
-{
-  switch (obj->kind)
-  {
-  case OBJ_CONSTANT:
-    free(obj->constAttrs->value);
-    free(obj->constAttrs);
-    break;
-  case OBJ_TYPE:
-    free(obj->typeAttrs->actualType);
-    free(obj->typeAttrs);
-    break;
-  case OBJ_VARIABLE:
-    free(obj->varAttrs->type);
-    free(obj->varAttrs);
-    break;
-  case OBJ_FUNCTION:
-    freeReferenceList(obj->funcAttrs->paramList);
-    freeType(obj->funcAttrs->returnType);
-    freeScope(obj->funcAttrs->scope);
-    free(obj->funcAttrs);
-    break;
-  case OBJ_PROCEDURE:
-    freeReferenceList(obj->procAttrs->paramList);
-    freeScope(obj->procAttrs->scope);
-    free(obj->procAttrs);
-    break;
-  case OBJ_PROGRAM:
-    freeScope(obj->progAttrs->scope);
-    free(obj->progAttrs);
-    break;
-  case OBJ_PARAMETER:
-    freeType(obj->paramAttrs->type);
-    free(obj->paramAttrs);
-  }
-  free(obj);
-}
-
-void freeScope(Scope *scope)
-{
-  freeObjectList(scope->objList);
-  free(scope);
-}
-
-void freeObjectList(ObjectNode *objList)
-{
-  ObjectNode *list = objList;
-
-  while (list != NULL)
-  {
-    ObjectNode *node = list;
-    list = list->next;
-    freeObject(node->object);
-    free(node);
-  }
-}
-
-void freeReferenceList(ObjectNode *objList)
-{
-  ObjectNode *list = objList;
-
-  while (list != NULL)
-  {
-    ObjectNode *node = list;
-    list = list->next;
-    free(node);
-  }
-}
-
-void addObject(ObjectNode **objList, Object *obj)
-{
-  ObjectNode *node = (ObjectNode *)malloc(sizeof(ObjectNode));
-  node->object = obj;
-  node->next = NULL;
-  if ((*objList) == NULL)
-    *objList = node;
-  else
-  {
-    ObjectNode *n = *objList;
-    while (n->next != NULL)
-      n = n->next;
-    n->next = node;
-  }
-}
-
-Object *findObject(ObjectNode *objList, char *name)
-{
-  while (objList != NULL)
-  {
-    if (strcmp(objList->object->name, name) == 0)
-      return objList->object;
-    else
-      objList = objList->next;
-  }
-  return NULL;
-}
-
-/******************* others ******************************/
-
-void initSymTab(void)
-{
-  Object *obj;
-  Object *param;
-
-  symtab = (SymTab *)malloc(sizeof(SymTab));
-  symtab->globalObjectList = NULL;
-
-  obj = createFunctionObject("READC");
-  obj->funcAttrs->returnType = makeCharType();
-  addObject(&(symtab->globalObjectList), obj);
-
-  obj = createFunctionObject("READI");
-  obj->funcAttrs->returnType = makeIntType();
-  addObject(&(symtab->globalObjectList), obj);
-
-  obj = createProcedureObject("WRITEI");
-  param = createParameterObject("i", PARAM_VALUE, obj);
-  param->paramAttrs->type = makeIntType();
-  addObject(&(obj->procAttrs->paramList), param);
-  addObject(&(symtab->globalObjectList), obj);
-
-  obj = createProcedureObject("WRITEC");
-  param = createParameterObject("ch", PARAM_VALUE, obj);
-  param->paramAttrs->type = makeCharType();
-  addObject(&(obj->procAttrs->paramList), param);
-  addObject(&(symtab->globalObjectList), obj);
-
-  obj = createProcedureObject("WRITES");
-  param = createParameterObject("str", PARAM_VALUE, obj);
-  param->paramAttrs->type = makeStringType();
-  addObject(&(obj->procAttrs->paramList), param);
-  addObject(&(symtab->globalObjectList), obj);
-
-  obj = createProcedureObject("WRITELN");
-  addObject(&(symtab->globalObjectList), obj);
-
-  intType = makeIntType();
-  charType = makeCharType();
-}
-
-void cleanSymTab(void)
-{
-  freeObject(symtab->program);
-  freeObjectList(symtab->globalObjectList);
-  free(symtab);
-  freeType(intType);
-  freeType(charType);
-}
-
-void enterBlock(Scope *scope)
-{
-  symtab->currentScope = scope;
-}
-
-void exitBlock(void)
-{
-  symtab->currentScope = symtab->currentScope->outer;
-}
-
-void declareObject(Object *obj)
-{
-  if (obj->kind == OBJ_PARAMETER)
-  {
-    Object *owner = symtab->currentScope->owner;
-    switch (owner->kind)
-    {
-    case OBJ_FUNCTION:
-      addObject(&(owner->funcAttrs->paramList), obj);
-      break;
-    case OBJ_PROCEDURE:
-      addObject(&(owner->procAttrs->paramList), obj);
-      break;
-    default:
-      break;
-    }
-  }
-
-  addObject(&(symtab->currentScope->objList), obj);
-}
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "symtab.h"
+#include "error.h"
+
+void freeObject(Object *obj);
+void freeScope(Scope *scope);
+void freeObjectList(ObjectNode *objList);
+void freeReferenceList(ObjectNode *objList);
+
+SymTab *symtab;
+Type *intType;
+Type *charType;
+
+/******************* Type utilities ******************************/
+
+Type *makeIntType(void)
+{
+  Type *type = (Type *)malloc(sizeof(Type));
+  type->typeClass = TP_INT;
+  return type;
+}
+
+Type *makeCharType(void)
+{
+  Type *type = (Type *)malloc(sizeof(Type));
+  type->typeClass = TP_CHAR;
+  return type;
+}
+
+Type *makeStringType(void)
+{
+  Type *type = (Type *)malloc(sizeof(Type));
+  type->typeClass = TP_STRING;
+  return type;
+}
+
+Type *makeDoubleType(void)
+{
+  Type *type = (Type *)malloc(sizeof(Type));
+  type->typeClass = TP_DOUBLE;
+  return type;
+}
+
+Type *makeArrayType(int arraySize, Type *elementType)
+{
+  Type *type = (Type *)malloc(sizeof(Type));
+  type->typeClass = TP_ARRAY;
+  type->arraySize = arraySize;
+  type->elementType = elementType;
+  return type;
+}
+
+Type *duplicateType(Type *type)
+{
+  Type *resultType = (Type *)malloc(sizeof(Type));
+  resultType->typeClass = type->typeClass;
+  if (type->typeClass == TP_ARRAY)
+  {
+    resultType->arraySize = type->arraySize;
+    resultType->elementType = duplicateType(type->elementType);
+  }
+  return resultType;
+}
+
+int compareType(Type *type1, Type *type2)
+{
+  if (type1->typeClass == type2->typeClass)
+  {
+    if (type1->typeClass == TP_ARRAY)
+    {
+      if (type1->arraySize == type2->arraySize)
+        return compareType(type1->elementType, type2->elementType);
+      else
+        return 0;
+    }
+    else
+      return 1;
+  }
+  else
+    return 0;
+}
+
+int sizeOfType(Type *type)
+{
+  switch (type->typeClass)
+  {
+  case TP_INT:
+    return INT_SIZE;
+  case TP_CHAR:
+    return CHAR_SIZE;
+  case TP_DOUBLE:
+    return DOUBLE_SIZE;
+  case TP_STRING:
+    return STRING_SIZE;
+  case TP_ARRAY:
+    return type->arraySize * sizeOfType(type->elementType);
+  }
+  return 0;
+}
+
+void freeType(Type *type)
+{
+  switch (type->typeClass)
+  {
+  case TP_INT:
+  case TP_CHAR:
+  case TP_STRING:
+  case TP_DOUBLE:
+    free(type);
+    break;
+  case TP_ARRAY:
+    freeType(type->elementType);
+    freeType(type);
+    break;
+  }
+}
+
+/******************* Constant utility ******************************/
+
+ConstantValue *makeIntConstant(int i)
+{
+  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
+  value->type = TP_INT;
+  value->intValue = i;
+  return value;
+}
+
+ConstantValue *makeDoubleConstant(double d)
+{
+  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
+  value->type = TP_DOUBLE;
+  value->doubleValue = d;
+  return value;
+}
+
+ConstantValue *makeStringConstant(char str[])
+{
+  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
+  value->type = TP_STRING;
+  strcpy(value->stringValue, str);
+  return value;
+}
+
+ConstantValue *makeCharConstant(char ch)
+{
+  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
+  value->type = TP_CHAR;
+  value->charValue = ch;
+  return value;
+}
+
+ConstantValue *duplicateConstantValue(ConstantValue *v)
+{
+  ConstantValue *value = (ConstantValue *)malloc(sizeof(ConstantValue));
+  value->type = v->type;
+  if (v->type == TP_INT)
+    value->intValue = v->intValue;
+  else if (v->type == TP_DOUBLE)
+    value->doubleValue = v->doubleValue;
+  else if (v->type == TP_STRING)
+    strcpy(value->stringValue,v->stringValue);
+  else
+    value->charValue = v->charValue;
+  return value;
+}
+
+static int compareValues(TokenType op, double x, double y)
+{
+  switch (op)
+  {
+  case SB_EQ:
+    return x == y;
+  case SB_NEQ:
+    return x != y;
+  case SB_LT:
+    return x < y;
+  case SB_LE:
+    return x <= y;
+  case SB_GT:
+    return x > y;
+  default:
+    return x >= y;
+  }
+}
+
+static ConstantValue *foldIntegers(TokenType op, long long x, long long y)
+{
+  long long result = 1;
+
+  switch (op)
+  {
+  case SB_PLUS:
+    result = x + y;
+    break;
+  case SB_MINUS:
+    result = x - y;
+    break;
+  case SB_TIMES:
+    result = x * y;
+    break;
+  case SB_SLASH:
+    if (y == 0)
+      return NULL;
+    result = x / y;
+    break;
+  case SB_POW:
+    // The program multiplies as long as the exponent is positive
+    if (y > 0 && (x == 0 || x == 1 || x == -1))
+      result = (x == -1 && y % 2 == 0) ? 1 : x;
+    else
+      for (; y > 0; y--)
+      {
+        result *= x;
+        if (result < INT_MIN || result > INT_MAX)
+          return NULL;
+      }
+    break;
+  default:
+    return NULL;
+  }
+  if (result < INT_MIN || result > INT_MAX)
+    return NULL;
+  return makeIntConstant((int)result);
+}
+
+ConstantValue *foldConstants(TokenType op, ConstantValue *v1, ConstantValue *v2)
+{
+  char str[MAX_LENGTH];
+
+  if (v1->type != v2->type)
+    return NULL;
+
+  switch (op)
+  {
+  case SB_EQ:
+  case SB_NEQ:
+  case SB_LT:
+  case SB_LE:
+  case SB_GT:
+  case SB_GE:
+    switch (v1->type)
+    {
+    case TP_INT:
+      return makeIntConstant(compareValues(op, v1->intValue, v2->intValue));
+    case TP_CHAR:
+      return makeIntConstant(compareValues(op, (unsigned char)v1->charValue, (unsigned char)v2->charValue));
+    case TP_DOUBLE:
+      return makeIntConstant(compareValues(op, v1->doubleValue, v2->doubleValue));
+    case TP_STRING:
+      return makeIntConstant(compareValues(op, strcmp(v1->stringValue, v2->stringValue), 0));
+    default:
+      return NULL;
+    }
+  default:
+    break;
+  }
+
+  switch (v1->type)
+  {
+  case TP_INT:
+    return foldIntegers(op, v1->intValue, v2->intValue);
+  case TP_DOUBLE:
+    switch (op)
+    {
+    case SB_PLUS:
+      return makeDoubleConstant(v1->doubleValue + v2->doubleValue);
+    case SB_MINUS:
+      return makeDoubleConstant(v1->doubleValue - v2->doubleValue);
+    case SB_TIMES:
+      return makeDoubleConstant(v1->doubleValue * v2->doubleValue);
+    case SB_SLASH:
+      return makeDoubleConstant(v1->doubleValue / v2->doubleValue);
+    default:
+      return NULL;
+    }
+  case TP_STRING:
+    if (op != SB_PLUS || strlen(v1->stringValue) + strlen(v2->stringValue) >= MAX_LENGTH)
+      return NULL;
+    strcpy(str, v1->stringValue);
+    strcat(str, v2->stringValue);
+    return makeStringConstant(str);
+  default:
+    return NULL;
+  }
+}
+
+int negateConstant(ConstantValue *value)
+{
+  if (value->type == TP_DOUBLE)
+    value->doubleValue = -value->doubleValue;
+  else if (value->type == TP_INT && value->intValue != INT_MIN)
+    value->intValue = -value->intValue;
+  else
+    return 0;
+  return 1;
+}
+
+/******************* Object utilities ******************************/
+
+Scope *createScope(Object *owner, Scope *outer)
+{
+  Scope *scope = (Scope *)malloc(sizeof(Scope));
+  scope->objList = NULL;
+  scope->owner = owner;
+  scope->outer = outer;
+  scope->frameSize = RESERVED_WORDS;
+  return scope;
+}
+
+Object *createProgramObject(char *programName)
+{
+  Object *program = (Object *)malloc(sizeof(Object));
+  strcpy(program->name, programName);
+  program->kind = OBJ_PROGRAM;
+  program->progAttrs = (ProgramAttributes *)malloc(sizeof(ProgramAttributes));
+  program->progAttrs->scope = createScope(program, NULL);
+  symtab->program = program;
+
+  return program;
+}
+
+Object *createConstantObject(char *name)
+{
+  Object *obj = (Object *)malloc(sizeof(Object));
+  strcpy(obj->name, name);
+  obj->kind = OBJ_CONSTANT;
+  obj->constAttrs = (ConstantAttributes *)malloc(sizeof(ConstantAttributes));
+  return obj;
+}
+
+Object *createTypeObject(char *name)
+{
+  Object *obj = (Object *)malloc(sizeof(Object));
+  strcpy(obj->name, name);
+  obj->kind = OBJ_TYPE;
+  obj->typeAttrs = (TypeAttributes *)malloc(sizeof(TypeAttributes));
+  return obj;
+}
+
+Object *createVariableObject(char *name)
+{
+  Object *obj = (Object *)malloc(sizeof(Object));
+  strcpy(obj->name, name);
+  obj->kind = OBJ_VARIABLE;
+  obj->varAttrs = (VariableAttributes *)malloc(sizeof(VariableAttributes));
+  obj->varAttrs->scope = symtab->currentScope;
+  return obj;
+}
+
+Object *createFunctionObject(char *name)
+{
+  Object *obj = (Object *)malloc(sizeof(Object));
+  strcpy(obj->name, name);
+  obj->kind = OBJ_FUNCTION;
+  obj->funcAttrs = (FunctionAttributes *)malloc(sizeof(FunctionAttributes));
+  obj->funcAttrs->paramList = NULL;
+  obj->funcAttrs->scope = createScope(obj, symtab->currentScope);
+  obj->funcAttrs->returnOffset = RETURN_VALUE_OFFSET;
+  return obj;
+}
+
+Object *createProcedureObject(char *name)
+{
+  Object *obj = (Object *)malloc(sizeof(Object));
+  strcpy(obj->name, name);
+  obj->kind = OBJ_PROCEDURE;
+  obj->procAttrs = (ProcedureAttributes *)malloc(sizeof(ProcedureAttributes));
+  obj->procAttrs->paramList = NULL;
+  obj->procAttrs->scope = createScope(obj, symtab->currentScope);
+  return obj;
+}
+
+Object *createParameterObject(char *name, enum ParamKind kind, Object *owner)
+{
+  Object *obj = (Object *)malloc(sizeof(Object));
+  strcpy(obj->name, name);
+  obj->kind = OBJ_PARAMETER;
+  obj->paramAttrs = (ParameterAttributes *)malloc(sizeof(ParameterAttributes));
+  obj->paramAttrs->kind = kind;
+  obj->paramAttrs->function = owner;
+  obj->paramAttrs->scope = symtab->currentScope;
+  return obj;
+}
+
+void freeObject(Object *obj)
+{
+  switch (obj->kind)
+  {
+  case OBJ_CONSTANT:
+    free(obj->constAttrs->value);
+    free(obj->constAttrs);
+    break;
+  case OBJ_TYPE:
+    free(obj->typeAttrs->actualType);
+    free(obj->typeAttrs);
+    break;
+  case OBJ_VARIABLE:
+    free(obj->varAttrs->type);
+    free(obj->varAttrs);
+    break;
+  case OBJ_FUNCTION:
+    freeReferenceList(obj->funcAttrs->paramList);
+    freeType(obj->funcAttrs->returnType);
+    freeScope(obj->funcAttrs->scope);
+    free(obj->funcAttrs);
+    break;
+  case OBJ_PROCEDURE:
+    freeReferenceList(obj->procAttrs->paramList);
+    freeScope(obj->procAttrs->scope);
+    free(obj->procAttrs);
+    break;
+  case OBJ_PROGRAM:
+    freeScope(obj->progAttrs->scope);
+    free(obj->progAttrs);
+    break;
+  case OBJ_PARAMETER:
+    freeType(obj->paramAttrs->type);
+    free(obj->paramAttrs);
+  }
+  free(obj);
+}
+
+void freeScope(Scope *scope)
+{
+  freeObjectList(scope->objList);
+  free(scope);
+}
+
+void freeObjectList(ObjectNode *objList)
+{
+  ObjectNode *list = objList;
+
+  while (list != NULL)
+  {
+    ObjectNode *node = list;
+    list = list->next;
+    freeObject(node->object);
+    free(node);
+  }
+}
+
+void freeReferenceList(ObjectNode *objList)
+{
+  ObjectNode *list = objList;
+
+  while (list != NULL)
+  {
+    ObjectNode *node = list;
+    list = list->next;
+    free(node);
+  }
+}
+
+void addObject(ObjectNode **objList, Object *obj)
+{
+  ObjectNode *node = (ObjectNode *)malloc(sizeof(ObjectNode));
+  node->object = obj;
+  node->next = NULL;
+  if ((*objList) == NULL)
+    *objList = node;
+  else
+  {
+    ObjectNode *n = *objList;
+    while (n->next != NULL)
+      n = n->next;
+    n->next = node;
+  }
+}
+
+Object *findObject(ObjectNode *objList, char *name)
+{
+  while (objList != NULL)
+  {
+    if (strcmp(objList->object->name, name) == 0)
+      return objList->object;
+    else
+      objList = objList->next;
+  }
+  return NULL;
+}
+
+/******************* others ******************************/
+
+void initSymTab(void)
+{
+  Object *obj;
+  Object *param;
+
+  symtab = (SymTab *)malloc(sizeof(SymTab));
+  symtab->globalObjectList = NULL;
+  symtab->currentScope = NULL;
+
+  obj = createFunctionObject("READC");
+  obj->funcAttrs->returnType = makeCharType();
+  addObject(&(symtab->globalObjectList), obj);
+
+  obj = createFunctionObject("READI");
+  obj->funcAttrs->returnType = makeIntType();
+  addObject(&(symtab->globalObjectList), obj);
+
+  obj = createProcedureObject("WRITEI");
+  param = createParameterObject("i", PARAM_VALUE, obj);
+  param->paramAttrs->type = makeIntType();
+  addObject(&(obj->procAttrs->paramList), param);
+  addObject(&(symtab->globalObjectList), obj);
+
+  obj = createProcedureObject("WRITEC");
+  param = createParameterObject("ch", PARAM_VALUE, obj);
+  param->paramAttrs->type = makeCharType();
+  addObject(&(obj->procAttrs->paramList), param);
+  addObject(&(symtab->globalObjectList), obj);
+
+  obj = createProcedureObject("WRITES");
+  param = createParameterObject("str", PARAM_VALUE, obj);
+  param->paramAttrs->type = makeStringType();
+  addObject(&(obj->procAttrs->paramList), param);
+  addObject(&(symtab->globalObjectList), obj);
+
+  obj = createProcedureObject("WRITEF");
+  param = createParameterObject("d", PARAM_VALUE, obj);
+  param->paramAttrs->type = makeDoubleType();
+  addObject(&(obj->procAttrs->paramList), param);
+  addObject(&(symtab->globalObjectList), obj);
+
+  obj = createProcedureObject("WRITELN");
+  addObject(&(symtab->globalObjectList), obj);
+
+  intType = makeIntType();
+  charType = makeCharType();
+}
+
+void cleanSymTab(void)
+{
+  freeObject(symtab->program);
+  freeObjectList(symtab->globalObjectList);
+  free(symtab);
+  freeType(intType);
+  freeType(charType);
+}
+
+void enterBlock(Scope *scope)
+{
+  symtab->currentScope = scope;
+}
+
+void exitBlock(void)
+{
+  symtab->currentScope = symtab->currentScope->outer;
+}
+
+void declareObject(Object *obj)
+{
+  Scope *scope = symtab->currentScope;
+
+  if (obj->kind == OBJ_VARIABLE)
+  {
+    obj->varAttrs->localOffset = scope->frameSize;
+    scope->frameSize += sizeOfType(obj->varAttrs->type);
+  }
+  else if (obj->kind == OBJ_PARAMETER)
+  {
+    Object *owner = scope->owner;
+
+    // A reference parameter holds the address of its argument
+    obj->paramAttrs->localOffset = scope->frameSize;
+    if (obj->paramAttrs->kind == PARAM_REFERENCE)
+      scope->frameSize += INT_SIZE;
+    else
+      scope->frameSize += sizeOfType(obj->paramAttrs->type);
+
+    switch (owner->kind)
+    {
+    case OBJ_FUNCTION:
+      addObject(&(owner->funcAttrs->paramList), obj);
+      break;
+    case OBJ_PROCEDURE:
+      addObject(&(owner->procAttrs->paramList), obj);
+      break;
+    default:
+      break;
+    }
+  }
+
+  addObject(&(scope->objList), obj);
+}
+
+int declareTemporary(int size)
+{
+  int offset = symtab->currentScope->frameSize;
+
+  symtab->currentScope->frameSize += size;
+  return offset;
+}
@@ -0,0 +1,226 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "batch.h"
+
+#define MAX_NAME 256
+
+// Not a machine status: the executable could not be read or verified
+#define JOB_LOAD_ERROR -1
+
+struct Job_ {
+  char executable[MAX_NAME];
+  char input[MAX_NAME];
+  char output[MAX_NAME];
+  Program* program;
+  int ownsProgram;      // the first job of its executable
+  int ps;
+};
+
+typedef struct Job_ Job;
+
+/*
+ * Jobs are handed out in manifest order.  Every worker keeps one context,
+ * and so one stack, for all the jobs it takes; the programs are loaded
+ * once and shared between the workers.
+ */
+struct Batch_ {
+  Job* jobs;
+  int jobCount;
+  int nextJob;
+  pthread_mutex_t lock;
+  BatchOptions* options;
+};
+
+typedef struct Batch_ Batch;
+
+static char* statusName(int ps) {
+  switch (ps) {
+  case PS_ACTIVE: return "PS_ACTIVE";
+  case PS_INACTIVE: return "PS_INACTIVE";
+  case PS_NORMAL_EXIT: return "PS_NORMAL_EXIT";
+  case PS_IO_ERROR: return "PS_IO_ERROR";
+  case PS_DIVIDE_BY_ZERO: return "PS_DIVIDE_BY_ZERO";
+  case PS_STACK_OVERFLOW: return "PS_STACK_OVERFLOW";
+  case PS_ARITH_OVERFLOW: return "PS_ARITH_OVERFLOW";
+  case PS_HEAP_OVERFLOW: return "PS_HEAP_OVERFLOW";
+  case PS_INVALID_STRING: return "PS_INVALID_STRING";
+  default: return "LOAD_ERROR";
+  }
+}
+
+static int readManifest(FILE* f, Batch* batch) {
+  char line[3 * MAX_NAME + 3];
+  char* field;
+  int capacity = 16;
+  int lineNo = 0;
+  Job* job;
+
+  batch->jobs = (Job*) malloc(capacity * sizeof(Job));
+  batch->jobCount = 0;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    lineNo ++;
+    field = line + strspn(line, " \t\r\n");
+    if ((*field == '\0') || (*field == '#')) continue;
+
+    if (batch->jobCount == capacity) {
+      capacity *= 2;
+      batch->jobs = (Job*) realloc(batch->jobs, capacity * sizeof(Job));
+    }
+    job = batch->jobs + batch->jobCount;
+    if (sscanf(field, "%255s %255s %255s", job->executable, job->input, job->output) != 3) {
+      printf("kplrun: line %d of the manifest is not \"executable input output\"!\n", lineNo);
+      return 0;
+    }
+    job->program = NULL;
+    job->ownsProgram = 0;
+    job->ps = JOB_LOAD_ERROR;
+    batch->jobCount ++;
+  }
+  return 1;
+}
+
+// Every executable is loaded once, whatever the number of its jobs
+static void loadPrograms(Batch* batch) {
+  Job* job;
+  FILE* f;
+  int i, j;
+
+  for (i = 0; i < batch->jobCount; i ++) {
+    job = batch->jobs + i;
+    for (j = 0; j < i; j ++)
+      if (strcmp(batch->jobs[j].executable, job->executable) == 0) break;
+    if (j < i) {
+      job->program = batch->jobs[j].program;
+      continue;
+    }
+
+    f = fopen(job->executable, "r");
+    if (f == NULL) continue;
+    job->program = loadProgram(f, batch->options->codeSize);
+    job->ownsProgram = 1;
+    fclose(f);
+    // As in a single run, only for the loops that use superinstructions
+    if ((job->program != NULL) && batch->options->fuse
+	&& (batch->options->dispatchMode != DISPATCH_JIT)
+	&& (batch->options->dispatchMode != DISPATCH_COMPACT)
+	&& (batch->options->dispatchMode != DISPATCH_REGISTER))
+      fuseProgram(job->program);
+  }
+}
+
+static void runJob(VMContext* vm, Job* job) {
+  FILE* in;
+  FILE* out;
+
+  if (job->program == NULL) return;
+
+  in = fopen(job->input, "r");
+  out = fopen(job->output, "w");
+  if ((in == NULL) || (out == NULL)) {
+    job->ps = PS_IO_ERROR;
+  } else {
+    setProgram(vm, job->program);
+    resetVM(vm);
+    redirectInput(vm, in);
+    redirectOutput(vm, out);
+    job->ps = execute(vm, vm->dispatchMode);
+    // The context must not keep files that are about to be closed
+    redirectInput(vm, stdin);
+    redirectOutput(vm, stdout);
+  }
+  if (in != NULL) fclose(in);
+  if (out != NULL) fclose(out);
+}
+
+static Job* takeJob(Batch* batch) {
+  Job* job = NULL;
+
+  pthread_mutex_lock(&batch->lock);
+  if (batch->nextJob < batch->jobCount)
+    job = batch->jobs + batch->nextJob ++;
+  pthread_mutex_unlock(&batch->lock);
+  return job;
+}
+
+static void* worker(void* arg) {
+  Batch* batch = (Batch*) arg;
+  VMContext* vm = createVM(NULL, batch->options->stackSize);
+  Job* job;
+
+  if (vm == NULL) return NULL;          // the other workers take its jobs
+  vm->dispatchMode = batch->options->dispatchMode;
+  while ((job = takeJob(batch)) != NULL)
+    runJob(vm, job);
+  freeVM(vm);
+  return NULL;
+}
+
+static int workerCount(BatchOptions* options, int jobCount) {
+  int n = options->workers;
+
+  if (n <= 0) n = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > jobCount) n = jobCount;
+  if (n > MAX_WORKERS) n = MAX_WORKERS;
+  if (n < 1) n = 1;
+  return n;
+}
+
+int runBatch(char* manifestName, char* resultsName, BatchOptions* options) {
+  Batch batch;
+  pthread_t threads[MAX_WORKERS];
+  FILE* f;
+  Job* job;
+  int i, n;
+
+  f = fopen(manifestName, "r");
+  if (f == NULL) {
+    printf("kplrun: Can\'t read manifest file!\n");
+    return -1;
+  }
+  batch.options = options;
+  if (!readManifest(f, &batch)) {
+    fclose(f);
+    free(batch.jobs);
+    return -1;
+  }
+  fclose(f);
+
+  f = fopen(resultsName, "w");
+  if (f == NULL) {
+    printf("kplrun: Can\'t write results file!\n");
+    free(batch.jobs);
+    return -1;
+  }
+
+  loadPrograms(&batch);
+  batch.nextJob = 0;
+  pthread_mutex_init(&batch.lock, NULL);
+  n = workerCount(options, batch.jobCount);
+  for (i = 0; i < n; i ++)
+    pthread_create(threads + i, NULL, worker, &batch);
+  for (i = 0; i < n; i ++)
+    pthread_join(threads[i], NULL);
+  pthread_mutex_destroy(&batch.lock);
+
+  for (i = 0; i < batch.jobCount; i ++) {
+    job = batch.jobs + i;
+    fprintf(f, "%s %s %s %s\n", job->executable, job->input, job->output, statusName(job->ps));
+  }
+  fclose(f);
+
+  for (i = 0; i < batch.jobCount; i ++)
+    if ((batch.jobs[i].program != NULL) && batch.jobs[i].ownsProgram)
+      freeProgram(batch.jobs[i].program);
+  free(batch.jobs);
+  return 0;
+}
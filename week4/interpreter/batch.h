@@ -0,0 +1,34 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include "vm.h"
+
+#define MAX_WORKERS 64
+
+struct BatchOptions_ {
+  int stackSize;
+  int codeSize;
+  int dispatchMode;
+  int fuse;
+  int workers;          // 0: one per processor
+};
+
+typedef struct BatchOptions_ BatchOptions;
+
+/*
+ * Runs every job of the manifest and writes their exit statuses to the
+ * results file.  A manifest line holds an executable, the file it reads
+ * its input from and the file its output goes to; empty lines and lines
+ * starting with '#' are skipped.  Each line of the results file repeats
+ * the job and adds its status, in the order of the manifest.
+ * Returns 0, or -1 when the manifest or the results file cannot be used.
+ */
+int runBatch(char* manifestName, char* resultsName, BatchOptions* options);
+
+#endif
@@ -0,0 +1,206 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vm.h"
+#include "compact.h"
+#define DEFAULT_CODE_SIZE 1024
+#define DEFAULT_REPEAT 5
+
+int stackSize;
+int codeSize;
+int repeat;
+int fuse;
+int jit;
+int compact;
+int registers;
+
+void printUsage(void) {
+  printf("Usage: kplbench input [-s=stack_size] [-c=code_size] [-n=repeat] [-nofuse] [-jit] [-compact] [-register]\n");
+  printf("   input: input kpl program\n");
+  printf("   -s=stack_size: set the stack size, in words (default %d)\n", DEFAULT_STACK_SIZE);
+  printf("   -c=code_size: set the code size\n");
+  printf("   -n=repeat: number of timed runs per interpreter loop\n");
+  printf("   -nofuse: do not fuse instructions into superinstructions\n");
+  printf("   -jit: also time the compiled code (the code is then not fused)\n");
+  printf("   -compact: also time the compact bytecode and compare code sizes\n");
+  printf("             (the code is then not fused)\n");
+  printf("   -register: also time the register code and compare instruction counts\n");
+  printf("              (the code is then not fused)\n");
+}
+
+int analyseParam(char* param) {
+  if (strncmp(param, "-s=", 3) == 0) {
+    stackSize = atoi(param+3);
+    return 1;
+  }
+  if (strncmp(param, "-c=", 3) == 0) {
+    codeSize = atoi(param+3);
+    return 1;
+  }
+  if (strncmp(param, "-n=", 3) == 0) {
+    repeat = atoi(param+3);
+    return 1;
+  }
+  if (strcmp(param, "-nofuse") == 0) {
+    fuse = 0;
+    return 1;
+  }
+  if (strcmp(param, "-jit") == 0) {
+    jit = 1;
+    return 1;
+  }
+  if (strcmp(param, "-compact") == 0) {
+    compact = 1;
+    return 1;
+  }
+  if (strcmp(param, "-register") == 0) {
+    registers = 1;
+    return 1;
+  }
+  return 0;
+}
+
+double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Returns the best wall-clock time of the timed runs
+double timeLoop(VMContext* vm, int dispatch) {
+  double best = -1;
+  double start, elapsed;
+  int i;
+
+  for (i = 0; i < repeat; i ++) {
+    resetVM(vm);
+    start = now();
+    execute(vm, dispatch);
+    elapsed = now() - start;
+    if ((best < 0) || (elapsed < best))
+      best = elapsed;
+  }
+  return best;
+}
+
+void report(char* name, long long instructionCount, double seconds) {
+  fprintf(stderr, "%-10s %14lld %10.4f %12.2f\n", name, instructionCount,
+	  seconds, instructionCount / seconds / 1e6);
+}
+
+/******************************************************************/
+
+int main(int argc, char *argv[]) {
+  int i;
+  FILE* f;
+  double switchTime, threadedTime, jitTime = 0, compactTime = 0, registerTime = 0;
+  CompactCode* compactCode;
+  long fixedSize;
+  Program* program;
+  VMContext* vm;
+  long long count, registerCount = 0;
+
+  stackSize = DEFAULT_STACK_SIZE;
+  codeSize = DEFAULT_CODE_SIZE;
+  repeat = DEFAULT_REPEAT;
+  fuse = 1;
+  jit = 0;
+  compact = 0;
+  registers = 0;
+
+  if (argc <= 1) {
+    printf("kplbench: no input file.\n");
+    printUsage();
+    return -1;
+  }
+
+  for ( i = 2; i < argc; i++)
+    if (analyseParam(argv[i]) == 0) {
+      printUsage();
+      return -1;
+    }
+
+  f = fopen(argv[1],"r");
+  if (f == NULL) {
+    printf("kplbench: Can\'t read input file!\n");
+    return -1;
+  }
+
+  program = loadProgram(f, codeSize);
+  fclose(f);
+  if (program == NULL) {
+    printf("kplbench: Wrong executable format!\n");
+    return -1;
+  }
+
+  // All of them run the instructions as they are in the executable
+  if (fuse && !jit && !compact && !registers)
+    fuseProgram(program);
+  vm = createVM(program, stackSize);
+  if (vm == NULL) {
+    printf("kplbench: Cannot allocate a stack of %d words!\n", stackSize);
+    freeProgram(program);
+    return -1;
+  }
+
+  // A counting run gives the number of dispatches of one execution
+  if (execute(vm, DISPATCH_COUNTING) != PS_NORMAL_EXIT) {
+    printf("kplbench: %s did not exit normally!\n", argv[1]);
+    freeVM(vm);
+    freeProgram(program);
+    return -1;
+  }
+  count = vm->instructionCount;
+  if (registers) {
+    resetVM(vm);
+    vm->instructionCount = 0;
+    execute(vm, DISPATCH_REGISTER_COUNTING);
+    registerCount = vm->instructionCount;
+  }
+
+  switchTime = timeLoop(vm, DISPATCH_SWITCH);
+  threadedTime = timeLoop(vm, DISPATCH_THREADED);
+  if (jit)
+    jitTime = timeLoop(vm, DISPATCH_JIT);
+  if (compact)
+    compactTime = timeLoop(vm, DISPATCH_COMPACT);
+  if (registers)
+    registerTime = timeLoop(vm, DISPATCH_REGISTER);
+
+  fprintf(stderr, "%s\n", argv[1]);
+  fprintf(stderr, "%-10s %14s %10s %12s\n", "loop", "instructions", "seconds", "Minstr/s");
+  report("switch", count, switchTime);
+  report("threaded", count, threadedTime);
+  if (jit)
+    report("jit", count, jitTime);
+  if (compact)
+    report("compact", count, compactTime);
+  if (registers)
+    report("register", registerCount, registerTime);
+  fprintf(stderr, "speedup    %.2fx\n", switchTime / threadedTime);
+  if (jit)
+    fprintf(stderr, "jit        %.2fx\n", switchTime / jitTime);
+  if (compact) {
+    fprintf(stderr, "compact    %.2fx\n", switchTime / compactTime);
+    compactCode = encodeCompact(program->codeBlock);
+    fixedSize = (long) program->codeBlock->codeSize * sizeof(Instruction);
+    fprintf(stderr, "code size  %ld bytes fixed, %d bytes compact (%.2fx smaller)\n",
+	    fixedSize, compactCode->length, (double) fixedSize / compactCode->length);
+    freeCompact(compactCode);
+  }
+  if (registers)
+    fprintf(stderr, "register   %.2fx, %.1f%% fewer instructions\n", switchTime / registerTime,
+	    100.0 * (count - registerCount) / count);
+
+  freeVM(vm);
+  freeProgram(program);
+  return 0;
+}
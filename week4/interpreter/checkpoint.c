@@ -0,0 +1,290 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+volatile sig_atomic_t checkpointDue = CHECKPOINT_NONE;
+
+struct CheckpointMessage {
+  CheckpointCode code;
+  char* message;
+};
+
+#define NUM_OF_MESSAGES 6
+
+struct CheckpointMessage checkpointMessages[NUM_OF_MESSAGES] = {
+  {CHECKPOINT_OK, "Ok"},
+  {CHECKPOINT_IO_ERROR, "Cannot read or write the checkpoint"},
+  {CHECKPOINT_BAD_FORMAT, "Not a checkpoint of this version"},
+  {CHECKPOINT_INCOMPLETE, "Checkpoint interrupted while it was written"},
+  {CHECKPOINT_OTHER_PROGRAM, "Checkpoint of another program"},
+  {CHECKPOINT_TOO_LARGE, "Checkpoint larger than the stack or the heap"}
+};
+
+char* checkpointMessage(CheckpointCode code) {
+  int i;
+  for (i = 0; i < NUM_OF_MESSAGES; i ++)
+    if (checkpointMessages[i].code == code)
+      return checkpointMessages[i].message;
+  return "Unknown error";
+}
+
+// FNV-1a over the code, with superinstructions as their first opcode, and the constants
+unsigned int hashCode(CodeBlock* codeBlock) {
+  unsigned int hash = 2166136261u;
+  WORD words[3];
+  unsigned char* bytes;
+  int pc, i, k;
+
+#define HASH_WORD(w)						\
+  do {								\
+    bytes = (unsigned char*) &(w);				\
+    for (k = 0; k < (int) sizeof(WORD); k ++)			\
+      hash = (hash ^ bytes[k]) * 16777619u;			\
+  } while (0)
+
+  HASH_WORD(codeBlock->entry);
+  for (pc = 0; pc < codeBlock->codeSize; pc ++) {
+    words[0] = unfusedOpcode(codeBlock->code[pc].op);
+    words[1] = codeBlock->code[pc].p;
+    words[2] = codeBlock->code[pc].q;
+    for (i = 0; i < 3; i ++)
+      HASH_WORD(words[i]);
+  }
+  for (i = 0; i < codeBlock->constantCount; i ++)
+    HASH_WORD(codeBlock->constants[i]);
+#undef HASH_WORD
+  return hash;
+}
+
+Checkpoint* createCheckpoint(char* name, CodeBlock* codeBlock) {
+  Checkpoint* checkpoint;
+  FILE* f = fopen(name, "w+b");
+
+  if (f == NULL) return NULL;
+  checkpoint = (Checkpoint*) malloc(sizeof(Checkpoint));
+  checkpoint->file = f;
+  checkpoint->codeHash = hashCode(codeBlock);
+  checkpoint->shadow = NULL;
+  checkpoint->pages = 0;
+  checkpoint->capacity = 0;
+  checkpoint->pagesWritten = 0;
+  checkpoint->count = 0;
+  checkpoint->stopAfter = 0;
+  return checkpoint;
+}
+
+void freeCheckpoint(Checkpoint* checkpoint) {
+  fclose(checkpoint->file);
+  free(checkpoint->shadow);
+  free(checkpoint);
+}
+
+static void onCheckpointSignal(int sig) {
+  if (sig == SIGTERM)
+    checkpointDue = CHECKPOINT_STOP;
+  else if (checkpointDue == CHECKPOINT_NONE)
+    checkpointDue = CHECKPOINT_CONTINUE;
+}
+
+void startCheckpoints(Checkpoint* checkpoint, int interval) {
+  struct sigaction action;
+  struct itimerval timer;
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = onCheckpointSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGUSR1, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  sigaction(SIGALRM, &action, NULL);
+
+  checkpointDue = CHECKPOINT_NONE;
+  if (interval > 0) {
+    timer.it_interval.tv_sec = interval;
+    timer.it_interval.tv_usec = 0;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_REAL, &timer, NULL);
+  }
+}
+
+void stopCheckpoints(Checkpoint* checkpoint) {
+  struct itimerval timer;
+
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_REAL, &timer, NULL);
+  signal(SIGUSR1, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  signal(SIGALRM, SIG_DFL);
+  checkpointDue = CHECKPOINT_NONE;
+}
+
+static int writeAt(FILE* f, long offset, void* data, size_t size, size_t count) {
+  return (fseek(f, offset, SEEK_SET) == 0) && (fwrite(data, size, count, f) == count);
+}
+
+static int readAt(FILE* f, long offset, void* data, size_t size, size_t count) {
+  return (fseek(f, offset, SEEK_SET) == 0) && (fread(data, size, count, f) == count);
+}
+
+// Where the page starts in the file; the rest follows the last page
+static long pageOffset(int page) {
+  return (long) sizeof(CheckpointHeader) + (long) page * CHECKPOINT_PAGE * sizeof(CELL);
+}
+
+static int pageCount(int t) {
+  return (t + CHECKPOINT_PAGE) / CHECKPOINT_PAGE;
+}
+
+// The stack pages that differ from the shadow, which is brought up to date
+static int writePages(Checkpoint* checkpoint, CELL* stack, int t) {
+  int pages = pageCount(t);
+  int page, cells;
+  CELL* live;
+  CELL* copy;
+
+  if (pages > checkpoint->capacity) {
+    copy = (CELL*) realloc(checkpoint->shadow, (size_t) pages * CHECKPOINT_PAGE * sizeof(CELL));
+    if (copy == NULL) return 0;
+    checkpoint->shadow = copy;
+    checkpoint->capacity = pages;
+  }
+
+  for (page = 0; page < pages; page ++) {
+    live = stack + page * CHECKPOINT_PAGE;
+    copy = checkpoint->shadow + page * CHECKPOINT_PAGE;
+    cells = t + 1 - page * CHECKPOINT_PAGE;
+    if (cells > CHECKPOINT_PAGE)
+      cells = CHECKPOINT_PAGE;
+    if ((page < checkpoint->pages) && (memcmp(live, copy, cells * sizeof(CELL)) == 0))
+      continue;
+    if (!writeAt(checkpoint->file, pageOffset(page), live, sizeof(CELL), cells))
+      return 0;
+    memcpy(copy, live, cells * sizeof(CELL));
+    checkpoint->pagesWritten ++;
+  }
+  checkpoint->pages = pages;
+  return 1;
+}
+
+CheckpointCode writeCheckpoint(Checkpoint* checkpoint, VMContext* vm) {
+  FILE* f = checkpoint->file;
+  CheckpointHeader header;
+  WORD link[2];
+  int i, ok;
+
+  flushOutput(&vm->output);
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CHECKPOINT_MAGIC, 4);
+  header.version = CHECKPOINT_VERSION;
+  header.complete = 0;
+  header.cellSize = sizeof(CELL);
+  header.codeHash = checkpoint->codeHash;
+  header.pc = vm->pc;
+  header.t = vm->t;
+  header.b = vm->b;
+  header.level = vm->level;
+  header.callDepth = vm->callDepth;
+  header.heapTop = vm->heap.top;
+  header.instructionCount = vm->instructionCount;
+  header.inputOffset = inputPosition(&vm->input);
+
+  // A checkpoint cut short stays marked incomplete
+  ok = writeAt(f, 0, &header, sizeof(header), 1) && (fflush(f) == 0)
+    && writePages(checkpoint, vm->stack, vm->t)
+    && writeAt(f, pageOffset(checkpoint->pages), vm->display, sizeof(WORD), vm->level + 1);
+  for (i = 0; ok && (i < vm->callDepth); i ++) {
+    link[0] = vm->links[i].display - vm->display;
+    link[1] = vm->links[i].base;
+    ok = (fwrite(link, sizeof(WORD), 2, f) == 2);
+  }
+  ok = ok && (fwrite(vm->heap.words, sizeof(WORD), vm->heap.top, f) == (size_t) vm->heap.top)
+    && (fflush(f) == 0) && (ftruncate(fileno(f), ftell(f)) == 0);
+
+  header.complete = 1;
+  ok = ok && writeAt(f, 0, &header, sizeof(header), 1) && (fflush(f) == 0);
+  if (!ok) {
+    // Nothing in the file can be trusted: the next checkpoint writes it all
+    checkpoint->pages = 0;
+    return CHECKPOINT_IO_ERROR;
+  }
+  checkpoint->count ++;
+  return CHECKPOINT_OK;
+}
+
+CheckpointCode resumeCheckpoint(VMContext* vm, char* name) {
+  FILE* f = fopen(name, "rb");
+  CheckpointHeader header;
+  CheckpointCode result = CHECKPOINT_OK;
+  WORD link[2];
+  int i;
+
+  if (f == NULL)
+    return CHECKPOINT_IO_ERROR;
+
+  if (!readAt(f, 0, &header, sizeof(header), 1)
+      || (memcmp(header.magic, CHECKPOINT_MAGIC, 4) != 0)
+      || (header.version != CHECKPOINT_VERSION) || (header.cellSize != (WORD) sizeof(CELL)))
+    result = CHECKPOINT_BAD_FORMAT;
+  else if (!header.complete)
+    result = CHECKPOINT_INCOMPLETE;
+  else if (header.codeHash != hashCode(vm->program->codeBlock))
+    result = CHECKPOINT_OTHER_PROGRAM;
+  else if ((header.pc < 0) || (header.pc >= vm->program->codeBlock->codeSize)
+	   || (header.t < -1) || (header.b < 0) || (header.level < 0) || (header.callDepth < 0)
+	   || (header.heapTop < 0))
+    result = CHECKPOINT_BAD_FORMAT;
+  else if ((header.t >= vm->stackSize) || (header.b > header.t)
+	   || (header.level >= vm->maxCallDepth) || (header.callDepth >= vm->maxCallDepth))
+    result = CHECKPOINT_TOO_LARGE;
+  else {
+    vm->heap.top = 0;
+    if (!reserveHeap(&vm->heap, header.heapTop))
+      result = CHECKPOINT_TOO_LARGE;
+  }
+
+  if ((result == CHECKPOINT_OK)
+      && !(readAt(f, pageOffset(0), vm->stack, sizeof(CELL), header.t + 1)
+	   && readAt(f, pageOffset(pageCount(header.t)), vm->display, sizeof(WORD), header.level + 1)))
+    result = CHECKPOINT_IO_ERROR;
+  for (i = 0; (result == CHECKPOINT_OK) && (i < header.callDepth); i ++) {
+    if (fread(link, sizeof(WORD), 2, f) != 2)
+      result = CHECKPOINT_IO_ERROR;
+    else if ((link[0] < 0) || (link[0] >= vm->maxCallDepth))
+      result = CHECKPOINT_BAD_FORMAT;
+    else {
+      vm->links[i].display = vm->display + link[0];
+      vm->links[i].base = link[1];
+    }
+  }
+  if ((result == CHECKPOINT_OK)
+      && (fread(vm->heap.words, sizeof(WORD), header.heapTop, f) != (size_t) header.heapTop))
+    result = CHECKPOINT_IO_ERROR;
+  fclose(f);
+
+  if (result != CHECKPOINT_OK) {
+    resetVM(vm);
+    return result;
+  }
+  vm->pc = header.pc;
+  vm->t = header.t;
+  vm->b = header.b;
+  vm->level = header.level;
+  vm->callDepth = header.callDepth;
+  vm->heap.top = header.heapTop;
+  vm->instructionCount = header.instructionCount;
+  // Input from a file goes on where it was; a pipe or a terminal cannot
+  if (header.inputOffset >= 0)
+    seekInput(&vm->input, header.inputOffset);
+  return CHECKPOINT_OK;
+}
@@ -0,0 +1,102 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <stdio.h>
+#include <signal.h>
+
+#include "vm.h"
+
+#define CHECKPOINT_MAGIC "KPLS"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_PAGE 1024            // cells compared and written at a time
+
+// Values of checkpointDue
+#define CHECKPOINT_NONE 0
+#define CHECKPOINT_CONTINUE 1           // write one and go on
+#define CHECKPOINT_STOP 2               // write one and stop the program
+
+/*
+ * Checkpoints for kplrun -checkpoint.  SIGUSR1 and the interval timer
+ * only raise checkpointDue, and SIGTERM raises it to CHECKPOINT_STOP; the
+ * checkpointing loop sees it at its next jump or call, where the frames
+ * are consistent, and writes the state of the machine there.  The loop
+ * also raises it to CHECKPOINT_STOP itself once it has passed stopAfter
+ * jumps and calls, which stops a program at the same point every time.
+ *
+ * The file is the header, the live stack in pages of CHECKPOINT_PAGE
+ * cells, then the display, the display links and the string heap.  Every
+ * page written is kept in a shadow copy, and the next checkpoint only
+ * writes the pages that differ from it, so a checkpoint costs a compare
+ * of the live stack and a write of what changed, however large the
+ * stack.  The header is marked complete once everything else is written.
+ */
+extern volatile sig_atomic_t checkpointDue;
+
+struct CheckpointHeader_ {
+  char magic[4];
+  WORD version;
+  WORD complete;                // 0 while a checkpoint is being written
+  WORD cellSize;                // sizeof(CELL) of the writer
+  unsigned int codeHash;        // of the program, see hashCode()
+  WORD pc;
+  WORD t;
+  WORD b;
+  WORD level;
+  WORD callDepth;
+  WORD heapTop;
+  long long instructionCount;
+  long long inputOffset;        // -1 when the input cannot be repositioned
+};
+
+typedef struct CheckpointHeader_ CheckpointHeader;
+
+struct Checkpoint_ {
+  FILE* file;
+  unsigned int codeHash;
+  CELL* shadow;                 // the stack pages as the file has them
+  int pages;                    // in the file and the shadow
+  int capacity;                 // pages the shadow can hold
+  long long pagesWritten;       // by all the checkpoints so far
+  int count;                    // checkpoints written
+  long long stopAfter;          // jumps and calls before one that stops the program, 0 for never
+};
+
+typedef struct Checkpoint_ Checkpoint;
+
+typedef enum {
+  CHECKPOINT_OK,
+  CHECKPOINT_IO_ERROR,
+  CHECKPOINT_BAD_FORMAT,
+  CHECKPOINT_INCOMPLETE,
+  CHECKPOINT_OTHER_PROGRAM,
+  CHECKPOINT_TOO_LARGE
+} CheckpointCode;
+
+// Same for a program fused or not
+unsigned int hashCode(CodeBlock* codeBlock);
+
+// NULL when the file cannot be written
+Checkpoint* createCheckpoint(char* name, CodeBlock* codeBlock);
+void freeCheckpoint(Checkpoint* checkpoint);
+
+// Every interval seconds, if interval > 0, and on SIGUSR1 and SIGTERM
+void startCheckpoints(Checkpoint* checkpoint, int interval);
+void stopCheckpoints(Checkpoint* checkpoint);
+
+// The output is flushed first, so that it goes with the state
+CheckpointCode writeCheckpoint(Checkpoint* checkpoint, VMContext* vm);
+
+/*
+ * Puts the machine, which runs the same program, in the state of the
+ * checkpoint, and repositions its input if it can.
+ */
+CheckpointCode resumeCheckpoint(VMContext* vm, char* name);
+char* checkpointMessage(CheckpointCode code);
+
+#endif
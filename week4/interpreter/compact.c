@@ -0,0 +1,132 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compact.h"
+
+int compactOperands(enum OpCode op) {
+  if (HAS_P(op)) return OPERANDS_PQ;
+  if (HAS_Q(op)) return OPERANDS_Q;
+  return OPERANDS_NONE;
+}
+
+static unsigned char* putVarint(unsigned char* out, WORD value) {
+  unsigned int n = ((unsigned int) value << 1) ^ (unsigned int) (value >> 31);
+
+  while (n >= 0x80) {
+    *out++ = (unsigned char) (n | 0x80);
+    n >>= 7;
+  }
+  *out++ = (unsigned char) n;
+  return out;
+}
+
+// Returns NULL when the encoding runs past end or is too long
+static unsigned char* getVarint(unsigned char* in, unsigned char* end, WORD* value) {
+  unsigned int n = 0;
+  int shift = 0;
+
+  do {
+    if ((in == end) || (shift >= 7 * MAX_VARINT)) return NULL;
+    n |= (unsigned int) (*in & 0x7F) << shift;
+    shift += 7;
+  } while (*in++ & 0x80);
+  *value = (WORD) ((n >> 1) ^ (0u - (n & 1)));
+  return in;
+}
+
+static unsigned char* putInstruction(unsigned char* out, Instruction* inst) {
+  enum OpCode op = unfusedOpcode(inst->op);
+
+  *out++ = (unsigned char) op;
+  switch (compactOperands(op)) {
+  case OPERANDS_PQ:
+    out = putVarint(out, inst->p);
+    out = putVarint(out, inst->q);
+    break;
+  case OPERANDS_Q:
+    out = putVarint(out, inst->q);
+    break;
+  default:
+    break;
+  }
+  return out;
+}
+
+CompactCode* encodeCompact(CodeBlock* codeBlock) {
+  CompactCode* compact = (CompactCode*) malloc(sizeof(CompactCode));
+  int n = codeBlock->codeSize;
+  unsigned char* out;
+  int pc;
+
+  // One more byte for the OP_HL that stops a run off the end
+  compact->bytes = (unsigned char*) malloc((size_t) n * (1 + 2 * MAX_VARINT) + 1);
+  compact->offset = (int*) malloc((n + 1) * sizeof(int));
+  compact->codeSize = n;
+  out = compact->bytes;
+  for (pc = 0; pc < n; pc ++) {
+    compact->offset[pc] = out - compact->bytes;
+    out = putInstruction(out, codeBlock->code + pc);
+  }
+  compact->offset[n] = out - compact->bytes;
+  compact->length = out - compact->bytes;
+  *out = OP_HL;
+  return compact;
+}
+
+void freeCompact(CompactCode* compact) {
+  if (compact == NULL) return;
+  free(compact->bytes);
+  free(compact->offset);
+  free(compact);
+}
+
+int decodeCompact(unsigned char* bytes, int length, Instruction* code, int count) {
+  unsigned char* in = bytes;
+  unsigned char* end = bytes + length;
+  int pc;
+
+  for (pc = 0; pc < count; pc ++) {
+    if ((in == end) || (*in > LAST_EXECUTABLE_OPCODE)) return -1;
+    code[pc].op = (enum OpCode) *in++;
+    code[pc].p = DC_VALUE;
+    code[pc].q = DC_VALUE;
+    switch (compactOperands(code[pc].op)) {
+    case OPERANDS_PQ:
+      in = getVarint(in, end, &code[pc].p);
+      if (in != NULL) in = getVarint(in, end, &code[pc].q);
+      break;
+    case OPERANDS_Q:
+      in = getVarint(in, end, &code[pc].q);
+      break;
+    default:
+      break;
+    }
+    if (in == NULL) return -1;
+  }
+  return in - bytes;
+}
+
+int saveCompactCode(CodeBlock* codeBlock, FILE* f) {
+  ExecutableHeader header;
+  CompactCode* compact = encodeCompact(codeBlock);
+  int ok;
+
+  memcpy(header.magic, EXECUTABLE_COMPACT_MAGIC, 4);
+  header.version = EXECUTABLE_VERSION;
+  header.instructionSize = 0;
+  header.codeLength = codeBlock->codeSize;
+  header.entry = codeBlock->entry;
+  header.constantCount = codeBlock->constantCount;
+  ok = (fwrite(&header, sizeof(header), 1, f) == 1)
+    && (fwrite(codeBlock->constants, sizeof(WORD), codeBlock->constantCount, f) == (size_t) codeBlock->constantCount)
+    && (fwrite(compact->bytes, 1, compact->length, f) == (size_t) compact->length);
+  freeCompact(compact);
+  return ok;
+}
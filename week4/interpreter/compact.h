@@ -0,0 +1,66 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __COMPACT_H__
+#define __COMPACT_H__
+
+#include <stdio.h>
+
+#include "instructions.h"
+
+/*
+ * Compact bytecode: every instruction is its opcode in one byte, followed
+ * by its operands as variable-length integers (7 bits per byte, the low
+ * bits first, zigzag-coded so that small negative values stay short).
+ * OP_LA, OP_LV, OP_LVF, OP_CALL and OP_TC have p and q, OP_LC, OP_INT,
+ * OP_DCT, OP_J, OP_FJ, OP_LCF, OP_EFF and OP_LS have q, and the others
+ * have no operand.  Jump and call targets
+ * stay instruction addresses; offset[] turns them into byte offsets.
+ * Superinstructions are never encoded: a fused block is encoded as the
+ * instructions it was fused from.
+ */
+#define OPERANDS_NONE 0
+#define OPERANDS_Q    1
+#define OPERANDS_PQ   2
+
+// Constant for a constant op, so that loops can decode in each handler
+#define HAS_P(op)     (((op) == OP_LA) || ((op) == OP_LV) || ((op) == OP_CALL) || ((op) == OP_LVF) \
+                       || ((op) == OP_TC))
+#define HAS_Q(op)     (HAS_P(op) || ((op) == OP_LC) || ((op) == OP_INT) || ((op) == OP_DCT) \
+                       || ((op) == OP_J) || ((op) == OP_FJ) || ((op) == OP_LCF) \
+                       || ((op) == OP_EFF) || ((op) == OP_LS))
+
+// Longest encoding of a WORD
+#define MAX_VARINT 5
+
+struct CompactCode_ {
+  unsigned char* bytes;
+  int length;                   // in bytes, without the final OP_HL
+  int* offset;                  // byte offset of every instruction, and of the end
+  int codeSize;
+};
+
+typedef struct CompactCode_ CompactCode;
+
+int compactOperands(enum OpCode op);
+
+CompactCode* encodeCompact(CodeBlock* codeBlock);
+void freeCompact(CompactCode* compact);
+
+/*
+ * Decodes count instructions from at most length bytes into code.  Returns
+ * the number of bytes used, or -1 when the instructions are malformed or
+ * do not fit.
+ */
+int decodeCompact(unsigned char* bytes, int length, Instruction* code, int count);
+
+/*
+ * Writes the block as a compact executable: the executable header with
+ * EXECUTABLE_COMPACT_MAGIC, the constant pool, then the compact bytes.
+ */
+int saveCompactCode(CodeBlock* codeBlock, FILE* f);
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "instructions.h"
+#define DEFAULT_CODE_SIZE 1024
+#define DEFAULT_LENGTH 4
+#define DEFAULT_TOP 30
+#define MAX_LENGTH 6
+#define MAX_GRAMS 4096
+
+/*
+ * Opcode n-gram miner: counts the opcode sequences of length 2..n that
+ * occur inside basic blocks of a set of executables.  The most frequent
+ * ones are the candidates for superinstructions (see fuseCode()).
+ */
+
+struct Gram_ {
+  int length;
+  enum OpCode ops[MAX_LENGTH];
+  long count;
+};
+
+typedef struct Gram_ Gram;
+
+Gram grams[MAX_GRAMS];
+int gramCount;
+int codeSize;
+int maxLength;
+int top;
+
+void printUsage(void) {
+  printf("Usage: kplgram executable... [-n=length] [-top=count] [-c=code_size]\n");
+  printf("   executable: kpl executables to mine\n");
+  printf("   -n=length: longest sequence to count (2..%d)\n", MAX_LENGTH);
+  printf("   -top=count: number of sequences to list\n");
+  printf("   -c=code_size: set the code size\n");
+}
+
+int analyseParam(char* param) {
+  if (strncmp(param, "-n=", 3) == 0) {
+    maxLength = atoi(param+3);
+    if ((maxLength < 2) || (maxLength > MAX_LENGTH))
+      return 0;
+    return 1;
+  }
+  if (strncmp(param, "-top=", 5) == 0) {
+    top = atoi(param+5);
+    return 1;
+  }
+  if (strncmp(param, "-c=", 3) == 0) {
+    codeSize = atoi(param+3);
+    return 1;
+  }
+  return 0;
+}
+
+void countGram(Instruction* code, int length) {
+  int i, j;
+
+  for (i = 0; i < gramCount; i ++) {
+    if (grams[i].length != length) continue;
+    for (j = 0; j < length; j ++)
+      if (grams[i].ops[j] != code[j].op) break;
+    if (j == length) {
+      grams[i].count ++;
+      return;
+    }
+  }
+  if (gramCount == MAX_GRAMS) return;
+  grams[gramCount].length = length;
+  for (j = 0; j < length; j ++)
+    grams[gramCount].ops[j] = code[j].op;
+  grams[gramCount].count = 1;
+  gramCount ++;
+}
+
+void mineCode(CodeBlock* codeBlock) {
+  Instruction* code = codeBlock->code;
+  int n = codeBlock->codeSize;
+  char* leader = (char*) calloc(n + 1, 1);
+  int i, length;
+
+  // A jump or call target starts a new basic block
+  for (i = 0; i < n; i ++)
+    switch (code[i].op) {
+    case OP_J:
+    case OP_FJ:
+    case OP_CALL:
+    case OP_TC:
+      if ((code[i].q >= 0) && (code[i].q < n))
+	leader[code[i].q] = 1;
+      break;
+    default:
+      break;
+    }
+
+  for (i = 0; i < n; i ++)
+    for (length = 2; (length <= maxLength) && (i + length <= n); length ++) {
+      if (leader[i + length - 1]) break;
+      countGram(code + i, length);
+      // Nothing follows a transfer of control inside the block
+      if ((code[i + length - 1].op == OP_J) || (code[i + length - 1].op == OP_FJ) ||
+	  (code[i + length - 1].op == OP_CALL) || (code[i + length - 1].op == OP_EP) ||
+	  (code[i + length - 1].op == OP_EF) || (code[i + length - 1].op == OP_EFF) ||
+	  (code[i + length - 1].op == OP_TC) || (code[i + length - 1].op == OP_HL))
+	break;
+    }
+  free(leader);
+}
+
+int compareGrams(const void* a, const void* b) {
+  const Gram* g1 = (const Gram*) a;
+  const Gram* g2 = (const Gram*) b;
+
+  if (g1->count != g2->count)
+    return (g2->count > g1->count) ? 1 : -1;
+  return g2->length - g1->length;
+}
+
+void printGram(Gram* gram) {
+  Instruction inst;
+  char s[100];
+  char* operands;
+  int j;
+
+  printf("%8ld  ", gram->count);
+  for (j = 0; j < gram->length; j ++) {
+    inst.op = gram->ops[j];
+    inst.p = DC_VALUE;
+    inst.q = DC_VALUE;
+    sprintInstruction(s, &inst);
+    // Keep only the mnemonic
+    operands = strchr(s, ' ');
+    if (operands != NULL) *operands = '\0';
+    printf("%s%s", (j == 0) ? "" : "; ", s);
+  }
+  printf("\n");
+}
+
+/******************************************************************/
+
+int main(int argc, char *argv[]) {
+  int i, files = 0;
+  FILE* f;
+  CodeBlock* codeBlock;
+
+  codeSize = DEFAULT_CODE_SIZE;
+  maxLength = DEFAULT_LENGTH;
+  top = DEFAULT_TOP;
+  gramCount = 0;
+
+  for (i = 1; i < argc; i++)
+    if ((argv[i][0] == '-') && (analyseParam(argv[i]) == 0)) {
+      printUsage();
+      return -1;
+    }
+
+  codeBlock = createCodeBlock(codeSize);
+  for (i = 1; i < argc; i++) {
+    if (argv[i][0] == '-') continue;
+    f = fopen(argv[i], "r");
+    if (f == NULL) {
+      printf("kplgram: Can\'t read input file %s!\n", argv[i]);
+      continue;
+    }
+    if (loadCode(codeBlock, f) != LOAD_OK) {
+      printf("kplgram: Wrong executable format in %s!\n", argv[i]);
+      fclose(f);
+      continue;
+    }
+    fclose(f);
+    mineCode(codeBlock);
+    files ++;
+  }
+  freeCodeBlock(codeBlock);
+
+  if (files == 0) {
+    printf("kplgram: no input file.\n");
+    printUsage();
+    return -1;
+  }
+
+  qsort(grams, gramCount, sizeof(Gram), compareGrams);
+  for (i = 0; (i < gramCount) && (i < top); i ++)
+    printGram(grams + i);
+  return 0;
+}
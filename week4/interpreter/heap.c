@@ -0,0 +1,108 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "heap.h"
+
+void openHeap(StringHeap* heap) {
+  heap->words = NULL;
+  heap->top = 0;
+  heap->capacity = 0;
+}
+
+void clearHeap(StringHeap* heap) {
+  heap->top = 0;
+}
+
+void closeHeap(StringHeap* heap) {
+  free(heap->words);
+  openHeap(heap);
+}
+
+WORD* stringRecord(StringHeap* heap, WORD* constants, CELL handle) {
+  return (handle < 0) ? heap->words + ~handle : constants + handle;
+}
+
+// The record at offset in the words must end by count
+static int recordFits(WORD* words, CELL offset, int count) {
+  if ((offset < 0) || (offset >= count))
+    return 0;
+  return (words[offset] >= 0) && (words[offset] < (count - offset - 1) * (CELL) sizeof(WORD));
+}
+
+int validString(StringHeap* heap, CodeBlock* codeBlock, CELL handle) {
+  if (handle < 0)
+    return recordFits(heap->words, ~handle, heap->top);
+  return recordFits(codeBlock->constants, handle, codeBlock->constantCount);
+}
+
+int reserveHeap(StringHeap* heap, int count) {
+  int size = (heap->capacity > 0) ? heap->capacity : INITIAL_HEAP_SIZE;
+  WORD* words;
+
+  if (count > MAX_HEAP_SIZE - heap->top)
+    return 0;
+  if (heap->top + count <= heap->capacity)
+    return 1;
+  while (size < heap->top + count)
+    size *= 2;
+  if (size > MAX_HEAP_SIZE)
+    size = MAX_HEAP_SIZE;
+  words = (WORD*) realloc(heap->words, size * sizeof(WORD));
+  if (words == NULL)
+    return 0;
+  heap->words = words;
+  heap->capacity = size;
+  return 1;
+}
+
+int concatStrings(StringHeap* heap, WORD* constants, CELL x, CELL y, CELL* result) {
+  WORD* first = stringRecord(heap, constants, x);
+  WORD* second = stringRecord(heap, constants, y);
+  int length, count;
+  WORD* record;
+
+  // Nothing to copy when a side is empty
+  if (second[0] == 0) {
+    *result = x;
+    return 1;
+  }
+  if (first[0] == 0) {
+    *result = y;
+    return 1;
+  }
+
+  length = first[0] + second[0];
+  if (length >= MAX_HEAP_SIZE * (int) sizeof(WORD))
+    return 0;
+  count = STRING_WORDS(length);
+  if (!reserveHeap(heap, count))
+    return 0;
+  first = stringRecord(heap, constants, x);
+  second = stringRecord(heap, constants, y);
+
+  record = heap->words + heap->top;
+  record[count - 1] = 0;                // the padding after the NUL
+  memcpy(STRING_CHARS(record), STRING_CHARS(first), first[0]);
+  memcpy(STRING_CHARS(record) + first[0], STRING_CHARS(second), second[0] + 1);
+  record[0] = length;
+  *result = ~ (CELL) heap->top;
+  heap->top += count;
+  return 1;
+}
+
+int compareStrings(StringHeap* heap, WORD* constants, CELL x, CELL y) {
+  WORD* first = stringRecord(heap, constants, x);
+  WORD* second = stringRecord(heap, constants, y);
+  int length = (first[0] < second[0]) ? first[0] : second[0];
+  int order = memcmp(STRING_CHARS(first), STRING_CHARS(second), length);
+
+  if (order != 0)
+    return (order < 0) ? -1 : 1;
+  return (first[0] > second[0]) - (first[0] < second[0]);
+}
@@ -0,0 +1,56 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __HEAP_H__
+#define __HEAP_H__
+
+#include "instructions.h"
+
+#define INITIAL_HEAP_SIZE 1024          // words
+#define MAX_HEAP_SIZE (1 << 24)
+
+/*
+ * Strings made by a running program.  OP_CAT puts its result on the top
+ * of the heap, as a record laid out like those of the constant pool (see
+ * STRING_WORDS); the handle of the record at offset x is ~x, so that it
+ * is negative and cannot be taken for a pool string.  Nothing is freed
+ * before the program is reset.
+ */
+struct StringHeap_ {
+  WORD* words;
+  int top;
+  int capacity;
+};
+
+typedef struct StringHeap_ StringHeap;
+
+void openHeap(StringHeap* heap);
+void clearHeap(StringHeap* heap);
+void closeHeap(StringHeap* heap);
+
+// Makes room for count more words on the top; records may move
+int reserveHeap(StringHeap* heap, int count);
+
+// Record of the string with the handle, in the heap or the pool
+WORD* stringRecord(StringHeap* heap, WORD* constants, CELL handle);
+
+/*
+ * Whether the handle is that of a whole record in the heap or the pool of
+ * the code block.  A program that reads a string it never stored gets
+ * whatever word was left on the stack, which must not be followed.
+ */
+int validString(StringHeap* heap, CodeBlock* codeBlock, CELL handle);
+
+/*
+ * *result gets the handle of x followed by y.  Returns 0 when the heap
+ * cannot hold it.
+ */
+int concatStrings(StringHeap* heap, WORD* constants, CELL x, CELL y, CELL* result);
+
+// Less than, equal to or greater than 0 as x is before, equal to or after y
+int compareStrings(StringHeap* heap, WORD* constants, CELL x, CELL y);
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "input.h"
+
+void openInput(InputChannel* channel, FILE* f, OutputChannel* prompt) {
+  channel->fd = fileno(f);
+  channel->prompt = prompt;
+  channel->start = 0;
+  channel->length = 0;
+}
+
+// Whether there is anything left to read, once the buffer is refilled
+static int fillInput(InputChannel* channel) {
+  int n;
+
+  if (channel->start < channel->length)
+    return 1;
+  flushOutput(channel->prompt);
+  do {
+    n = read(channel->fd, channel->buffer, INPUT_BUFFER_SIZE);
+  } while ((n < 0) && (errno == EINTR));
+  channel->start = 0;
+  channel->length = (n > 0) ? n : 0;
+  return n > 0;
+}
+
+WORD inputChar(InputChannel* channel) {
+  if ((channel->start == channel->length) && !fillInput(channel))
+    return 0;
+  return (unsigned char) channel->buffer[channel->start++];
+}
+
+static int isBlank(char c) {
+  return (c == ' ') || (c == '\n') || (c == '\t') || (c == '\r') || (c == '\v') || (c == '\f');
+}
+
+CELL inputInt(InputChannel* channel) {
+  UCELL n = 0;
+  int negative = 0;
+  char c;
+
+  while (fillInput(channel) && isBlank(channel->buffer[channel->start]))
+    channel->start ++;
+  if (!fillInput(channel))
+    return 0;
+  c = channel->buffer[channel->start];
+  if ((c == '-') || (c == '+')) {
+    negative = (c == '-');
+    channel->start ++;
+  }
+  // Digits may run across refills; the number wraps as the cell does
+  while (fillInput(channel)) {
+    c = channel->buffer[channel->start];
+    if ((c < '0') || (c > '9'))
+      break;
+    n = n * 10 + (UCELL) (c - '0');
+    channel->start ++;
+  }
+  return negative ? (CELL) (0u - n) : (CELL) n;
+}
+
+long long inputPosition(InputChannel* channel) {
+  long long position = lseek(channel->fd, 0, SEEK_CUR);
+
+  if (position < 0)
+    return -1;
+  return position - (channel->length - channel->start);
+}
+
+int seekInput(InputChannel* channel, long long position) {
+  channel->start = 0;
+  channel->length = 0;
+  return lseek(channel->fd, position, SEEK_SET) >= 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __INPUT_H__
+#define __INPUT_H__
+
+#include <stdio.h>
+
+#include "instructions.h"
+#include "output.h"
+
+#define INPUT_BUFFER_SIZE 65536
+
+/*
+ * Input of a running program.  OP_RC and OP_RI take their characters and
+ * integers from the buffer, which is refilled by one read() of whatever
+ * the file has ready, up to INPUT_BUFFER_SIZE bytes.  The output is
+ * flushed before a refill, when the program may wait for its input, and
+ * not on every read.
+ */
+struct InputChannel_ {
+  int fd;
+  OutputChannel* prompt;        // flushed before the channel waits
+  int start;                    // next byte of the buffer
+  int length;
+  char buffer[INPUT_BUFFER_SIZE];
+};
+
+typedef struct InputChannel_ InputChannel;
+
+void openInput(InputChannel* channel, FILE* f, OutputChannel* prompt);
+
+// Both give 0 at the end of the input
+WORD inputChar(InputChannel* channel);
+// Skips blanks and reads an optional sign and digits, as scanf("%d") does
+CELL inputInt(InputChannel* channel);
+
+// Where the next byte comes from in the file, or -1 when it cannot be repositioned
+long long inputPosition(InputChannel* channel);
+int seekInput(InputChannel* channel, long long position);
+
+#endif
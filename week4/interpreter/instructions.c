@@ -1,175 +1,637 @@
-/* 
- * @copyright (c) 2008, Hedspi, Hanoi University of Technology
- * @author Huu-Duc Nguyen
- * @version 1.0
- */
-#include <stdio.h>
-#include <stdlib.h>
-#include "instructions.h"
-
-#define MAX_BLOCK 50
-
-CodeBlock* createCodeBlock(int maxSize) {
-  CodeBlock* codeBlock = (CodeBlock*) malloc(sizeof(CodeBlock));
-
-  codeBlock->code = (Instruction*) malloc(maxSize * sizeof(Instruction));
-  codeBlock->codeSize = 0;
-  codeBlock->maxSize = maxSize;
-  return codeBlock;
-}
-
-void freeCodeBlock(CodeBlock* codeBlock) {
-  free(codeBlock->code);
-  free(codeBlock);
-}
-
-int emitCode(CodeBlock* codeBlock, enum OpCode op, WORD p, WORD q) {
-  Instruction* bottom = codeBlock->code + codeBlock->codeSize;
-
-  if (codeBlock->codeSize >= codeBlock->maxSize) return 0;
-
-  bottom->op = op;
-  bottom->p = p;
-  bottom->q = q;
-  codeBlock->codeSize ++;
-  return 1;
-}
-
-int emitLA(CodeBlock* codeBlock, WORD p, WORD q) { return emitCode(codeBlock, OP_LA, p, q); }
-int emitLV(CodeBlock* codeBlock, WORD p, WORD q) { return emitCode(codeBlock, OP_LV, p, q); }
-int emitLC(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_LC, DC_VALUE, q); }
-int emitLI(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_LI, DC_VALUE, DC_VALUE); }
-int emitINT(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_INT, DC_VALUE, q); }
-int emitDCT(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_DCT, DC_VALUE, q); }
-int emitJ(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_J, DC_VALUE, q); }
-int emitFJ(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_FJ, DC_VALUE, q); }
-int emitHL(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_HL, DC_VALUE, DC_VALUE); }
-int emitST(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_ST, DC_VALUE, DC_VALUE); }
-int emitCALL(CodeBlock* codeBlock, WORD p, WORD q) { return emitCode(codeBlock, OP_CALL, p, q); }
-int emitEP(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_EP, DC_VALUE, DC_VALUE); }
-int emitEF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_EF, DC_VALUE, DC_VALUE); }
-int emitRC(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_RC, DC_VALUE, DC_VALUE); }
-int emitRI(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_RI, DC_VALUE, DC_VALUE); }
-int emitWRC(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_WRC, DC_VALUE, DC_VALUE); }
-int emitWRI(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_WRI, DC_VALUE, DC_VALUE); }
-int emitWLN(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_WLN, DC_VALUE, DC_VALUE); }
-int emitAD(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_AD, DC_VALUE, DC_VALUE); }
-int emitSB(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_SB, DC_VALUE, DC_VALUE); }
-int emitML(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_ML, DC_VALUE, DC_VALUE); }
-int emitDV(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_DV, DC_VALUE, DC_VALUE); }
-int emitNEG(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_NEG, DC_VALUE, DC_VALUE); }
-int emitCV(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_CV, DC_VALUE, DC_VALUE); }
-int emitEQ(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_EQ, DC_VALUE, DC_VALUE); }
-int emitNE(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_NE, DC_VALUE, DC_VALUE); }
-int emitGT(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_GT, DC_VALUE, DC_VALUE); }
-int emitLT(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_LT, DC_VALUE, DC_VALUE); }
-int emitGE(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_GE, DC_VALUE, DC_VALUE); }
-int emitLE(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_LE, DC_VALUE, DC_VALUE); }
-
-int emitBP(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_BP, DC_VALUE, DC_VALUE); }
-
-
-void printInstruction(Instruction* inst) {
-  switch (inst->op) {
-  case OP_LA: printf("LA %d,%d", inst->p, inst->q); break;
-  case OP_LV: printf("LV %d,%d", inst->p, inst->q); break;
-  case OP_LC: printf("LC %d", inst->q); break;
-  case OP_LI: printf("LI"); break;
-  case OP_INT: printf("INT %d", inst->q); break;
-  case OP_DCT: printf("DCT %d", inst->q); break;
-  case OP_J: printf("J %d", inst->q); break;
-  case OP_FJ: printf("FJ %d", inst->q); break;
-  case OP_HL: printf("HL"); break;
-  case OP_ST: printf("ST"); break;
-  case OP_CALL: printf("CALL %d,%d", inst->p, inst->q); break;
-  case OP_EP: printf("EP"); break;
-  case OP_EF: printf("EF"); break;
-  case OP_RC: printf("RC"); break;
-  case OP_RI: printf("RI"); break;
-  case OP_WRC: printf("WRC"); break;
-  case OP_WRI: printf("WRI"); break;
-  case OP_WLN: printf("WLN"); break;
-  case OP_AD: printf("AD"); break;
-  case OP_SB: printf("SB"); break;
-  case OP_ML: printf("ML"); break;
-  case OP_DV: printf("DV"); break;
-  case OP_NEG: printf("NEG"); break;
-  case OP_CV: printf("CV"); break;
-  case OP_EQ: printf("EQ"); break;
-  case OP_NE: printf("NE"); break;
-  case OP_GT: printf("GT"); break;
-  case OP_LT: printf("LT"); break;
-  case OP_GE: printf("GE"); break;
-  case OP_LE: printf("LE"); break;
-
-  case OP_BP: printf("BP"); break;
-  default: break;
-  }
-}
-
-void sprintInstruction(char* s, Instruction* inst) {
-  switch (inst->op) {
-  case OP_LA: sprintf(s,"LA %d,%d", inst->p, inst->q); break;
-  case OP_LV: sprintf(s, "LV %d,%d", inst->p, inst->q); break;
-  case OP_LC: sprintf(s, "LC %d", inst->q); break;
-  case OP_LI: sprintf(s, "LI"); break;
-  case OP_INT: sprintf(s, "INT %d", inst->q); break;
-  case OP_DCT: sprintf(s, "DCT %d", inst->q); break;
-  case OP_J: sprintf(s, "J %d", inst->q); break;
-  case OP_FJ: sprintf(s, "FJ %d", inst->q); break;
-  case OP_HL: sprintf(s,"HL"); break;
-  case OP_ST: sprintf(s,"ST"); break;
-  case OP_CALL: sprintf(s,"CALL %d,%d", inst->p, inst->q); break;
-  case OP_EP: sprintf(s,"EP"); break;
-  case OP_EF: sprintf(s,"EF"); break;
-  case OP_RC: sprintf(s,"RC"); break;
-  case OP_RI: sprintf(s,"RI"); break;
-  case OP_WRC: sprintf(s,"WRC"); break;
-  case OP_WRI: sprintf(s,"WRI"); break;
-  case OP_WLN: sprintf(s,"WLN"); break;
-  case OP_AD: sprintf(s,"AD"); break;
-  case OP_SB: sprintf(s,"SB"); break;
-  case OP_ML: sprintf(s,"ML"); break;
-  case OP_DV: sprintf(s,"DV"); break;
-  case OP_NEG: sprintf(s,"NEG"); break;
-  case OP_CV: sprintf(s,"CV"); break;
-  case OP_EQ: sprintf(s,"EQ"); break;
-  case OP_NE: sprintf(s,"NE"); break;
-  case OP_GT: sprintf(s,"GT"); break;
-  case OP_LT: sprintf(s,"LT"); break;
-  case OP_GE: sprintf(s,"GE"); break;
-  case OP_LE: sprintf(s,"LE"); break;
-
-  case OP_BP: sprintf(s,"BP"); break;
-  default: break;
-  }
-}
-
-void printCodeBlock(CodeBlock* codeBlock) {
-  Instruction* pc = codeBlock->code;
-  int i;
-  for (i = 0 ; i < codeBlock->codeSize; i ++) {
-    printf("%d:  ",i);
-    printInstruction(pc);
-    printf("\n");
-    pc ++;
-  }
-}
-
-
-void loadCode(CodeBlock* codeBlock, FILE* f) {
-  Instruction* code = codeBlock->code;
-  int n;
-
-  codeBlock->codeSize = 0;
-  while (!feof(f)) {
-    n = fread(code, sizeof(Instruction), MAX_BLOCK, f);
-    code += n;
-    codeBlock->codeSize += n;
-  }
-}
-
-
-void saveCode(CodeBlock* codeBlock, FILE* f) {
-  fwrite(codeBlock->code, sizeof(Instruction), codeBlock->codeSize, f);
-}
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "instructions.h"
+#include "compact.h"
+
+#ifndef _WIN32
+#define MAPPED_CODE
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define MAX_FUSED 6
+
+struct Superinstruction_ {
+  enum OpCode op;
+  int length;
+  enum OpCode ops[MAX_FUSED];
+};
+
+typedef struct Superinstruction_ Superinstruction;
+
+// Chosen from the opcode n-grams that kplgram finds in compiled programs
+Superinstruction superinstructions[] = {
+  {OP_LC_AD,    2, {OP_LC, OP_AD}},
+  {OP_CV_LI,    2, {OP_CV, OP_LI}},
+  {OP_LV_LC,    2, {OP_LV, OP_LC}},
+  {OP_LV_LC_AD, 3, {OP_LV, OP_LC, OP_AD}},
+  {OP_LA_LC_ST, 3, {OP_LA, OP_LC, OP_ST}},
+  {OP_LA_LV_ST, 3, {OP_LA, OP_LV, OP_ST}},
+  {OP_LC_ML_AD, 3, {OP_LC, OP_ML, OP_AD}},
+  {OP_EQ_FJ,    2, {OP_EQ, OP_FJ}},
+  {OP_NE_FJ,    2, {OP_NE, OP_FJ}},
+  {OP_GT_FJ,    2, {OP_GT, OP_FJ}},
+  {OP_LT_FJ,    2, {OP_LT, OP_FJ}},
+  {OP_GE_FJ,    2, {OP_GE, OP_FJ}},
+  {OP_LE_FJ,    2, {OP_LE, OP_FJ}},
+  {OP_INC,      6, {OP_CV, OP_CV, OP_LI, OP_LC, OP_AD, OP_ST}}
+};
+
+#define NUM_OF_SUPERINSTRUCTIONS 14
+
+CodeBlock* createCodeBlock(int maxSize) {
+  CodeBlock* codeBlock = (CodeBlock*) malloc(sizeof(CodeBlock));
+
+  codeBlock->code = (Instruction*) malloc(maxSize * sizeof(Instruction));
+  codeBlock->codeSize = 0;
+  codeBlock->maxSize = maxSize;
+  codeBlock->entry = 0;
+  codeBlock->constants = NULL;
+  codeBlock->constantCount = 0;
+  codeBlock->maxConstants = 0;
+  codeBlock->image = NULL;
+  codeBlock->imageSize = 0;
+  codeBlock->mapped = 0;
+  return codeBlock;
+}
+
+static void releaseCode(CodeBlock* codeBlock);
+
+void freeCodeBlock(CodeBlock* codeBlock) {
+  releaseCode(codeBlock);
+  free(codeBlock);
+}
+
+int emitCode(CodeBlock* codeBlock, enum OpCode op, WORD p, WORD q) {
+  Instruction* bottom = codeBlock->code + codeBlock->codeSize;
+
+  if (codeBlock->codeSize >= codeBlock->maxSize) return 0;
+
+  bottom->op = op;
+  bottom->p = p;
+  bottom->q = q;
+  codeBlock->codeSize ++;
+  return 1;
+}
+
+int emitLA(CodeBlock* codeBlock, WORD p, WORD q) { return emitCode(codeBlock, OP_LA, p, q); }
+int emitLV(CodeBlock* codeBlock, WORD p, WORD q) { return emitCode(codeBlock, OP_LV, p, q); }
+int emitLC(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_LC, DC_VALUE, q); }
+int emitLI(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_LI, DC_VALUE, DC_VALUE); }
+int emitINT(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_INT, DC_VALUE, q); }
+int emitDCT(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_DCT, DC_VALUE, q); }
+int emitJ(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_J, DC_VALUE, q); }
+int emitFJ(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_FJ, DC_VALUE, q); }
+int emitHL(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_HL, DC_VALUE, DC_VALUE); }
+int emitST(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_ST, DC_VALUE, DC_VALUE); }
+int emitCALL(CodeBlock* codeBlock, WORD p, WORD q) { return emitCode(codeBlock, OP_CALL, p, q); }
+int emitEP(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_EP, DC_VALUE, DC_VALUE); }
+int emitEF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_EF, DC_VALUE, DC_VALUE); }
+int emitRC(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_RC, DC_VALUE, DC_VALUE); }
+int emitRI(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_RI, DC_VALUE, DC_VALUE); }
+int emitWRC(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_WRC, DC_VALUE, DC_VALUE); }
+int emitWRI(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_WRI, DC_VALUE, DC_VALUE); }
+int emitWLN(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_WLN, DC_VALUE, DC_VALUE); }
+int emitAD(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_AD, DC_VALUE, DC_VALUE); }
+int emitSB(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_SB, DC_VALUE, DC_VALUE); }
+int emitML(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_ML, DC_VALUE, DC_VALUE); }
+int emitDV(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_DV, DC_VALUE, DC_VALUE); }
+int emitNEG(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_NEG, DC_VALUE, DC_VALUE); }
+int emitCV(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_CV, DC_VALUE, DC_VALUE); }
+int emitEQ(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_EQ, DC_VALUE, DC_VALUE); }
+int emitNE(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_NE, DC_VALUE, DC_VALUE); }
+int emitGT(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_GT, DC_VALUE, DC_VALUE); }
+int emitLT(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_LT, DC_VALUE, DC_VALUE); }
+int emitGE(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_GE, DC_VALUE, DC_VALUE); }
+int emitLE(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_LE, DC_VALUE, DC_VALUE); }
+
+int emitBP(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_BP, DC_VALUE, DC_VALUE); }
+
+int emitLCF(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_LCF, DC_VALUE, q); }
+int emitLVF(CodeBlock* codeBlock, WORD p, WORD q) { return emitCode(codeBlock, OP_LVF, p, q); }
+int emitLIF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_LIF, DC_VALUE, DC_VALUE); }
+int emitSTF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_STF, DC_VALUE, DC_VALUE); }
+int emitITF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_ITF, DC_VALUE, DC_VALUE); }
+int emitADF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_ADF, DC_VALUE, DC_VALUE); }
+int emitSBF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_SBF, DC_VALUE, DC_VALUE); }
+int emitMLF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_MLF, DC_VALUE, DC_VALUE); }
+int emitDVF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_DVF, DC_VALUE, DC_VALUE); }
+int emitNEGF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_NEGF, DC_VALUE, DC_VALUE); }
+int emitEQF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_EQF, DC_VALUE, DC_VALUE); }
+int emitNEF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_NEF, DC_VALUE, DC_VALUE); }
+int emitGTF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_GTF, DC_VALUE, DC_VALUE); }
+int emitLTF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_LTF, DC_VALUE, DC_VALUE); }
+int emitGEF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_GEF, DC_VALUE, DC_VALUE); }
+int emitLEF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_LEF, DC_VALUE, DC_VALUE); }
+int emitWRF(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_WRF, DC_VALUE, DC_VALUE); }
+int emitEFF(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_EFF, DC_VALUE, q); }
+int emitLS(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_LS, DC_VALUE, q); }
+int emitCAT(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_CAT, DC_VALUE, DC_VALUE); }
+int emitCMPS(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_CMPS, DC_VALUE, DC_VALUE); }
+int emitWRS(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_WRS, DC_VALUE, DC_VALUE); }
+int emitTC(CodeBlock* codeBlock, WORD p, WORD q) { return emitCode(codeBlock, OP_TC, p, q); }
+
+// Index of the words in the pool, appended when they are not there yet
+static int addConstant(CodeBlock* codeBlock, WORD* words, int count) {
+  WORD* constants;
+  int size, i;
+
+  for (i = 0; i + count <= codeBlock->constantCount; i ++)
+    if (memcmp(codeBlock->constants + i, words, count * sizeof(WORD)) == 0)
+      return i;
+
+  if (codeBlock->constantCount + count > codeBlock->maxConstants) {
+    if ((codeBlock->constants != NULL) && (codeBlock->maxConstants == 0))
+      return -1;                  // Loaded with the code, not ours to grow
+    size = (codeBlock->maxConstants > 0) ? codeBlock->maxConstants : 64;
+    while (codeBlock->constantCount + count > size)
+      size *= 2;
+    if (size > MAX_CODE_LENGTH)
+      return -1;
+    constants = (WORD*) realloc(codeBlock->constants, size * sizeof(WORD));
+    if (constants == NULL)
+      return -1;
+    codeBlock->constants = constants;
+    codeBlock->maxConstants = size;
+  }
+
+  i = codeBlock->constantCount;
+  memcpy(codeBlock->constants + i, words, count * sizeof(WORD));
+  codeBlock->constantCount += count;
+  return i;
+}
+
+int addDoubleConstant(CodeBlock* codeBlock, double value) {
+  DoubleWords d;
+
+  d.value = value;
+  return addConstant(codeBlock, d.words, DOUBLE_SIZE);
+}
+
+int addStringConstant(CodeBlock* codeBlock, char* s) {
+  int length = strlen(s);
+  int count = STRING_WORDS(length);
+  WORD* record;
+  int index;
+
+  if (length >= MAX_CODE_LENGTH)
+    return -1;
+  record = (WORD*) calloc(count, sizeof(WORD));
+  record[0] = length;
+  memcpy(STRING_CHARS(record), s, length);
+  index = addConstant(codeBlock, record, count);
+  free(record);
+  return index;
+}
+
+
+void printInstruction(Instruction* inst) {
+  switch (inst->op) {
+  case OP_LA: printf("LA %d,%d", inst->p, inst->q); break;
+  case OP_LV: printf("LV %d,%d", inst->p, inst->q); break;
+  case OP_LC: printf("LC %d", inst->q); break;
+  case OP_LI: printf("LI"); break;
+  case OP_INT: printf("INT %d", inst->q); break;
+  case OP_DCT: printf("DCT %d", inst->q); break;
+  case OP_J: printf("J %d", inst->q); break;
+  case OP_FJ: printf("FJ %d", inst->q); break;
+  case OP_HL: printf("HL"); break;
+  case OP_ST: printf("ST"); break;
+  case OP_CALL: printf("CALL %d,%d", inst->p, inst->q); break;
+  case OP_EP: printf("EP"); break;
+  case OP_EF: printf("EF"); break;
+  case OP_RC: printf("RC"); break;
+  case OP_RI: printf("RI"); break;
+  case OP_WRC: printf("WRC"); break;
+  case OP_WRI: printf("WRI"); break;
+  case OP_WLN: printf("WLN"); break;
+  case OP_AD: printf("AD"); break;
+  case OP_SB: printf("SB"); break;
+  case OP_ML: printf("ML"); break;
+  case OP_DV: printf("DV"); break;
+  case OP_NEG: printf("NEG"); break;
+  case OP_CV: printf("CV"); break;
+  case OP_EQ: printf("EQ"); break;
+  case OP_NE: printf("NE"); break;
+  case OP_GT: printf("GT"); break;
+  case OP_LT: printf("LT"); break;
+  case OP_GE: printf("GE"); break;
+  case OP_LE: printf("LE"); break;
+
+  case OP_BP: printf("BP"); break;
+
+  case OP_LCF: printf("LCF %d", inst->q); break;
+  case OP_LVF: printf("LVF %d,%d", inst->p, inst->q); break;
+  case OP_LIF: printf("LIF"); break;
+  case OP_STF: printf("STF"); break;
+  case OP_ITF: printf("ITF"); break;
+  case OP_ADF: printf("ADF"); break;
+  case OP_SBF: printf("SBF"); break;
+  case OP_MLF: printf("MLF"); break;
+  case OP_DVF: printf("DVF"); break;
+  case OP_NEGF: printf("NEGF"); break;
+  case OP_EQF: printf("EQF"); break;
+  case OP_NEF: printf("NEF"); break;
+  case OP_GTF: printf("GTF"); break;
+  case OP_LTF: printf("LTF"); break;
+  case OP_GEF: printf("GEF"); break;
+  case OP_LEF: printf("LEF"); break;
+  case OP_WRF: printf("WRF"); break;
+  case OP_EFF: printf("EFF %d", inst->q); break;
+  case OP_LS: printf("LS %d", inst->q); break;
+  case OP_CAT: printf("CAT"); break;
+  case OP_CMPS: printf("CMPS"); break;
+  case OP_WRS: printf("WRS"); break;
+  case OP_TC: printf("TC %d,%d", inst->p, inst->q); break;
+
+  case OP_LC_AD: printf("LC_AD %d", inst->q); break;
+  case OP_CV_LI: printf("CV_LI"); break;
+  case OP_LV_LC: printf("LV_LC %d,%d", inst->p, inst->q); break;
+  case OP_LV_LC_AD: printf("LV_LC_AD %d,%d", inst->p, inst->q); break;
+  case OP_LA_LC_ST: printf("LA_LC_ST %d,%d", inst->p, inst->q); break;
+  case OP_LA_LV_ST: printf("LA_LV_ST %d,%d", inst->p, inst->q); break;
+  case OP_LC_ML_AD: printf("LC_ML_AD %d", inst->q); break;
+  case OP_EQ_FJ: printf("EQ_FJ"); break;
+  case OP_NE_FJ: printf("NE_FJ"); break;
+  case OP_GT_FJ: printf("GT_FJ"); break;
+  case OP_LT_FJ: printf("LT_FJ"); break;
+  case OP_GE_FJ: printf("GE_FJ"); break;
+  case OP_LE_FJ: printf("LE_FJ"); break;
+  case OP_INC: printf("INC"); break;
+  default: break;
+  }
+}
+
+void sprintInstruction(char* s, Instruction* inst) {
+  switch (inst->op) {
+  case OP_LA: sprintf(s,"LA %d,%d", inst->p, inst->q); break;
+  case OP_LV: sprintf(s, "LV %d,%d", inst->p, inst->q); break;
+  case OP_LC: sprintf(s, "LC %d", inst->q); break;
+  case OP_LI: sprintf(s, "LI"); break;
+  case OP_INT: sprintf(s, "INT %d", inst->q); break;
+  case OP_DCT: sprintf(s, "DCT %d", inst->q); break;
+  case OP_J: sprintf(s, "J %d", inst->q); break;
+  case OP_FJ: sprintf(s, "FJ %d", inst->q); break;
+  case OP_HL: sprintf(s,"HL"); break;
+  case OP_ST: sprintf(s,"ST"); break;
+  case OP_CALL: sprintf(s,"CALL %d,%d", inst->p, inst->q); break;
+  case OP_EP: sprintf(s,"EP"); break;
+  case OP_EF: sprintf(s,"EF"); break;
+  case OP_RC: sprintf(s,"RC"); break;
+  case OP_RI: sprintf(s,"RI"); break;
+  case OP_WRC: sprintf(s,"WRC"); break;
+  case OP_WRI: sprintf(s,"WRI"); break;
+  case OP_WLN: sprintf(s,"WLN"); break;
+  case OP_AD: sprintf(s,"AD"); break;
+  case OP_SB: sprintf(s,"SB"); break;
+  case OP_ML: sprintf(s,"ML"); break;
+  case OP_DV: sprintf(s,"DV"); break;
+  case OP_NEG: sprintf(s,"NEG"); break;
+  case OP_CV: sprintf(s,"CV"); break;
+  case OP_EQ: sprintf(s,"EQ"); break;
+  case OP_NE: sprintf(s,"NE"); break;
+  case OP_GT: sprintf(s,"GT"); break;
+  case OP_LT: sprintf(s,"LT"); break;
+  case OP_GE: sprintf(s,"GE"); break;
+  case OP_LE: sprintf(s,"LE"); break;
+
+  case OP_BP: sprintf(s,"BP"); break;
+
+  case OP_LCF: sprintf(s,"LCF %d", inst->q); break;
+  case OP_LVF: sprintf(s,"LVF %d,%d", inst->p, inst->q); break;
+  case OP_LIF: sprintf(s,"LIF"); break;
+  case OP_STF: sprintf(s,"STF"); break;
+  case OP_ITF: sprintf(s,"ITF"); break;
+  case OP_ADF: sprintf(s,"ADF"); break;
+  case OP_SBF: sprintf(s,"SBF"); break;
+  case OP_MLF: sprintf(s,"MLF"); break;
+  case OP_DVF: sprintf(s,"DVF"); break;
+  case OP_NEGF: sprintf(s,"NEGF"); break;
+  case OP_EQF: sprintf(s,"EQF"); break;
+  case OP_NEF: sprintf(s,"NEF"); break;
+  case OP_GTF: sprintf(s,"GTF"); break;
+  case OP_LTF: sprintf(s,"LTF"); break;
+  case OP_GEF: sprintf(s,"GEF"); break;
+  case OP_LEF: sprintf(s,"LEF"); break;
+  case OP_WRF: sprintf(s,"WRF"); break;
+  case OP_EFF: sprintf(s,"EFF %d", inst->q); break;
+  case OP_LS: sprintf(s,"LS %d", inst->q); break;
+  case OP_CAT: sprintf(s,"CAT"); break;
+  case OP_CMPS: sprintf(s,"CMPS"); break;
+  case OP_WRS: sprintf(s,"WRS"); break;
+  case OP_TC: sprintf(s,"TC %d,%d", inst->p, inst->q); break;
+
+  case OP_LC_AD: sprintf(s,"LC_AD %d", inst->q); break;
+  case OP_CV_LI: sprintf(s,"CV_LI"); break;
+  case OP_LV_LC: sprintf(s,"LV_LC %d,%d", inst->p, inst->q); break;
+  case OP_LV_LC_AD: sprintf(s,"LV_LC_AD %d,%d", inst->p, inst->q); break;
+  case OP_LA_LC_ST: sprintf(s,"LA_LC_ST %d,%d", inst->p, inst->q); break;
+  case OP_LA_LV_ST: sprintf(s,"LA_LV_ST %d,%d", inst->p, inst->q); break;
+  case OP_LC_ML_AD: sprintf(s,"LC_ML_AD %d", inst->q); break;
+  case OP_EQ_FJ: sprintf(s,"EQ_FJ"); break;
+  case OP_NE_FJ: sprintf(s,"NE_FJ"); break;
+  case OP_GT_FJ: sprintf(s,"GT_FJ"); break;
+  case OP_LT_FJ: sprintf(s,"LT_FJ"); break;
+  case OP_GE_FJ: sprintf(s,"GE_FJ"); break;
+  case OP_LE_FJ: sprintf(s,"LE_FJ"); break;
+  case OP_INC: sprintf(s,"INC"); break;
+  default: break;
+  }
+}
+
+void printCodeBlock(CodeBlock* codeBlock) {
+  Instruction* pc = codeBlock->code;
+  int i;
+  for (i = 0 ; i < codeBlock->codeSize; i ++) {
+    printf("%d:  ",i);
+    printInstruction(pc);
+    printf("\n");
+    pc ++;
+  }
+}
+
+int instructionLength(enum OpCode op) {
+  int i;
+  for (i = 0; i < NUM_OF_SUPERINSTRUCTIONS; i ++)
+    if (superinstructions[i].op == op)
+      return superinstructions[i].length;
+  return 1;
+}
+
+// First instruction of the sequence a superinstruction was fused from
+enum OpCode unfusedOpcode(enum OpCode op) {
+  int i;
+  for (i = 0; i < NUM_OF_SUPERINSTRUCTIONS; i ++)
+    if (superinstructions[i].op == op)
+      return superinstructions[i].ops[0];
+  return op;
+}
+
+int matchSuperinstruction(Superinstruction* super, Instruction* code, char* leader, int remaining) {
+  int i;
+
+  if (super->length > remaining) return 0;
+  for (i = 0; i < super->length; i ++) {
+    if (code[i].op != super->ops[i]) return 0;
+    // Nothing may jump into the middle of a fused sequence
+    if ((i > 0) && leader[i]) return 0;
+  }
+  return 1;
+}
+
+/*
+ * Replaces instruction sequences with superinstructions, choosing the
+ * fusion that leaves the fewest dispatches in every stretch of code.
+ * Addresses do not change, so jump targets stay valid.
+ */
+void fuseCode(CodeBlock* codeBlock) {
+  Instruction* code = codeBlock->code;
+  int n = codeBlock->codeSize;
+  char* leader = (char*) calloc(n + 1, 1);
+  int* cost = (int*) malloc((n + 1) * sizeof(int));
+  int* choice = (int*) malloc((n + 1) * sizeof(int));
+  int i, k, c;
+
+#ifdef MAPPED_CODE
+  // Fusion only dirties private copies of the pages it changes
+  if (codeBlock->mapped)
+    mprotect(codeBlock->image, codeBlock->imageSize, PROT_READ | PROT_WRITE);
+#endif
+
+  leader[codeBlock->entry] = 1;
+  for (i = 0; i < n; i ++)
+    switch (code[i].op) {
+    case OP_J:
+    case OP_FJ:
+    case OP_CALL:
+    case OP_TC:
+      if ((code[i].q >= 0) && (code[i].q < n))
+	leader[code[i].q] = 1;
+      break;
+    default:
+      break;
+    }
+
+  // cost[i]: fewest dispatches for code[i..n-1]; choice[i]: what starts at i
+  cost[n] = 0;
+  for (i = n - 1; i >= 0; i --) {
+    cost[i] = cost[i + 1] + 1;
+    choice[i] = -1;
+    for (k = 0; k < NUM_OF_SUPERINSTRUCTIONS; k ++)
+      if (matchSuperinstruction(superinstructions + k, code + i, leader + i, n - i)) {
+	c = cost[i + superinstructions[k].length] + 1;
+	if (c < cost[i]) {
+	  cost[i] = c;
+	  choice[i] = k;
+	}
+      }
+  }
+
+  i = 0;
+  while (i < n) {
+    if (choice[i] < 0)
+      i ++;
+    else {
+      code[i].op = superinstructions[choice[i]].op;
+      i += superinstructions[choice[i]].length;
+    }
+  }
+
+  free(leader);
+  free(cost);
+  free(choice);
+}
+
+// Frees whatever holds the code of the block
+static void releaseCode(CodeBlock* codeBlock) {
+  if (codeBlock->image == NULL)
+    free(codeBlock->code);
+#ifdef MAPPED_CODE
+  else if (codeBlock->mapped)
+    munmap(codeBlock->image, codeBlock->imageSize);
+#endif
+  else free(codeBlock->image);
+  if (codeBlock->maxConstants > 0)
+    free(codeBlock->constants);
+  codeBlock->constants = NULL;
+  codeBlock->maxConstants = 0;
+  codeBlock->code = NULL;
+  codeBlock->image = NULL;
+  codeBlock->mapped = 0;
+}
+
+// Maps a regular file, or else reads the whole stream
+static char* readImage(FILE* f, long* size, int* mapped) {
+  char* image;
+  long capacity = 4096;
+  size_t n;
+#ifdef MAPPED_CODE
+  struct stat st;
+
+  if ((fstat(fileno(f), &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+    image = (char*) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    if (image != MAP_FAILED) {
+      *size = st.st_size;
+      *mapped = 1;
+      return image;
+    }
+  }
+#endif
+
+  *size = 0;
+  *mapped = 0;
+  image = (char*) malloc(capacity);
+  while ((n = fread(image + *size, 1, capacity - *size, f)) > 0) {
+    *size += n;
+    if (*size == capacity) {
+      capacity *= 2;
+      image = (char*) realloc(image, capacity);
+    }
+  }
+  if (ferror(f)) {
+    free(image);
+    return NULL;
+  }
+  return image;
+}
+
+static LoadCode checkHeader(ExecutableHeader* header, int instructionSize) {
+  if ((header->version != EXECUTABLE_VERSION) || (header->instructionSize != instructionSize))
+    return LOAD_BAD_VERSION;
+  if ((header->codeLength < 0) || (header->codeLength > MAX_CODE_LENGTH)
+      || (header->constantCount < 0) || (header->constantCount > MAX_CODE_LENGTH))
+    return LOAD_OVERSIZED;
+  if ((header->entry < 0) || (header->entry >= header->codeLength))
+    return LOAD_INVALID_ENTRY;
+  return LOAD_OK;
+}
+
+// Decodes a compact image into a fixed-format one that replaces it
+static LoadCode decodeImage(CodeBlock* codeBlock) {
+  ExecutableHeader* header = (ExecutableHeader*) codeBlock->image;
+  WORD* constants = (WORD*) (header + 1);
+  unsigned char* bytes;
+  long length;
+  long codeBytes;
+  char* image;
+  int used;
+  LoadCode result;
+
+  result = checkHeader(header, 0);
+  if (result != LOAD_OK)
+    return result;
+  bytes = (unsigned char*) (constants + header->constantCount);
+  length = codeBlock->imageSize - ((char*) bytes - codeBlock->image);
+  if (length < 0)
+    return LOAD_TRUNCATED;
+
+  codeBytes = (long) header->codeLength * sizeof(Instruction);
+  image = (char*) malloc(codeBytes + header->constantCount * sizeof(WORD));
+  used = decodeCompact(bytes, length, (Instruction*) image, header->codeLength);
+  if (used != length) {
+    free(image);
+    return (used < 0) ? LOAD_MALFORMED : LOAD_OVERSIZED;
+  }
+  memcpy(image + codeBytes, constants, header->constantCount * sizeof(WORD));
+
+  codeBlock->codeSize = header->codeLength;
+  codeBlock->entry = header->entry;
+  codeBlock->constantCount = header->constantCount;
+  releaseCode(codeBlock);
+  codeBlock->image = image;
+  codeBlock->imageSize = codeBytes + codeBlock->constantCount * sizeof(WORD);
+  codeBlock->code = (Instruction*) image;
+  codeBlock->constants = (WORD*) (image + codeBytes);
+  return LOAD_OK;
+}
+
+static LoadCode checkImage(CodeBlock* codeBlock) {
+  ExecutableHeader* header = (ExecutableHeader*) codeBlock->image;
+  long size = codeBlock->imageSize;
+  long expected;
+  LoadCode result;
+
+  if ((size >= (long) sizeof(ExecutableHeader))
+      && (memcmp(header->magic, EXECUTABLE_COMPACT_MAGIC, 4) == 0))
+    return decodeImage(codeBlock);
+
+  if ((size < (long) sizeof(ExecutableHeader))
+      || (memcmp(header->magic, EXECUTABLE_MAGIC, 4) != 0)) {
+    // Headerless: whole instructions, as many as the block was made for
+    if (size % sizeof(Instruction) != 0)
+      return LOAD_TRUNCATED;
+    if (size / sizeof(Instruction) > (unsigned long) codeBlock->maxSize)
+      return LOAD_OVERSIZED;
+    codeBlock->code = (Instruction*) codeBlock->image;
+    codeBlock->codeSize = size / sizeof(Instruction);
+    return LOAD_OK;
+  }
+
+  result = checkHeader(header, sizeof(Instruction));
+  if (result != LOAD_OK)
+    return result;
+  expected = sizeof(ExecutableHeader) + (long) header->codeLength * sizeof(Instruction)
+    + (long) header->constantCount * sizeof(WORD);
+  if (size < expected)
+    return LOAD_TRUNCATED;
+  if (size > expected)
+    return LOAD_OVERSIZED;
+
+  codeBlock->code = (Instruction*) (header + 1);
+  codeBlock->codeSize = header->codeLength;
+  codeBlock->entry = header->entry;
+  codeBlock->constants = (WORD*) (codeBlock->code + header->codeLength);
+  codeBlock->constantCount = header->constantCount;
+  return LOAD_OK;
+}
+
+LoadCode loadCode(CodeBlock* codeBlock, FILE* f) {
+  LoadCode result;
+
+  releaseCode(codeBlock);
+  codeBlock->codeSize = 0;
+  codeBlock->entry = 0;
+  codeBlock->constants = NULL;
+  codeBlock->constantCount = 0;
+  codeBlock->image = readImage(f, &codeBlock->imageSize, &codeBlock->mapped);
+  if (codeBlock->image == NULL)
+    return LOAD_IO_ERROR;
+
+  result = checkImage(codeBlock);
+  if (result != LOAD_OK)
+    codeBlock->codeSize = 0;
+  return result;
+}
+
+char* loadMessage(LoadCode code) {
+  switch (code) {
+  case LOAD_OK: return "ok";
+  case LOAD_IO_ERROR: return "cannot read the executable";
+  case LOAD_BAD_VERSION: return "unsupported executable version";
+  case LOAD_TRUNCATED: return "truncated executable";
+  case LOAD_OVERSIZED: return "executable larger than its header or the code size";
+  case LOAD_INVALID_ENTRY: return "entry point outside the code";
+  case LOAD_MALFORMED: return "malformed compact code";
+  default: return "unknown error";
+  }
+}
+
+int saveCode(CodeBlock* codeBlock, FILE* f) {
+  ExecutableHeader header;
+
+  memcpy(header.magic, EXECUTABLE_MAGIC, 4);
+  header.version = EXECUTABLE_VERSION;
+  header.instructionSize = sizeof(Instruction);
+  header.codeLength = codeBlock->codeSize;
+  header.entry = codeBlock->entry;
+  header.constantCount = codeBlock->constantCount;
+  return (fwrite(&header, sizeof(header), 1, f) == 1)
+    && (fwrite(codeBlock->code, sizeof(Instruction), codeBlock->codeSize, f) == (size_t) codeBlock->codeSize)
+    && (fwrite(codeBlock->constants, sizeof(WORD), codeBlock->constantCount, f) == (size_t) codeBlock->constantCount);
+}
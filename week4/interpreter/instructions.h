@@ -1,117 +1,291 @@
-/* 
- * @copyright (c) 2008, Hedspi, Hanoi University of Technology
- * @author Huu-Duc Nguyen
- * @version 1.0
- */
-
-#ifndef __INSTRUCTIONS_H__
-#define __INSTRUCTIONS_H__
-
-#include <stdio.h>
-
-#define TRUE 1
-#define FALSE 0
-#define DC_VALUE 0
-#define INT_SIZE 1
-#define CHAR_SIZE 1
-
-typedef int WORD;
-
-enum OpCode {
-  OP_LA,   // Load Address:    t := t + 1; s[t] := base(p) + q;
-  OP_LV,   // Load Value:      t := t + 1; s[t] := s[base(p) + q];
-  OP_LC,   // load Constant    t := t + 1; s[t] := q;
-  OP_LI,   // Load Indirect    s[t] := s[s[t]];
-  OP_INT,  // Increment t      t := t + q;
-  OP_DCT,  // Decrement t      t := t - q;
-  OP_J,    // Jump             pc := q;
-  OP_FJ,   // False Jump       if s[t] = 0 then pc := q; t := t - 1;
-  OP_HL,   // Halt             Halt
-  OP_ST,   // Store            s[s[t-1]] := s[t]; t := t -2;
-  OP_CALL, // Call             s[t+2] := b; s[t+3] := pc; s[t+4]:= base(p); b:=t+1; pc:=q;
-  OP_EP,   // Exit Procedure   t := b - 1;  pc := s[b+2];  b := s[b+1];
-  OP_EF,   // Exit Function    t := b;  pc := s[b+2];  b := s[b+1];
-  OP_RC,   // Read Char        read one character into s[s[t]];  t := t - 1;
-  OP_RI,   // Read Integer     read integer to s[s[t]];  t := t-1;
-  OP_WRC,  // Write Char       write one character from s[t];  t := t-1;
-  OP_WRI,  // Write Int        write integer from s[t];  t := t-1;
-  OP_WLN,  // WriteLN          CR/LF
-  OP_AD,   // Add              t := t-1;  s[t] := s[t] + s[t+1];
-  OP_SB,   // Substract        t := t-1;  s[t] := s[t] - s[t+1];
-  OP_ML,   // Multiple         t := t-1;  s[t] := s[t] * s[t+1];
-  OP_DV,   // Divide           t := t-1;  s[t] := s[t] / s[t+1];
-  OP_NEG,  // Negative         s[t] := - s[t];
-  OP_CV,   // Copy Top         s[t+1] := s[t]; t := t + 1;
-  OP_EQ,   // Equal            t := t - 1;  if s[t] = s[t+1] then s[t] := 1 else s[t] := 0;
-  OP_NE,   // Not Equal        t := t - 1;  if s[t] != s[t+1] then s[t] := 1 else s[t] := 0;
-  OP_GT,   // Greater          t := t - 1;  if s[t] > s[t+1] then s[t] := 1 else s[t] := 0;
-  OP_LT,   // Less             t := t - 1;  if s[t] < s[t+1] then s[t] := 1 else s[t] := 0;
-  OP_GE,   // Greater or Equal t := t - 1;  if s[t] >= s[t+1] then s[t] := 1 else s[t] := 0;
-  OP_LE,   // Less or Equal    t := t - 1;  if s[t] >= s[t+1] then s[t] := 1 else s[t] := 0;
-
-  OP_BP    // Break point. Just for debugging
-};
-
-struct Instruction_ {
-  enum OpCode op;
-  WORD p;
-  WORD q;
-};
-
-typedef struct Instruction_ Instruction;
-typedef int CodeAddress;
-
-struct CodeBlock_ {
-  Instruction* code;
-  int codeSize;
-  int maxSize;
-};
-
-typedef struct CodeBlock_ CodeBlock;
-
-CodeBlock* createCodeBlock(int maxSize);
-void freeCodeBlock(CodeBlock* codeBlock);
-
-int emitCode(CodeBlock* codeBlock, enum OpCode op, WORD p, WORD q);
-
-int emitLA(CodeBlock* codeBlock, WORD p, WORD q);
-int emitLV(CodeBlock* codeBlock, WORD p, WORD q);
-int emitLC(CodeBlock* codeBlock, WORD q);
-int emitLI(CodeBlock* codeBlock);
-int emitINT(CodeBlock* codeBlock, WORD q);
-int emitDCT(CodeBlock* codeBlock, WORD q);
-int emitJ(CodeBlock* codeBlock, WORD q);
-int emitFJ(CodeBlock* codeBlock, WORD q);
-int emitHL(CodeBlock* codeBlock);
-int emitST(CodeBlock* codeBlock);
-int emitCALL(CodeBlock* codeBlock, WORD p, WORD q);
-int emitEP(CodeBlock* codeBlock);
-int emitEF(CodeBlock* codeBlock);
-int emitRC(CodeBlock* codeBlock);
-int emitRI(CodeBlock* codeBlock);
-int emitWRC(CodeBlock* codeBlock);
-int emitWRI(CodeBlock* codeBlock);
-int emitWLN(CodeBlock* codeBlock);
-int emitAD(CodeBlock* codeBlock);
-int emitSB(CodeBlock* codeBlock);
-int emitML(CodeBlock* codeBlock);
-int emitDV(CodeBlock* codeBlock);
-int emitNEG(CodeBlock* codeBlock);
-int emitCV(CodeBlock* codeBlock);
-int emitEQ(CodeBlock* codeBlock);
-int emitNE(CodeBlock* codeBlock);
-int emitGT(CodeBlock* codeBlock);
-int emitLT(CodeBlock* codeBlock);
-int emitGE(CodeBlock* codeBlock);
-int emitLE(CodeBlock* codeBlock);
-
-int emitBP(CodeBlock* codeBlock);
-
-void sprintInstruction(char *buffer,Instruction* instruction);
-void printInstruction(Instruction* instruction);
-void printCodeBlock(CodeBlock* codeBlock);
-
-void loadCode(CodeBlock* codeBlock, FILE* f);
-void saveCode(CodeBlock* codeBlock, FILE* f);
-
-#endif
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __INSTRUCTIONS_H__
+#define __INSTRUCTIONS_H__
+
+#include <stdio.h>
+
+#define TRUE 1
+#define FALSE 0
+#define DC_VALUE 0
+#define INT_SIZE 1
+#define CHAR_SIZE 1
+
+typedef int WORD;
+
+/*
+ * A word of the VM stack, which holds every value a program computes.
+ * Code and executables always use WORD, so the same executables run
+ * whatever the cells.  Built with WIDE_CELLS, cells are 64 bits and the
+ * arithmetic that overflows them stops the program; otherwise they are
+ * WORDs and wrap around as they always have.
+ */
+#ifdef WIDE_CELLS
+typedef long long CELL;
+typedef unsigned long long UCELL;
+#define CELL_FORMAT "%lld"
+#else
+typedef WORD CELL;
+typedef unsigned int UCELL;
+#define CELL_FORMAT "%d"
+#endif
+
+enum OpCode {
+  OP_LA,   // Load Address:    t := t + 1; s[t] := base(p) + q;
+  OP_LV,   // Load Value:      t := t + 1; s[t] := s[base(p) + q];
+  OP_LC,   // load Constant    t := t + 1; s[t] := q;
+  OP_LI,   // Load Indirect    s[t] := s[s[t]];
+  OP_INT,  // Increment t      t := t + q;
+  OP_DCT,  // Decrement t      t := t - q;
+  OP_J,    // Jump             pc := q;
+  OP_FJ,   // False Jump       if s[t] = 0 then pc := q; t := t - 1;
+  OP_HL,   // Halt             Halt
+  OP_ST,   // Store            s[s[t-1]] := s[t]; t := t -2;
+  OP_CALL, // Call             s[t+2] := b; s[t+3] := pc; s[t+4]:= base(p); b:=t+1; pc:=q;
+  OP_EP,   // Exit Procedure   t := b - 1;  pc := s[b+2];  b := s[b+1];
+  OP_EF,   // Exit Function    t := b;  pc := s[b+2];  b := s[b+1];
+  OP_RC,   // Read Char        read one character into s[s[t]];  t := t - 1;
+  OP_RI,   // Read Integer     read integer to s[s[t]];  t := t-1;
+  OP_WRC,  // Write Char       write one character from s[t];  t := t-1;
+  OP_WRI,  // Write Int        write integer from s[t];  t := t-1;
+  OP_WLN,  // WriteLN          CR/LF
+  OP_AD,   // Add              t := t-1;  s[t] := s[t] + s[t+1];
+  OP_SB,   // Substract        t := t-1;  s[t] := s[t] - s[t+1];
+  OP_ML,   // Multiple         t := t-1;  s[t] := s[t] * s[t+1];
+  OP_DV,   // Divide           t := t-1;  s[t] := s[t] / s[t+1];
+  OP_NEG,  // Negative         s[t] := - s[t];
+  OP_CV,   // Copy Top         s[t+1] := s[t]; t := t + 1;
+  OP_EQ,   // Equal            t := t - 1;  if s[t] = s[t+1] then s[t] := 1 else s[t] := 0;
+  OP_NE,   // Not Equal        t := t - 1;  if s[t] != s[t+1] then s[t] := 1 else s[t] := 0;
+  OP_GT,   // Greater          t := t - 1;  if s[t] > s[t+1] then s[t] := 1 else s[t] := 0;
+  OP_LT,   // Less             t := t - 1;  if s[t] < s[t+1] then s[t] := 1 else s[t] := 0;
+  OP_GE,   // Greater or Equal t := t - 1;  if s[t] >= s[t+1] then s[t] := 1 else s[t] := 0;
+  OP_LE,   // Less or Equal    t := t - 1;  if s[t] >= s[t+1] then s[t] := 1 else s[t] := 0;
+
+  OP_BP,   // Break point. Just for debugging
+
+  // Doubles and strings.  A double takes DOUBLE_SIZE cells, d[x] below is
+  // the double in s[x] and s[x+1]; a string is one cell holding a string
+  // handle (see STRING_WORDS).  c[q] is the constant pool of the block.
+  OP_LCF,  // Load Double      t := t + 2; d[t-1] := c[q], c[q+1];
+  OP_LVF,  // Load Double Var  t := t + 2; d[t-1] := d[base(p) + q];
+  OP_LIF,  // Double Indirect  d[t] := d[s[t]]; t := t + 1;
+  OP_STF,  // Store Double     d[s[t-2]] := d[t-1]; t := t - 3;
+  OP_ITF,  // Int To Double    d[t] := s[t]; t := t + 1;
+  OP_ADF,  // Add Double       t := t - 2; d[t-1] := d[t-1] + d[t+1];
+  OP_SBF,  // Sub Double       t := t - 2; d[t-1] := d[t-1] - d[t+1];
+  OP_MLF,  // Mult Double      t := t - 2; d[t-1] := d[t-1] * d[t+1];
+  OP_DVF,  // Div Double       t := t - 2; d[t-1] := d[t-1] / d[t+1];
+  OP_NEGF, // Neg Double       d[t-1] := - d[t-1];
+  OP_EQF,  // Equal Double     t := t - 3; s[t] := d[t] = d[t+2];
+  OP_NEF,  //                  t := t - 3; s[t] := d[t] != d[t+2];
+  OP_GTF,  //                  t := t - 3; s[t] := d[t] > d[t+2];
+  OP_LTF,  //                  t := t - 3; s[t] := d[t] < d[t+2];
+  OP_GEF,  //                  t := t - 3; s[t] := d[t] >= d[t+2];
+  OP_LEF,  //                  t := t - 3; s[t] := d[t] <= d[t+2];
+  OP_WRF,  // Write Double     write the double d[t-1];  t := t - 2;
+  OP_EFF,  // Exit Double Fn   as OP_EF, with the result d[b+q] left in d[b]; t := b + 1;
+  OP_LS,   // Load String      t := t + 1; s[t] := the string at c[q];
+  OP_CAT,  // Concatenate      t := t - 1; s[t] := s[t] + s[t+1], a new string;
+  OP_CMPS, // Compare Strings  t := t - 1; s[t] := -1, 0 or 1 as s[t] <, = or > s[t+1];
+  OP_WRS,  // Write String     write the string s[t];  t := t - 1;
+
+  // A call the caller would return from right away, to a procedure on its
+  // own level: the callee takes over the frame, and returns to the caller's
+  // caller.  The p words of arguments are on the top, above a frame header.
+  OP_TC,   // Tail Call        s[b+4 .. b+3+p] := s[t-p+1 .. t]; t := b - 1; pc := q;
+
+  // Superinstructions.  They never appear in executables: fuseCode() makes
+  // them at load time from the sequences in their names.  A fused sequence
+  // keeps all its slots; the first one gets the new opcode, the others keep
+  // their operands and are skipped over.
+  OP_LC_AD,     // LC c; AD                  s[t] := s[t] + c;
+  OP_CV_LI,     // CV; LI                    s[t+1] := s[s[t]]; t := t + 1;
+  OP_LV_LC,     // LV p,q; LC c              push s[base(p) + q]; push c;
+  OP_LV_LC_AD,  // LV p,q; LC c; AD          push s[base(p) + q] + c;
+  OP_LA_LC_ST,  // LA p,q; LC c; ST          s[base(p) + q] := c;
+  OP_LA_LV_ST,  // LA p,q; LV p',q'; ST      s[base(p) + q] := s[base(p') + q'];
+  OP_LC_ML_AD,  // LC c; ML; AD              t := t - 1; s[t] := s[t] + s[t+1] * c;
+  OP_EQ_FJ,     // EQ; FJ l                  t := t - 2; if s[t+1] != s[t+2] then pc := l;
+  OP_NE_FJ,     // NE; FJ l
+  OP_GT_FJ,     // GT; FJ l
+  OP_LT_FJ,     // LT; FJ l
+  OP_GE_FJ,     // GE; FJ l
+  OP_LE_FJ,     // LE; FJ l
+  OP_INC        // CV; CV; LI; LC c; AD; ST  s[s[t]] := s[s[t]] + c;
+};
+
+#define NUM_OF_OPCODES (OP_INC + 1)
+#define LAST_EXECUTABLE_OPCODE OP_TC
+
+/*
+ * The constant pool holds doubles as DOUBLE_SIZE words, and strings as
+ * records: the length, then the characters and a NUL packed into words,
+ * the rest of the last word zero.  The handle of a pool string is the
+ * index of its record; running programs also make strings of their own,
+ * whose handles are negative (see heap.h).
+ */
+#define DOUBLE_SIZE 2
+#define STRING_WORDS(length) (1 + ((length) + (int) sizeof(WORD)) / (int) sizeof(WORD))
+#define STRING_CHARS(record) ((char*) ((record) + 1))
+
+union DoubleWords_ {
+  double value;
+  WORD words[DOUBLE_SIZE];
+};
+
+typedef union DoubleWords_ DoubleWords;
+
+struct Instruction_ {
+  enum OpCode op;
+  WORD p;
+  WORD q;
+};
+
+typedef struct Instruction_ Instruction;
+typedef int CodeAddress;
+
+struct CodeBlock_ {
+  Instruction* code;
+  int codeSize;
+  int maxSize;
+  int entry;                    // where the main program starts
+  WORD* constants;
+  int constantCount;
+  int maxConstants;             // room in constants, when the block owns them
+  // A loaded block runs in place from the image of its executable
+  char* image;
+  long imageSize;
+  int mapped;                   // the image is a read-only mapping
+};
+
+typedef struct CodeBlock_ CodeBlock;
+
+/*
+ * Executable format: the header below, then codeLength instructions, then
+ * constantCount words of the constant pool, in the byte order of the host.
+ * The file ends right after the constant pool.  A compact executable (see
+ * compact.h) has its own magic number, an instructionSize of 0, and the
+ * constant pool before the code, which runs to the end of the file.  A
+ * file with neither magic number is taken as the headerless format of
+ * earlier versions, which is instructions only.
+ */
+#define EXECUTABLE_MAGIC "KPLX"
+#define EXECUTABLE_COMPACT_MAGIC "KPLC"
+#define EXECUTABLE_VERSION 1
+#define MAX_CODE_LENGTH (1 << 24)
+
+struct ExecutableHeader_ {
+  char magic[4];
+  WORD version;
+  WORD instructionSize;         // sizeof(Instruction) of the writer
+  WORD codeLength;
+  WORD entry;
+  WORD constantCount;
+};
+
+typedef struct ExecutableHeader_ ExecutableHeader;
+
+typedef enum {
+  LOAD_OK,
+  LOAD_IO_ERROR,
+  LOAD_BAD_VERSION,
+  LOAD_TRUNCATED,
+  LOAD_OVERSIZED,
+  LOAD_INVALID_ENTRY,
+  LOAD_MALFORMED
+} LoadCode;
+
+CodeBlock* createCodeBlock(int maxSize);
+void freeCodeBlock(CodeBlock* codeBlock);
+
+int emitCode(CodeBlock* codeBlock, enum OpCode op, WORD p, WORD q);
+
+int emitLA(CodeBlock* codeBlock, WORD p, WORD q);
+int emitLV(CodeBlock* codeBlock, WORD p, WORD q);
+int emitLC(CodeBlock* codeBlock, WORD q);
+int emitLI(CodeBlock* codeBlock);
+int emitINT(CodeBlock* codeBlock, WORD q);
+int emitDCT(CodeBlock* codeBlock, WORD q);
+int emitJ(CodeBlock* codeBlock, WORD q);
+int emitFJ(CodeBlock* codeBlock, WORD q);
+int emitHL(CodeBlock* codeBlock);
+int emitST(CodeBlock* codeBlock);
+int emitCALL(CodeBlock* codeBlock, WORD p, WORD q);
+int emitEP(CodeBlock* codeBlock);
+int emitEF(CodeBlock* codeBlock);
+int emitRC(CodeBlock* codeBlock);
+int emitRI(CodeBlock* codeBlock);
+int emitWRC(CodeBlock* codeBlock);
+int emitWRI(CodeBlock* codeBlock);
+int emitWLN(CodeBlock* codeBlock);
+int emitAD(CodeBlock* codeBlock);
+int emitSB(CodeBlock* codeBlock);
+int emitML(CodeBlock* codeBlock);
+int emitDV(CodeBlock* codeBlock);
+int emitNEG(CodeBlock* codeBlock);
+int emitCV(CodeBlock* codeBlock);
+int emitEQ(CodeBlock* codeBlock);
+int emitNE(CodeBlock* codeBlock);
+int emitGT(CodeBlock* codeBlock);
+int emitLT(CodeBlock* codeBlock);
+int emitGE(CodeBlock* codeBlock);
+int emitLE(CodeBlock* codeBlock);
+
+int emitBP(CodeBlock* codeBlock);
+
+int emitLCF(CodeBlock* codeBlock, WORD q);
+int emitLVF(CodeBlock* codeBlock, WORD p, WORD q);
+int emitLIF(CodeBlock* codeBlock);
+int emitSTF(CodeBlock* codeBlock);
+int emitITF(CodeBlock* codeBlock);
+int emitADF(CodeBlock* codeBlock);
+int emitSBF(CodeBlock* codeBlock);
+int emitMLF(CodeBlock* codeBlock);
+int emitDVF(CodeBlock* codeBlock);
+int emitNEGF(CodeBlock* codeBlock);
+int emitEQF(CodeBlock* codeBlock);
+int emitNEF(CodeBlock* codeBlock);
+int emitGTF(CodeBlock* codeBlock);
+int emitLTF(CodeBlock* codeBlock);
+int emitGEF(CodeBlock* codeBlock);
+int emitLEF(CodeBlock* codeBlock);
+int emitWRF(CodeBlock* codeBlock);
+int emitEFF(CodeBlock* codeBlock, WORD q);
+int emitLS(CodeBlock* codeBlock, WORD q);
+int emitCAT(CodeBlock* codeBlock);
+int emitCMPS(CodeBlock* codeBlock);
+int emitWRS(CodeBlock* codeBlock);
+int emitTC(CodeBlock* codeBlock, WORD p, WORD q);
+
+/*
+ * Put a constant in the pool of the block and return its index, for
+ * OP_LCF and OP_LS.  Equal constants share their words, so equal strings
+ * get the same handle.  -1 when the pool is full.
+ */
+int addDoubleConstant(CodeBlock* codeBlock, double value);
+int addStringConstant(CodeBlock* codeBlock, char* s);
+
+void sprintInstruction(char *buffer,Instruction* instruction);
+void printInstruction(Instruction* instruction);
+void printCodeBlock(CodeBlock* codeBlock);
+
+int instructionLength(enum OpCode op);
+enum OpCode unfusedOpcode(enum OpCode op);
+void fuseCode(CodeBlock* codeBlock);
+
+/*
+ * Replaces the code of the block with the executable in f.  The file is
+ * mapped, not read, when it can be; the block then holds no copy of it,
+ * unless it is compact and has to be decoded.
+ * A headerless executable may not hold more than maxSize instructions.
+ */
+LoadCode loadCode(CodeBlock* codeBlock, FILE* f);
+char* loadMessage(LoadCode code);
+int saveCode(CodeBlock* codeBlock, FILE* f);
+
+#endif
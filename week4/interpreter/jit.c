@@ -0,0 +1,924 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+
+#include "jit.h"
+#include "verifier.h"
+
+// The compiled code works on WORD cells
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)) \
+  && !defined(WIDE_CELLS)
+#define JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+/*
+ * Template JIT for x86-64.
+ *
+ * Every instruction is translated by a fixed template, but the templates
+ * do not push and pop the VM stack one word at a time: inside a basic
+ * block the top words of the stack are kept in a small cache of constants
+ * and machine registers, and they are written to the stack only when the
+ * block ends, when a call or an I/O routine needs them, or when the cache
+ * is full.  At every leader (jump and call target, return address) the
+ * cache is empty and the stack is exactly what the interpreter would have,
+ * so control can pass between compiled code and the interpreter there.
+ *
+ * The frame layout, the display and the saved display links are the ones
+ * of the interpreter.  Register use:
+ *
+ *   rbx  stack             r12  t, less the cached words
+ *   rbp  JitState          r13  b
+ *   r14  disp              r15  link
+ *   r11  scratch           rax, rcx, rdx, rsi, rdi, r8-r10  cache
+ */
+
+#ifdef JIT_SUPPORTED
+
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RBX 3
+#define RSP 4
+#define RBP 5
+#define RSI 6
+#define RDI 7
+#define R8  8
+#define R9  9
+#define R10 10
+#define R11 11
+#define R12 12
+#define R13 13
+#define R14 14
+#define R15 15
+
+#define NO_INDEX -1
+#define SCALE_WORD 2          // log2(sizeof(WORD))
+#define SCALE_POINTER 3       // log2(sizeof(void*))
+
+// Condition codes
+#define CC_E  0x4
+#define CC_NE 0x5
+#define CC_L  0xC
+#define CC_GE 0xD
+#define CC_LE 0xE
+#define CC_G  0xF
+#define CC_ALWAYS -1
+#define CC_NEVER  -2
+
+// Extensions of the 0x81/0x83 group
+#define ALU_ADD 0
+#define ALU_SUB 5
+#define ALU_CMP 7
+
+#define MAX_CACHED 8
+#define MIN_FREE_REGS 3       // enough for the operands and result of any template
+#define MAX_TEMPLATE 256      // bytes of machine code for one instruction at most
+#define STUB_SIZE 256         // entry, exit and resume stubs
+#define MAX_LEVEL (1 << 20)
+#define MAX_TAIL_WORDS 12     // arguments a tail call template copies
+
+#define CACHE_CONST 0
+#define CACHE_REG 1
+
+struct CacheEntry_ {
+  int kind;
+  WORD value;               // the constant or the register holding the word
+};
+
+typedef struct CacheEntry_ CacheEntry;
+
+struct JitCode_ {
+  unsigned char* memory;
+  size_t size;
+  void** entries;           // machine code address of every leader
+  void* resume;             // the other entries: go back to the interpreter
+  int codeSize;
+};
+
+static const int cacheRegs[] = { RAX, RCX, RDX, RSI, RDI, R8, R9, R10 };
+#define CACHE_REGS ((int) (sizeof(cacheRegs) / sizeof(cacheRegs[0])))
+
+// State of the compilation in progress, one per thread
+static __thread unsigned char* out;
+static __thread unsigned char* exitStub;
+static __thread CacheEntry cache[MAX_CACHED];
+static __thread int cached;
+static __thread int freeRegs;
+
+static __thread unsigned char** fixupFields;
+static __thread int* fixupTargets;
+static __thread int fixupCount;
+
+/************************** Encoding *****************************/
+
+static void emitByte(int byte) {
+  *out++ = (unsigned char) byte;
+}
+
+static void emitInt32(int value) {
+  memcpy(out, &value, 4);
+  out += 4;
+}
+
+static void emitPointer(void* value) {
+  memcpy(out, &value, 8);
+  out += 8;
+}
+
+// Opcodes above 0xFF are the two-byte ones
+static void emitOpcode(int op) {
+  if (op > 0xFF) emitByte(op >> 8);
+  emitByte(op & 0xFF);
+}
+
+// force is needed to reach sil and dil as byte registers
+static void emitRex(int w, int reg, int index, int base, int force) {
+  int rex = 0x40 | (w << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+  if ((rex != 0x40) || force) emitByte(rex);
+}
+
+// op reg, rm with rm a register
+static void opReg(int w, int op, int reg, int rm) {
+  emitRex(w, reg, 0, rm, 0);
+  emitOpcode(op);
+  emitByte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// The same on byte registers
+static void opRegByte(int op, int reg, int rm) {
+  emitRex(0, reg, 0, rm, (reg >= RSP) || (rm >= RSP));
+  emitOpcode(op);
+  emitByte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// op reg, [base + (index << scale) + disp]
+static void opMem(int w, int op, int reg, int base, int index, int scale, int disp) {
+  int mod = ((disp >= -128) && (disp <= 127)) ? 0x40 : 0x80;
+
+  emitRex(w, reg, (index == NO_INDEX) ? 0 : index, base, 0);
+  emitOpcode(op);
+  if ((index == NO_INDEX) && ((base & 7) != RSP))
+    emitByte(mod | ((reg & 7) << 3) | (base & 7));
+  else {
+    emitByte(mod | ((reg & 7) << 3) | 4);
+    if (index == NO_INDEX)
+      emitByte(0x20 | (base & 7));
+    else emitByte((scale << 6) | ((index & 7) << 3) | (base & 7));
+  }
+  if (mod == 0x40) emitByte(disp);
+  else emitInt32(disp);
+}
+
+static void movImm(int reg, WORD value) {
+  emitRex(0, 0, 0, reg, 0);
+  emitByte(0xB8 + (reg & 7));
+  emitInt32(value);
+}
+
+static void movPointer(int reg, void* value) {
+  emitRex(1, 0, 0, reg, 0);
+  emitByte(0xB8 + (reg & 7));
+  emitPointer(value);
+}
+
+static void movReg(int dst, int src) {
+  opReg(0, 0x89, src, dst);
+}
+
+static void loadWord(int reg, int base, int index, int disp) {
+  opMem(0, 0x8B, reg, base, index, SCALE_WORD, disp);
+}
+
+static void storeWord(int reg, int base, int index, int disp) {
+  opMem(0, 0x89, reg, base, index, SCALE_WORD, disp);
+}
+
+static void storeImm(WORD value, int base, int index, int disp) {
+  opMem(0, 0xC7, 0, base, index, SCALE_WORD, disp);
+  emitInt32(value);
+}
+
+// movsxd: a word used as a stack index
+static void loadIndex(int reg, int base, int index, int disp) {
+  opMem(1, 0x63, reg, base, index, SCALE_WORD, disp);
+}
+
+static void signExtend(int dst, int src) {
+  opReg(1, 0x63, dst, src);
+}
+
+static void load64(int reg, int base, int disp) {
+  opMem(1, 0x8B, reg, base, NO_INDEX, 0, disp);
+}
+
+static void store64(int reg, int base, int disp) {
+  opMem(1, 0x89, reg, base, NO_INDEX, 0, disp);
+}
+
+// lea leaves the flags alone
+static void lea64(int reg, int base, int disp) {
+  opMem(1, 0x8D, reg, base, NO_INDEX, 0, disp);
+}
+
+static void aluImm(int w, int ext, int reg, int value) {
+  if ((value >= -128) && (value <= 127)) {
+    opReg(w, 0x83, ext, reg);
+    emitByte(value);
+  } else {
+    opReg(w, 0x81, ext, reg);
+    emitInt32(value);
+  }
+}
+
+static void emitCall(void* function) {
+  movPointer(RAX, function);
+  opReg(0, 0xFF, 2, RAX);
+}
+
+// Returns the rel32 field to patch
+static unsigned char* emitJump(int cc) {
+  if (cc == CC_ALWAYS) emitByte(0xE9);
+  else {
+    emitByte(0x0F);
+    emitByte(0x80 | cc);
+  }
+  emitInt32(0);
+  return out - 4;
+}
+
+static void patchJump(unsigned char* field, unsigned char* target) {
+  int rel = (int) (target - (field + 4));
+  memcpy(field, &rel, 4);
+}
+
+static void branchTo(int cc, int target) {
+  fixupFields[fixupCount] = emitJump(cc);
+  fixupTargets[fixupCount] = target;
+  fixupCount ++;
+}
+
+static void emitExit(int pc, int ps) {
+  storeImm(pc, RBP, NO_INDEX, offsetof(JitState, pc));
+  storeImm(ps, RBP, NO_INDEX, offsetof(JitState, ps));
+  patchJump(emitJump(CC_ALWAYS), exitStub);
+}
+
+/************************** Stack cache ****************************/
+
+static int allocReg(void) {
+  int i;
+
+  for (i = 0; i < CACHE_REGS; i ++)
+    if (freeRegs & (1 << cacheRegs[i])) {
+      freeRegs &= ~(1 << cacheRegs[i]);
+      return cacheRegs[i];
+    }
+  return -1;
+}
+
+static void releaseReg(int reg) {
+  freeRegs |= 1 << reg;
+}
+
+static int freeRegCount(void) {
+  int i, count = 0;
+
+  for (i = 0; i < CACHE_REGS; i ++)
+    if (freeRegs & (1 << cacheRegs[i])) count ++;
+  return count;
+}
+
+static void resetCache(void) {
+  int i;
+
+  cached = 0;
+  freeRegs = 0;
+  for (i = 0; i < CACHE_REGS; i ++)
+    freeRegs |= 1 << cacheRegs[i];
+}
+
+static void pushConst(WORD value) {
+  cache[cached].kind = CACHE_CONST;
+  cache[cached].value = value;
+  cached ++;
+}
+
+static void pushReg(int reg) {
+  cache[cached].kind = CACHE_REG;
+  cache[cached].value = reg;
+  cached ++;
+}
+
+// Writes the cached words to the stack
+static void flushCache(void) {
+  int i;
+
+  for (i = 0; i < cached; i ++)
+    if (cache[i].kind == CACHE_CONST)
+      storeImm(cache[i].value, RBX, R12, 4 * (i + 1));
+    else storeWord(cache[i].value, RBX, R12, 4 * (i + 1));
+  if (cached > 0)
+    lea64(R12, R12, cached);
+  resetCache();
+}
+
+static CacheEntry pop(void) {
+  CacheEntry entry;
+
+  if (cached > 0)
+    return cache[--cached];
+  entry.kind = CACHE_REG;
+  entry.value = allocReg();
+  loadWord(entry.value, RBX, R12, 0);
+  lea64(R12, R12, -1);
+  return entry;
+}
+
+static int inRegister(CacheEntry entry) {
+  int reg;
+
+  if (entry.kind == CACHE_REG)
+    return entry.value;
+  reg = allocReg();
+  movImm(reg, entry.value);
+  return reg;
+}
+
+static void drop(CacheEntry entry) {
+  if (entry.kind == CACHE_REG)
+    releaseReg(entry.value);
+}
+
+/************************** Templates *****************************/
+
+static int swapCondition(int cc) {
+  switch (cc) {
+  case CC_L: return CC_G;
+  case CC_G: return CC_L;
+  case CC_LE: return CC_GE;
+  case CC_GE: return CC_LE;
+  default: return cc;
+  }
+}
+
+static int conditionHolds(int cc, WORD x, WORD y) {
+  switch (cc) {
+  case CC_E: return x == y;
+  case CC_NE: return x != y;
+  case CC_L: return x < y;
+  case CC_G: return x > y;
+  case CC_LE: return x <= y;
+  default: return x >= y;
+  }
+}
+
+static int comparison(enum OpCode op) {
+  switch (op) {
+  case OP_EQ: return CC_E;
+  case OP_NE: return CC_NE;
+  case OP_GT: return CC_G;
+  case OP_LT: return CC_L;
+  case OP_GE: return CC_GE;
+  default: return CC_LE;
+  }
+}
+
+/*
+ * Compares the two operands x and y of a comparison and returns the
+ * condition that is true when x cc y holds, or CC_ALWAYS/CC_NEVER when both
+ * are constants.  *spare gets a register of the operands that is free for
+ * the result.
+ */
+static int compare(CacheEntry x, CacheEntry y, int cc, int* spare) {
+  *spare = -1;
+  if ((x.kind == CACHE_CONST) && (y.kind == CACHE_CONST))
+    return conditionHolds(cc, x.value, y.value) ? CC_ALWAYS : CC_NEVER;
+  if (x.kind == CACHE_CONST) {
+    aluImm(0, ALU_CMP, y.value, x.value);
+    *spare = y.value;
+    return swapCondition(cc);
+  }
+  if (y.kind == CACHE_CONST)
+    aluImm(0, ALU_CMP, x.value, y.value);
+  else {
+    opReg(0, 0x39, y.value, x.value);
+    releaseReg(y.value);
+  }
+  *spare = x.value;
+  return cc;
+}
+
+static void arithmetic(enum OpCode op) {
+  CacheEntry y = pop();
+  CacheEntry x = pop();
+  CacheEntry swap;
+  unsigned int u = (unsigned int) x.value, v = (unsigned int) y.value;
+  int reg;
+
+  if ((x.kind == CACHE_CONST) && (y.kind == CACHE_CONST)) {
+    pushConst((WORD) ((op == OP_AD) ? u + v : ((op == OP_SB) ? u - v : u * v)));
+    return;
+  }
+  if ((op != OP_SB) && (x.kind == CACHE_CONST)) {
+    swap = x; x = y; y = swap;
+  }
+  reg = inRegister(x);
+  if (y.kind == CACHE_CONST) {
+    if (op == OP_ML) {
+      opReg(0, 0x69, reg, reg);
+      emitInt32(y.value);
+    } else aluImm(0, (op == OP_AD) ? ALU_ADD : ALU_SUB, reg, y.value);
+  } else {
+    if (op == OP_ML) opReg(0, 0x0FAF, reg, y.value);
+    else opReg(0, (op == OP_AD) ? 0x01 : 0x29, y.value, reg);
+    releaseReg(y.value);
+  }
+  pushReg(reg);
+}
+
+static void division(int pc) {
+  unsigned char* skip;
+  unsigned char* divisor;
+
+  flushCache();
+  loadWord(RCX, RBX, R12, 0);
+  opReg(0, 0x85, RCX, RCX);
+  skip = emitJump(CC_NE);
+  lea64(R12, R12, -1);
+  emitExit(pc, PS_DIVIDE_BY_ZERO);
+  patchJump(skip, out);
+  loadWord(RAX, RBX, R12, -4);
+  // idiv traps on INT_MIN / -1; stop as the interpreter does
+  aluImm(0, ALU_CMP, RCX, -1);
+  divisor = emitJump(CC_NE);
+  aluImm(0, ALU_CMP, RAX, INT_MIN);
+  skip = emitJump(CC_NE);
+  lea64(R12, R12, -1);
+  emitExit(pc, PS_ARITH_OVERFLOW);
+  patchJump(divisor, out);
+  patchJump(skip, out);
+  emitByte(0x99);                       // cdq
+  opReg(0, 0xF7, 7, RCX);               // idiv ecx
+  lea64(R12, R12, -2);
+  freeRegs &= ~(1 << RAX);
+  pushReg(RAX);
+}
+
+static void call(Instruction* inst, int pc, int frameSize, int stackSize) {
+#ifndef GUARDED_STACK
+  unsigned char* fits;
+#endif
+
+  flushCache();
+#ifndef GUARDED_STACK
+  lea64(R11, R12, 1 + frameSize);
+  aluImm(1, ALU_CMP, R11, stackSize);
+  fits = emitJump(CC_LE);
+  emitExit(pc, PS_STACK_OVERFLOW);
+  patchJump(fits, out);
+#endif
+
+  storeWord(R13, RBX, R12, 8);                          // Dynamic Link
+  storeImm(pc, RBX, R12, 12);                           // Return Address
+  loadWord(RAX, R14, NO_INDEX, -4 * inst->p);           // Static Link
+  storeWord(RAX, RBX, R12, 16);
+  lea64(R13, R12, 1);                                   // Base & Result
+  store64(R14, R15, offsetof(DisplayLink, display));
+  lea64(R14, R14, 4 * (1 - inst->p));
+  loadWord(RAX, R14, NO_INDEX, 0);
+  storeWord(RAX, R15, NO_INDEX, offsetof(DisplayLink, base));
+  storeWord(R13, R14, NO_INDEX, 0);
+  lea64(R15, R15, sizeof(DisplayLink));
+  branchTo(CC_ALWAYS, inst->q);
+}
+
+// The arguments go down to the frame, which is the callee's now
+static void tailCall(Instruction* inst, int pc, int frameSize, int stackSize) {
+  int i;
+#ifndef GUARDED_STACK
+  unsigned char* fits;
+#endif
+
+  flushCache();
+#ifndef GUARDED_STACK
+  lea64(R11, R13, frameSize);
+  aluImm(1, ALU_CMP, R11, stackSize);
+  fits = emitJump(CC_LE);
+  emitExit(pc, PS_STACK_OVERFLOW);
+  patchJump(fits, out);
+#endif
+
+  for (i = 0; i < inst->p; i ++) {
+    loadWord(RAX, RBX, R12, 4 * (i - inst->p + 1));
+    storeWord(RAX, RBX, R13, 4 * (FRAME_HEADER_SIZE + i));
+  }
+  lea64(R12, R13, -1);
+  branchTo(CC_ALWAYS, inst->q);
+}
+
+static void leave(JitCode* jit, enum OpCode op) {
+  if (op == OP_EP) lea64(R12, R13, -1);
+  else opReg(1, 0x89, R13, R12);
+  loadIndex(RAX, RBX, R13, 8);                          // Saved return address
+  loadIndex(R13, RBX, R13, 4);                          // Saved base
+  lea64(R15, R15, - (int) sizeof(DisplayLink));
+  loadWord(RCX, R15, NO_INDEX, offsetof(DisplayLink, base));
+  storeWord(RCX, R14, NO_INDEX, 0);
+  load64(R14, R15, offsetof(DisplayLink, display));
+  movPointer(RCX, jit->entries);
+  opMem(0, 0xFF, 4, RCX, RAX, SCALE_POINTER, sizeof(void*));
+  resetCache();
+}
+
+/*********************** Runtime routines ***************************/
+
+static WORD readChar(JitState* state) {
+  return inputChar(state->input);
+}
+
+static WORD readInt(JitState* state) {
+  return inputInt(state->input);
+}
+
+static void output(CacheEntry entry, void* routine) {
+  flushCache();
+  if (entry.kind == CACHE_CONST) movImm(RSI, entry.value);
+  else if (entry.value != RSI) movReg(RSI, entry.value);
+  load64(RDI, RBP, offsetof(JitState, output));
+  emitCall(routine);
+}
+
+/************************** Translation ****************************/
+
+static int targetValid(WORD q, int n) {
+  return (q >= 0) && (q < n);
+}
+
+// Instructions (and operands) the templates cover; the rest is interpreted
+static int translatable(Instruction* inst, int n) {
+  switch (inst->op) {
+  case OP_LA:
+  case OP_LV:
+    return (inst->p >= 0) && (inst->p <= MAX_LEVEL) && (inst->q >= 0) && (inst->q <= MAX_FRAME_SIZE);
+  case OP_INT:
+  case OP_DCT:
+    return (inst->q >= 0) && (inst->q <= MAX_FRAME_SIZE);
+  case OP_J:
+  case OP_FJ:
+    return targetValid(inst->q, n);
+  case OP_CALL:
+    return targetValid(inst->q, n) && (inst->p >= 0) && (inst->p <= MAX_LEVEL);
+  case OP_TC:
+    return targetValid(inst->q, n) && (inst->p >= 0) && (inst->p <= MAX_TAIL_WORDS);
+  case OP_LC: case OP_LI: case OP_HL: case OP_ST: case OP_EP: case OP_EF:
+  case OP_RC: case OP_RI: case OP_WRC: case OP_WRI: case OP_WLN:
+  case OP_AD: case OP_SB: case OP_ML: case OP_DV: case OP_NEG: case OP_CV:
+  case OP_EQ: case OP_NE: case OP_GT: case OP_LT: case OP_GE: case OP_LE:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static void findLeaders(Instruction* code, int n, char* leader) {
+  int pc;
+
+  leader[0] = 1;
+  leader[n] = 1;
+  for (pc = 0; pc < n; pc ++) {
+    if (!translatable(code + pc, n)) {
+      leader[pc + 1] = 1;
+      continue;
+    }
+    switch (code[pc].op) {
+    case OP_J:
+    case OP_FJ:
+    case OP_CALL:
+    case OP_TC:
+      leader[code[pc].q] = 1;
+      leader[pc + 1] = 1;
+      break;
+    case OP_HL:
+    case OP_EP:
+    case OP_EF:
+      leader[pc + 1] = 1;
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+// Returns the address of the last instruction translated
+static int translate(JitCode* jit, Instruction* code, int pc, int n, char* leader,
+		     int* frameSize, int stackSize) {
+  Instruction* inst = code + pc;
+  CacheEntry x, y;
+  int reg, cc;
+
+  if (!translatable(inst, n)) {
+    flushCache();
+    emitExit(pc, PS_ACTIVE);
+    return pc;
+  }
+
+  switch (inst->op) {
+  case OP_LA:
+    reg = allocReg();
+    if (inst->p == 0) movReg(reg, R13);
+    else loadWord(reg, R14, NO_INDEX, -4 * inst->p);
+    if (inst->q != 0) aluImm(0, ALU_ADD, reg, inst->q);
+    pushReg(reg);
+    break;
+  case OP_LV:
+    reg = allocReg();
+    if (inst->p == 0) loadWord(reg, RBX, R13, 4 * inst->q);
+    else {
+      loadIndex(R11, R14, NO_INDEX, -4 * inst->p);
+      loadWord(reg, RBX, R11, 4 * inst->q);
+    }
+    pushReg(reg);
+    break;
+  case OP_LC:
+    pushConst(inst->q);
+    break;
+  case OP_LI:
+    reg = inRegister(pop());
+    signExtend(R11, reg);
+    loadWord(reg, RBX, R11, 0);
+    pushReg(reg);
+    break;
+  case OP_INT:
+    flushCache();
+    if (inst->q != 0) lea64(R12, R12, inst->q);
+    break;
+  case OP_DCT:
+    flushCache();
+    if (inst->q != 0) lea64(R12, R12, - inst->q);
+    break;
+  case OP_J:
+    flushCache();
+    branchTo(CC_ALWAYS, inst->q);
+    break;
+  case OP_FJ:
+    x = pop();
+    flushCache();
+    if (x.kind == CACHE_CONST) {
+      if (x.value == FALSE) branchTo(CC_ALWAYS, inst->q);
+    } else {
+      opReg(0, 0x85, x.value, x.value);
+      branchTo(CC_E, inst->q);
+    }
+    break;
+  case OP_HL:
+    flushCache();
+    emitExit(pc, PS_NORMAL_EXIT);
+    break;
+  case OP_ST:
+    y = pop();
+    x = pop();
+    if ((x.kind == CACHE_CONST) && (x.value >= 0) && (x.value <= MAX_FRAME_SIZE)) {
+      if (y.kind == CACHE_CONST) storeImm(y.value, RBX, NO_INDEX, 4 * x.value);
+      else storeWord(y.value, RBX, NO_INDEX, 4 * x.value);
+    } else {
+      signExtend(R11, inRegister(x));
+      if (y.kind == CACHE_CONST) storeImm(y.value, RBX, R11, 0);
+      else storeWord(y.value, RBX, R11, 0);
+    }
+    drop(x);
+    drop(y);
+    break;
+  case OP_CALL:
+    call(inst, pc, frameSize[inst->q], stackSize);
+    break;
+  case OP_TC:
+    tailCall(inst, pc, frameSize[inst->q], stackSize);
+    break;
+  case OP_EP:
+  case OP_EF:
+    leave(jit, inst->op);
+    break;
+  case OP_RC:
+  case OP_RI:
+    flushCache();
+    lea64(RDI, RBP, 0);
+    emitCall((inst->op == OP_RC) ? (void*) readChar : (void*) readInt);
+    freeRegs &= ~(1 << RAX);
+    pushReg(RAX);
+    break;
+  case OP_WRC:
+    output(pop(), (void*) outputChar);
+    break;
+  case OP_WRI:
+    output(pop(), (void*) outputInt);
+    break;
+  case OP_WLN:
+    flushCache();
+    load64(RDI, RBP, offsetof(JitState, output));
+    emitCall((void*) outputLn);
+    break;
+  case OP_AD:
+  case OP_SB:
+  case OP_ML:
+    arithmetic(inst->op);
+    break;
+  case OP_DV:
+    division(pc);
+    break;
+  case OP_NEG:
+    x = pop();
+    if (x.kind == CACHE_CONST) pushConst((WORD) (0u - (unsigned int) x.value));
+    else {
+      opReg(0, 0xF7, 3, x.value);
+      pushReg(x.value);
+    }
+    break;
+  case OP_CV:
+    if (cached > 0) {
+      x = cache[cached - 1];
+      if (x.kind == CACHE_CONST) pushConst(x.value);
+      else {
+	reg = allocReg();
+	movReg(reg, x.value);
+	pushReg(reg);
+      }
+    } else {
+      reg = allocReg();
+      loadWord(reg, RBX, R12, 0);
+      pushReg(reg);
+    }
+    break;
+  default:
+    // Comparisons; one that feeds a false jump becomes a conditional jump
+    y = pop();
+    x = pop();
+    if ((pc + 1 < n) && (code[pc + 1].op == OP_FJ) && !leader[pc + 1] &&
+	translatable(code + pc + 1, n)) {
+      flushCache();
+      cc = compare(x, y, comparison(inst->op), &reg);
+      if (cc == CC_NEVER) branchTo(CC_ALWAYS, code[pc + 1].q);
+      else if (cc != CC_ALWAYS) branchTo(cc ^ 1, code[pc + 1].q);
+      return pc + 1;
+    }
+    cc = compare(x, y, comparison(inst->op), &reg);
+    if (cc == CC_ALWAYS) pushConst(TRUE);
+    else if (cc == CC_NEVER) pushConst(FALSE);
+    else {
+      opRegByte(0x0F90 | cc, 0, reg);                   // setcc
+      opRegByte(0x0FB6, reg, reg);                      // movzx
+      pushReg(reg);
+    }
+    break;
+  }
+  return pc;
+}
+
+static void emitStubs(JitCode* jit) {
+  // Entry: jitEnter(JitState* state, void* target)
+  emitByte(0x53);                                       // push rbx
+  emitByte(0x55);                                       // push rbp
+  emitByte(0x41); emitByte(0x54);                       // push r12
+  emitByte(0x41); emitByte(0x55);                       // push r13
+  emitByte(0x41); emitByte(0x56);                       // push r14
+  emitByte(0x41); emitByte(0x57);                       // push r15
+  aluImm(1, ALU_SUB, RSP, 8);                           // keep calls aligned
+  opReg(1, 0x89, RDI, RBP);
+  load64(RBX, RBP, offsetof(JitState, stack));
+  load64(R12, RBP, offsetof(JitState, t));
+  load64(R13, RBP, offsetof(JitState, b));
+  load64(R14, RBP, offsetof(JitState, disp));
+  load64(R15, RBP, offsetof(JitState, link));
+  opReg(0, 0xFF, 4, RSI);                               // jmp rsi
+
+  // Exit: pc and ps have been stored
+  exitStub = out;
+  store64(R12, RBP, offsetof(JitState, t));
+  store64(R13, RBP, offsetof(JitState, b));
+  store64(R14, RBP, offsetof(JitState, disp));
+  store64(R15, RBP, offsetof(JitState, link));
+  aluImm(1, ALU_ADD, RSP, 8);
+  emitByte(0x41); emitByte(0x5F);                       // pop r15
+  emitByte(0x41); emitByte(0x5E);                       // pop r14
+  emitByte(0x41); emitByte(0x5D);                       // pop r13
+  emitByte(0x41); emitByte(0x5C);                       // pop r12
+  emitByte(0x5D);                                       // pop rbp
+  emitByte(0x5B);                                       // pop rbx
+  emitByte(0xC3);                                       // ret
+
+  // A return to an address that is not a leader: rax is the call's address
+  jit->resume = out;
+  opMem(0, 0x8D, RCX, RAX, NO_INDEX, 0, 1);
+  storeWord(RCX, RBP, NO_INDEX, offsetof(JitState, pc));
+  storeImm(PS_ACTIVE, RBP, NO_INDEX, offsetof(JitState, ps));
+  patchJump(emitJump(CC_ALWAYS), exitStub);
+}
+
+JitCode* compileJit(CodeBlock* codeBlock, int* frameSize, int stackSize) {
+  Instruction* code = codeBlock->code;
+  int n = codeBlock->codeSize;
+  JitCode* jit;
+  char* leader;
+  unsigned char* limit;
+  long pageSize = 4096;
+  int pc, i;
+
+  jit = (JitCode*) malloc(sizeof(JitCode));
+  jit->codeSize = n;
+  jit->size = (STUB_SIZE + (size_t) (n + 1) * MAX_TEMPLATE + pageSize - 1) / pageSize * pageSize;
+  jit->memory = (unsigned char*) mmap(NULL, jit->size, PROT_READ | PROT_WRITE,
+				      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (jit->memory == MAP_FAILED) {
+    free(jit);
+    return NULL;
+  }
+  jit->entries = (void**) malloc((n + 1) * sizeof(void*));
+  leader = (char*) calloc(n + 1, 1);
+  fixupFields = (unsigned char**) malloc((n + 1) * sizeof(unsigned char*));
+  fixupTargets = (int*) malloc((n + 1) * sizeof(int));
+  fixupCount = 0;
+
+  findLeaders(code, n, leader);
+  leader[codeBlock->entry] = 1;
+  out = jit->memory;
+  emitStubs(jit);
+  for (pc = 0; pc <= n; pc ++)
+    jit->entries[pc] = jit->resume;
+
+  resetCache();
+  for (pc = 0; pc < n; pc ++) {
+    limit = out + MAX_TEMPLATE;
+    if (leader[pc]) {
+      flushCache();
+      jit->entries[pc] = out;
+    } else if ((cached > MAX_CACHED - 2) || (freeRegCount() < MIN_FREE_REGS))
+      flushCache();
+    pc = translate(jit, code, pc, n, leader, frameSize, stackSize);
+    if (out > limit) {
+      fprintf(stderr, "kplrun: JIT template overflow at %d\n", pc);
+      abort();
+    }
+  }
+  // Running off the end of the code halts, as in the threaded loop
+  flushCache();
+  jit->entries[n] = out;
+  emitExit(n, PS_NORMAL_EXIT);
+
+  for (i = 0; i < fixupCount; i ++)
+    patchJump(fixupFields[i], (unsigned char*) jit->entries[fixupTargets[i]]);
+
+  free(leader);
+  free(fixupFields);
+  free(fixupTargets);
+
+  if (mprotect(jit->memory, jit->size, PROT_READ | PROT_EXEC) != 0) {
+    freeJit(jit);
+    return NULL;
+  }
+  return jit;
+}
+
+void freeJit(JitCode* jit) {
+  if (jit == NULL) return;
+  munmap(jit->memory, jit->size);
+  free(jit->entries);
+  free(jit);
+}
+
+int jitEntry(JitCode* jit, int pc) {
+  return (pc >= 0) && (pc <= jit->codeSize) && (jit->entries[pc] != jit->resume);
+}
+
+void runJitCode(JitCode* jit, JitState* state) {
+  void (*enter)(JitState*, void*) = (void (*)(JitState*, void*)) jit->memory;
+
+  enter(state, jit->entries[state->pc]);
+}
+
+#else
+
+// No code generator for this host: everything stays interpreted
+
+JitCode* compileJit(CodeBlock* codeBlock, int* frameSize, int stackSize) {
+  return NULL;
+}
+
+void freeJit(JitCode* jit) {
+}
+
+int jitEntry(JitCode* jit, int pc) {
+  return 0;
+}
+
+void runJitCode(JitCode* jit, JitState* state) {
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __JIT_H__
+#define __JIT_H__
+
+#include "vm.h"
+
+// Machine registers handed over between the interpreter and compiled code
+struct JitState_ {
+  CELL* stack;
+  long t;
+  long b;
+  WORD* disp;           // display entry of the current lexical level
+  DisplayLink* link;    // top of the saved display entries
+  int pc;               // where the compiled code stopped
+  int ps;               // PS_ACTIVE when it stopped to let the interpreter go on
+  InputChannel* input;
+  OutputChannel* output;
+};
+
+typedef struct JitState_ JitState;
+
+typedef struct JitCode_ JitCode;
+
+/*
+ * Translates a verified (and not fused) code block into x86-64 machine
+ * code.  Returns NULL when the host cannot run it; the caller then keeps
+ * interpreting.
+ */
+JitCode* compileJit(CodeBlock* codeBlock, int* frameSize, int stackSize);
+void freeJit(JitCode* jit);
+
+// Whether the compiled code can be entered at pc
+int jitEntry(JitCode* jit, int pc);
+
+/*
+ * Runs the compiled code from state->pc until it halts, fails, or reaches
+ * an instruction it leaves to the interpreter (state->ps is then PS_ACTIVE
+ * and state->pc is that instruction).
+ */
+void runJitCode(JitCode* jit, JitState* state);
+
+#endif
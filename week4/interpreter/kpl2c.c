@@ -0,0 +1,353 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "instructions.h"
+#include "verifier.h"
+// As kplrun's: the array is zero-filled, so only what is used takes memory
+#define DEFAULT_STACK_SIZE (1 << 24)
+#define DEFAULT_CODE_SIZE 1024
+
+/*
+ * Ahead-of-time translator: turns a KPL executable into a C program.
+ *
+ * Every procedure becomes a C function taking its frame base, and every
+ * instruction a statement on the stack array.  The verifier gives the
+ * stack height before each instruction, so the top of the stack is a
+ * constant offset from the frame base and t disappears from the program.
+ * OP_CALL becomes a C call and OP_EP/OP_EF a return; the caller knows
+ * from the callee whether a result was left on the top.  OP_TC moves the
+ * arguments down, then jumps back to the start of its own procedure or
+ * calls another one and returns.  The frames and
+ * the display are laid out as in kplrun, so programs that reach into them
+ * behave the same.
+ */
+
+int stackSize;
+int codeSize;
+
+CodeBlock* codeBlock;
+CodeInfo info;
+char* isTarget;
+FILE* out;
+
+void printUsage(void) {
+  printf("Usage: kpl2c input output [-s=stack_size] [-c=code_size]\n");
+  printf("   input: input kpl program\n");
+  printf("   output: C source file\n");
+  printf("   -s=stack_size: set the stack size of the program\n");
+  printf("   -c=code_size: set the code size\n");
+}
+
+int analyseParam(char* param) {
+  if (strncmp(param, "-s=", 3) == 0) {
+    stackSize = atoi(param+3);
+    return 1;
+  }
+  if (strncmp(param, "-c=", 3) == 0) {
+    codeSize = atoi(param+3);
+    return 1;
+  }
+  return 0;
+}
+
+// Base of the frame p levels out from a procedure on the given level
+char* frameBase(char* buffer, int level, int p) {
+  if (p == 0)
+    strcpy(buffer, "b");
+  else sprintf(buffer, "display[%d]", level - p);
+  return buffer;
+}
+
+void translateInstruction(int pc, int entry, int level) {
+  Instruction* inst = codeBlock->code + pc;
+  int h = info.height[pc];
+  char s[100];
+  char base[30];
+  int callee, i;
+
+  sprintInstruction(s, inst);
+  fprintf(out, "  /* %d: %s */\n", pc, s);
+
+  switch (inst->op) {
+  case OP_LA:
+    fprintf(out, "  s[b+%d] = %s + %d;\n", h, frameBase(base, level, inst->p), inst->q);
+    break;
+  case OP_LV:
+    fprintf(out, "  s[b+%d] = s[%s + %d];\n", h, frameBase(base, level, inst->p), inst->q);
+    break;
+  case OP_LC:
+    fprintf(out, "  s[b+%d] = %d;\n", h, inst->q);
+    break;
+  case OP_LI:
+    fprintf(out, "  s[b+%d] = s[s[b+%d]];\n", h - 1, h - 1);
+    break;
+  case OP_J:
+    fprintf(out, "  goto L%d;\n", inst->q);
+    break;
+  case OP_FJ:
+    fprintf(out, "  if (s[b+%d] == 0) goto L%d;\n", h - 1, inst->q);
+    break;
+  case OP_HL:
+    fprintf(out, "  halt();\n");
+    break;
+  case OP_ST:
+    fprintf(out, "  s[s[b+%d]] = s[b+%d];\n", h - 2, h - 1);
+    break;
+  case OP_CALL:
+    callee = inst->q;
+    fprintf(out, "  if (b + %d > STACK_SIZE) stackOverflow();\n", h + info.frameSize[callee]);
+    fprintf(out, "  s[b+%d] = b;\n", h + 1);
+    fprintf(out, "  s[b+%d] = %d;\n", h + 2, pc);
+    fprintf(out, "  s[b+%d] = %s;\n", h + 3, frameBase(base, level, inst->p));
+    fprintf(out, "  P%d(b + %d);\n", callee, h);
+    break;
+  case OP_EP:
+  case OP_EF:
+    fprintf(out, "  display[%d] = saved;\n", level);
+    fprintf(out, "  return;\n");
+    break;
+  case OP_TC:
+    callee = inst->q;
+    fprintf(out, "  if (b + %d > STACK_SIZE) stackOverflow();\n", info.frameSize[callee]);
+    for (i = 0; i < inst->p; i ++)
+      fprintf(out, "  s[b+%d] = s[b+%d];\n", FRAME_HEADER_SIZE + i, h - inst->p + i);
+    if (callee == entry)
+      fprintf(out, "  goto L%d;\n", callee);
+    else {
+      fprintf(out, "  P%d(b);\n", callee);
+      fprintf(out, "  display[%d] = saved;\n", level);
+      fprintf(out, "  return;\n");
+    }
+    break;
+  case OP_RC:
+    fprintf(out, "  s[b+%d] = readChar();\n", h);
+    break;
+  case OP_RI:
+    fprintf(out, "  s[b+%d] = readInt();\n", h);
+    break;
+  case OP_WRC:
+    fprintf(out, "  printf(\"%%c\", s[b+%d]);\n", h - 1);
+    break;
+  case OP_WRI:
+    fprintf(out, "  printf(\"%%d\", s[b+%d]);\n", h - 1);
+    break;
+  case OP_WLN:
+    fprintf(out, "  printf(\"\\n\");\n");
+    break;
+  case OP_AD:
+    fprintf(out, "  s[b+%d] += s[b+%d];\n", h - 2, h - 1);
+    break;
+  case OP_SB:
+    fprintf(out, "  s[b+%d] -= s[b+%d];\n", h - 2, h - 1);
+    break;
+  case OP_ML:
+    fprintf(out, "  s[b+%d] *= s[b+%d];\n", h - 2, h - 1);
+    break;
+  case OP_DV:
+    fprintf(out, "  if (s[b+%d] == 0) divideByZero();\n", h - 1);
+    fprintf(out, "  if ((s[b+%d] == -1) && (s[b+%d] == INT_MIN)) arithOverflow();\n", h - 1, h - 2);
+    fprintf(out, "  s[b+%d] /= s[b+%d];\n", h - 2, h - 1);
+    break;
+  case OP_NEG:
+    fprintf(out, "  s[b+%d] = - s[b+%d];\n", h - 1, h - 1);
+    break;
+  case OP_CV:
+    fprintf(out, "  s[b+%d] = s[b+%d];\n", h, h - 1);
+    break;
+  case OP_EQ:
+    fprintf(out, "  s[b+%d] = s[b+%d] == s[b+%d];\n", h - 2, h - 2, h - 1);
+    break;
+  case OP_NE:
+    fprintf(out, "  s[b+%d] = s[b+%d] != s[b+%d];\n", h - 2, h - 2, h - 1);
+    break;
+  case OP_GT:
+    fprintf(out, "  s[b+%d] = s[b+%d] > s[b+%d];\n", h - 2, h - 2, h - 1);
+    break;
+  case OP_LT:
+    fprintf(out, "  s[b+%d] = s[b+%d] < s[b+%d];\n", h - 2, h - 2, h - 1);
+    break;
+  case OP_GE:
+    fprintf(out, "  s[b+%d] = s[b+%d] >= s[b+%d];\n", h - 2, h - 2, h - 1);
+    break;
+  case OP_LE:
+    fprintf(out, "  s[b+%d] = s[b+%d] <= s[b+%d];\n", h - 2, h - 2, h - 1);
+    break;
+  default:
+    // OP_INT and OP_DCT only move t; there is no debugger for OP_BP
+    break;
+  }
+}
+
+void translateProcedure(int entry) {
+  int level = info.level[entry];
+  int pc;
+
+  fprintf(out, "\n/* Procedure at %d, level %d */\n", entry, level);
+  fprintf(out, "static void P%d(WORD b) {\n", entry);
+  // The display entry is put back on return, as OP_EP/OP_EF do
+  if (info.returnKind[entry] != RETURN_NONE)
+    fprintf(out, "  WORD saved = display[%d];\n\n", level);
+  fprintf(out, "  display[%d] = b;\n", level);
+  // The main program need not start at its first instruction
+  for (pc = 0; pc < codeBlock->codeSize; pc ++) {
+    if (info.owner[pc] != entry) continue;
+    if (isTarget[pc])
+      fprintf(out, " L%d: ;\n", pc);
+    translateInstruction(pc, entry, level);
+  }
+  fprintf(out, "}\n");
+}
+
+void translate(char* name) {
+  Instruction* code = codeBlock->code;
+  int n = codeBlock->codeSize;
+  int maxLevel = 0;
+  char used[NUM_OF_OPCODES];
+  int pc;
+
+  isTarget = (char*) calloc(n, 1);
+  memset(used, 0, sizeof(used));
+  for (pc = 0; pc < n; pc ++) {
+    if (info.owner[pc] < 0) continue;
+    used[code[pc].op] = 1;
+    if ((code[pc].op == OP_J) || (code[pc].op == OP_FJ)
+	|| ((code[pc].op == OP_TC) && (code[pc].q == info.owner[pc])))
+      isTarget[code[pc].q] = 1;
+    if ((info.level[pc] >= 0) && (info.level[pc] > maxLevel))
+      maxLevel = info.level[pc];
+  }
+
+  fprintf(out, "/* Translated by kpl2c from %s */\n\n", name);
+  fprintf(out, "#include <stdio.h>\n");
+  fprintf(out, "#include <stdlib.h>\n");
+  fprintf(out, "#include <limits.h>\n\n");
+  fprintf(out, "#define STACK_SIZE %d\n\n", stackSize);
+  fprintf(out, "typedef int WORD;\n\n");
+  fprintf(out, "static WORD s[STACK_SIZE];\n");
+  fprintf(out, "static WORD display[%d];\n\n", maxLevel + 1);
+  // Only the runtime routines the program needs, to keep it warning free
+  if (used[OP_HL]) {
+    fprintf(out, "static void halt(void) {\n");
+    fprintf(out, "  exit(0);\n");
+    fprintf(out, "}\n\n");
+  }
+  fprintf(out, "static void stackOverflow(void) {\n");
+  fprintf(out, "  printf(\"\\nRuntime error: Stack overflow!\\n\");\n");
+  fprintf(out, "  exit(1);\n");
+  fprintf(out, "}\n\n");
+  if (used[OP_DV]) {
+    fprintf(out, "static void divideByZero(void) {\n");
+    fprintf(out, "  printf(\"\\nRuntime error: Divide by zero!\\n\");\n");
+    fprintf(out, "  exit(1);\n");
+    fprintf(out, "}\n\n");
+    fprintf(out, "static void arithOverflow(void) {\n");
+    fprintf(out, "  printf(\"\\nRuntime error: Arithmetic overflow!\\n\");\n");
+    fprintf(out, "  exit(1);\n");
+    fprintf(out, "}\n\n");
+  }
+  if (used[OP_RC]) {
+    fprintf(out, "static WORD readChar(void) {\n");
+    fprintf(out, "  unsigned char c = 0;\n");
+    fprintf(out, "  if (scanf(\"%%c\", &c) != 1) return 0;\n");
+    fprintf(out, "  return c;\n");
+    fprintf(out, "}\n\n");
+  }
+  if (used[OP_RI]) {
+    fprintf(out, "static WORD readInt(void) {\n");
+    fprintf(out, "  WORD number = 0;\n");
+    fprintf(out, "  if (scanf(\"%%d\", &number) != 1) return 0;\n");
+    fprintf(out, "  return number;\n");
+    fprintf(out, "}\n\n");
+  }
+
+  for (pc = 0; pc < n; pc ++)
+    if (info.level[pc] >= 0)
+      fprintf(out, "static void P%d(WORD b);\n", pc);
+
+  for (pc = 0; pc < n; pc ++)
+    if (info.level[pc] >= 0)
+      translateProcedure(pc);
+
+  fprintf(out, "\nint main(void) {\n");
+  fprintf(out, "  if (%d > STACK_SIZE) stackOverflow();\n", info.frameSize[codeBlock->entry]);
+  fprintf(out, "  P%d(0);\n", codeBlock->entry);
+  fprintf(out, "  return 0;\n");
+  fprintf(out, "}\n");
+  free(isTarget);
+}
+
+/******************************************************************/
+
+int main(int argc, char *argv[]) {
+  int i, errorPc;
+  FILE* f;
+  LoadCode loaded;
+  VerifyCode result;
+
+  stackSize = DEFAULT_STACK_SIZE;
+  codeSize = DEFAULT_CODE_SIZE;
+
+  if (argc <= 2) {
+    printf("kpl2c: no input or output file.\n");
+    printUsage();
+    return -1;
+  }
+
+  for (i = 3; i < argc; i++)
+    if (analyseParam(argv[i]) == 0) {
+      printUsage();
+      return -1;
+    }
+
+  f = fopen(argv[1], "r");
+  if (f == NULL) {
+    printf("kpl2c: Can\'t read input file!\n");
+    return -1;
+  }
+  codeBlock = createCodeBlock(codeSize);
+  loaded = loadCode(codeBlock, f);
+  fclose(f);
+  if (loaded != LOAD_OK) {
+    printf("kpl2c: %s!\n", loadMessage(loaded));
+    freeCodeBlock(codeBlock);
+    return -1;
+  }
+
+  result = analyseCode(codeBlock, &info, &errorPc);
+  if (result != VERIFY_OK) {
+    printf("Verification error at %d: %s\n", errorPc, verifyMessage(result));
+    printf("kpl2c: Wrong executable format!\n");
+    freeCodeInfo(&info);
+    freeCodeBlock(codeBlock);
+    return -1;
+  }
+
+  for (i = 0; i < codeBlock->codeSize; i ++)
+    if ((info.owner[i] >= 0) && (codeBlock->code[i].op > OP_BP) && (codeBlock->code[i].op != OP_TC)) {
+      printf("kpl2c: Doubles and strings are not supported (at %d)!\n", i);
+      freeCodeInfo(&info);
+      freeCodeBlock(codeBlock);
+      return -1;
+    }
+
+  out = fopen(argv[2], "w");
+  if (out == NULL) {
+    printf("kpl2c: Can\'t write output file!\n");
+    freeCodeInfo(&info);
+    freeCodeBlock(codeBlock);
+    return -1;
+  }
+  translate(argv[1]);
+  fclose(out);
+
+  freeCodeInfo(&info);
+  freeCodeBlock(codeBlock);
+  return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "instructions.h"
+#include "optimizer.h"
+#define DEFAULT_CODE_SIZE 1024
+
+/*
+ * Bytecode optimizer: reads a KPL executable, rewrites it with
+ * optimizeCode() and writes it in the executable format, so that the
+ * output of any compiler can be improved without touching the compiler.
+ */
+
+int codeSize;
+char* mapName;
+
+void printUsage(void) {
+  printf("Usage: kplopt input output [-c=code_size] [-map=map_file]\n");
+  printf("   input: input kpl program\n");
+  printf("   output: optimized kpl program\n");
+  printf("   -c=code_size: set the code size\n");
+  printf("   -map=map_file: write the original address of every instruction\n");
+}
+
+int analyseParam(char* param) {
+  if (strncmp(param, "-c=", 3) == 0) {
+    codeSize = atoi(param+3);
+    return 1;
+  }
+  if (strncmp(param, "-map=", 5) == 0) {
+    mapName = param+5;
+    return 1;
+  }
+  return 0;
+}
+
+// One line per instruction: its address, then its address in the input
+int writeMap(CodeBlock* codeBlock, int* origin, char* name) {
+  FILE* f = fopen(name, "w");
+  int pc;
+
+  if (f == NULL) return 0;
+  for (pc = 0; pc < codeBlock->codeSize; pc ++)
+    fprintf(f, "%d %d\n", pc, origin[pc]);
+  return fclose(f) == 0;
+}
+
+int main(int argc, char *argv[]) {
+  CodeBlock* codeBlock;
+  int* origin;
+  int i, size;
+  FILE* f;
+  LoadCode loaded;
+
+  codeSize = DEFAULT_CODE_SIZE;
+  mapName = NULL;
+
+  if (argc <= 2) {
+    printf("kplopt: no input or output file.\n");
+    printUsage();
+    return -1;
+  }
+
+  for (i = 3; i < argc; i++)
+    if (analyseParam(argv[i]) == 0) {
+      printUsage();
+      return -1;
+    }
+
+  f = fopen(argv[1], "r");
+  if (f == NULL) {
+    printf("kplopt: Can\'t read input file!\n");
+    return -1;
+  }
+  codeBlock = createCodeBlock(codeSize);
+  loaded = loadCode(codeBlock, f);
+  fclose(f);
+  if (loaded != LOAD_OK) {
+    printf("kplopt: %s!\n", loadMessage(loaded));
+    freeCodeBlock(codeBlock);
+    return -1;
+  }
+
+  size = codeBlock->codeSize;
+  origin = optimizeCode(codeBlock);
+  if (origin == NULL) {
+    printf("kplopt: Wrong executable format!\n");
+    freeCodeBlock(codeBlock);
+    return -1;
+  }
+
+  f = fopen(argv[2], "wb");
+  if ((f == NULL) || !saveCode(codeBlock, f) || (fclose(f) != 0)) {
+    printf("kplopt: Can\'t write output file!\n");
+    free(origin);
+    freeCodeBlock(codeBlock);
+    return -1;
+  }
+  if ((mapName != NULL) && !writeMap(codeBlock, origin, mapName)) {
+    printf("kplopt: Can\'t write map file!\n");
+    free(origin);
+    freeCodeBlock(codeBlock);
+    return -1;
+  }
+  printf("kplopt: %d -> %d instructions\n", size, codeBlock->codeSize);
+
+  free(origin);
+  freeCodeBlock(codeBlock);
+  return 0;
+}
@@ -1,109 +1,400 @@
-/* 
- * @copyright (c) 2008, Hedspi, Hanoi University of Technology
- * @author Huu-Duc Nguyen
- * @version 1.0
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-#include "vm.h"
-#define DEFAULT_STACK_SIZE 2048
-#define DEFAULT_CODE_SIZE 1024
-
-extern int debugMode;
-extern int stackSize;
-extern int codeSize;
-
-int dumpCode;
-
-
-void printUsage(void) {
-  printf("Usage: kplrun input [-s=stack_size] [-c=code_size] [-debug] [-dump]\n");
-  printf("   input: input kpl program\n");
-  printf("   -s=stack_size: set the stack size\n");
-  printf("   -c=code_size: set the code size\n");
-  printf("   -debug: enable code dump\n");
-}
-
-int analyseParam(char* param) {
-  if (strncmp(param, "-s=", 3) == 0) {
-    stackSize = atoi(param+3);
-    return 1;
-  }
-  if (strncmp(param, "-c=", 3) == 0) {
-    codeSize = atoi(param+3);
-    return 1;
-  }
-  if (strcmp(param, "-debug") == 0) {
-    debugMode = 1;
-    return 1;
-  }
-  if (strcmp(param, "-dump") == 0) {
-    dumpCode = 1;
-    return 1;
-  }
-  return 0;
-}
-
-/******************************************************************/
-
-int main(int argc, char *argv[]) {
-  int i;
-  FILE* f;
-
-  debugMode = 0;
-  stackSize = DEFAULT_STACK_SIZE;
-  codeSize = DEFAULT_CODE_SIZE;
-  dumpCode = 0;
-
-  if (argc <= 1) {
-    printf("kplrun: no input file.\n");
-    printUsage();
-    return -1;
-  }
-
-  for ( i = 2; i < argc; i++) 
-    if (analyseParam(argv[i]) == 0) {
-      printUsage();
-      return -1;
-    }
-
-  f = fopen(argv[1],"r");
-	    
-  if (f == NULL) {
-    printf("kplrun: Can\'t read input file!\n");
-    return -1;
-  }
-
-  initVM();
-  if (loadExecutable(f) == 0) {
-    printf("kplrun: Wrong executable format!\n");
-    fclose(f);
-    cleanVM();
-    return -1;
-  }
-  fclose(f);
-
-  if (dumpCode) {
-    printCodeBuffer();
-    return 0;
-  }
-
-  switch (run()) {
-  case PS_DIVIDE_BY_ZERO:
-    printf("Runtime error: Divide by zero!\n");
-    break;
-  case PS_STACK_OVERFLOW:
-    printf("Runtime error: Stack overflow!\n");
-    break;
-  case PS_IO_ERROR:
-    printf("Runtime error: IO error!\n");
-    break;
-  default:
-    break;
-  }
-  cleanVM();
-  return 0;
-}
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm.h"
+#include "batch.h"
+#include "compact.h"
+#include "profile.h"
+#include "sampler.h"
+#include "checkpoint.h"
+#include "regcode.h"
+#define DEFAULT_CODE_SIZE 1024
+
+int debugMode;
+int stackSize;
+int codeSize;
+int dispatchMode;
+int pauseAtExit;
+int dumpCode;
+int profiling;
+char* sampleName;
+char* checkpointName;
+int checkpointInterval;
+long long checkpointStop;
+char* resumeName;
+char* saveName;
+int fuse;
+int workers;
+char* outputName;
+char* inputName;
+
+
+void printUsage(void) {
+  printf("Usage: kplrun input [-s=stack_size] [-c=code_size] [-threaded] [-jit] [-compact] [-register] [-nofuse] [-i=file] [-o=file] [-nowait] [-save=file] [-profile] [-sample=file] [-checkpoint=file] [-every=seconds] [-stop=jumps] [-resume=file] [-debug] [-dump]\n");
+  printf("   input: input kpl program\n");
+  printf("   -s=stack_size: set the stack size, in words (default %d)\n", DEFAULT_STACK_SIZE);
+  printf("   -c=code_size: set the code size\n");
+  printf("   -threaded: run with the direct-threaded interpreter loop\n");
+  printf("   -jit: compile the program to machine code before running it\n");
+  printf("   -compact: run from the compact bytecode (with -save=, write it)\n");
+  printf("   -register: run the program translated to register code (with -dump, print it)\n");
+  printf("   -nofuse: do not fuse instructions into superinstructions\n");
+  printf("   -i=file: read the program input from file\n");
+  printf("   -o=file: write the program output to file\n");
+  printf("   -nowait: do not wait for a key when the program ends\n");
+  printf("   -save=file: write the program in the current executable format, then exit\n");
+  printf("   -profile: count and time every instruction, and print a profile at exit\n");
+  printf("   -sample=file: sample the call stack and write it in folded format to file\n");
+  printf("   -checkpoint=file: save the state of the program to file on SIGUSR1, and stop after saving it on SIGTERM\n");
+  printf("   -every=seconds: with -checkpoint=, also save it every so many seconds\n");
+  printf("   -stop=jumps: with -checkpoint=, save it and stop after so many jumps and calls\n");
+  printf("   -resume=file: continue the program from the state saved in file\n");
+  printf("   -debug: enable code dump\n");
+  printf("       kplrun --batch manifest results [-s=stack_size] [-c=code_size] [-threaded] [-jit] [-compact] [-register] [-nofuse] [-j=workers]\n");
+  printf("   manifest: one job per line: executable input output\n");
+  printf("   results: the exit status of every job\n");
+  printf("   -j=workers: number of worker threads (default: one per processor)\n");
+}
+
+int analyseParam(char* param) {
+  if (strncmp(param, "-s=", 3) == 0) {
+    stackSize = atoi(param+3);
+    return 1;
+  }
+  if (strncmp(param, "-c=", 3) == 0) {
+    codeSize = atoi(param+3);
+    return 1;
+  }
+  if (strcmp(param, "-threaded") == 0) {
+    dispatchMode = DISPATCH_THREADED;
+    return 1;
+  }
+  if (strcmp(param, "-jit") == 0) {
+    dispatchMode = DISPATCH_JIT;
+    return 1;
+  }
+  if (strcmp(param, "-compact") == 0) {
+    dispatchMode = DISPATCH_COMPACT;
+    return 1;
+  }
+  if (strcmp(param, "-register") == 0) {
+    dispatchMode = DISPATCH_REGISTER;
+    return 1;
+  }
+  if (strcmp(param, "-nofuse") == 0) {
+    fuse = 0;
+    return 1;
+  }
+  if (strncmp(param, "-i=", 3) == 0) {
+    inputName = param+3;
+    return 1;
+  }
+  if (strncmp(param, "-o=", 3) == 0) {
+    outputName = param+3;
+    return 1;
+  }
+  if (strncmp(param, "-j=", 3) == 0) {
+    workers = atoi(param+3);
+    return 1;
+  }
+  if (strcmp(param, "-nowait") == 0) {
+    pauseAtExit = 0;
+    return 1;
+  }
+  if (strcmp(param, "-debug") == 0) {
+    debugMode = 1;
+    return 1;
+  }
+  if (strncmp(param, "-save=", 6) == 0) {
+    saveName = param+6;
+    return 1;
+  }
+  if (strncmp(param, "-sample=", 8) == 0) {
+    sampleName = param+8;
+    return 1;
+  }
+  if (strncmp(param, "-checkpoint=", 12) == 0) {
+    checkpointName = param+12;
+    return 1;
+  }
+  if (strncmp(param, "-every=", 7) == 0) {
+    checkpointInterval = atoi(param+7);
+    return 1;
+  }
+  if (strncmp(param, "-stop=", 6) == 0) {
+    checkpointStop = atoll(param+6);
+    return 1;
+  }
+  if (strncmp(param, "-resume=", 8) == 0) {
+    resumeName = param+8;
+    return 1;
+  }
+  if (strcmp(param, "-profile") == 0) {
+    profiling = 1;
+    return 1;
+  }
+  if (strcmp(param, "-dump") == 0) {
+    dumpCode = 1;
+    return 1;
+  }
+  return 0;
+}
+
+int batchMain(int argc, char *argv[]) {
+  BatchOptions options;
+  int i;
+
+  if (argc <= 3) {
+    printf("kplrun: no manifest or results file.\n");
+    printUsage();
+    return -1;
+  }
+  for (i = 4; i < argc; i++)
+    if (analyseParam(argv[i]) == 0) {
+      printUsage();
+      return -1;
+    }
+
+  options.stackSize = stackSize;
+  options.codeSize = codeSize;
+  options.dispatchMode = dispatchMode;
+  options.fuse = fuse;
+  options.workers = workers;
+  return runBatch(argv[2], argv[3], &options);
+}
+
+/******************************************************************/
+
+int main(int argc, char *argv[]) {
+  int i;
+  FILE* f;
+  FILE* in = NULL;
+  FILE* out = NULL;
+  Program* program;
+  VMContext* vm;
+  Profile* profile = NULL;
+  Sampler* sampler = NULL;
+  FILE* samples = NULL;
+  Checkpoint* checkpoint = NULL;
+  CheckpointCode resumed;
+  RegisterCode* registers;
+  int ps;
+
+  debugMode = 0;
+  dispatchMode = DISPATCH_SWITCH;
+  stackSize = DEFAULT_STACK_SIZE;
+  codeSize = DEFAULT_CODE_SIZE;
+  dumpCode = 0;
+  profiling = 0;
+  sampleName = NULL;
+  checkpointName = NULL;
+  checkpointInterval = 0;
+  checkpointStop = 0;
+  resumeName = NULL;
+  saveName = NULL;
+  fuse = 1;
+  outputName = NULL;
+  inputName = NULL;
+  pauseAtExit = 1;
+  workers = 0;
+
+  if (argc <= 1) {
+    printf("kplrun: no input file.\n");
+    printUsage();
+    return -1;
+  }
+
+  if (strcmp(argv[1], "--batch") == 0)
+    return batchMain(argc, argv);
+
+  for ( i = 2; i < argc; i++) 
+    if (analyseParam(argv[i]) == 0) {
+      printUsage();
+      return -1;
+    }
+
+  f = fopen(argv[1],"r");
+	    
+  if (f == NULL) {
+    printf("kplrun: Can\'t read input file!\n");
+    return -1;
+  }
+
+  program = loadProgram(f, codeSize);
+  fclose(f);
+  if (program == NULL) {
+    printf("kplrun: Wrong executable format!\n");
+    return -1;
+  }
+
+  if (dumpCode && (dispatchMode == DISPATCH_REGISTER)) {
+    registers = translateRegisters(program->codeBlock);
+    if (registers != NULL) printRegisterCode(registers);
+    freeRegisters(registers);
+    freeProgram(program);
+    return 0;
+  }
+
+  if (dumpCode) {
+    printProgram(program);
+    freeProgram(program);
+    return 0;
+  }
+
+  if (saveName != NULL) {
+    out = fopen(saveName, "wb");
+    if ((out == NULL) || !((dispatchMode == DISPATCH_COMPACT)
+			   ? saveCompactCode(program->codeBlock, out) : saveProgram(program, out))) {
+      printf("kplrun: Can\'t write %s!\n", saveName);
+      if (out != NULL) fclose(out);
+      freeProgram(program);
+      return -1;
+    }
+    fclose(out);
+    freeProgram(program);
+    return 0;
+  }
+
+  // Procedures are found before the code is fused
+  if (profiling) {
+    profile = createProfile(program->codeBlock);
+    dispatchMode = DISPATCH_PROFILE;
+  } else if (sampleName != NULL) {
+    samples = fopen(sampleName, "w");
+    if (samples == NULL) {
+      printf("kplrun: Can\'t write %s!\n", sampleName);
+      freeProgram(program);
+      return -1;
+    }
+    sampler = createSampler(program->codeBlock);
+    dispatchMode = DISPATCH_SAMPLE;
+  } else if (checkpointName != NULL)
+    dispatchMode = DISPATCH_CHECKPOINT;
+
+  // The JIT and the register code do their own combining of
+  // instructions, and compact code has no superinstructions
+  if (fuse && (dispatchMode != DISPATCH_JIT) && (dispatchMode != DISPATCH_COMPACT)
+      && (dispatchMode != DISPATCH_REGISTER))
+    fuseProgram(program);
+
+  vm = createVM(program, stackSize);
+  if (vm == NULL) {
+    printf("kplrun: Cannot allocate a stack of %d words!\n", stackSize);
+    freeProgram(program);
+    return -1;
+  }
+  vm->debugMode = debugMode;
+  vm->dispatchMode = dispatchMode;
+  vm->pauseAtExit = pauseAtExit;
+  vm->profile = profile;
+  vm->sampler = sampler;
+
+  // Before a resumed program repositions it
+  if (inputName != NULL) {
+    in = fopen(inputName, "rb");
+    if (in == NULL) {
+      printf("kplrun: Can\'t read %s!\n", inputName);
+      freeVM(vm);
+      freeProgram(program);
+      return -1;
+    }
+    redirectInput(vm, in);
+  }
+
+  // Before the checkpoint file is created, which may be the same file
+  if (resumeName != NULL) {
+    resumed = resumeCheckpoint(vm, resumeName);
+    if (resumed != CHECKPOINT_OK) {
+      printf("kplrun: Cannot resume from %s: %s!\n", resumeName, checkpointMessage(resumed));
+      if (in != NULL) fclose(in);
+      freeVM(vm);
+      freeProgram(program);
+      return -1;
+    }
+  }
+
+  if (checkpointName != NULL) {
+    checkpoint = createCheckpoint(checkpointName, program->codeBlock);
+    if (checkpoint == NULL) {
+      printf("kplrun: Can\'t write %s!\n", checkpointName);
+      if (in != NULL) fclose(in);
+      freeVM(vm);
+      freeProgram(program);
+      return -1;
+    }
+    checkpoint->stopAfter = checkpointStop;
+    vm->checkpoint = checkpoint;
+  }
+
+  if (outputName != NULL) {
+    // A resumed program adds to the output it wrote before the checkpoint
+    out = fopen(outputName, (resumeName != NULL) ? "a" : "w");
+    if (out == NULL) {
+      printf("kplrun: Can\'t write output file!\n");
+      if (checkpoint != NULL) freeCheckpoint(checkpoint);
+      if (in != NULL) fclose(in);
+      freeVM(vm);
+      freeProgram(program);
+      return -1;
+    }
+    redirectOutput(vm, out);
+  }
+
+  if (sampler != NULL)
+    startSampler(sampler);
+  if (checkpoint != NULL)
+    startCheckpoints(checkpoint, checkpointInterval);
+  ps = run(vm);
+  if (checkpoint != NULL) {
+    stopCheckpoints(checkpoint);
+    if (ps == PS_INACTIVE)
+      fprintf(stderr, "kplrun: Checkpointed to %s\n", checkpointName);
+    freeCheckpoint(checkpoint);
+  }
+  if (sampler != NULL) {
+    stopSampler(sampler);
+    writeFoldedStacks(sampler, samples);
+    fclose(samples);
+    freeSampler(sampler);
+  }
+  if (profile != NULL) {
+    printProfile(profile, program->codeBlock, stderr);
+    freeProfile(profile);
+  }
+  freeVM(vm);
+  freeProgram(program);
+  switch (ps) {
+  case PS_DIVIDE_BY_ZERO:
+    printf("Runtime error: Divide by zero!\n");
+    break;
+  case PS_STACK_OVERFLOW:
+    printf("Runtime error: Stack overflow!\n");
+    break;
+  case PS_ARITH_OVERFLOW:
+    printf("Runtime error: Arithmetic overflow!\n");
+    break;
+  case PS_HEAP_OVERFLOW:
+    printf("Runtime error: Heap overflow!\n");
+    break;
+  case PS_INVALID_STRING:
+    printf("Runtime error: Invalid string!\n");
+    break;
+  case PS_IO_ERROR:
+    printf("Runtime error: IO error!\n");
+    break;
+  default:
+    break;
+  }
+  if (in != NULL)
+    fclose(in);
+  if (out != NULL)
+    fclose(out);
+  return 0;
+}
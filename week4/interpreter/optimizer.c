@@ -0,0 +1,244 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "optimizer.h"
+#include "verifier.h"
+
+#ifndef _WIN32
+#define MAPPED_CODE
+#include <sys/mman.h>
+#endif
+
+// Nothing falls through these
+static int endsFlow(enum OpCode op) {
+  return (op == OP_J) || (op == OP_HL) || (op == OP_EP) || (op == OP_EF) || (op == OP_EFF) ||
+    (op == OP_TC);
+}
+
+static int isBranch(enum OpCode op) {
+  return (op == OP_J) || (op == OP_FJ) || (op == OP_CALL) || (op == OP_TC);
+}
+
+// x op y in *r, when it fits in a WORD and cannot fail
+static int fold(enum OpCode op, WORD x, WORD y, WORD* r) {
+  long long a = x;
+  long long b = y;
+  long long v;
+
+  switch (op) {
+  case OP_AD: v = a + b; break;
+  case OP_SB: v = a - b; break;
+  case OP_ML: v = a * b; break;
+  case OP_DV:
+    if (b == 0) return 0;
+    v = a / b;
+    break;
+  case OP_EQ: v = (a == b) ? TRUE : FALSE; break;
+  case OP_NE: v = (a != b) ? TRUE : FALSE; break;
+  case OP_GT: v = (a > b) ? TRUE : FALSE; break;
+  case OP_LT: v = (a < b) ? TRUE : FALSE; break;
+  case OP_GE: v = (a >= b) ? TRUE : FALSE; break;
+  case OP_LE: v = (a <= b) ? TRUE : FALSE; break;
+  default: return 0;
+  }
+  if ((v < INT_MIN) || (v > INT_MAX))
+    return 0;
+  *r = (WORD) v;
+  return 1;
+}
+
+static void setLC(Instruction* inst, WORD value) {
+  inst->op = OP_LC;
+  inst->p = DC_VALUE;
+  inst->q = value;
+}
+
+// End of the chain of J that starts at pc; pc itself on a loop of jumps
+static int followJumps(Instruction* code, int n, int pc) {
+  int end = pc;
+  int steps = 0;
+
+  while (code[end].op == OP_J) {
+    if (++ steps > n) return pc;
+    end = code[end].q;
+  }
+  return end;
+}
+
+/*
+ * One pass of the rewrites.  Removed instructions only ever fall through
+ * to the next one left, so a jump to one of them goes there.
+ */
+static int rewrite(CodeBlock* codeBlock, char* target, char* removed) {
+  Instruction* code = codeBlock->code;
+  int n = codeBlock->codeSize;
+  int changed = 0;
+  int pc, q;
+  WORD r;
+
+  // The program can as well start where its first jump goes
+  pc = followJumps(code, n, codeBlock->entry);
+  if (pc != codeBlock->entry) {
+    codeBlock->entry = pc;
+    changed = 1;
+  }
+
+  memset(target, 0, n + 1);
+  target[codeBlock->entry] = 1;
+  for (pc = 0; pc < n; pc ++)
+    if (isBranch(code[pc].op))
+      target[code[pc].q] = 1;
+
+  for (pc = 0; pc < n; pc ++) {
+    if (removed[pc]) continue;
+    switch (code[pc].op) {
+    case OP_LC:
+      if ((pc + 2 < n) && (code[pc+1].op == OP_LC) && !target[pc+1] && !target[pc+2]
+	  && fold(code[pc+2].op, code[pc].q, code[pc+1].q, &r)) {
+	setLC(code + pc + 2, r);
+	removed[pc] = removed[pc+1] = 1;
+	changed = 1;
+      } else if ((pc + 1 < n) && (code[pc+1].op == OP_NEG) && !target[pc+1]
+		 && fold(OP_SB, 0, code[pc].q, &r)) {
+	setLC(code + pc + 1, r);
+	removed[pc] = 1;
+	changed = 1;
+      } else if ((pc + 1 < n) && (code[pc+1].op == OP_FJ) && !target[pc+1]) {
+	if (code[pc].q == FALSE) {
+	  code[pc+1].op = OP_J;
+	  code[pc+1].p = DC_VALUE;
+	} else removed[pc+1] = 1;
+	removed[pc] = 1;
+	changed = 1;
+      }
+      break;
+    case OP_J:
+    case OP_FJ:
+      q = followJumps(code, n, code[pc].q);
+      if (q != code[pc].q) {
+	code[pc].q = q;
+	changed = 1;
+      }
+      if ((code[pc].op == OP_J) && (q == pc + 1)) {
+	removed[pc] = 1;
+	changed = 1;
+      }
+      break;
+    case OP_INT:
+    case OP_DCT:
+      if (code[pc].q == 0) {
+	removed[pc] = 1;
+	changed = 1;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return changed;
+}
+
+// Marks what no path from the entry reaches as removed
+static int removeUnreachable(CodeBlock* codeBlock, char* reached, char* removed, int* work) {
+  Instruction* code = codeBlock->code;
+  int n = codeBlock->codeSize;
+  int top = 0;
+  int changed = 0;
+  int pc;
+
+  memset(reached, 0, n + 1);
+  reached[codeBlock->entry] = 1;
+  work[top++] = codeBlock->entry;
+  while (top > 0) {
+    pc = work[--top];
+    if (isBranch(code[pc].op) && !reached[code[pc].q]) {
+      reached[code[pc].q] = 1;
+      work[top++] = code[pc].q;
+    }
+    if (!endsFlow(code[pc].op) && (pc + 1 < n) && !reached[pc + 1]) {
+      reached[pc + 1] = 1;
+      work[top++] = pc + 1;
+    }
+  }
+
+  for (pc = 0; pc < n; pc ++)
+    if (!reached[pc] && !removed[pc]) {
+      removed[pc] = 1;
+      changed = 1;
+    }
+  return changed;
+}
+
+// Closes the gaps, moving jumps, calls, the entry and the origins along
+static void compactCode(CodeBlock* codeBlock, char* removed, int* origin, int* newPc) {
+  Instruction* code = codeBlock->code;
+  int n = codeBlock->codeSize;
+  int pc, count;
+
+  count = 0;
+  for (pc = 0; pc < n; pc ++) {
+    newPc[pc] = count;
+    if (!removed[pc]) count ++;
+  }
+  newPc[n] = count;
+
+  for (pc = 0; pc < n; pc ++)
+    if (!removed[pc]) {
+      if (isBranch(code[pc].op))
+	code[pc].q = newPc[code[pc].q];
+      code[newPc[pc]] = code[pc];
+      origin[newPc[pc]] = origin[pc];
+    }
+  codeBlock->entry = newPc[codeBlock->entry];
+  codeBlock->codeSize = count;
+}
+
+int* optimizeCode(CodeBlock* codeBlock) {
+  int n = codeBlock->codeSize;
+  int* frameSize;
+  int* origin;
+  int* work;
+  char* marks;
+  char* removed;
+  int errorPc, pc, changed;
+  VerifyCode result;
+
+  frameSize = (int*) malloc((n + 1) * sizeof(int));
+  result = verifyCode(codeBlock, frameSize, &errorPc);
+  free(frameSize);
+  if (result != VERIFY_OK)
+    return NULL;
+
+#ifdef MAPPED_CODE
+  // Only the private copies of the pages it changes get dirty
+  if (codeBlock->mapped)
+    mprotect(codeBlock->image, codeBlock->imageSize, PROT_READ | PROT_WRITE);
+#endif
+
+  origin = (int*) malloc((n + 1) * sizeof(int));
+  work = (int*) malloc((n + 1) * sizeof(int));
+  marks = (char*) malloc(n + 1);
+  removed = (char*) malloc(n + 1);
+  for (pc = 0; pc < n; pc ++)
+    origin[pc] = pc;
+
+  do {
+    memset(removed, 0, codeBlock->codeSize + 1);
+    changed = rewrite(codeBlock, marks, removed);
+    changed |= removeUnreachable(codeBlock, marks, removed, work);
+    if (changed)
+      compactCode(codeBlock, removed, origin, work);
+  } while (changed);
+
+  free(work);
+  free(marks);
+  free(removed);
+  return origin;
+}
@@ -0,0 +1,35 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __OPTIMIZER_H__
+#define __OPTIMIZER_H__
+
+#include "instructions.h"
+
+/*
+ * Bytecode optimizer.  Rewrites a verified (and not fused) code block in
+ * place, as long as something changes:
+ *
+ *   LC a; LC b; AD (SB, ML, DV, EQ ... LE)  ->  LC a op b
+ *   LC a; NEG                               ->  LC -a
+ *   LC 0; FJ x                              ->  J x
+ *   LC c; FJ x, c not 0                     ->  (nothing)
+ *   J x or FJ x, where x is J y             ->  J y or FJ y
+ *   J to the next instruction, INT 0, DCT 0 ->  (nothing)
+ *
+ * moves the entry past the jumps it starts with, and drops the
+ * instructions that no path from the entry reaches.  A constant is only
+ * folded when the result fits in a WORD and the operation cannot fail at
+ * run time.  No pattern spans a jump target, and jumps, calls and the
+ * entry are moved with the instructions they reach.
+ *
+ * Returns the map back to the original code: origin[pc] is the address
+ * of instruction pc before optimizing.  NULL when the block does not
+ * verify, in which case it is left as it was.
+ */
+int* optimizeCode(CodeBlock* codeBlock);
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "output.h"
+
+// Longer than the decimal form of any CELL
+#define MAX_DIGITS ((int) (3 * sizeof(CELL)))
+// Longer than any double printed with %g
+#define MAX_DOUBLE_DIGITS 32
+
+void openOutput(OutputChannel* channel, FILE* f) {
+  channel->file = f;
+  channel->length = 0;
+}
+
+void flushOutput(OutputChannel* channel) {
+  if (channel->length > 0)
+    fwrite(channel->buffer, 1, channel->length, channel->file);
+  channel->length = 0;
+  fflush(channel->file);
+}
+
+void outputChar(OutputChannel* channel, WORD c) {
+  if (channel->length == OUTPUT_BUFFER_SIZE)
+    flushOutput(channel);
+  channel->buffer[channel->length++] = (char) c;
+}
+
+void outputInt(OutputChannel* channel, CELL number) {
+  char digits[MAX_DIGITS];
+  int i = MAX_DIGITS;
+  UCELL n = (number < 0) ? 0u - (UCELL) number : (UCELL) number;
+
+  if (channel->length > OUTPUT_BUFFER_SIZE - MAX_DIGITS)
+    flushOutput(channel);
+  // Digits come out from the right
+  do {
+    digits[--i] = (char) ('0' + n % 10);
+    n /= 10;
+  } while (n != 0);
+  if (number < 0)
+    digits[--i] = '-';
+  memcpy(channel->buffer + channel->length, digits + i, MAX_DIGITS - i);
+  channel->length += MAX_DIGITS - i;
+}
+
+void outputDouble(OutputChannel* channel, double number) {
+  if (channel->length > OUTPUT_BUFFER_SIZE - MAX_DOUBLE_DIGITS)
+    flushOutput(channel);
+  channel->length += snprintf(channel->buffer + channel->length, MAX_DOUBLE_DIGITS, "%g", number);
+}
+
+// Writes the string of a record of the pool or the heap
+void outputString(OutputChannel* channel, WORD* record) {
+  char* s = STRING_CHARS(record);
+  int length = record[0];
+  int n;
+
+  while (length > 0) {
+    if (channel->length == OUTPUT_BUFFER_SIZE)
+      flushOutput(channel);
+    n = OUTPUT_BUFFER_SIZE - channel->length;
+    if (n > length)
+      n = length;
+    memcpy(channel->buffer + channel->length, s, n);
+    channel->length += n;
+    s += n;
+    length -= n;
+  }
+}
+
+void outputLn(OutputChannel* channel) {
+  outputChar(channel, '\n');
+}
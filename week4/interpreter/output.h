@@ -0,0 +1,38 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __OUTPUT_H__
+#define __OUTPUT_H__
+
+#include <stdio.h>
+
+#include "instructions.h"
+
+#define OUTPUT_BUFFER_SIZE 65536
+
+/*
+ * Output of a running program.  OP_WRC, OP_WRI, OP_WRF, OP_WRS and OP_WLN
+ * append to the buffer, which is written to the file when it fills, before the program
+ * reads its input and when it stops.
+ */
+struct OutputChannel_ {
+  FILE* file;
+  int length;
+  char buffer[OUTPUT_BUFFER_SIZE];
+};
+
+typedef struct OutputChannel_ OutputChannel;
+
+void openOutput(OutputChannel* channel, FILE* f);
+void flushOutput(OutputChannel* channel);
+
+void outputChar(OutputChannel* channel, WORD c);
+void outputInt(OutputChannel* channel, CELL number);
+void outputDouble(OutputChannel* channel, double number);
+void outputString(OutputChannel* channel, WORD* record);
+void outputLn(OutputChannel* channel);
+
+#endif
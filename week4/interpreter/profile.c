@@ -0,0 +1,161 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+#include "verifier.h"
+
+Profile* createProfile(CodeBlock* codeBlock) {
+  Profile* profile = (Profile*) malloc(sizeof(Profile));
+  int n = codeBlock->codeSize;
+  CodeInfo info;
+  int errorPc;
+  int pc;
+
+  profile->codeSize = n;
+  // One more slot for a run off the end of the code
+  profile->count = (long long*) calloc(n + 1, sizeof(long long));
+  profile->cycles = (long long*) calloc(n + 1, sizeof(long long));
+  profile->owner = (int*) malloc((n + 1) * sizeof(int));
+  profile->level = (int*) malloc((n + 1) * sizeof(int));
+
+  analyseCode(codeBlock, &info, &errorPc);
+  for (pc = 0; pc <= n; pc ++) {
+    profile->owner[pc] = ((pc < n) && (info.owner != NULL)) ? info.owner[pc] : -1;
+    profile->level[pc] = ((pc < n) && (info.level != NULL)) ? info.level[pc] : -1;
+  }
+  freeCodeInfo(&info);
+  return profile;
+}
+
+void freeProfile(Profile* profile) {
+  free(profile->count);
+  free(profile->cycles);
+  free(profile->owner);
+  free(profile->level);
+  free(profile);
+}
+
+static double percent(long long part, long long total) {
+  return (total > 0) ? 100.0 * part / total : 0.0;
+}
+
+// Mnemonic of an opcode, without operands
+static void opcodeName(char* buffer, enum OpCode op) {
+  Instruction inst;
+  char* space;
+
+  inst.op = op;
+  inst.p = 0;
+  inst.q = 0;
+  buffer[0] = '\0';
+  sprintInstruction(buffer, &inst);
+  space = strchr(buffer, ' ');
+  if (space != NULL) *space = '\0';
+}
+
+struct HotSpot_ {
+  long long cycles;
+  int pc;
+};
+
+typedef struct HotSpot_ HotSpot;
+
+// Hottest first; ties by address
+static int compareHot(const void* a, const void* b) {
+  const HotSpot* x = (const HotSpot*) a;
+  const HotSpot* y = (const HotSpot*) b;
+
+  if (x->cycles != y->cycles)
+    return (x->cycles < y->cycles) ? 1 : -1;
+  return x->pc - y->pc;
+}
+
+static void printProcedures(Profile* profile, FILE* f, long long total) {
+  int n = profile->codeSize;
+  long long* cycles = (long long*) calloc(n, sizeof(long long));
+  long long* count = (long long*) calloc(n, sizeof(long long));
+  int entry, pc;
+
+  for (pc = 0; pc < n; pc ++)
+    if (profile->owner[pc] >= 0) {
+      cycles[profile->owner[pc]] += profile->cycles[pc];
+      count[profile->owner[pc]] += profile->count[pc];
+    }
+
+  fprintf(f, "Flat profile by procedure:\n");
+  fprintf(f, "  %%time %16s %14s  procedure\n", CYCLE_UNIT, "instructions");
+  for (entry = 0; entry < n; entry ++) {
+    if ((profile->level[entry] < 0) || (count[entry] == 0)) continue;
+    fprintf(f, " %6.2f %16lld %14lld  at %d, level %d%s\n", percent(cycles[entry], total),
+	    cycles[entry], count[entry], entry, profile->level[entry],
+	    (profile->level[entry] == 0) ? " (main)" : "");
+  }
+  free(cycles);
+  free(count);
+}
+
+static void printOpcodes(Profile* profile, CodeBlock* codeBlock, FILE* f, long long total) {
+  long long cycles[NUM_OF_OPCODES];
+  long long count[NUM_OF_OPCODES];
+  char name[100];
+  int pc, op;
+
+  memset(cycles, 0, sizeof(cycles));
+  memset(count, 0, sizeof(count));
+  for (pc = 0; pc < profile->codeSize; pc ++) {
+    op = codeBlock->code[pc].op;
+    if ((op < 0) || (op >= NUM_OF_OPCODES)) continue;
+    cycles[op] += profile->cycles[pc];
+    count[op] += profile->count[pc];
+  }
+
+  fprintf(f, "\nFlat profile by opcode:\n");
+  fprintf(f, "  %%time %16s %14s  opcode\n", CYCLE_UNIT, "executions");
+  for (op = 0; op < NUM_OF_OPCODES; op ++) {
+    if (count[op] == 0) continue;
+    opcodeName(name, (enum OpCode) op);
+    fprintf(f, " %6.2f %16lld %14lld  %s\n", percent(cycles[op], total), cycles[op], count[op], name);
+  }
+}
+
+static void printHotSpots(Profile* profile, CodeBlock* codeBlock, FILE* f, long long total) {
+  HotSpot* order = (HotSpot*) malloc(profile->codeSize * sizeof(HotSpot));
+  char s[100];
+  int i, pc;
+
+  for (i = 0; i < profile->codeSize; i ++) {
+    order[i].cycles = profile->cycles[i];
+    order[i].pc = i;
+  }
+  qsort(order, profile->codeSize, sizeof(HotSpot), compareHot);
+
+  fprintf(f, "\nHot spots:\n");
+  fprintf(f, "  %%time %16s %14s  %6s  instruction\n", CYCLE_UNIT, "executions", "pc");
+  for (i = 0; (i < profile->codeSize) && (i < HOT_SPOTS); i ++) {
+    pc = order[i].pc;
+    if (profile->count[pc] == 0) break;
+    sprintInstruction(s, codeBlock->code + pc);
+    fprintf(f, " %6.2f %16lld %14lld  %6d  %s\n", percent(profile->cycles[pc], total),
+	    profile->cycles[pc], profile->count[pc], pc, s);
+  }
+  free(order);
+}
+
+void printProfile(Profile* profile, CodeBlock* codeBlock, FILE* f) {
+  long long total = 0;
+  int pc;
+
+  for (pc = 0; pc <= profile->codeSize; pc ++)
+    total += profile->cycles[pc];
+
+  printProcedures(profile, f, total);
+  printOpcodes(profile, codeBlock, f, total);
+  printHotSpots(profile, codeBlock, f, total);
+}
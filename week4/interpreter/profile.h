@@ -0,0 +1,53 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdio.h>
+#include <time.h>
+
+#include "instructions.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLE_UNIT "cycles"
+static inline long long readCycles(void) {
+  return (long long) __rdtsc();
+}
+#else
+#define CYCLE_UNIT "ns"
+static inline long long readCycles(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+#endif
+
+#define HOT_SPOTS 20
+
+/*
+ * What kplrun -profile gathers: how many times every instruction ran,
+ * and the cycles from its dispatch to the next one.  The procedures are
+ * those of the verifier, so a profile is made before the code is fused.
+ */
+struct Profile_ {
+  int codeSize;
+  long long* count;
+  long long* cycles;
+  int* owner;           // entry of the procedure of each instruction
+  int* level;           // lexical level of each procedure entry
+};
+
+typedef struct Profile_ Profile;
+
+Profile* createProfile(CodeBlock* codeBlock);
+void freeProfile(Profile* profile);
+
+// Flat profiles by procedure and by opcode, then the hottest instructions
+void printProfile(Profile* profile, CodeBlock* codeBlock, FILE* f);
+
+#endif
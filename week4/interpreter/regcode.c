@@ -0,0 +1,636 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "regcode.h"
+#include "verifier.h"
+
+/*
+ * The translator runs through each procedure with a model of its stack:
+ * for every stack word, where its value is.  A value stays a constant, an
+ * address or another register until an instruction needs it in a
+ * register of its own, so that pushes and pops cost nothing.  At the end
+ * of a block every value is stored in its own register, which is all a
+ * jump target assumes.
+ */
+#define IN_REGISTER 0           // in register x
+#define IN_CONSTANT 1           // the constant x
+#define IN_ADDRESS  2           // the address base(x) + y
+
+struct Value_ {
+  int kind;
+  WORD x;
+  WORD y;
+  int stored;                   // also in the register of its own stack word
+};
+
+typedef struct Value_ Value;
+
+struct Translator_ {
+  CodeBlock* codeBlock;
+  CodeInfo info;
+  char* join;                   // jump targets and procedure entries
+  RegisterCode* registers;
+  int capacity;
+  Value* stack;
+  int n;                        // stack height
+  int pc;                       // stack address being translated
+  int blockStart;               // nothing before it may be changed
+};
+
+typedef struct Translator_ Translator;
+
+static int emit(Translator* tr, enum RegOpCode op, WORD a, WORD b, WORD c) {
+  RegisterCode* registers = tr->registers;
+  RegInstruction* inst;
+
+  if (registers->length + 1 >= tr->capacity) {
+    tr->capacity *= 2;
+    registers->code = (RegInstruction*) realloc(registers->code, tr->capacity * sizeof(RegInstruction));
+    registers->origin = (int*) realloc(registers->origin, tr->capacity * sizeof(int));
+    registers->height = (int*) realloc(registers->height, tr->capacity * sizeof(int));
+  }
+  inst = registers->code + registers->length;
+  inst->op = op;
+  inst->a = a;
+  inst->b = b;
+  inst->c = c;
+  registers->origin[registers->length] = tr->pc;
+  registers->height[registers->length] = tr->info.height[tr->pc];
+  return registers->length ++;
+}
+
+// Last instruction, if it is in the current block
+static RegInstruction* lastInstruction(Translator* tr) {
+  if (tr->registers->length <= tr->blockStart) return NULL;
+  return tr->registers->code + tr->registers->length - 1;
+}
+
+static void startBlock(Translator* tr, int pc) {
+  tr->registers->start[pc] = tr->registers->length;
+  tr->blockStart = tr->registers->length;
+}
+
+static void push(Translator* tr, int kind, WORD x, WORD y) {
+  Value* v = tr->stack + tr->n;
+
+  v->kind = kind;
+  v->x = x;
+  v->y = y;
+  v->stored = (kind == IN_REGISTER) && (x == tr->n);
+  tr->n ++;
+}
+
+// The value of stack word i, as a new value on the top
+static void pushCopy(Translator* tr, int i) {
+  Value v = tr->stack[i];
+
+  if (v.kind == IN_REGISTER)
+    push(tr, IN_REGISTER, v.x, 0);
+  else push(tr, v.kind, v.x, v.y);
+}
+
+static void defineRegister(Translator* tr, int i) {
+  tr->stack[i].kind = IN_REGISTER;
+  tr->stack[i].x = i;
+  tr->stack[i].stored = 1;
+}
+
+// Stores the value of stack word i in its own register
+static void store(Translator* tr, int i) {
+  Value* v = tr->stack + i;
+
+  if (v->stored) return;
+  switch (v->kind) {
+  case IN_CONSTANT: emit(tr, R_LDK, i, v->x, 0); break;
+  case IN_ADDRESS: emit(tr, R_LDA, i, v->x, v->y); break;
+  default:
+    // A copy of a variable keeps the value the variable had
+    emit(tr, R_MOV, i, v->x, 0);
+    v->x = i;
+    break;
+  }
+  v->stored = 1;
+}
+
+// The register that holds the value of stack word i
+static WORD operand(Translator* tr, int i) {
+  Value* v = tr->stack + i;
+
+  if (v->kind == IN_REGISTER) return v->x;
+  store(tr, i);
+  return i;
+}
+
+static void storeAll(Translator* tr) {
+  int i;
+  for (i = 0; i < tr->n; i ++)
+    store(tr, i);
+}
+
+// Before register r changes: the values below the top count that were
+// left in it are stored where they belong
+static int copiesOf(Translator* tr, WORD r, int count) {
+  int i, copies = 0;
+  for (i = 0; i < count; i ++)
+    if ((tr->stack[i].kind == IN_REGISTER) && (tr->stack[i].x == r) && (i != r))
+      copies ++;
+  return copies;
+}
+
+static void storeCopies(Translator* tr, WORD r, int count) {
+  int i;
+  for (i = 0; i < count; i ++)
+    if ((tr->stack[i].kind == IN_REGISTER) && (tr->stack[i].x == r) && (i != r))
+      store(tr, i);
+}
+
+// Before an unknown store or a call, which may change any variable
+static void storeVariables(Translator* tr, int count) {
+  int i;
+  for (i = 0; i < count; i ++)
+    if (tr->stack[i].kind == IN_REGISTER)
+      store(tr, i);
+}
+
+static int writesA(enum RegOpCode op) {
+  switch (op) {
+  case R_MOV: case R_LDK: case R_LDA: case R_LDO: case R_LDI:
+  case R_ADD: case R_SUB: case R_MUL: case R_DIV: case R_ADDK: case R_MULK: case R_NEG:
+  case R_EQ: case R_NE: case R_GT: case R_LT: case R_GE: case R_LE:
+  case R_RC: case R_RI:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+// ST to the variable in register r of the value on the top
+static void storeVariable(Translator* tr, WORD r) {
+  int top = tr->n - 1;
+  Value* v = tr->stack + top;
+  RegInstruction* last = lastInstruction(tr);
+  int below = tr->n - 2;
+
+  if ((v->kind == IN_REGISTER) && (v->x == r))
+    return;
+  // The instruction that computed the value can write it to r directly
+  if ((v->kind == IN_REGISTER) && (v->x == top) && (last != NULL)
+      && writesA(last->op) && (last->a == top) && (copiesOf(tr, r, below) == 0)) {
+    last->a = r;
+    return;
+  }
+  storeCopies(tr, r, below);
+  switch (v->kind) {
+  case IN_CONSTANT: emit(tr, R_LDK, r, v->x, 0); break;
+  case IN_ADDRESS: emit(tr, R_LDA, r, v->x, v->y); break;
+  default: emit(tr, R_MOV, r, v->x, 0); break;
+  }
+}
+
+static void translateST(Translator* tr) {
+  Value* address = tr->stack + tr->n - 2;
+  Value* v = tr->stack + tr->n - 1;
+  RegInstruction* last;
+  WORD ra, rv;
+  int below = tr->n - 2;
+
+  if ((address->kind == IN_ADDRESS) && (address->x == 0) && (address->y < below)) {
+    storeVariable(tr, address->y);
+    defineRegister(tr, address->y);
+  } else if ((address->kind == IN_ADDRESS) && (address->x > 0)) {
+    emit(tr, R_STO, operand(tr, below + 1), address->x, address->y);
+  } else {
+    storeVariables(tr, below);
+    ra = operand(tr, below);
+    rv = operand(tr, below + 1);
+    last = lastInstruction(tr);
+    // LDI x,a; ADDK x,x,c; STI x,a is the increment of a FOR loop
+    if ((v->kind == IN_REGISTER) && (rv == below + 1) && (last != NULL)
+	&& (last->op == R_ADDK) && (last->a == rv) && (last->b == rv)
+	&& (tr->registers->length - 2 >= tr->blockStart)
+	&& (last[-1].op == R_LDI) && (last[-1].a == rv) && (last[-1].b == ra)) {
+      tr->registers->length -= 2;
+      emit(tr, R_INCI, 0, ra, last->c);
+    } else emit(tr, R_STI, rv, ra, 0);
+  }
+  tr->n -= 2;
+}
+
+// A folded value becomes an operand, which is a WORD even if cells are
+// wider; WORD cells wrap, so everything fits
+#ifdef WIDE_CELLS
+#define FITS_WORD(v)  (((v) >= INT_MIN) && ((v) <= INT_MAX))
+#else
+#define FITS_WORD(v)  TRUE
+#endif
+
+static CELL fold(enum OpCode op, WORD x, WORD y) {
+  switch (op) {
+#ifdef WIDE_CELLS
+  case OP_AD: return (CELL) x + y;
+  case OP_SB: return (CELL) x - y;
+  case OP_ML: return (CELL) x * y;
+#else
+  case OP_AD: return (WORD) ((unsigned int) x + (unsigned int) y);
+  case OP_SB: return (WORD) ((unsigned int) x - (unsigned int) y);
+  case OP_ML: return (WORD) ((unsigned int) x * (unsigned int) y);
+#endif
+  case OP_DV: return x / y;
+  case OP_EQ: return x == y;
+  case OP_NE: return x != y;
+  case OP_GT: return x > y;
+  case OP_LT: return x < y;
+  case OP_GE: return x >= y;
+  default: return x <= y;
+  }
+}
+
+static enum RegOpCode registerOp(enum OpCode op) {
+  switch (op) {
+  case OP_AD: return R_ADD;
+  case OP_SB: return R_SUB;
+  case OP_ML: return R_MUL;
+  case OP_DV: return R_DIV;
+  case OP_EQ: return R_EQ;
+  case OP_NE: return R_NE;
+  case OP_GT: return R_GT;
+  case OP_LT: return R_LT;
+  case OP_GE: return R_GE;
+  default: return R_LE;
+  }
+}
+
+static void translateBinary(Translator* tr, enum OpCode op) {
+  int d = tr->n - 2;
+  Value* x = tr->stack + d;
+  Value* y = tr->stack + d + 1;
+  WORD rx, ry;
+
+  if ((x->kind == IN_CONSTANT) && (y->kind == IN_CONSTANT)
+      && ((op != OP_DV) || ((y->x != 0) && !((x->x == INT_MIN) && (y->x == -1))))
+      && FITS_WORD(fold(op, x->x, y->x))) {
+    tr->n -= 2;
+    push(tr, IN_CONSTANT, (WORD) fold(op, x->x, y->x), 0);
+    return;
+  }
+
+  if ((y->kind == IN_CONSTANT) && ((op == OP_AD) || (op == OP_ML)
+				   || ((op == OP_SB) && FITS_WORD(- (CELL) y->x)))) {
+    rx = operand(tr, d);
+    if (op == OP_ML)
+      emit(tr, R_MULK, d, rx, y->x);
+    else emit(tr, R_ADDK, d, rx, (op == OP_AD) ? y->x : (WORD) (0u - (unsigned int) y->x));
+  } else if ((x->kind == IN_CONSTANT) && ((op == OP_AD) || (op == OP_ML))) {
+    ry = operand(tr, d + 1);
+    emit(tr, (op == OP_AD) ? R_ADDK : R_MULK, d, ry, x->x);
+  } else {
+    rx = operand(tr, d);
+    ry = operand(tr, d + 1);
+    emit(tr, registerOp(op), d, rx, ry);
+  }
+  tr->n = d + 1;
+  defineRegister(tr, d);
+}
+
+// Branch taken when the comparison op fails, and the same with the
+// operands swapped
+static enum RegOpCode failBranch(enum OpCode op, int swapped) {
+  switch (op) {
+  case OP_EQ: return R_BNE;
+  case OP_NE: return R_BEQ;
+  case OP_GT: return swapped ? R_BGE : R_BLE;
+  case OP_LT: return swapped ? R_BLE : R_BGE;
+  case OP_GE: return swapped ? R_BGT : R_BLT;
+  default: return swapped ? R_BLT : R_BGT;
+  }
+}
+
+// A comparison and the FJ after it, as one branch
+static void translateBranch(Translator* tr, enum OpCode op, WORD target) {
+  int d = tr->n - 2;
+  Value x = tr->stack[d];
+  Value y = tr->stack[d + 1];
+  enum RegOpCode branch;
+  WORD rx, ry;
+
+  if (y.kind == IN_CONSTANT) {
+    rx = operand(tr, d);
+    tr->n = d;
+    storeAll(tr);
+    branch = failBranch(op, 0);
+    emit(tr, (enum RegOpCode) (branch + R_BEQK - R_BEQ), rx, y.x, target);
+  } else if (x.kind == IN_CONSTANT) {
+    ry = operand(tr, d + 1);
+    tr->n = d;
+    storeAll(tr);
+    branch = failBranch(op, 1);
+    emit(tr, (enum RegOpCode) (branch + R_BEQK - R_BEQ), ry, x.x, target);
+  } else {
+    rx = operand(tr, d);
+    ry = operand(tr, d + 1);
+    tr->n = d;
+    storeAll(tr);
+    emit(tr, failBranch(op, 0), rx, ry, target);
+  }
+}
+
+static void translateFJ(Translator* tr, WORD target) {
+  Value* cond = tr->stack + tr->n - 1;
+  WORD r;
+
+  if (cond->kind == IN_CONSTANT) {
+    tr->n --;
+    storeAll(tr);
+    if (cond->x == FALSE)
+      emit(tr, R_J, 0, 0, target);
+    return;
+  }
+  r = operand(tr, tr->n - 1);
+  tr->n --;
+  storeAll(tr);
+  emit(tr, R_JF, r, 0, target);
+}
+
+static void translateLoad(Translator* tr, WORD p, WORD q) {
+  if (p > 0) {
+    emit(tr, R_LDO, tr->n, p, q);
+    push(tr, IN_REGISTER, tr->n, 0);
+  } else if (q < tr->n)
+    pushCopy(tr, q);
+  else {
+    emit(tr, R_MOV, tr->n, q, 0);
+    push(tr, IN_REGISTER, tr->n, 0);
+  }
+}
+
+// Translates the instruction at pc; returns the number of instructions used
+static int translateInstruction(Translator* tr, int pc) {
+  Instruction* inst = tr->codeBlock->code + pc;
+  Instruction* next = inst + 1;
+  int top = tr->n - 1;
+  Value v;
+  WORD r;
+  int i;
+
+  switch (inst->op) {
+  case OP_LA:
+    push(tr, IN_ADDRESS, inst->p, inst->q);
+    break;
+  case OP_LV:
+    translateLoad(tr, inst->p, inst->q);
+    break;
+  case OP_LC:
+    push(tr, IN_CONSTANT, inst->q, 0);
+    break;
+  case OP_LI:
+    v = tr->stack[top];
+    tr->n --;
+    if (v.kind == IN_ADDRESS)
+      translateLoad(tr, v.x, v.y);
+    else {
+      tr->n ++;
+      r = operand(tr, top);
+      emit(tr, R_LDI, top, r, 0);
+      defineRegister(tr, top);
+    }
+    break;
+  case OP_INT:
+    for (i = 0; i < inst->q; i ++)
+      push(tr, IN_REGISTER, tr->n, 0);
+    break;
+  case OP_DCT:
+    // What is left above the top is the arguments of a call
+    for (i = tr->n - inst->q; i < tr->n; i ++)
+      store(tr, i);
+    tr->n -= inst->q;
+    break;
+  case OP_J:
+    storeAll(tr);
+    emit(tr, R_J, 0, 0, inst->q);
+    break;
+  case OP_FJ:
+    translateFJ(tr, inst->q);
+    break;
+  case OP_HL:
+    emit(tr, R_HL, 0, 0, 0);
+    break;
+  case OP_ST:
+    translateST(tr);
+    break;
+  case OP_CALL:
+    storeAll(tr);
+    emit(tr, R_CALL, inst->p, inst->q, tr->n);
+    if (tr->info.height[pc + 1] > tr->n)
+      push(tr, IN_REGISTER, tr->n, 0);
+    // Returns come back here, with every value stored
+    startBlock(tr, pc + 1);
+    break;
+  case OP_EP:
+    emit(tr, R_EP, 0, 0, 0);
+    break;
+  case OP_EF:
+    if (tr->n > 0)
+      store(tr, 0);
+    emit(tr, R_EF, 0, 0, 0);
+    break;
+  case OP_TC:
+    storeAll(tr);
+    emit(tr, R_TC, inst->p, inst->q, tr->n - inst->p);
+    break;
+  case OP_RC:
+  case OP_RI:
+    emit(tr, (inst->op == OP_RC) ? R_RC : R_RI, tr->n, 0, 0);
+    push(tr, IN_REGISTER, tr->n, 0);
+    break;
+  case OP_WRC:
+  case OP_WRI:
+    emit(tr, (inst->op == OP_WRC) ? R_WRC : R_WRI, operand(tr, top), 0, 0);
+    tr->n --;
+    break;
+  case OP_WLN:
+    emit(tr, R_WLN, 0, 0, 0);
+    break;
+  case OP_AD: case OP_SB: case OP_ML: case OP_DV:
+    translateBinary(tr, inst->op);
+    break;
+  case OP_EQ: case OP_NE: case OP_GT: case OP_LT: case OP_GE: case OP_LE:
+    if ((pc + 1 < tr->codeBlock->codeSize) && (next->op == OP_FJ) && !tr->join[pc + 1]
+	&& !((tr->stack[top - 1].kind == IN_CONSTANT) && (tr->stack[top].kind == IN_CONSTANT))) {
+      translateBranch(tr, inst->op, next->q);
+      return 2;
+    }
+    translateBinary(tr, inst->op);
+    break;
+  case OP_NEG:
+    v = tr->stack[top];
+    tr->n --;
+    if ((v.kind == IN_CONSTANT) && FITS_WORD(- (CELL) v.x))
+      push(tr, IN_CONSTANT, (WORD) (0u - (unsigned int) v.x), 0);
+    else {
+      tr->n ++;
+      emit(tr, R_NEG, top, operand(tr, top), 0);
+      defineRegister(tr, top);
+    }
+    break;
+  case OP_CV:
+    pushCopy(tr, top);
+    break;
+  case OP_BP:
+    storeAll(tr);
+    emit(tr, R_BP, 0, 0, 0);
+    startBlock(tr, pc + 1);
+    break;
+  default:
+    break;
+  }
+  return 1;
+}
+
+static int fallsThrough(enum OpCode op) {
+  return (op != OP_J) && (op != OP_HL) && (op != OP_EP) && (op != OP_EF) && (op != OP_TC);
+}
+
+static int isJump(enum RegOpCode op) {
+  return (op == R_J) || (op == R_JF) || ((op >= R_BEQ) && (op <= R_BLEK));
+}
+
+RegisterCode* translateRegisters(CodeBlock* codeBlock) {
+  Translator tr;
+  RegisterCode* registers;
+  Instruction* code = codeBlock->code;
+  int n = codeBlock->codeSize;
+  int errorPc, pc, i, maxHeight, live;
+
+  for (pc = 0; pc < n; pc ++)
+    if ((code[pc].op > OP_BP) && (code[pc].op != OP_TC))
+      return NULL;
+  if (analyseCode(codeBlock, &tr.info, &errorPc) != VERIFY_OK) {
+    freeCodeInfo(&tr.info);
+    return NULL;
+  }
+
+  tr.codeBlock = codeBlock;
+  tr.join = (char*) calloc(n + 1, 1);
+  tr.join[codeBlock->entry] = 1;
+  maxHeight = 0;
+  for (pc = 0; pc < n; pc ++) {
+    if ((tr.info.owner[pc] >= 0)
+	&& ((code[pc].op == OP_J) || (code[pc].op == OP_FJ) || (code[pc].op == OP_CALL)
+	    || (code[pc].op == OP_TC)))
+      tr.join[code[pc].q] = 1;
+    if (tr.info.frameSize[pc] > maxHeight)
+      maxHeight = tr.info.frameSize[pc];
+  }
+  tr.stack = (Value*) malloc((maxHeight + 1) * sizeof(Value));
+
+  registers = (RegisterCode*) malloc(sizeof(RegisterCode));
+  tr.registers = registers;
+  tr.capacity = n + 16;
+  registers->code = (RegInstruction*) malloc(tr.capacity * sizeof(RegInstruction));
+  registers->origin = (int*) malloc(tr.capacity * sizeof(int));
+  registers->height = (int*) malloc(tr.capacity * sizeof(int));
+  registers->start = (int*) malloc((n + 1) * sizeof(int));
+  registers->codeSize = n;
+  registers->length = 0;
+  for (pc = 0; pc <= n; pc ++)
+    registers->start[pc] = -1;
+
+  tr.n = 0;
+  tr.blockStart = 0;
+  live = 0;
+  pc = 0;
+  while (pc < n) {
+    if (tr.info.owner[pc] < 0) {
+      live = 0;
+      pc ++;
+      continue;
+    }
+    tr.pc = pc;
+    if (tr.join[pc]) {
+      if (live) storeAll(&tr);
+      startBlock(&tr, pc);
+      tr.n = 0;
+      for (i = 0; i < tr.info.height[pc]; i ++)
+	push(&tr, IN_REGISTER, i, 0);
+    }
+    i = translateInstruction(&tr, pc);
+    pc += i;
+    live = fallsThrough(code[pc - 1].op);
+  }
+  tr.pc = 0;
+  emit(&tr, R_HL, 0, 0, 0);
+  registers->length --;
+
+  for (i = 0; i < registers->length; i ++)
+    if (isJump(registers->code[i].op))
+      registers->code[i].c = registers->start[registers->code[i].c];
+
+  free(tr.join);
+  free(tr.stack);
+  freeCodeInfo(&tr.info);
+  return registers;
+}
+
+void freeRegisters(RegisterCode* registers) {
+  if (registers == NULL) return;
+  free(registers->code);
+  free(registers->start);
+  free(registers->origin);
+  free(registers->height);
+  free(registers);
+}
+
+static char* regOpNames[NUM_OF_REG_OPCODES] = {
+  "MOV", "LDK", "LDA", "LDO", "STO", "LDI", "STI", "INCI",
+  "ADD", "SUB", "MUL", "DIV", "ADDK", "MULK", "NEG",
+  "EQ", "NE", "GT", "LT", "GE", "LE",
+  "J", "JF", "BEQ", "BNE", "BGT", "BLT", "BGE", "BLE",
+  "BEQK", "BNEK", "BGTK", "BLTK", "BGEK", "BLEK",
+  "CALL", "EP", "EF", "TC", "RC", "RI", "WRC", "WRI", "WLN", "HL", "BP"
+};
+
+void sprintRegInstruction(char* buffer, RegInstruction* inst) {
+  char* name = ((inst->op >= 0) && (inst->op < NUM_OF_REG_OPCODES)) ? regOpNames[inst->op] : "?";
+
+  switch (inst->op) {
+  case R_MOV: case R_LDK: case R_LDI: case R_STI: case R_NEG:
+    sprintf(buffer, "%s %d,%d", name, inst->a, inst->b);
+    break;
+  case R_INCI:
+    sprintf(buffer, "%s %d,%d", name, inst->b, inst->c);
+    break;
+  case R_J:
+    sprintf(buffer, "%s %d", name, inst->c);
+    break;
+  case R_JF:
+    sprintf(buffer, "%s %d,%d", name, inst->a, inst->c);
+    break;
+  case R_RC: case R_RI: case R_WRC: case R_WRI:
+    sprintf(buffer, "%s %d", name, inst->a);
+    break;
+  case R_EP: case R_EF: case R_WLN: case R_HL: case R_BP:
+    sprintf(buffer, "%s", name);
+    break;
+  default:
+    sprintf(buffer, "%s %d,%d,%d", name, inst->a, inst->b, inst->c);
+    break;
+  }
+}
+
+void printRegisterCode(RegisterCode* registers) {
+  char s[100];
+  int i;
+
+  for (i = 0; i < registers->length; i ++) {
+    sprintRegInstruction(s, registers->code + i);
+    printf("%d:  %s\n", i, s);
+  }
+}
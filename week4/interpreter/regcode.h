@@ -0,0 +1,106 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __REGCODE_H__
+#define __REGCODE_H__
+
+#include "instructions.h"
+
+/*
+ * Register code: a three-address form of the stack code.  Register x of
+ * a procedure is the stack word b + x of its frame, so the locals and the
+ * evaluation stack of the stack code are both registers, and frames,
+ * calls and returns are exactly those of the stack code.  r[x] below is
+ * s[b + x].  Targets (c of jumps) are register code addresses; CALL keeps
+ * the stack address of its callee.
+ */
+enum RegOpCode {
+  R_MOV,   // Move              r[a] := r[b];
+  R_LDK,   // Load Constant     r[a] := b;
+  R_LDA,   // Load Address      r[a] := base(b) + c;
+  R_LDO,   // Load Outer        r[a] := s[base(b) + c];
+  R_STO,   // Store Outer       s[base(b) + c] := r[a];
+  R_LDI,   // Load Indirect     r[a] := s[r[b]];
+  R_STI,   // Store Indirect    s[r[b]] := r[a];
+  R_INCI,  // Increment         s[r[b]] := s[r[b]] + c;
+  R_ADD,   // Add               r[a] := r[b] + r[c];
+  R_SUB,   // Substract         r[a] := r[b] - r[c];
+  R_MUL,   // Multiple          r[a] := r[b] * r[c];
+  R_DIV,   // Divide            r[a] := r[b] / r[c];
+  R_ADDK,  // Add Constant      r[a] := r[b] + c;
+  R_MULK,  // Multiple Constant r[a] := r[b] * c;
+  R_NEG,   // Negative          r[a] := - r[b];
+  R_EQ,    // Equal             r[a] := r[b] = r[c];
+  R_NE,    // Not Equal         r[a] := r[b] != r[c];
+  R_GT,    // Greater           r[a] := r[b] > r[c];
+  R_LT,    // Less              r[a] := r[b] < r[c];
+  R_GE,    // Greater or Equal  r[a] := r[b] >= r[c];
+  R_LE,    // Less or Equal     r[a] := r[b] <= r[c];
+  R_J,     // Jump              pc := c;
+  R_JF,    // False Jump        if r[a] = 0 then pc := c;
+  R_BEQ,   // Branch            if r[a] = r[b] then pc := c;
+  R_BNE,   //                   if r[a] != r[b] then pc := c;
+  R_BGT,   //                   if r[a] > r[b] then pc := c;
+  R_BLT,   //                   if r[a] < r[b] then pc := c;
+  R_BGE,   //                   if r[a] >= r[b] then pc := c;
+  R_BLE,   //                   if r[a] <= r[b] then pc := c;
+  R_BEQK,  // Branch Constant   if r[a] = b then pc := c;
+  R_BNEK,  //                   if r[a] != b then pc := c;
+  R_BGTK,  //                   if r[a] > b then pc := c;
+  R_BLTK,  //                   if r[a] < b then pc := c;
+  R_BGEK,  //                   if r[a] >= b then pc := c;
+  R_BLEK,  //                   if r[a] <= b then pc := c;
+  R_CALL,  // Call              as OP_CALL a,b, with the callee frame at register c
+           //                   instead of t + 1
+  R_EP,    // Exit Procedure    as OP_EP
+  R_EF,    // Exit Function     as OP_EF
+  R_TC,    // Tail Call         as OP_TC a,b, with the arguments from register c
+           //                   instead of t - a + 1
+  R_RC,    // Read Char         r[a] := read one character;
+  R_RI,    // Read Integer      r[a] := read integer;
+  R_WRC,   // Write Char        write one character from r[a];
+  R_WRI,   // Write Int         write integer from r[a];
+  R_WLN,   // WriteLN           CR/LF
+  R_HL,    // Halt              Halt
+  R_BP     // Break point. Stops at the OP_BP it was translated from
+};
+
+#define NUM_OF_REG_OPCODES (R_BP + 1)
+
+struct RegInstruction_ {
+  enum RegOpCode op;
+  WORD a;
+  WORD b;
+  WORD c;
+};
+
+typedef struct RegInstruction_ RegInstruction;
+
+struct RegisterCode_ {
+  RegInstruction* code;
+  int length;                   // without the final R_HL
+  int codeSize;                 // of the stack code
+  // Register address of every stack address where the register code can
+  // be entered (procedure entries, jump targets, return addresses), or -1
+  int* start;
+  int* origin;                  // stack address each instruction comes from
+  int* height;                  // stack height at that address
+};
+
+typedef struct RegisterCode_ RegisterCode;
+
+/*
+ * Translates a verified (and not fused) code block into register code.
+ * Returns NULL when the block does not verify, or when it uses doubles
+ * or strings, which have no register form.
+ */
+RegisterCode* translateRegisters(CodeBlock* codeBlock);
+void freeRegisters(RegisterCode* registers);
+
+void sprintRegInstruction(char* buffer, RegInstruction* instruction);
+void printRegisterCode(RegisterCode* registers);
+
+#endif
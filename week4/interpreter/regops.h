@@ -0,0 +1,271 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/*
+ * Opcode handlers of the register code (see regcode.h).
+ *
+ * Like vmops.h, this file is included inside the body of the register
+ * loops in vm.c.  Before including it, the loop defines
+ *
+ *   CASE(op)        start of the handler for op
+ *   NEXT            continue with the following instruction
+ *   JUMP(addr)      continue with the instruction at register address addr
+ *   STOP            leave the loop (vm->ps has been updated)
+ *   ENTER_DEBUGGER  hand control to the debugging loop
+ *   A, B, C, PC     operands and address of the current instruction
+ *   BASE(p)         base of the frame p static levels out
+ *   R(x)            register x of the current frame
+ *   START(pc)       register address of the stack address pc
+ *   ORIGIN          stack address of the current instruction
+ *
+ * and provides the context vm and the locals stack, b, number, disp and
+ * link of the stack loops, FRAME_FITS and ADD_OVERFLOWS and the like.
+ * R(x) is stack word b + x, so frames are laid out as in the stack code.
+ */
+
+CASE(R_MOV)
+  R(A) = R(B);
+  NEXT;
+
+CASE(R_LDK)
+  R(A) = B;
+  NEXT;
+
+CASE(R_LDA)
+  R(A) = BASE(B) + C;
+  NEXT;
+
+CASE(R_LDO)
+  R(A) = stack[BASE(B) + C];
+  NEXT;
+
+CASE(R_STO)
+  stack[BASE(B) + C] = R(A);
+  NEXT;
+
+CASE(R_LDI)
+  R(A) = stack[R(B)];
+  NEXT;
+
+CASE(R_STI)
+  stack[R(B)] = R(A);
+  NEXT;
+
+CASE(R_INCI)
+  if (ADD_OVERFLOWS(stack[R(B)], stack[R(B)], C)) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  NEXT;
+
+CASE(R_ADD)
+  if (ADD_OVERFLOWS(R(A), R(B), R(C))) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  NEXT;
+
+CASE(R_SUB)
+  if (SUB_OVERFLOWS(R(A), R(B), R(C))) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  NEXT;
+
+CASE(R_MUL)
+  if (MUL_OVERFLOWS(R(A), R(B), R(C))) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  NEXT;
+
+CASE(R_DIV)
+  if (R(C) == 0) {
+    vm->ps = PS_DIVIDE_BY_ZERO;
+    STOP;
+  }
+  if (DIV_OVERFLOWS(R(B), R(C))) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  R(A) = R(B) / R(C);
+  NEXT;
+
+CASE(R_ADDK)
+  if (ADD_OVERFLOWS(R(A), R(B), C)) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  NEXT;
+
+CASE(R_MULK)
+  if (MUL_OVERFLOWS(R(A), R(B), C)) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  NEXT;
+
+CASE(R_NEG)
+  if (SUB_OVERFLOWS(R(A), 0, R(B))) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  NEXT;
+
+CASE(R_EQ)
+  R(A) = (R(B) == R(C)) ? TRUE : FALSE;
+  NEXT;
+
+CASE(R_NE)
+  R(A) = (R(B) != R(C)) ? TRUE : FALSE;
+  NEXT;
+
+CASE(R_GT)
+  R(A) = (R(B) > R(C)) ? TRUE : FALSE;
+  NEXT;
+
+CASE(R_LT)
+  R(A) = (R(B) < R(C)) ? TRUE : FALSE;
+  NEXT;
+
+CASE(R_GE)
+  R(A) = (R(B) >= R(C)) ? TRUE : FALSE;
+  NEXT;
+
+CASE(R_LE)
+  R(A) = (R(B) <= R(C)) ? TRUE : FALSE;
+  NEXT;
+
+CASE(R_J)
+  JUMP(C);
+
+CASE(R_JF)
+  if (R(A) == FALSE)
+    JUMP(C);
+  NEXT;
+
+CASE(R_BEQ)
+  if (R(A) == R(B))
+    JUMP(C);
+  NEXT;
+
+CASE(R_BNE)
+  if (R(A) != R(B))
+    JUMP(C);
+  NEXT;
+
+CASE(R_BGT)
+  if (R(A) > R(B))
+    JUMP(C);
+  NEXT;
+
+CASE(R_BLT)
+  if (R(A) < R(B))
+    JUMP(C);
+  NEXT;
+
+CASE(R_BGE)
+  if (R(A) >= R(B))
+    JUMP(C);
+  NEXT;
+
+CASE(R_BLE)
+  if (R(A) <= R(B))
+    JUMP(C);
+  NEXT;
+
+CASE(R_BEQK)
+  if (R(A) == B)
+    JUMP(C);
+  NEXT;
+
+CASE(R_BNEK)
+  if (R(A) != B)
+    JUMP(C);
+  NEXT;
+
+CASE(R_BGTK)
+  if (R(A) > B)
+    JUMP(C);
+  NEXT;
+
+CASE(R_BLTK)
+  if (R(A) < B)
+    JUMP(C);
+  NEXT;
+
+CASE(R_BGEK)
+  if (R(A) >= B)
+    JUMP(C);
+  NEXT;
+
+CASE(R_BLEK)
+  if (R(A) <= B)
+    JUMP(C);
+  NEXT;
+
+CASE(R_CALL)
+  number = b + C;                 // Base of the callee
+  if (!FRAME_FITS(number, B)) {
+    vm->ps = PS_STACK_OVERFLOW;
+    STOP;
+  }
+  stack[number+1] = b;            // Dynamic Link
+  stack[number+2] = ORIGIN;       // Return Address, in the stack code
+  stack[number+3] = BASE(A);      // Static Link
+  b = number;
+  link->display = disp;
+  disp += 1 - A;
+  link->base = *disp;
+  *disp = b;
+  link ++;
+  JUMP(START(B));
+
+CASE(R_EP)
+CASE(R_EF)
+  number = stack[b+2];            // Saved return address
+  b = stack[b+1];                 // Saved base
+  link --;
+  *disp = link->base;
+  disp = link->display;
+  JUMP(START(number + 1));
+
+CASE(R_TC)
+  if (!FRAME_FITS(b, B)) {
+    vm->ps = PS_STACK_OVERFLOW;
+    STOP;
+  }
+  for (number = 0; number < A; number ++)
+    R(4 + number) = R(C + number);
+  JUMP(START(B));
+
+CASE(R_RC)
+  R(A) = inputChar(&vm->input);
+  NEXT;
+
+CASE(R_RI)
+  R(A) = inputInt(&vm->input);
+  NEXT;
+
+CASE(R_WRC)
+  outputChar(&vm->output, R(A));
+  NEXT;
+
+CASE(R_WRI)
+  outputInt(&vm->output, R(A));
+  NEXT;
+
+CASE(R_WLN)
+  outputLn(&vm->output);
+  NEXT;
+
+CASE(R_HL)
+  vm->ps = PS_NORMAL_EXIT;
+  STOP;
+
+CASE(R_BP)
+  vm->debugMode = 1;
+  ENTER_DEBUGGER;
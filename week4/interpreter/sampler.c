@@ -0,0 +1,187 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "sampler.h"
+#include "verifier.h"
+
+#define INITIAL_CAPACITY 64
+
+volatile sig_atomic_t sampleDue = 0;
+
+struct FoldedStack_ {
+  int* frames;          // procedure entries, outermost first; NULL if the slot is free
+  int depth;
+  unsigned int hash;
+  long long count;
+};
+
+Sampler* createSampler(CodeBlock* codeBlock) {
+  Sampler* sampler = (Sampler*) malloc(sizeof(Sampler));
+  int n = codeBlock->codeSize;
+  CodeInfo info;
+  int errorPc;
+  int pc;
+
+  sampler->codeSize = n;
+  sampler->owner = (int*) malloc((n + 1) * sizeof(int));
+  sampler->level = (int*) malloc((n + 1) * sizeof(int));
+  analyseCode(codeBlock, &info, &errorPc);
+  for (pc = 0; pc <= n; pc ++) {
+    sampler->owner[pc] = ((pc < n) && (info.owner != NULL)) ? info.owner[pc] : -1;
+    sampler->level[pc] = ((pc < n) && (info.level != NULL)) ? info.level[pc] : -1;
+  }
+  freeCodeInfo(&info);
+
+  sampler->capacity = INITIAL_CAPACITY;
+  sampler->stacks = (FoldedStack*) calloc(sampler->capacity, sizeof(FoldedStack));
+  sampler->stackCount = 0;
+  sampler->samples = 0;
+  return sampler;
+}
+
+void freeSampler(Sampler* sampler) {
+  int i;
+
+  for (i = 0; i < sampler->capacity; i ++)
+    free(sampler->stacks[i].frames);
+  free(sampler->stacks);
+  free(sampler->owner);
+  free(sampler->level);
+  free(sampler);
+}
+
+static void onTimer(int sig) {
+  sampleDue = 1;
+}
+
+void startSampler(Sampler* sampler) {
+  struct sigaction action;
+  struct itimerval timer;
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = onTimer;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGPROF, &action, NULL);
+
+  sampleDue = 0;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = SAMPLE_INTERVAL;
+  timer.it_value = timer.it_interval;
+  setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+void stopSampler(Sampler* sampler) {
+  struct itimerval timer;
+
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+  signal(SIGPROF, SIG_DFL);
+  sampleDue = 0;
+}
+
+static unsigned int hashFrames(int* frames, int depth) {
+  unsigned int hash = 5381;
+  int i;
+
+  for (i = 0; i < depth; i ++)
+    hash = hash * 33 + (unsigned int) frames[i];
+  return hash;
+}
+
+// Slot of the stack, or the free slot where it belongs
+static FoldedStack* findStack(Sampler* sampler, int* frames, int depth, unsigned int hash) {
+  FoldedStack* slot;
+  int i = hash & (sampler->capacity - 1);
+
+  for (;;) {
+    slot = sampler->stacks + i;
+    if (slot->frames == NULL)
+      return slot;
+    if ((slot->hash == hash) && (slot->depth == depth)
+	&& (memcmp(slot->frames, frames, depth * sizeof(int)) == 0))
+      return slot;
+    i = (i + 1) & (sampler->capacity - 1);
+  }
+}
+
+static void growTable(Sampler* sampler) {
+  FoldedStack* old = sampler->stacks;
+  int oldCapacity = sampler->capacity;
+  int i;
+
+  sampler->capacity *= 2;
+  sampler->stacks = (FoldedStack*) calloc(sampler->capacity, sizeof(FoldedStack));
+  for (i = 0; i < oldCapacity; i ++)
+    if (old[i].frames != NULL)
+      *findStack(sampler, old[i].frames, old[i].depth, old[i].hash) = old[i];
+  free(old);
+}
+
+void takeSample(Sampler* sampler, CELL* stack, int pc, int b) {
+  int inner[MAX_SAMPLE_DEPTH];
+  int frames[MAX_SAMPLE_DEPTH];
+  int depth = 0;
+  int i, returnPc;
+  unsigned int hash;
+  FoldedStack* slot;
+
+  if ((pc < 0) || (pc >= sampler->codeSize)) return;
+  inner[depth++] = sampler->owner[pc];
+  // The main program's frame is at 0, and every caller's frame is below
+  // its callee's
+  while ((b > 0) && (depth < MAX_SAMPLE_DEPTH)) {
+    returnPc = stack[b + 2];
+    if ((returnPc < 0) || (returnPc >= sampler->codeSize) || (stack[b + 1] >= b)) break;
+    inner[depth++] = sampler->owner[returnPc];
+    b = stack[b + 1];
+  }
+  for (i = 0; i < depth; i ++)
+    frames[i] = inner[depth - 1 - i];
+
+  if (2 * (sampler->stackCount + 1) > sampler->capacity)
+    growTable(sampler);
+  hash = hashFrames(frames, depth);
+  slot = findStack(sampler, frames, depth, hash);
+  if (slot->frames == NULL) {
+    slot->frames = (int*) malloc(depth * sizeof(int));
+    memcpy(slot->frames, frames, depth * sizeof(int));
+    slot->depth = depth;
+    slot->hash = hash;
+    slot->count = 0;
+    sampler->stackCount ++;
+  }
+  slot->count ++;
+  sampler->samples ++;
+}
+
+static void writeFrame(Sampler* sampler, int entry, FILE* f) {
+  if (entry < 0)
+    fprintf(f, "unknown");
+  else if (sampler->level[entry] == 0)
+    fprintf(f, "main");
+  else fprintf(f, "proc@%d", entry);
+}
+
+void writeFoldedStacks(Sampler* sampler, FILE* f) {
+  FoldedStack* slot;
+  int i, j;
+
+  for (i = 0; i < sampler->capacity; i ++) {
+    slot = sampler->stacks + i;
+    if (slot->frames == NULL) continue;
+    for (j = 0; j < slot->depth; j ++) {
+      if (j > 0) fputc(';', f);
+      writeFrame(sampler, slot->frames[j], f);
+    }
+    fprintf(f, " %lld\n", slot->count);
+  }
+}
@@ -0,0 +1,52 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __SAMPLER_H__
+#define __SAMPLER_H__
+
+#include <stdio.h>
+#include <signal.h>
+
+#include "instructions.h"
+
+#define SAMPLE_INTERVAL 1000    // microseconds of CPU time
+#define MAX_SAMPLE_DEPTH 256    // deeper stacks lose their outer frames
+
+/*
+ * Sampling profiler for kplrun -sample.  A CPU timer only raises
+ * sampleDue; the sampling loop sees it at its next jump or call, walks the
+ * dynamic links from there and counts the call stack it finds.  The
+ * stacks are written in the folded format of flame graph tools: frames
+ * from the outermost, separated by ';', then the number of samples.
+ */
+extern volatile sig_atomic_t sampleDue;
+
+typedef struct FoldedStack_ FoldedStack;
+
+struct Sampler_ {
+  int codeSize;
+  int* owner;           // entry of the procedure of each instruction
+  int* level;           // lexical level of each procedure entry
+  FoldedStack* stacks;  // hash table of the distinct stacks
+  int capacity;
+  int stackCount;
+  long long samples;
+};
+
+typedef struct Sampler_ Sampler;
+
+// Procedures are found by the verifier, so before the code is fused
+Sampler* createSampler(CodeBlock* codeBlock);
+void freeSampler(Sampler* sampler);
+
+// Only one sampler runs at a time: the timer is per process
+void startSampler(Sampler* sampler);
+void stopSampler(Sampler* sampler);
+
+void takeSample(Sampler* sampler, CELL* stack, int pc, int b);
+void writeFoldedStacks(Sampler* sampler, FILE* f);
+
+#endif
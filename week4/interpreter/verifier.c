@@ -0,0 +1,390 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "verifier.h"
+
+#define UNKNOWN -1
+
+struct VerifyMessage {
+  VerifyCode code;
+  char* message;
+};
+
+#define NUM_OF_MESSAGES 13
+
+struct VerifyMessage verifyMessages[NUM_OF_MESSAGES] = {
+  {VERIFY_OK, "Ok."},
+  {VERIFY_EMPTY_CODE, "Empty code."},
+  {VERIFY_INVALID_OPCODE, "Invalid opcode."},
+  {VERIFY_INVALID_TARGET, "Jump or call target out of the code."},
+  {VERIFY_INVALID_OPERAND, "Invalid operand."},
+  {VERIFY_INVALID_LEVEL, "Static level out of range."},
+  {VERIFY_SHARED_CODE, "Code shared between procedures."},
+  {VERIFY_STACK_UNDERFLOW, "Stack underflow."},
+  {VERIFY_STACK_MISMATCH, "Inconsistent stack height at a join point."},
+  {VERIFY_FRAME_TOO_LARGE, "Frame too large."},
+  {VERIFY_MISSING_FRAME, "Local outside the allocated frame."},
+  {VERIFY_INCONSISTENT_RETURN, "Procedure returns in more than one way."},
+  {VERIFY_INVALID_CONSTANT, "Constant out of the constant pool."}
+};
+
+char* verifyMessage(VerifyCode code) {
+  int i;
+  for (i = 0; i < NUM_OF_MESSAGES; i ++)
+    if (verifyMessages[i].code == code)
+      return verifyMessages[i].message;
+  return "Unknown error.";
+}
+
+// Words an instruction needs on the stack and how it changes the height
+void stackEffect(Instruction* inst, int* need, int* delta) {
+  *need = 0;
+  *delta = 0;
+  switch (inst->op) {
+  case OP_LA: case OP_LV: case OP_LC:
+  case OP_RC: case OP_RI:
+    *delta = 1;
+    break;
+  case OP_INT:
+    *delta = inst->q;
+    break;
+  case OP_DCT:
+    *need = inst->q;
+    *delta = - inst->q;
+    break;
+  case OP_LI: case OP_NEG:
+    *need = 1;
+    break;
+  case OP_CV:
+    *need = 1;
+    *delta = 1;
+    break;
+  case OP_FJ: case OP_WRC: case OP_WRI:
+    *need = 1;
+    *delta = -1;
+    break;
+  case OP_ST:
+    *need = 2;
+    *delta = -2;
+    break;
+  case OP_AD: case OP_SB: case OP_ML: case OP_DV:
+  case OP_EQ: case OP_NE: case OP_GT: case OP_LT: case OP_GE: case OP_LE:
+    *need = 2;
+    *delta = -1;
+    break;
+  case OP_CALL:
+    *need = FRAME_HEADER_SIZE;
+    break;
+  case OP_TC:
+    // The arguments are copied down, never over words still to be copied
+    *need = FRAME_HEADER_SIZE + inst->p;
+    break;
+  case OP_LCF: case OP_LVF:
+    *delta = DOUBLE_SIZE;
+    break;
+  case OP_LIF: case OP_ITF:
+    *need = 1;
+    *delta = 1;
+    break;
+  case OP_STF:
+    *need = 1 + DOUBLE_SIZE;
+    *delta = - 1 - DOUBLE_SIZE;
+    break;
+  case OP_ADF: case OP_SBF: case OP_MLF: case OP_DVF:
+    *need = 2 * DOUBLE_SIZE;
+    *delta = - DOUBLE_SIZE;
+    break;
+  case OP_NEGF:
+    *need = DOUBLE_SIZE;
+    break;
+  case OP_WRF:
+    *need = DOUBLE_SIZE;
+    *delta = - DOUBLE_SIZE;
+    break;
+  case OP_EQF: case OP_NEF: case OP_GTF: case OP_LTF: case OP_GEF: case OP_LEF:
+    *need = 2 * DOUBLE_SIZE;
+    *delta = 1 - 2 * DOUBLE_SIZE;
+    break;
+  case OP_LS:
+    *delta = 1;
+    break;
+  case OP_CAT: case OP_CMPS:
+    *need = 2;
+    *delta = -1;
+    break;
+  case OP_WRS:
+    *need = 1;
+    *delta = -1;
+    break;
+  default:
+    break;
+  }
+}
+
+/*
+ * First pass over one procedure: walks every instruction reachable from
+ * entry without entering callees, checks operands and targets, finds how
+ * the procedure returns and gives each callee its lexical level.
+ */
+VerifyCode scanProcedure(CodeBlock* codeBlock, int entry, int* owner, int* level,
+			 int* returnKind, int* procs, int* procCount, int* work, int* errorPc) {
+  Instruction* code = codeBlock->code;
+  int n = codeBlock->codeSize;
+  int top = 0;
+  int pc, calleeLevel, kind;
+  Instruction* inst;
+
+  owner[entry] = entry;
+  work[top++] = entry;
+  while (top > 0) {
+    pc = work[--top];
+    inst = code + pc;
+    *errorPc = pc;
+
+    if ((inst->op < OP_LA) || (inst->op > LAST_EXECUTABLE_OPCODE))
+      return VERIFY_INVALID_OPCODE;
+
+    switch (inst->op) {
+    case OP_LA:
+    case OP_LV:
+    case OP_LVF:
+      if ((inst->p < 0) || (inst->p > level[entry]))
+	return VERIFY_INVALID_LEVEL;
+      // Inside a frame, so never past the guard above the stack
+      if ((inst->q < 0) || (inst->q > MAX_FRAME_SIZE - ((inst->op == OP_LVF) ? DOUBLE_SIZE : 1)))
+	return VERIFY_INVALID_OPERAND;
+      break;
+    case OP_INT:
+    case OP_DCT:
+      if ((inst->q < 0) || (inst->q > MAX_FRAME_SIZE))
+	return VERIFY_INVALID_OPERAND;
+      break;
+    case OP_J:
+    case OP_FJ:
+      if ((inst->q < 0) || (inst->q >= n))
+	return VERIFY_INVALID_TARGET;
+      break;
+    case OP_CALL:
+      if ((inst->q < 0) || (inst->q >= n))
+	return VERIFY_INVALID_TARGET;
+      if ((inst->p < 0) || (inst->p > level[entry]))
+	return VERIFY_INVALID_LEVEL;
+      calleeLevel = level[entry] - inst->p + 1;
+      if (level[inst->q] == UNKNOWN) {
+	if (owner[inst->q] != UNKNOWN)
+	  return VERIFY_SHARED_CODE;
+	level[inst->q] = calleeLevel;
+	procs[(*procCount)++] = inst->q;
+      } else if (level[inst->q] != calleeLevel)
+	return VERIFY_INVALID_LEVEL;
+      break;
+    case OP_TC:
+      if ((inst->q < 0) || (inst->q >= n))
+	return VERIFY_INVALID_TARGET;
+      if ((inst->p < 0) || (inst->p > MAX_FRAME_SIZE))
+	return VERIFY_INVALID_OPERAND;
+      // The callee replaces the procedure on its own level
+      if (level[inst->q] == UNKNOWN) {
+	if (owner[inst->q] != UNKNOWN)
+	  return VERIFY_SHARED_CODE;
+	level[inst->q] = level[entry];
+	procs[(*procCount)++] = inst->q;
+      } else if (level[inst->q] != level[entry])
+	return VERIFY_INVALID_LEVEL;
+      break;
+    case OP_LCF:
+      if ((inst->q < 0) || (inst->q > codeBlock->constantCount - DOUBLE_SIZE))
+	return VERIFY_INVALID_CONSTANT;
+      break;
+    case OP_LS:
+      if ((inst->q < 0) || (inst->q >= codeBlock->constantCount)
+	  || (codeBlock->constants[inst->q] < 0)
+	  || (codeBlock->constants[inst->q] >= codeBlock->constantCount * (int) sizeof(WORD))
+	  || (STRING_WORDS(codeBlock->constants[inst->q]) > codeBlock->constantCount - inst->q))
+	return VERIFY_INVALID_CONSTANT;
+      break;
+    case OP_EFF:
+      if ((inst->q < FRAME_HEADER_SIZE) || (inst->q > MAX_FRAME_SIZE))
+	return VERIFY_INVALID_OPERAND;
+      // Fall through
+    case OP_EP:
+    case OP_EF:
+      kind = (inst->op == OP_EP) ? RETURN_EP : (inst->op == OP_EF) ? RETURN_EF : RETURN_EFF;
+      if (returnKind[entry] == RETURN_NONE)
+	returnKind[entry] = kind;
+      else if (returnKind[entry] != kind)
+	return VERIFY_INCONSISTENT_RETURN;
+      break;
+    default:
+      break;
+    }
+
+    // Push the successors not seen yet
+    if ((inst->op == OP_J) || (inst->op == OP_FJ)) {
+      if (owner[inst->q] == UNKNOWN) {
+	if (level[inst->q] != UNKNOWN)
+	  return VERIFY_SHARED_CODE;
+	owner[inst->q] = entry;
+	work[top++] = inst->q;
+      } else if (owner[inst->q] != entry)
+	return VERIFY_SHARED_CODE;
+    }
+    if ((inst->op != OP_J) && (inst->op != OP_HL) && (inst->op != OP_EP) &&
+	(inst->op != OP_EF) && (inst->op != OP_EFF) && (inst->op != OP_TC)) {
+      if (pc + 1 >= n)
+	return VERIFY_INVALID_TARGET;
+      if (owner[pc + 1] == UNKNOWN) {
+	if (level[pc + 1] != UNKNOWN)
+	  return VERIFY_SHARED_CODE;
+	owner[pc + 1] = entry;
+	work[top++] = pc + 1;
+      } else if (owner[pc + 1] != entry)
+	return VERIFY_SHARED_CODE;
+    }
+  }
+  return VERIFY_OK;
+}
+
+/*
+ * Second pass over one procedure: propagates the stack height, relative
+ * to the frame base, along every path and records the largest one.
+ */
+VerifyCode measureProcedure(CodeBlock* codeBlock, int entry, int* height,
+			    int* returnKind, int* frameSize, int* work, int* errorPc) {
+  Instruction* code = codeBlock->code;
+  int top = 0;
+  int maxHeight = FRAME_HEADER_SIZE;
+  int pc, h, need, delta, succ;
+  Instruction* inst;
+
+  height[entry] = 0;
+  work[top++] = entry;
+  while (top > 0) {
+    pc = work[--top];
+    inst = code + pc;
+    h = height[pc];
+    *errorPc = pc;
+
+    stackEffect(inst, &need, &delta);
+    if (h < need)
+      return VERIFY_STACK_UNDERFLOW;
+    if ((inst->op == OP_CALL) && (returnKind[inst->q] == RETURN_EF))
+      delta = 1;                   // the function result stays on the top
+    if ((inst->op == OP_CALL) && (returnKind[inst->q] == RETURN_EFF))
+      delta = DOUBLE_SIZE;
+    if ((inst->op == OP_EFF) && (h < inst->q + DOUBLE_SIZE))
+      return VERIFY_STACK_UNDERFLOW;
+    // A local of the procedure's own frame has to be allocated by INT first
+    if (((inst->op == OP_LA) || (inst->op == OP_LV) || (inst->op == OP_LVF)) && (inst->p == 0) &&
+	(h < inst->q + ((inst->op == OP_LVF) ? DOUBLE_SIZE : 1)))
+      return VERIFY_MISSING_FRAME;
+    // The callee returns for the procedure, so it has to return the same way
+    if ((inst->op == OP_TC) &&
+	((returnKind[entry] == RETURN_NONE) || (returnKind[inst->q] != returnKind[entry])))
+      return VERIFY_INCONSISTENT_RETURN;
+    h += delta;
+    if (h > MAX_FRAME_SIZE)
+      return VERIFY_FRAME_TOO_LARGE;
+    if (h > maxHeight)
+      maxHeight = h;
+
+    if ((inst->op == OP_HL) || (inst->op == OP_EP) || (inst->op == OP_EF) || (inst->op == OP_EFF) ||
+	(inst->op == OP_TC))
+      continue;
+    if ((inst->op == OP_J) || (inst->op == OP_FJ)) {
+      succ = inst->q;
+      if (height[succ] == UNKNOWN) {
+	height[succ] = h;
+	work[top++] = succ;
+      } else if (height[succ] != h)
+	return VERIFY_STACK_MISMATCH;
+    }
+    if (inst->op != OP_J) {
+      succ = pc + 1;
+      if (height[succ] == UNKNOWN) {
+	height[succ] = h;
+	work[top++] = succ;
+      } else if (height[succ] != h)
+	return VERIFY_STACK_MISMATCH;
+    }
+  }
+  frameSize[entry] = maxHeight;
+  return VERIFY_OK;
+}
+
+VerifyCode analyseCode(CodeBlock* codeBlock, CodeInfo* info, int* errorPc) {
+  int n = codeBlock->codeSize;
+  int* procs;
+  int* work;
+  int procCount = 0;
+  int i;
+  VerifyCode result = VERIFY_OK;
+
+  *errorPc = 0;
+  info->codeSize = n;
+  info->owner = NULL;
+  info->level = NULL;
+  info->returnKind = NULL;
+  info->height = NULL;
+  info->frameSize = NULL;
+  if (n <= 0)
+    return VERIFY_EMPTY_CODE;
+
+  info->owner = (int*) malloc(n * sizeof(int));
+  info->level = (int*) malloc(n * sizeof(int));
+  info->returnKind = (int*) malloc(n * sizeof(int));
+  info->height = (int*) malloc(n * sizeof(int));
+  info->frameSize = (int*) malloc(n * sizeof(int));
+  procs = (int*) malloc(n * sizeof(int));
+  // Each instruction is pushed at most once per pass
+  work = (int*) malloc(n * sizeof(int));
+
+  for (i = 0; i < n; i ++) {
+    info->owner[i] = UNKNOWN;
+    info->level[i] = UNKNOWN;
+    info->returnKind[i] = RETURN_NONE;
+    info->height[i] = UNKNOWN;
+    info->frameSize[i] = 0;
+  }
+
+  // The main program is on level 0; callees are found on the way
+  info->level[codeBlock->entry] = 0;
+  procs[procCount++] = codeBlock->entry;
+  for (i = 0; (i < procCount) && (result == VERIFY_OK); i ++)
+    result = scanProcedure(codeBlock, procs[i], info->owner, info->level, info->returnKind,
+			   procs, &procCount, work, errorPc);
+
+  for (i = 0; (i < procCount) && (result == VERIFY_OK); i ++)
+    result = measureProcedure(codeBlock, procs[i], info->height, info->returnKind,
+			      info->frameSize, work, errorPc);
+
+  free(procs);
+  free(work);
+  return result;
+}
+
+void freeCodeInfo(CodeInfo* info) {
+  free(info->owner);
+  free(info->level);
+  free(info->returnKind);
+  free(info->height);
+  free(info->frameSize);
+}
+
+VerifyCode verifyCode(CodeBlock* codeBlock, int* frameSize, int* errorPc) {
+  CodeInfo info;
+  VerifyCode result;
+  int i;
+
+  result = analyseCode(codeBlock, &info, errorPc);
+  for (i = 0; i < info.codeSize; i ++)
+    frameSize[i] = (info.frameSize != NULL) ? info.frameSize[i] : 0;
+  freeCodeInfo(&info);
+  return result;
+}
@@ -0,0 +1,73 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __VERIFIER_H__
+#define __VERIFIER_H__
+
+#include "instructions.h"
+
+// Every frame starts with result, dynamic link, return address and static link
+#define FRAME_HEADER_SIZE 4
+#define MAX_FRAME_SIZE (1 << 24)
+
+// How a procedure returns
+#define RETURN_NONE 0
+#define RETURN_EP   1
+#define RETURN_EF   2
+#define RETURN_EFF  3
+
+typedef enum {
+  VERIFY_OK,
+  VERIFY_EMPTY_CODE,
+  VERIFY_INVALID_OPCODE,
+  VERIFY_INVALID_TARGET,
+  VERIFY_INVALID_OPERAND,
+  VERIFY_INVALID_LEVEL,
+  VERIFY_SHARED_CODE,
+  VERIFY_STACK_UNDERFLOW,
+  VERIFY_STACK_MISMATCH,
+  VERIFY_FRAME_TOO_LARGE,
+  VERIFY_MISSING_FRAME,
+  VERIFY_INCONSISTENT_RETURN,
+  VERIFY_INVALID_CONSTANT
+} VerifyCode;
+
+/*
+ * Checks a loaded code block before it is run: opcodes, operand ranges,
+ * jump and call targets, and the stack height at every reachable
+ * instruction of every procedure.  On success frameSize[entry] holds the
+ * number of stack words a procedure starting at entry needs at most
+ * (frameSize[codeBlock->entry] is the main program); on failure *errorPc is the address
+ * of the offending instruction.
+ */
+VerifyCode verifyCode(CodeBlock* codeBlock, int* frameSize, int* errorPc);
+
+// Words an instruction needs on the stack and how it changes the height;
+// CALL needs the frame header, and leaves any result to the caller; TC
+// needs its arguments above a frame header
+void stackEffect(Instruction* inst, int* need, int* delta);
+
+// What the verifier learns about the code, for the tools that translate it
+struct CodeInfo_ {
+  int codeSize;
+  int* owner;        // entry of the procedure of each instruction, -1 if unreachable
+  int* level;        // lexical level of each procedure entry, otherwise -1
+  int* returnKind;   // RETURN_EP, RETURN_EF or RETURN_EFF of each procedure entry
+  int* height;       // stack height before each instruction, from the frame base
+  int* frameSize;    // as for verifyCode()
+};
+
+typedef struct CodeInfo_ CodeInfo;
+
+/*
+ * verifyCode() with its results kept.  Whatever the result, the arrays
+ * are released by freeCodeInfo().
+ */
+VerifyCode analyseCode(CodeBlock* codeBlock, CodeInfo* info, int* errorPc);
+void freeCodeInfo(CodeInfo* info);
+char* verifyMessage(VerifyCode code);
+
+#endif
@@ -1,317 +1,1063 @@
-/* 
- * @copyright (c) 2008, Hedspi, Hanoi University of Technology
- * @author Huu-Duc Nguyen
- * @version 1.0
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-//#include <conio.h>
-
-#include "vm.h"
-
-CodeBlock *codeBlock;
-WORD* stack;
-WORD* global;
-int t;
-int b;
-int pc;
-int ps;
-int stackSize;
-int codeSize;
-int debugMode;
-
-void resetVM(void) {
-  pc = 0;
-  t = -1;
-  b = 0;
-  ps = PS_INACTIVE;
-}
-
-void initVM(void) {
-  codeBlock = createCodeBlock(codeSize);
-  stack = (Memory) malloc(stackSize * sizeof(WORD));
-  resetVM();
-}
-
-void cleanVM(void) {
-  freeCodeBlock(codeBlock);
-  free(stack);
-}
-
-int loadExecutable(FILE* f) {
-  loadCode(codeBlock,f);
-  resetVM();
-  return 1;
-}
-
-int saveExecutable(FILE* f) {
-  saveCode(codeBlock,f);
-  return 1;
-}
-
-int checkStack(void) {
-  return ((t >= 0) && (t <stackSize));
-}
-
-int base(int p) {
-  int currentBase = b;
-  while (p > 0) {
-    currentBase = stack[currentBase + 3];
-    p --;
-  }
-  return currentBase;
-}
-
-void printMemory(void) {
-  int i;
-  printf("Start dumping...\n");
-  for (i = 0; i <= t; i++) 
-    printf("  %4d: %d\n",i,stack[i]);
-  printf("Finish dumping!\n");
-}
-
-void printCodeBuffer(void) {
-  printCodeBlock(codeBlock);
-}
-
-int run(void) {
-  Instruction* code = codeBlock->code;
-  int count = 0;
-  int number;
-  char s[100];
-
-//  WINDOW* win = initscr();
-//  nonl();
-//  cbreak();
-//  noecho();
-//  scrollok(win,TRUE);
-  
-  ps = PS_ACTIVE;
-  while (ps == PS_ACTIVE) {
-    if (debugMode) {
-      sprintInstruction(s,&(code[pc]));
-      printf( "%6d-%-4d:  %s\n",count++,pc,s);
-    }
-
-    switch (code[pc].op) {
-    case OP_LA: 
-      t ++;
-      if (checkStack())
-	stack[t] = base(code[pc].p) + code[pc].q;
-      break;
-    case OP_LV: 
-      t ++;
-      if (checkStack())
-	stack[t] = stack[base(code[pc].p) + code[pc].q];
-      break;
-    case OP_LC: 
-      t ++;
-      if (checkStack())
-	stack[t] = code[pc].q;
-      break;
-    case OP_LI: 
-      stack[t] = stack[stack[t]];
-      break;
-    case OP_INT:
-      t += code[pc].q;
-      checkStack();
-      break;
-    case OP_DCT: 
-      t -= code[pc].q;
-      checkStack();
-      break;
-    case OP_J: 
-      pc = code[pc].q - 1;
-      break;
-    case OP_FJ: 
-      if (stack[t] == FALSE) 
-	pc = code[pc].q - 1;
-      t --;
-      checkStack();
-      break;
-    case OP_HL: 
-      ps = PS_NORMAL_EXIT;
-      break;
-    case OP_ST: 
-      stack[stack[t-1]] = stack[t];
-      t -= 2;
-      checkStack();
-      break;
-    case OP_CALL: 
-      stack[t+2] = b;                 // Dynamic Link
-      stack[t+3] = pc;                // Return Address
-      stack[t+4] = base(code[pc].p);  // Static Link
-      b = t + 1;                      // Base & Result
-      pc = code[pc].q - 1;              
-      break;
-    case OP_EP: 
-      t = b - 1;                      // Previous top
-      pc = stack[b+2];                // Saved return address
-      b = stack[b+1];                 // Saved base
-      break;
-    case OP_EF:
-      t = b;                          // return value is on the top of the stack
-      pc = stack[b+2];                // Saved return address
-      b = stack[b+1];                 // saved base
-      break;
-    case OP_RC: 
-      t ++;
-//      echo();
-      scanf("%c",&number);
-//      noecho();
-      stack[t] = number;
-      checkStack();
-      break;
-    case OP_RI:
-      t ++;
-//      echo();
-      scanf("%d",&number);
-//      noecho();
-      stack[t] = number;
-      checkStack();
-      break;
-    case OP_WRC: 
-      printf("%c",stack[t]);
-      t --;
-      checkStack();
-      break;     
-    case OP_WRI: 
-      printf("%d",stack[t]);
-      t --;
-      checkStack();
-      break;
-    case OP_WLN:
-      printf("\n");
-      break;
-    case OP_AD:
-      t --;
-      if (checkStack()) 
-	stack[t] += stack[t+1];
-      break;
-    case OP_SB:
-      t --;
-      if (checkStack()) 
-	stack[t] -= stack[t+1];
-      break;
-    case OP_ML:
-      t --;
-      if (checkStack()) 
-	stack[t] *= stack[t+1];
-      break;
-
-    case OP_DV: 
-      t --;
-      if (checkStack()) {
-	if (stack[t+1] == 0)
-	  ps = PS_DIVIDE_BY_ZERO;
-	else stack[t] /= stack[t+1];
-      }
-      break;
-    case OP_NEG:
-      stack[t] = - stack[t];
-      break;
-    case OP_CV: 
-      stack[t+1] = stack[t];
-      t ++;
-      checkStack();
-      break;
-    case OP_EQ:
-      t --;
-      if (stack[t] == stack[t+1]) 
-         stack[t] = TRUE;
-      else 
-           stack[t] = FALSE;
-      checkStack();
-      break;
-    case OP_NE:
-      t --;
-      if (stack[t] != stack[t+1]) 
-	     stack[t] = TRUE;
-      else stack[t] = FALSE;
-      checkStack();
-      break;
-    case OP_GT:
-      t --;
-      if (stack[t] > stack[t+1]) 
-	     stack[t] = TRUE;
-      else 
-           stack[t] = FALSE;
-      checkStack();
-      break;
-    case OP_LT:
-      t --;
-      if (stack[t] < stack[t+1]) 
-	     stack[t] = TRUE;
-      else 
-           stack[t] = FALSE;
-      checkStack();
-      break;
-    case OP_GE:
-      t --;
-      if (stack[t] >= stack[t+1]) 
-	stack[t] = TRUE;
-      else stack[t] = FALSE;
-      checkStack();
-      break;
-    case OP_LE:
-      t --;
-      if (stack[t] <= stack[t+1]) 
-	stack[t] = TRUE;
-      else stack[t] = FALSE;
-      checkStack();
-      break;
-    case OP_BP:
-      // Just for debugging
-      debugMode = 1;
-      break;
-    default: break;
-    }
-
-    if (debugMode) {
-      int command;
-      int level, offset;
-      int interactive = 1;
-      
-      do {
-	interactive = 0;
-
-	command = getch();
-	switch (command) {
-	case 'a':
-	case 'A':
-	  printf("\nEnter memory location (level, offset):");
-	  scanf("%d %d", &level, &offset);
-	  printf("Absolute address = %d\n", base(level) + offset);
-	  interactive = 1;
-	  break;
-	case 'm':
-	case 'M':
-	  printf("\nEnter memory location (level, offset):");
-	  scanf("%d %d", &level, &offset);
-	  printf("Value = %d\n", stack[base(level) + offset]);
-	  interactive = 1;
-	  break;
-	case 't':
-	case 'T':
-	  printf("Top (%d) = %d\n", t, stack[t]);
-	  interactive = 1;
-	  break;
-	case 'c':
-	case 'C':
-	  debugMode = 0;
-	  break;
-	case 'h':
-	case 'H':
-	  ps = PS_NORMAL_EXIT;
-	  break;
-	default: break;
-	}
-      } while (interactive);
-    }
-    pc ++;
-  }
-  printf("\nPress any key to exit...");getch();
-//  endwin();
-  return ps;
-}
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+//#include <conio.h>
+
+#include "vm.h"
+#include "verifier.h"
+#include "jit.h"
+#include "compact.h"
+#include "profile.h"
+#include "sampler.h"
+#include "regcode.h"
+#include "checkpoint.h"
+
+#ifdef GUARDED_STACK
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef __GNUC__
+#define THREADED_DISPATCH
+#endif
+
+struct ThreadedInstruction_ {
+  void* handler;
+  WORD p;
+  WORD q;
+};
+
+typedef struct ThreadedInstruction_ ThreadedInstruction;
+
+static void trimStack(VMContext* vm);
+
+void resetVM(VMContext* vm) {
+  trimStack(vm);
+  vm->pc = (vm->program != NULL) ? vm->program->codeBlock->entry : 0;
+  vm->t = -1;
+  vm->b = 0;
+  vm->ps = PS_INACTIVE;
+  vm->level = 0;
+  vm->display[0] = 0;
+  vm->callDepth = 0;
+  vm->traceCount = 0;
+  clearHeap(&vm->heap);
+}
+
+Program* loadProgram(FILE* f, int codeSize) {
+  Program* program = (Program*) malloc(sizeof(Program));
+  LoadCode loaded;
+  VerifyCode result;
+  int errorPc;
+
+  program->codeBlock = createCodeBlock(codeSize);
+  program->frameSize = NULL;
+  loaded = loadCode(program->codeBlock, f);
+  if (loaded != LOAD_OK) {
+    printf("Load error: %s\n", loadMessage(loaded));
+    freeProgram(program);
+    return NULL;
+  }
+  program->frameSize = (int*) malloc((program->codeBlock->codeSize + 1) * sizeof(int));
+
+  // Verified code runs without stack checks, apart from the frame
+  // size guard on OP_CALL and OP_TC and at program start
+  result = verifyCode(program->codeBlock, program->frameSize, &errorPc);
+  if (result != VERIFY_OK) {
+    printf("Verification error at %d: %s\n", errorPc, verifyMessage(result));
+    freeProgram(program);
+    return NULL;
+  }
+  return program;
+}
+
+int saveProgram(Program* program, FILE* f) {
+  return saveCode(program->codeBlock, f);
+}
+
+// Only before the program is given to a context
+void fuseProgram(Program* program) {
+  fuseCode(program->codeBlock);
+}
+
+void freeProgram(Program* program) {
+  freeCodeBlock(program->codeBlock);
+  free(program->frameSize);
+  free(program);
+}
+
+void printProgram(Program* program) {
+  printCodeBlock(program->codeBlock);
+}
+
+#ifdef GUARDED_STACK
+
+// No frame is larger than MAX_FRAME_SIZE, so none can jump the guard
+#define GUARD_SIZE ((size_t) MAX_FRAME_SIZE * sizeof(CELL))
+// Cells at the bottom of the stack that stay committed across resets
+#define KEPT_STACK (1 << 16)
+
+// Address space that takes memory only where it is touched
+static void* reserve(size_t size) {
+  void* p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return (p == MAP_FAILED) ? NULL : p;
+}
+
+static void release(void* p, size_t size) {
+  if (p != NULL) munmap(p, size);
+}
+
+static size_t roundToPages(size_t size) {
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  return (size + page - 1) / page * page;
+}
+
+static __thread VMContext* runningVM;   // on this thread, if any
+
+static void onFault(int signal, siginfo_t* info, void* context) {
+  VMContext* vm = runningVM;
+  char* address = (char*) info->si_addr;
+  struct sigaction action;
+
+  (void) context;
+  if ((vm != NULL) && (address >= (char*) (vm->stack + vm->stackSize))
+      && (address < vm->stackRegion + vm->regionSize))
+    siglongjmp(vm->overflow, 1);
+  // Not an overflow: the fault happens again on return, and is fatal
+  action.sa_handler = SIG_DFL;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = 0;
+  sigaction(signal, &action, NULL);
+}
+
+static void catchOverflows(void) {
+  struct sigaction action;
+
+  action.sa_sigaction = onFault;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_SIGINFO;
+  sigaction(SIGSEGV, &action, NULL);
+}
+
+// The stack ends exactly where the guard starts, whatever its size
+static int allocateStack(VMContext* vm, int stackSize) {
+  size_t size = roundToPages((size_t) stackSize * sizeof(CELL));
+
+  vm->regionSize = size + roundToPages(GUARD_SIZE);
+  vm->stackRegion = (char*) reserve(vm->regionSize);
+  if (vm->stackRegion == NULL) return 0;
+  if (mprotect(vm->stackRegion + size, vm->regionSize - size, PROT_NONE) != 0) {
+    release(vm->stackRegion, vm->regionSize);
+    vm->stackRegion = NULL;
+    return 0;
+  }
+  vm->stack = (Memory) (vm->stackRegion + size) - stackSize;
+  catchOverflows();
+  return 1;
+}
+
+/*
+ * Gives back the pages of the size bytes from p on that lie after offset;
+ * they read as zeros when a program touches them again.
+ */
+static void discard(void* p, size_t offset, size_t size) {
+  size_t start = roundToPages(offset);
+
+  if (start < size)
+    madvise((char*) p + start, size - start, MADV_DONTNEED);
+}
+
+/*
+ * A context that has run a deep program keeps the memory it touched, and
+ * a batch worker runs many programs in one; at a reset nothing on the
+ * stack is live, so all but its bottom KEPT_STACK cells go back.
+ */
+static void trimStack(VMContext* vm) {
+  size_t bottom = (char*) vm->stack - vm->stackRegion;
+
+  discard(vm->stackRegion, bottom + KEPT_STACK * sizeof(CELL),
+	  bottom + (size_t) vm->stackSize * sizeof(CELL));
+  discard(vm->display, KEPT_STACK / 4 * sizeof(WORD), (vm->maxCallDepth + 1) * sizeof(WORD));
+  discard(vm->links, KEPT_STACK / 4 * sizeof(DisplayLink), vm->maxCallDepth * sizeof(DisplayLink));
+}
+
+static void freeStack(VMContext* vm) {
+  release(vm->stackRegion, vm->regionSize);
+  release(vm->display, (vm->maxCallDepth + 1) * sizeof(WORD));
+  release(vm->links, vm->maxCallDepth * sizeof(DisplayLink));
+}
+
+#else
+
+static void* reserve(size_t size) {
+  return malloc(size);
+}
+
+static int allocateStack(VMContext* vm, int stackSize) {
+  vm->stack = (Memory) malloc(stackSize * sizeof(CELL));
+  return vm->stack != NULL;
+}
+
+static void trimStack(VMContext* vm) {
+  (void) vm;
+}
+
+static void freeStack(VMContext* vm) {
+  free(vm->stack);
+  free(vm->display);
+  free(vm->links);
+}
+
+#endif
+
+VMContext* createVM(Program* program, int stackSize) {
+  VMContext* vm = (VMContext*) malloc(sizeof(VMContext));
+
+  vm->program = program;
+  vm->threadedCode = NULL;
+  vm->jitCode = NULL;
+  vm->compactCode = NULL;
+  vm->profile = NULL;
+  vm->sampler = NULL;
+  vm->registerCode = NULL;
+  vm->checkpoint = NULL;
+  vm->stackSize = stackSize;
+  // Every frame takes at least 4 words, and every call nests at most one
+  // level deeper, so neither the call depth nor the level can exceed this
+  vm->maxCallDepth = stackSize / 4 + 1;
+  vm->display = (WORD*) reserve((vm->maxCallDepth + 1) * sizeof(WORD));
+  vm->links = (DisplayLink*) reserve(vm->maxCallDepth * sizeof(DisplayLink));
+  if (!allocateStack(vm, stackSize) || (vm->display == NULL) || (vm->links == NULL)) {
+    freeStack(vm);
+    free(vm);
+    return NULL;
+  }
+  vm->debugMode = 0;
+  vm->dispatchMode = DISPATCH_SWITCH;
+  vm->pauseAtExit = 0;
+  vm->instructionCount = 0;
+  openOutput(&vm->output, stdout);
+  openInput(&vm->input, stdin, &vm->output);
+  openHeap(&vm->heap);
+  resetVM(vm);
+  return vm;
+}
+
+// Gives the context another program to run, keeping its stack
+void setProgram(VMContext* vm, Program* program) {
+  if (vm->program == program) return;
+  free(vm->threadedCode);
+  freeJit(vm->jitCode);
+  freeCompact(vm->compactCode);
+  freeRegisters(vm->registerCode);
+  vm->threadedCode = NULL;
+  vm->jitCode = NULL;
+  vm->compactCode = NULL;
+  vm->registerCode = NULL;
+  vm->program = program;
+}
+
+void freeVM(VMContext* vm) {
+  free(vm->threadedCode);
+  freeJit(vm->jitCode);
+  freeCompact(vm->compactCode);
+  freeRegisters(vm->registerCode);
+  freeStack(vm);
+  closeHeap(&vm->heap);
+  free(vm);
+}
+
+void redirectInput(VMContext* vm, FILE* f) {
+  openInput(&vm->input, f, &vm->output);
+}
+
+void redirectOutput(VMContext* vm, FILE* f) {
+  flushOutput(&vm->output);
+  openOutput(&vm->output, f);
+}
+
+int frameBase(CELL* stack, int b, int p) {
+  while (p > 0) {
+    b = stack[b + 3];
+    p --;
+  }
+  return b;
+}
+
+int base(VMContext* vm, int p) {
+  return frameBase(vm->stack, vm->b, p);
+}
+
+void printMemory(VMContext* vm) {
+  int i;
+  printf("Start dumping...\n");
+  for (i = 0; i <= vm->t; i++) 
+    printf("  %4d: " CELL_FORMAT "\n",i,vm->stack[i]);
+  printf("Finish dumping!\n");
+}
+
+
+/********************* Execution loops **************************/
+
+/*
+ * Every loop below includes vmops.h for its opcode handlers and differs
+ * only in how it dispatches.  The machine registers are copied from the
+ * context into locals on entry and written back when the loop leaves, so
+ * the fast loops never touch the context per instruction.
+ */
+
+#define P        (ip->p)
+#define Q        (ip->q)
+#define PC       ((int) (ip - code))
+#define BASE(p)  disp[-(p)]
+
+#ifdef GUARDED_STACK
+// A frame that does not fit runs into the guard, and faults there
+#define FRAME_LIMITS
+#define FRAME_FITS(base, entry)  TRUE
+#else
+#define FRAME_LIMITS                                    \
+  int* frameSize = vm->program->frameSize;              \
+  int stackSize = vm->stackSize;
+#define FRAME_FITS(base, entry)  ((base) + frameSize[entry] <= stackSize)
+#endif
+
+/*
+ * Arithmetic on cells: r := x op y, true when the result overflowed.  Only
+ * wide cells check sums and products; WORD cells wrap and those tests fold
+ * away.  INT_MIN / -1 traps in hardware, so division checks in both.
+ */
+#ifdef WIDE_CELLS
+#define ADD_OVERFLOWS(r, x, y)  __builtin_add_overflow(x, y, &(r))
+#define SUB_OVERFLOWS(r, x, y)  __builtin_sub_overflow(x, y, &(r))
+#define MUL_OVERFLOWS(r, x, y)  __builtin_mul_overflow(x, y, &(r))
+#define DIV_OVERFLOWS(x, y)     (((x) == LLONG_MIN) && ((y) == -1))
+#else
+#define ADD_OVERFLOWS(r, x, y)  ((r) = (x) + (y), FALSE)
+#define SUB_OVERFLOWS(r, x, y)  ((r) = (x) - (y), FALSE)
+#define MUL_OVERFLOWS(r, x, y)  ((r) = (x) * (y), FALSE)
+#define DIV_OVERFLOWS(x, y)     (((x) == INT_MIN) && ((y) == -1))
+#endif
+
+#define LOAD_REGISTERS                                  \
+  CELL* stack = vm->stack;                              \
+  FRAME_LIMITS                                          \
+  int t = vm->t;                                        \
+  int b = vm->b;                                        \
+  WORD* disp = vm->display + vm->level;                 \
+  DisplayLink* link = vm->links + vm->callDepth;        \
+  CELL number
+
+#define SAVE_REGISTERS                                  \
+  vm->pc = PC;                                          \
+  vm->t = t;                                            \
+  vm->b = b;                                            \
+  vm->level = disp - vm->display;                       \
+  vm->callDepth = link - vm->links
+
+// A double is DOUBLE_SIZE cells, each holding one word of it
+static double getDouble(CELL* cells) {
+  DoubleWords d;
+
+  d.words[0] = (WORD) cells[0];
+  d.words[1] = (WORD) cells[1];
+  return d.value;
+}
+
+static void putDouble(CELL* cells, double value) {
+  DoubleWords d;
+
+  d.value = value;
+  cells[0] = d.words[0];
+  cells[1] = d.words[1];
+}
+
+void debugPrompt(VMContext* vm) {
+  int command;
+  int level, offset;
+  int interactive = 1;
+
+  do {
+    interactive = 0;
+
+    command = getch();
+    switch (command) {
+    case 'a':
+    case 'A':
+      printf("\nEnter memory location (level, offset):");
+      scanf("%d %d", &level, &offset);
+      printf("Absolute address = %d\n", base(vm, level) + offset);
+      interactive = 1;
+      break;
+    case 'm':
+    case 'M':
+      printf("\nEnter memory location (level, offset):");
+      scanf("%d %d", &level, &offset);
+      printf("Value = " CELL_FORMAT "\n", vm->stack[base(vm, level) + offset]);
+      interactive = 1;
+      break;
+    case 't':
+    case 'T':
+      printf("Top (%d) = " CELL_FORMAT "\n", vm->t, vm->stack[vm->t]);
+      interactive = 1;
+      break;
+    case 'c':
+    case 'C':
+      vm->debugMode = 0;
+      break;
+    case 'h':
+    case 'H':
+      vm->ps = PS_NORMAL_EXIT;
+      break;
+    default: break;
+    }
+  } while (interactive);
+}
+
+// Single-stepping loop: traces every instruction and prompts after it
+void runDebug(VMContext* vm) {
+  Instruction* code = vm->program->codeBlock->code;
+  Instruction* ip = code + vm->pc;
+  LOAD_REGISTERS;
+  char s[100];
+
+#define CASE(op)        case op:
+#define NEXT            { ip ++; break; }
+#define SKIP(n)         { ip += (n); break; }
+#define JUMP(addr)      { ip = code + (addr); break; }
+#define STOP            break
+#define ENTER_DEBUGGER  NEXT
+
+  while (vm->ps == PS_ACTIVE && vm->debugMode) {
+    flushOutput(&vm->output);
+    sprintInstruction(s, ip);
+    printf( "%6d-%-4d:  %s\n", vm->traceCount++, PC, s);
+
+    switch (ip->op) {
+#include "vmops.h"
+    default:
+      NEXT;
+    }
+
+    SAVE_REGISTERS;
+    debugPrompt(vm);
+  }
+
+#undef CASE
+#undef NEXT
+#undef SKIP
+#undef JUMP
+#undef STOP
+#undef ENTER_DEBUGGER
+}
+
+// Plain switch dispatch
+void runSwitch(VMContext* vm) {
+  Instruction* code = vm->program->codeBlock->code;
+  Instruction* ip = code + vm->pc;
+  LOAD_REGISTERS;
+
+#define CASE(op)        case op:
+#define NEXT            { ip ++; continue; }
+#define SKIP(n)         { ip += (n); continue; }
+#define JUMP(addr)      { ip = code + (addr); continue; }
+#define STOP            goto stopped
+#define ENTER_DEBUGGER  goto stopped
+
+  for (;;) {
+    switch (ip->op) {
+#include "vmops.h"
+    default:
+      NEXT;
+    }
+  }
+
+ stopped:
+  SAVE_REGISTERS;
+
+#undef CASE
+#undef NEXT
+#undef SKIP
+#undef JUMP
+#undef STOP
+#undef ENTER_DEBUGGER
+}
+
+// Switch dispatch that also counts the executed instructions
+void runCounting(VMContext* vm) {
+  Instruction* code = vm->program->codeBlock->code;
+  Instruction* ip = code + vm->pc;
+  LOAD_REGISTERS;
+  long long count = 0;
+
+#define CASE(op)        case op:
+#define NEXT            { ip ++; continue; }
+#define SKIP(n)         { ip += (n); continue; }
+#define JUMP(addr)      { ip = code + (addr); continue; }
+#define STOP            goto stopped
+#define ENTER_DEBUGGER  goto stopped
+
+  for (;;) {
+    count ++;
+    switch (ip->op) {
+#include "vmops.h"
+    default:
+      NEXT;
+    }
+  }
+
+ stopped:
+  SAVE_REGISTERS;
+  vm->instructionCount += count;
+
+#undef CASE
+#undef NEXT
+#undef SKIP
+#undef JUMP
+#undef STOP
+#undef ENTER_DEBUGGER
+}
+
+/*
+ * Switch dispatch for -checkpoint: leaves the loop at a jump when a
+ * checkpoint is due, and writes it there.  Only the stack up to t is
+ * saved, and from the DCT before a call to the INT of the callee the
+ * arguments are above t, so a checkpoint waits for a jump outside of that.
+ */
+void runCheckpointing(VMContext* vm) {
+  Instruction* code = vm->program->codeBlock->code;
+  Instruction* ip = code + vm->pc;
+  long long polls = vm->checkpoint->stopAfter;
+  int due;
+  LOAD_REGISTERS;
+
+#define CASE(op)        case op:
+#define NEXT            { ip ++; continue; }
+#define SKIP(n)         { ip += (n); continue; }
+#define JUMP(addr)      { ip = code + (addr); continue; }
+#define STOP            goto stopped
+#define ENTER_DEBUGGER  goto stopped
+#define POLL            { if ((polls > 0) && (-- polls == 0)) checkpointDue = CHECKPOINT_STOP; \
+                          if (checkpointDue && (t >= b) && (ip->op != OP_CALL)) STOP; }
+
+  for (;;) {
+    switch (ip->op) {
+#include "vmops.h"
+    default:
+      NEXT;
+    }
+  }
+
+ stopped:
+  SAVE_REGISTERS;
+  vm->checkpoint->stopAfter = polls;
+  if ((vm->ps != PS_ACTIVE) || vm->debugMode || !checkpointDue)
+    return;
+
+  due = checkpointDue;
+  checkpointDue = CHECKPOINT_NONE;
+  if (writeCheckpoint(vm->checkpoint, vm) != CHECKPOINT_OK)
+    fprintf(stderr, "kplrun: %s\n", checkpointMessage(CHECKPOINT_IO_ERROR));
+  else if (due == CHECKPOINT_STOP)
+    vm->ps = PS_INACTIVE;
+
+#undef CASE
+#undef NEXT
+#undef SKIP
+#undef JUMP
+#undef STOP
+#undef ENTER_DEBUGGER
+#undef POLL
+}
+
+/*
+ * Switch dispatch for -profile: every instruction is counted, and charged
+ * with the cycles until the next dispatch.  The other loops have no
+ * counters at all.
+ */
+void runProfile(VMContext* vm) {
+  Instruction* code = vm->program->codeBlock->code;
+  Instruction* ip = code + vm->pc;
+  long long* count = vm->profile->count;
+  long long* cycles = vm->profile->cycles;
+  long long now, last = readCycles();
+  int lastPc = vm->pc;
+  LOAD_REGISTERS;
+
+#define CASE(op)        case op:
+#define NEXT            { ip ++; continue; }
+#define SKIP(n)         { ip += (n); continue; }
+#define JUMP(addr)      { ip = code + (addr); continue; }
+#define STOP            goto stopped
+#define ENTER_DEBUGGER  goto stopped
+
+  for (;;) {
+    now = readCycles();
+    cycles[lastPc] += now - last;
+    last = now;
+    lastPc = PC;
+    count[lastPc] ++;
+    switch (ip->op) {
+#include "vmops.h"
+    default:
+      NEXT;
+    }
+  }
+
+ stopped:
+  cycles[lastPc] += readCycles() - last;
+  SAVE_REGISTERS;
+
+#undef CASE
+#undef NEXT
+#undef SKIP
+#undef JUMP
+#undef STOP
+#undef ENTER_DEBUGGER
+}
+
+// Switch dispatch for -sample: takes a sample at a jump or call when one is due
+void runSampling(VMContext* vm) {
+  Instruction* code = vm->program->codeBlock->code;
+  Instruction* ip = code + vm->pc;
+  Sampler* sampler = vm->sampler;
+  LOAD_REGISTERS;
+
+#define CASE(op)        case op:
+#define NEXT            { ip ++; continue; }
+#define SKIP(n)         { ip += (n); continue; }
+#define JUMP(addr)      { ip = code + (addr); continue; }
+#define STOP            goto stopped
+#define ENTER_DEBUGGER  goto stopped
+#define POLL            if (sampleDue) { sampleDue = 0; takeSample(sampler, stack, PC, b); }
+
+  for (;;) {
+    switch (ip->op) {
+#include "vmops.h"
+    default:
+      NEXT;
+    }
+  }
+
+ stopped:
+  SAVE_REGISTERS;
+
+#undef CASE
+#undef NEXT
+#undef SKIP
+#undef JUMP
+#undef STOP
+#undef ENTER_DEBUGGER
+#undef POLL
+}
+
+#ifdef THREADED_DISPATCH
+
+/*
+ * Direct threading: the code block is decoded once into an array that
+ * holds the address of each instruction's handler, and every handler ends
+ * by jumping straight to the handler of its successor.
+ */
+ThreadedInstruction* decodeThreaded(CodeBlock* codeBlock, void** handlers, int handlerCount) {
+  ThreadedInstruction* threaded;
+  Instruction* inst = codeBlock->code;
+  int i;
+
+  // One extra slot so that running off the end of the code halts
+  threaded = (ThreadedInstruction*) malloc((codeBlock->codeSize + 1) * sizeof(ThreadedInstruction));
+  for (i = 0; i < codeBlock->codeSize; i ++, inst ++) {
+    if ((inst->op >= 0) && (inst->op < handlerCount) && (handlers[inst->op] != NULL))
+      threaded[i].handler = handlers[inst->op];
+    else threaded[i].handler = handlers[handlerCount];
+    threaded[i].p = inst->p;
+    threaded[i].q = inst->q;
+  }
+  threaded[i].handler = handlers[OP_HL];
+  threaded[i].p = DC_VALUE;
+  threaded[i].q = DC_VALUE;
+  return threaded;
+}
+
+void runThreaded(VMContext* vm) {
+  static void* handlers[] = {
+    [OP_LA] = &&L_OP_LA,     [OP_LV] = &&L_OP_LV,     [OP_LC] = &&L_OP_LC,
+    [OP_LI] = &&L_OP_LI,     [OP_INT] = &&L_OP_INT,   [OP_DCT] = &&L_OP_DCT,
+    [OP_J] = &&L_OP_J,       [OP_FJ] = &&L_OP_FJ,     [OP_HL] = &&L_OP_HL,
+    [OP_ST] = &&L_OP_ST,     [OP_CALL] = &&L_OP_CALL, [OP_EP] = &&L_OP_EP,
+    [OP_EF] = &&L_OP_EF,     [OP_RC] = &&L_OP_RC,     [OP_RI] = &&L_OP_RI,
+    [OP_WRC] = &&L_OP_WRC,   [OP_WRI] = &&L_OP_WRI,   [OP_WLN] = &&L_OP_WLN,
+    [OP_AD] = &&L_OP_AD,     [OP_SB] = &&L_OP_SB,     [OP_ML] = &&L_OP_ML,
+    [OP_DV] = &&L_OP_DV,     [OP_NEG] = &&L_OP_NEG,   [OP_CV] = &&L_OP_CV,
+    [OP_EQ] = &&L_OP_EQ,     [OP_NE] = &&L_OP_NE,     [OP_GT] = &&L_OP_GT,
+    [OP_LT] = &&L_OP_LT,     [OP_GE] = &&L_OP_GE,     [OP_LE] = &&L_OP_LE,
+    [OP_BP] = &&L_OP_BP,
+    [OP_LCF] = &&L_OP_LCF,   [OP_LVF] = &&L_OP_LVF,   [OP_LIF] = &&L_OP_LIF,
+    [OP_STF] = &&L_OP_STF,   [OP_ITF] = &&L_OP_ITF,   [OP_ADF] = &&L_OP_ADF,
+    [OP_SBF] = &&L_OP_SBF,   [OP_MLF] = &&L_OP_MLF,   [OP_DVF] = &&L_OP_DVF,
+    [OP_NEGF] = &&L_OP_NEGF, [OP_EQF] = &&L_OP_EQF,   [OP_NEF] = &&L_OP_NEF,
+    [OP_GTF] = &&L_OP_GTF,   [OP_LTF] = &&L_OP_LTF,   [OP_GEF] = &&L_OP_GEF,
+    [OP_LEF] = &&L_OP_LEF,   [OP_WRF] = &&L_OP_WRF,   [OP_EFF] = &&L_OP_EFF,
+    [OP_LS] = &&L_OP_LS,     [OP_CAT] = &&L_OP_CAT,   [OP_CMPS] = &&L_OP_CMPS,
+    [OP_WRS] = &&L_OP_WRS,     [OP_TC] = &&L_OP_TC,
+    [OP_LC_AD] = &&L_OP_LC_AD,         [OP_CV_LI] = &&L_OP_CV_LI,
+    [OP_LV_LC] = &&L_OP_LV_LC,         [OP_LV_LC_AD] = &&L_OP_LV_LC_AD,
+    [OP_LA_LC_ST] = &&L_OP_LA_LC_ST,   [OP_LA_LV_ST] = &&L_OP_LA_LV_ST,
+    [OP_LC_ML_AD] = &&L_OP_LC_ML_AD,   [OP_EQ_FJ] = &&L_OP_EQ_FJ,
+    [OP_NE_FJ] = &&L_OP_NE_FJ,         [OP_GT_FJ] = &&L_OP_GT_FJ,
+    [OP_LT_FJ] = &&L_OP_LT_FJ,         [OP_GE_FJ] = &&L_OP_GE_FJ,
+    [OP_LE_FJ] = &&L_OP_LE_FJ,         [OP_INC] = &&L_OP_INC,
+    [NUM_OF_OPCODES] = &&L_default
+  };
+  ThreadedInstruction* code;
+  ThreadedInstruction* ip;
+  LOAD_REGISTERS;
+
+  if (vm->threadedCode == NULL)
+    vm->threadedCode = decodeThreaded(vm->program->codeBlock, handlers, NUM_OF_OPCODES);
+  code = vm->threadedCode;
+  ip = code + vm->pc;
+
+#define CASE(op)        L_##op:
+#define NEXT            { ip ++; goto *ip->handler; }
+#define SKIP(n)         { ip += (n); goto *ip->handler; }
+#define JUMP(addr)      { ip = code + (addr); goto *ip->handler; }
+#define STOP            goto stopped
+#define ENTER_DEBUGGER  goto stopped
+
+  goto *ip->handler;
+
+#include "vmops.h"
+ L_default:
+  NEXT;
+
+ stopped:
+  SAVE_REGISTERS;
+
+#undef CASE
+#undef NEXT
+#undef SKIP
+#undef JUMP
+#undef STOP
+#undef ENTER_DEBUGGER
+}
+
+#else
+
+// Without computed goto the threaded engine is the switch engine
+void runThreaded(VMContext* vm) {
+  runSwitch(vm);
+}
+
+#endif
+
+// Rest of a variable-length integer whose first byte was n
+static unsigned int readVarint(unsigned int n, unsigned char** ip) {
+  int shift = 7;
+
+  n &= 0x7F;
+  do {
+    n |= (unsigned int) (**ip & 0x7F) << shift;
+    shift += 7;
+  } while (*(*ip)++ & 0x80);
+  return n;
+}
+
+/*
+ * Compact bytecode (see compact.h), decoded as it runs.  The address of
+ * the current instruction is kept beside the byte pointer, so that frames
+ * hold the same return addresses as in the other loops.
+ */
+void runCompact(VMContext* vm) {
+  CompactCode* compact;
+  unsigned char* bytes;
+  int* offset;
+  unsigned char* ip;
+  int pc = vm->pc;
+  WORD p = 0, q = 0;
+  unsigned int n;
+  LOAD_REGISTERS;
+
+  if (vm->compactCode == NULL)
+    vm->compactCode = encodeCompact(vm->program->codeBlock);
+  compact = vm->compactCode;
+  bytes = compact->bytes;
+  offset = compact->offset;
+  ip = bytes + offset[pc];
+
+#undef P
+#undef Q
+#undef PC
+#define P               p
+#define Q               q
+#define PC              pc
+#define OPERAND(v)      { n = *ip++; if (n & 0x80) n = readVarint(n, &ip); \
+                          v = (WORD) ((n >> 1) ^ (0u - (n & 1))); }
+
+#define CASE(op)        case op: if (HAS_P(op)) OPERAND(p); if (HAS_Q(op)) OPERAND(q);
+#define NEXT            { pc ++; continue; }
+#define JUMP(addr)      { pc = (addr); ip = bytes + offset[pc]; continue; }
+#define STOP            goto stopped
+#define ENTER_DEBUGGER  goto stopped
+#define NO_SUPERINSTRUCTIONS
+
+  for (;;) {
+    switch (*ip++) {
+#include "vmops.h"
+    default:
+      NEXT;
+    }
+  }
+
+ stopped:
+  SAVE_REGISTERS;
+
+#undef CASE
+#undef NEXT
+#undef JUMP
+#undef STOP
+#undef ENTER_DEBUGGER
+#undef NO_SUPERINSTRUCTIONS
+#undef OPERAND
+#undef P
+#undef Q
+#undef PC
+#define P        (ip->p)
+#define Q        (ip->q)
+#define PC       ((int) (ip - code))
+}
+
+// Executes one instruction
+void runStep(VMContext* vm) {
+  Instruction* code = vm->program->codeBlock->code;
+  Instruction* ip = code + vm->pc;
+  LOAD_REGISTERS;
+
+#define CASE(op)        case op:
+#define NEXT            { ip ++; goto stopped; }
+#define SKIP(n)         { ip += (n); goto stopped; }
+#define JUMP(addr)      { ip = code + (addr); goto stopped; }
+#define STOP            goto stopped
+#define ENTER_DEBUGGER  goto stopped
+
+  switch (ip->op) {
+#include "vmops.h"
+  default:
+    NEXT;
+  }
+
+ stopped:
+  SAVE_REGISTERS;
+
+#undef CASE
+#undef NEXT
+#undef SKIP
+#undef JUMP
+#undef STOP
+#undef ENTER_DEBUGGER
+}
+
+/*
+ * Register code (see regcode.h).  A frame is the same as in the stack
+ * code, and a return address is the stack address of the call, so the
+ * register loops take over from the stack loops, and back, wherever the
+ * register code has a block start.
+ */
+#define A          (ip->a)
+#define B          (ip->b)
+#define C          (ip->c)
+#define R(x)       stack[b + (x)]
+#define START(pc)  start[pc]
+#define ORIGIN     origin[PC]
+
+#define LOAD_REGISTER_CODE                              \
+  RegisterCode* registers = vm->registerCode;           \
+  RegInstruction* code = registers->code;               \
+  RegInstruction* ip = code + registers->start[vm->pc]; \
+  int* start = registers->start;                        \
+  int* origin = registers->origin;                      \
+  CELL* stack = vm->stack;                              \
+  FRAME_LIMITS                                          \
+  int b = vm->b;                                        \
+  WORD* disp = vm->display + vm->level;                 \
+  DisplayLink* link = vm->links + vm->callDepth;        \
+  CELL number
+
+// Every value the stack code would have on the stack is in its register
+#define SAVE_REGISTER_CODE                              \
+  vm->pc = origin[PC];                                  \
+  vm->t = b + registers->height[PC] - 1;                \
+  vm->b = b;                                            \
+  vm->level = disp - vm->display;                       \
+  vm->callDepth = link - vm->links
+
+#define CASE(op)        case op:
+#define NEXT            { ip ++; continue; }
+#define JUMP(addr)      { ip = code + (addr); continue; }
+#define STOP            goto stopped
+#define ENTER_DEBUGGER  goto stopped
+
+void registerLoop(VMContext* vm) {
+  LOAD_REGISTER_CODE;
+
+  for (;;) {
+    switch (ip->op) {
+#include "regops.h"
+    default:
+      NEXT;
+    }
+  }
+
+ stopped:
+  SAVE_REGISTER_CODE;
+}
+
+void countingRegisterLoop(VMContext* vm) {
+  LOAD_REGISTER_CODE;
+  long long count = 0;
+
+  for (;;) {
+    count ++;
+    switch (ip->op) {
+#include "regops.h"
+    default:
+      NEXT;
+    }
+  }
+
+ stopped:
+  SAVE_REGISTER_CODE;
+  vm->instructionCount += count;
+}
+
+#undef CASE
+#undef NEXT
+#undef JUMP
+#undef STOP
+#undef ENTER_DEBUGGER
+#undef A
+#undef B
+#undef C
+#undef R
+#undef START
+#undef ORIGIN
+
+void runRegister(VMContext* vm, int counting) {
+  if (vm->registerCode == NULL)
+    vm->registerCode = translateRegisters(vm->program->codeBlock);
+  if (vm->registerCode == NULL) {
+    runSwitch(vm);
+    return;
+  }
+
+  while ((vm->ps == PS_ACTIVE) && !vm->debugMode) {
+    if (vm->registerCode->start[vm->pc] >= 0) {
+      if (counting)
+	countingRegisterLoop(vm);
+      else registerLoop(vm);
+    } else runStep(vm);
+  }
+}
+
+/*
+ * Compiled code (see jit.c).  The JIT leaves some instructions, such as
+ * OP_BP, to the interpreter: they are stepped through here until the code
+ * reaches an address where the compiled code can be entered again.
+ */
+void runJit(VMContext* vm) {
+  JitState state;
+
+  if (vm->jitCode == NULL)
+    vm->jitCode = compileJit(vm->program->codeBlock, vm->program->frameSize, vm->stackSize);
+  if (vm->jitCode == NULL) {
+    runThreaded(vm);
+    return;
+  }
+
+  while ((vm->ps == PS_ACTIVE) && !vm->debugMode) {
+    if (jitEntry(vm->jitCode, vm->pc)) {
+      state.stack = vm->stack;
+      state.t = vm->t;
+      state.b = vm->b;
+      state.disp = vm->display + vm->level;
+      state.link = vm->links + vm->callDepth;
+      state.pc = vm->pc;
+      state.input = &vm->input;
+      state.output = &vm->output;
+      runJitCode(vm->jitCode, &state);
+      vm->pc = state.pc;
+      vm->t = state.t;
+      vm->b = state.b;
+      vm->level = state.disp - vm->display;
+      vm->callDepth = state.link - vm->links;
+      vm->ps = state.ps;
+      if (vm->ps != PS_ACTIVE) break;
+    }
+    runStep(vm);
+  }
+}
+
+int execute(VMContext* vm, int dispatch) {
+  vm->traceCount = 0;
+  vm->ps = PS_ACTIVE;
+  if ((vm->t < 0) && (vm->program->frameSize[vm->pc] > vm->stackSize))
+    vm->ps = PS_STACK_OVERFLOW;
+#ifdef GUARDED_STACK
+  runningVM = vm;
+  // A loop that ran into the guard comes back here; it has not saved its
+  // registers, but the run is over anyway
+  if (sigsetjmp(vm->overflow, 1))
+    vm->ps = PS_STACK_OVERFLOW;
+#endif
+  while (vm->ps == PS_ACTIVE) {
+    if (vm->debugMode)
+      runDebug(vm);
+    else if (dispatch == DISPATCH_THREADED)
+      runThreaded(vm);
+    else if (dispatch == DISPATCH_COUNTING)
+      runCounting(vm);
+    else if (dispatch == DISPATCH_COMPACT)
+      runCompact(vm);
+    else if (dispatch == DISPATCH_PROFILE)
+      runProfile(vm);
+    else if (dispatch == DISPATCH_SAMPLE)
+      runSampling(vm);
+    else if (dispatch == DISPATCH_CHECKPOINT)
+      runCheckpointing(vm);
+    else if (dispatch == DISPATCH_JIT)
+      runJit(vm);
+    else if (dispatch == DISPATCH_REGISTER)
+      runRegister(vm, 0);
+    else if (dispatch == DISPATCH_REGISTER_COUNTING)
+      runRegister(vm, 1);
+    else runSwitch(vm);
+  }
+#ifdef GUARDED_STACK
+  runningVM = NULL;
+#endif
+  // Whatever the reason the program stopped, its output is complete
+  flushOutput(&vm->output);
+  return vm->ps;
+}
+
+int run(VMContext* vm) {
+//  WINDOW* win = initscr();
+//  nonl();
+//  cbreak();
+//  noecho();
+//  scrollok(win,TRUE);
+
+  execute(vm, vm->dispatchMode);
+  if (vm->pauseAtExit) {
+    printf("\nPress any key to exit...");getch();
+  }
+//  endwin();
+  return vm->ps;
+}
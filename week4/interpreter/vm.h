@@ -1,33 +1,135 @@
-/* 
- * @copyright (c) 2008, Hedspi, Hanoi University of Technology
- * @author Huu-Duc Nguyen
- * @version 1.0
- */
-
-#ifndef __VM_H__
-#define __VM_H__
-
-#include "instructions.h"
-
-#define PS_ACTIVE         0
-#define PS_INACTIVE       1
-#define PS_NORMAL_EXIT    2
-#define PS_IO_ERROR       3
-#define PS_DIVIDE_BY_ZERO 4
-#define PS_STACK_OVERFLOW 5
-
-typedef WORD* Memory;
-
-void printMemory(void);
-void printCodeBuffer(void);
-
-void resetVM(void);
-void initVM(void);
-void cleanVM(void);
-
-int loadExecutable(FILE* f);
-int saveExecutable(FILE* f);
-
-int run(void);
-
-#endif
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __VM_H__
+#define __VM_H__
+
+#include "instructions.h"
+#include "input.h"
+#include "output.h"
+#include "heap.h"
+
+/*
+ * On 64-bit hosts with mmap, the stack is reserved rather than allocated:
+ * memory is only committed where a program actually reaches, and a
+ * region that cannot be accessed follows it, so a frame that does not fit
+ * faults there instead of being checked on every call.
+ */
+#if !defined(_WIN32) && defined(__LP64__)
+#define GUARDED_STACK
+#include <setjmp.h>
+#define DEFAULT_STACK_SIZE (1 << 24)    // cells; 64 or 128 MB of address space
+#else
+#define DEFAULT_STACK_SIZE 2048
+#endif
+
+#define PS_ACTIVE         0
+#define PS_INACTIVE       1
+#define PS_NORMAL_EXIT    2
+#define PS_IO_ERROR       3
+#define PS_DIVIDE_BY_ZERO 4
+#define PS_STACK_OVERFLOW 5
+#define PS_ARITH_OVERFLOW 6     // only with WIDE_CELLS
+#define PS_HEAP_OVERFLOW  7
+#define PS_INVALID_STRING 8     // a string handle that is no string
+
+#define DISPATCH_SWITCH            0
+#define DISPATCH_THREADED          1
+#define DISPATCH_COUNTING          2
+#define DISPATCH_JIT               3
+#define DISPATCH_COMPACT           4
+#define DISPATCH_PROFILE           5
+#define DISPATCH_SAMPLE            6
+#define DISPATCH_REGISTER          7
+#define DISPATCH_REGISTER_COUNTING 8
+#define DISPATCH_CHECKPOINT        9
+
+typedef CELL* Memory;
+
+// Saved on OP_CALL, restored on OP_EP/OP_EF
+struct DisplayLink_ {
+  WORD* display;    // caller's display top
+  WORD base;        // display entry overwritten by the callee
+};
+
+typedef struct DisplayLink_ DisplayLink;
+
+/*
+ * A loaded and verified executable.  Once it has been fused (or not), it
+ * is only read, and any number of contexts can run it at the same time.
+ */
+struct Program_ {
+  CodeBlock* codeBlock;
+  int* frameSize;               // see verifyCode()
+};
+
+typedef struct Program_ Program;
+
+/*
+ * One run of a program: the machine registers, the stack and everything
+ * else the execution loops change.  Contexts share nothing but their
+ * program, so each can run on its own thread.
+ */
+struct VMContext_ {
+  Program* program;
+  struct ThreadedInstruction_* threadedCode;    // decoded on first use
+  struct JitCode_* jitCode;                     // compiled on first use
+  struct CompactCode_* compactCode;             // encoded on first use
+  struct Profile_* profile;                     // for DISPATCH_PROFILE
+  struct Sampler_* sampler;                     // for DISPATCH_SAMPLE
+  struct RegisterCode_* registerCode;           // translated on first use
+  struct Checkpoint_* checkpoint;               // for DISPATCH_CHECKPOINT
+
+  CELL* stack;
+  int stackSize;
+#ifdef GUARDED_STACK
+  char* stackRegion;            // the mapping: stack, then the guard
+  size_t regionSize;
+  sigjmp_buf overflow;          // where a fault in the guard returns to
+#endif
+  int t;
+  int b;
+  int pc;
+  int ps;
+
+  WORD* display;
+  int level;
+  DisplayLink* links;
+  int callDepth;
+  int maxCallDepth;
+
+  int debugMode;
+  int dispatchMode;
+  int pauseAtExit;
+  long long instructionCount;
+  int traceCount;
+  InputChannel input;           // read by OP_RC and OP_RI
+  OutputChannel output;
+  StringHeap heap;              // strings made by OP_CAT
+};
+
+typedef struct VMContext_ VMContext;
+
+Program* loadProgram(FILE* f, int codeSize);
+int saveProgram(Program* program, FILE* f);
+void fuseProgram(Program* program);
+void freeProgram(Program* program);
+void printProgram(Program* program);
+
+// Returns NULL when the stack cannot be reserved
+VMContext* createVM(Program* program, int stackSize);
+void setProgram(VMContext* vm, Program* program);
+void resetVM(VMContext* vm);
+void freeVM(VMContext* vm);
+
+void redirectInput(VMContext* vm, FILE* f);
+void redirectOutput(VMContext* vm, FILE* f);
+void printMemory(VMContext* vm);
+
+int execute(VMContext* vm, int dispatch);
+int run(VMContext* vm);
+
+#endif
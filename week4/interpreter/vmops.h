@@ -0,0 +1,492 @@
+/*
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/*
+ * Opcode handlers of the KPL virtual machine.
+ *
+ * This file is not a normal header: it is included inside the body of
+ * every execution loop in vm.c.  Before including it, the loop defines
+ *
+ *   CASE(op)        start of the handler for op
+ *   NEXT            continue with the following instruction
+ *   SKIP(n)         continue with the instruction n slots ahead
+ *   JUMP(addr)      continue with the instruction at addr
+ *   STOP            leave the loop (vm->ps has been updated)
+ *   ENTER_DEBUGGER  hand control to the debugging loop
+ *   P, Q, PC        operands and address of the current instruction
+ *   BASE(p)         base of the frame p static levels out
+ *
+ * and may define POLL, which runs before every jump and call, where the
+ * frames are consistent; by default it does nothing.  The loop provides
+ * the context vm and the locals stack, t, b and number, plus the display
+ * registers: disp points at the display entry of the current lexical
+ * level, and link at the top of the stack of saved display entries.
+ * FRAME_FITS(base, entry) tells whether the frame of the procedure at
+ * entry fits on the stack from base on, and ADD_OVERFLOWS and the like do
+ * the arithmetic on cells.
+ * Programs read vm->input and write to vm->output.
+ *
+ * A loop that cannot run superinstructions defines NO_SUPERINSTRUCTIONS.
+ *
+ * The code has been checked by verifyCode() when it was loaded, so the
+ * handlers do not check the stack: the only guards are on OP_CALL and
+ * OP_TC, where the whole frame of the callee must fit.  With GUARDED_STACK
+ * that check is the guard region after the stack itself.  The string
+ * instructions check their handles, which the verifier cannot follow.
+ */
+
+#ifndef POLL
+#define POLL
+#define DEFAULT_POLL
+#endif
+
+CASE(OP_LA)
+  t ++;
+  stack[t] = BASE(P) + Q;
+  NEXT;
+
+CASE(OP_LV)
+  t ++;
+  stack[t] = stack[BASE(P) + Q];
+  NEXT;
+
+CASE(OP_LC)
+  t ++;
+  stack[t] = Q;
+  NEXT;
+
+CASE(OP_LI)
+  stack[t] = stack[stack[t]];
+  NEXT;
+
+CASE(OP_INT)
+  t += Q;
+  NEXT;
+
+CASE(OP_DCT)
+  t -= Q;
+  NEXT;
+
+CASE(OP_J)
+  POLL;
+  JUMP(Q);
+
+CASE(OP_FJ)
+  POLL;
+  t --;
+  if (stack[t+1] == FALSE)
+    JUMP(Q);
+  NEXT;
+
+CASE(OP_HL)
+  vm->ps = PS_NORMAL_EXIT;
+  STOP;
+
+CASE(OP_ST)
+  stack[stack[t-1]] = stack[t];
+  t -= 2;
+  NEXT;
+
+CASE(OP_CALL)
+  POLL;
+  if (!FRAME_FITS(t + 1, Q)) {
+    vm->ps = PS_STACK_OVERFLOW;
+    STOP;
+  }
+  stack[t+2] = b;                 // Dynamic Link
+  stack[t+3] = PC;                // Return Address
+  stack[t+4] = BASE(P);           // Static Link
+  b = t + 1;                      // Base & Result
+  link->display = disp;           // The callee sits one level inside
+  disp += 1 - P;                  // the procedure p levels out
+  link->base = *disp;
+  *disp = b;
+  link ++;
+  JUMP(Q);
+
+CASE(OP_EP)
+  t = b - 1;                      // Previous top
+  number = stack[b+2];            // Saved return address
+  b = stack[b+1];                 // Saved base
+  link --;
+  *disp = link->base;
+  disp = link->display;
+  JUMP(number + 1);
+
+CASE(OP_EF)
+  t = b;                          // return value is on the top of the stack
+  number = stack[b+2];            // Saved return address
+  b = stack[b+1];                 // saved base
+  link --;
+  *disp = link->base;
+  disp = link->display;
+  JUMP(number + 1);
+
+CASE(OP_RC)
+  t ++;
+  stack[t] = inputChar(&vm->input);
+  NEXT;
+
+CASE(OP_RI)
+  t ++;
+  stack[t] = inputInt(&vm->input);
+  NEXT;
+
+CASE(OP_WRC)
+  outputChar(&vm->output, stack[t]);
+  t --;
+  NEXT;
+
+CASE(OP_WRI)
+  outputInt(&vm->output, stack[t]);
+  t --;
+  NEXT;
+
+CASE(OP_WLN)
+  outputLn(&vm->output);
+  NEXT;
+
+CASE(OP_AD)
+  t --;
+  if (ADD_OVERFLOWS(stack[t], stack[t], stack[t+1])) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  NEXT;
+
+CASE(OP_SB)
+  t --;
+  if (SUB_OVERFLOWS(stack[t], stack[t], stack[t+1])) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  NEXT;
+
+CASE(OP_ML)
+  t --;
+  if (MUL_OVERFLOWS(stack[t], stack[t], stack[t+1])) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  NEXT;
+
+CASE(OP_DV)
+  t --;
+  if (stack[t+1] == 0) {
+    vm->ps = PS_DIVIDE_BY_ZERO;
+    STOP;
+  }
+  if (DIV_OVERFLOWS(stack[t], stack[t+1])) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  stack[t] /= stack[t+1];
+  NEXT;
+
+CASE(OP_NEG)
+  if (SUB_OVERFLOWS(stack[t], 0, stack[t])) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  NEXT;
+
+CASE(OP_CV)
+  stack[t+1] = stack[t];
+  t ++;
+  NEXT;
+
+CASE(OP_EQ)
+  t --;
+  stack[t] = (stack[t] == stack[t+1]) ? TRUE : FALSE;
+  NEXT;
+
+CASE(OP_NE)
+  t --;
+  stack[t] = (stack[t] != stack[t+1]) ? TRUE : FALSE;
+  NEXT;
+
+CASE(OP_GT)
+  t --;
+  stack[t] = (stack[t] > stack[t+1]) ? TRUE : FALSE;
+  NEXT;
+
+CASE(OP_LT)
+  t --;
+  stack[t] = (stack[t] < stack[t+1]) ? TRUE : FALSE;
+  NEXT;
+
+CASE(OP_GE)
+  t --;
+  stack[t] = (stack[t] >= stack[t+1]) ? TRUE : FALSE;
+  NEXT;
+
+CASE(OP_LE)
+  t --;
+  stack[t] = (stack[t] <= stack[t+1]) ? TRUE : FALSE;
+  NEXT;
+
+CASE(OP_BP)
+  // Just for debugging
+  vm->debugMode = 1;
+  ENTER_DEBUGGER;
+
+/* Doubles and strings: see DOUBLE_SIZE and heap.h */
+
+CASE(OP_LCF)
+  stack[t+1] = vm->program->codeBlock->constants[Q];
+  stack[t+2] = vm->program->codeBlock->constants[Q+1];
+  t += DOUBLE_SIZE;
+  NEXT;
+
+CASE(OP_LVF)
+  number = BASE(P) + Q;
+  stack[t+1] = stack[number];
+  stack[t+2] = stack[number+1];
+  t += DOUBLE_SIZE;
+  NEXT;
+
+CASE(OP_LIF)
+  number = stack[t];
+  stack[t] = stack[number];
+  stack[t+1] = stack[number+1];
+  t ++;
+  NEXT;
+
+CASE(OP_STF)
+  number = stack[t-2];
+  stack[number] = stack[t-1];
+  stack[number+1] = stack[t];
+  t -= 1 + DOUBLE_SIZE;
+  NEXT;
+
+CASE(OP_ITF)
+  putDouble(stack + t, (double) stack[t]);
+  t ++;
+  NEXT;
+
+CASE(OP_ADF)
+  t -= DOUBLE_SIZE;
+  putDouble(stack + t - 1, getDouble(stack + t - 1) + getDouble(stack + t + 1));
+  NEXT;
+
+CASE(OP_SBF)
+  t -= DOUBLE_SIZE;
+  putDouble(stack + t - 1, getDouble(stack + t - 1) - getDouble(stack + t + 1));
+  NEXT;
+
+CASE(OP_MLF)
+  t -= DOUBLE_SIZE;
+  putDouble(stack + t - 1, getDouble(stack + t - 1) * getDouble(stack + t + 1));
+  NEXT;
+
+CASE(OP_DVF)
+  // IEEE division: by zero gives an infinity or a NaN
+  t -= DOUBLE_SIZE;
+  putDouble(stack + t - 1, getDouble(stack + t - 1) / getDouble(stack + t + 1));
+  NEXT;
+
+CASE(OP_NEGF)
+  putDouble(stack + t - 1, - getDouble(stack + t - 1));
+  NEXT;
+
+CASE(OP_EQF)
+  t -= 3;
+  stack[t] = (getDouble(stack + t) == getDouble(stack + t + 2)) ? TRUE : FALSE;
+  NEXT;
+
+CASE(OP_NEF)
+  t -= 3;
+  stack[t] = (getDouble(stack + t) != getDouble(stack + t + 2)) ? TRUE : FALSE;
+  NEXT;
+
+CASE(OP_GTF)
+  t -= 3;
+  stack[t] = (getDouble(stack + t) > getDouble(stack + t + 2)) ? TRUE : FALSE;
+  NEXT;
+
+CASE(OP_LTF)
+  t -= 3;
+  stack[t] = (getDouble(stack + t) < getDouble(stack + t + 2)) ? TRUE : FALSE;
+  NEXT;
+
+CASE(OP_GEF)
+  t -= 3;
+  stack[t] = (getDouble(stack + t) >= getDouble(stack + t + 2)) ? TRUE : FALSE;
+  NEXT;
+
+CASE(OP_LEF)
+  t -= 3;
+  stack[t] = (getDouble(stack + t) <= getDouble(stack + t + 2)) ? TRUE : FALSE;
+  NEXT;
+
+CASE(OP_WRF)
+  outputDouble(&vm->output, getDouble(stack + t - 1));
+  t -= DOUBLE_SIZE;
+  NEXT;
+
+CASE(OP_EFF)
+  number = stack[b+1];            // Saved base
+  stack[b] = stack[b+Q];          // The result takes the place of the
+  stack[b+1] = stack[b+Q+1];      // result word and the dynamic link
+  t = b + 1;
+  b = number;
+  number = stack[t+1];            // Saved return address
+  link --;
+  *disp = link->base;
+  disp = link->display;
+  JUMP(number + 1);
+
+CASE(OP_LS)
+  t ++;
+  stack[t] = Q;                   // Pool strings are known by their index
+  NEXT;
+
+CASE(OP_CAT)
+  if (!validString(&vm->heap, vm->program->codeBlock, stack[t-1])
+      || !validString(&vm->heap, vm->program->codeBlock, stack[t])) {
+    vm->ps = PS_INVALID_STRING;
+    STOP;
+  }
+  if (!concatStrings(&vm->heap, vm->program->codeBlock->constants, stack[t-1], stack[t], &number)) {
+    vm->ps = PS_HEAP_OVERFLOW;
+    STOP;
+  }
+  t --;
+  stack[t] = number;
+  NEXT;
+
+CASE(OP_CMPS)
+  if (!validString(&vm->heap, vm->program->codeBlock, stack[t-1])
+      || !validString(&vm->heap, vm->program->codeBlock, stack[t])) {
+    vm->ps = PS_INVALID_STRING;
+    STOP;
+  }
+  t --;
+  stack[t] = compareStrings(&vm->heap, vm->program->codeBlock->constants, stack[t], stack[t+1]);
+  NEXT;
+
+CASE(OP_WRS)
+  if (!validString(&vm->heap, vm->program->codeBlock, stack[t])) {
+    vm->ps = PS_INVALID_STRING;
+    STOP;
+  }
+  outputString(&vm->output, stringRecord(&vm->heap, vm->program->codeBlock->constants, stack[t]));
+  t --;
+  NEXT;
+
+CASE(OP_TC)
+  POLL;
+  if (!FRAME_FITS(b, Q)) {
+    vm->ps = PS_STACK_OVERFLOW;
+    STOP;
+  }
+  // The links and the display entry stay: the callee is on this level
+  for (number = 0; number < P; number ++)
+    stack[b+4+number] = stack[t-P+1+number];
+  t = b - 1;
+  JUMP(Q);
+
+/* Superinstructions: operands of the later slots are read in place */
+
+#ifndef NO_SUPERINSTRUCTIONS
+
+CASE(OP_LC_AD)
+  if (ADD_OVERFLOWS(stack[t], stack[t], Q)) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  SKIP(2);
+
+CASE(OP_CV_LI)
+  stack[t+1] = stack[stack[t]];
+  t ++;
+  SKIP(2);
+
+CASE(OP_LV_LC)
+  stack[t+1] = stack[BASE(P) + Q];
+  stack[t+2] = ip[1].q;
+  t += 2;
+  SKIP(2);
+
+CASE(OP_LV_LC_AD)
+  t ++;
+  if (ADD_OVERFLOWS(stack[t], stack[BASE(P) + Q], ip[1].q)) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  SKIP(3);
+
+CASE(OP_LA_LC_ST)
+  stack[BASE(P) + Q] = ip[1].q;
+  SKIP(3);
+
+CASE(OP_LA_LV_ST)
+  stack[BASE(P) + Q] = stack[BASE(ip[1].p) + ip[1].q];
+  SKIP(3);
+
+CASE(OP_LC_ML_AD)
+  t --;
+  if (MUL_OVERFLOWS(number, stack[t+1], Q) || ADD_OVERFLOWS(stack[t], stack[t], number)) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  SKIP(3);
+
+CASE(OP_EQ_FJ)
+  POLL;
+  t -= 2;
+  if (stack[t+1] != stack[t+2])
+    JUMP(ip[1].q);
+  SKIP(2);
+
+CASE(OP_NE_FJ)
+  POLL;
+  t -= 2;
+  if (stack[t+1] == stack[t+2])
+    JUMP(ip[1].q);
+  SKIP(2);
+
+CASE(OP_GT_FJ)
+  POLL;
+  t -= 2;
+  if (stack[t+1] <= stack[t+2])
+    JUMP(ip[1].q);
+  SKIP(2);
+
+CASE(OP_LT_FJ)
+  POLL;
+  t -= 2;
+  if (stack[t+1] >= stack[t+2])
+    JUMP(ip[1].q);
+  SKIP(2);
+
+CASE(OP_GE_FJ)
+  POLL;
+  t -= 2;
+  if (stack[t+1] < stack[t+2])
+    JUMP(ip[1].q);
+  SKIP(2);
+
+CASE(OP_LE_FJ)
+  POLL;
+  t -= 2;
+  if (stack[t+1] > stack[t+2])
+    JUMP(ip[1].q);
+  SKIP(2);
+
+CASE(OP_INC)
+  if (ADD_OVERFLOWS(stack[stack[t]], stack[stack[t]], ip[3].q)) {
+    vm->ps = PS_ARITH_OVERFLOW;
+    STOP;
+  }
+  SKIP(6);
+
+#endif
+
+#ifdef DEFAULT_POLL
+#undef POLL
+#undef DEFAULT_POLL
+#endif